@@ -115,6 +115,7 @@
 #include "lgc.h"
 #include "lmem.h"
 #include "lobject.h"
+#include "lprof.h"
 #include "lstate.h"
 #include "lstring.h"
 #include "ltable.h"
@@ -932,7 +933,7 @@ LUA_API void lua_pushvalue(lua_State *L, int idx)
 LUA_API int lua_type(lua_State *L, int idx)
 {
     StkId o = index2adr(L, idx);
-    return (o == luaO_nilobject) ? LUA_TNONE : ttype(o);
+    return (o == luaO_nilobject) ? LUA_TNONE : basetype(o);
 }
 
 /**
@@ -1382,6 +1383,8 @@ LUA_API lua_Integer lua_tointeger(lua_State *L, int idx)
 {
     TValue n;
     const TValue *o = index2adr(L, idx);
+    if (ttisint(o))
+        return cast(lua_Integer, ivalue(o));
     if (tonumber(o, &n)) {
         lua_Integer res;
         lua_Number num = nvalue(o);
@@ -1550,7 +1553,7 @@ LUA_API const char *lua_tolstring(lua_State *L, int idx, size_t *len)
 LUA_API size_t lua_objlen(lua_State *L, int idx)
 {
     StkId o = index2adr(L, idx);
-    switch (ttype(o)) {
+    switch (basetype(o)) {
         case LUA_TSTRING: return tsvalue(o)->len;
         case LUA_TUSERDATA: return uvalue(o)->len;
         case LUA_TTABLE: return luaH_getn(hvalue(o));
@@ -1880,7 +1883,11 @@ LUA_API void lua_pushnumber(lua_State *L, lua_Number n)
 LUA_API void lua_pushinteger(lua_State *L, lua_Integer n)
 {
     lua_lock(L);
-    setnvalue(L->top, cast_num(n));
+    if (cast(lua_Integer, cast_int(n)) == n) {
+        setivalue(L->top, cast_int(n));  /* ipairs、table库等的下标 */
+    } else {
+        setnvalue(L->top, cast_num(n));
+    }
     api_incr_top(L);
     lua_unlock(L);
 }
@@ -2610,6 +2617,72 @@ LUA_API void lua_createtable(lua_State *L, int narray, int nrec)
     lua_unlock(L);
 }
 
+/**
+ * @brief 清空表，保留已分配的内存
+ *
+ * @param L Lua状态机指针
+ * @param idx 表的栈索引
+ *
+ * @see luaH_clear
+ */
+LUA_API void lua_cleartable(lua_State *L, int idx)
+{
+    StkId t;
+    lua_lock(L);
+    t = index2adr(L, idx);
+    api_check(L, ttistable(t));
+    luaH_clear(L, hvalue(t));
+    lua_unlock(L);
+}
+
+/**
+ * @brief 复制整数键区间：a2[t..t+e-f] = a1[f..e]
+ *
+ * @param L Lua状态机指针
+ * @param idx1 源表a1的栈索引
+ * @param f 源区间起点
+ * @param e 源区间终点，小于f时什么也不做
+ * @param t 目标区间起点
+ * @param idx2 目标表a2的栈索引
+ *
+ * @see luaH_move
+ */
+LUA_API void lua_movetable(lua_State *L, int idx1, int f, int e, int t,
+                           int idx2)
+{
+    StkId a1, a2;
+    lua_lock(L);
+    a1 = index2adr(L, idx1);
+    a2 = index2adr(L, idx2);
+    api_check(L, ttistable(a1) && ttistable(a2));
+    if (f <= e) {
+        luaH_move(L, hvalue(a1), f, e, t, hvalue(a2));
+    }
+    lua_unlock(L);
+}
+
+/**
+ * @brief 用<直接排序表的t[1..n]
+ *
+ * @param L Lua状态机指针
+ * @param idx 表的栈索引
+ * @param n 元素个数
+ * @return 排好了返回1，不适用时返回0
+ *
+ * @see luaH_sort
+ */
+LUA_API int lua_sortarray(lua_State *L, int idx, int n)
+{
+    StkId t;
+    int res;
+    lua_lock(L);
+    t = index2adr(L, idx);
+    api_check(L, ttistable(t));
+    res = luaH_sort(L, hvalue(t), n);
+    lua_unlock(L);
+    return res;
+}
+
 /**
  * @brief 获取对象的元表
  *
@@ -2669,7 +2742,7 @@ LUA_API int lua_getmetatable(lua_State *L, int objindex)
             mt = uvalue(obj)->metatable;
             break;
         default:
-            mt = G(L)->mt[ttype(obj)];
+            mt = G(L)->mt[basetype(obj)];
             break;
     }
     if (mt == NULL)
@@ -2792,7 +2865,7 @@ LUA_API int lua_setmetatable (lua_State *L, int objindex) {
       break;
     }
     default: {
-      G(L)->mt[ttype(obj)] = mt;
+      G(L)->mt[basetype(obj)] = mt;
       break;
     }
   }
@@ -3257,6 +3330,7 @@ LUA_API int lua_load(lua_State *L, lua_Reader reader, void *data,
  *
  * @note 只能转储Lua函数，不能转储C函数
  * @note 字节码是平台和版本相关的
+ * @note 超级指令还原为原始操作码，输出可由标准Lua 5.1加载
  * @note 栈顶必须是Lua函数
  *
  * @since C89
@@ -3277,6 +3351,27 @@ LUA_API int lua_dump(lua_State *L, lua_Writer writer, void *data)
     return status;
 }
 
+/**
+ * @brief 输出堆分析报告
+ *
+ * 详细说明：
+ * 按火焰图的folded格式逐行调用writer，每行"调用栈 字节数"。what为0
+ * 时输出仍然存活的采样内存，为1时输出累计分配量。堆分析器未开启时
+ * 什么都不输出。
+ *
+ * @return writer返回的第一个非0值，全部成功时为0
+ *
+ * @see lua_Writer, LUA_GCHEAPPROF, luaR_dump
+ */
+LUA_API int lua_heapdump(lua_State *L, lua_Writer writer, void *data, int what)
+{
+    int status;
+    lua_lock(L);
+    status = luaR_dump(L, writer, data, what);
+    lua_unlock(L);
+    return status;
+}
+
 /**
  * @brief 获取线程状态
  *
@@ -3383,6 +3478,36 @@ LUA_API int lua_status(lua_State *L)
  * - 值越大，每次回收越多
  * - 返回之前的设置值
  *
+ * LUA_GCGEN / LUA_GCINC：
+ * - 切换到分代模式或增量模式
+ * - LUA_GCGEN的data大于0时设置次要回收间隔（百分比）
+ * - 返回之前的模式
+ *
+ * LUA_GCPARMARK：
+ * - 设置并行标记的辅助线程数，0关闭，负数只查询
+ * - 返回之前的线程数；未启用LUA_USE_PARMARK时什么都不做，返回0
+ *
+ * LUA_GCBGFREE：
+ * - data大于0时启动后台释放线程，0时结束它，负数只查询
+ * - 返回之前的状态；未启用LUA_USE_BGFREE时什么都不做，返回0
+ *
+ * LUA_GCSLABSIZE / LUA_GCSLABUSED / LUA_GCSLABFREE：
+ * - 查询内存池第data个大小类的块大小、使用中的块数和空闲块数
+ * - 没有这个大小类或不使用内存池时返回0
+ *
+ * LUA_GCSETBUDGET：
+ * - 设置增量模式下每次步进的时间预算（微秒），0恢复按工作量步进，
+ *   负数只查询
+ * - 返回之前的预算
+ *
+ * LUA_GCMAXSTEP：
+ * - 返回上次查询以来最长一次步进的耗时（微秒），然后清零
+ *
+ * LUA_GCHEAPPROF：
+ * - data大于0时以data字节为平均采样间隔开启（或调整）堆分析器，
+ *   0时关闭并丢弃数据，负数只查询
+ * - 返回之前的采样间隔，未开启时为0
+ *
  * 性能调优：
  * - pause参数：控制回收频率，影响内存使用
  * - stepmul参数：控制回收强度，影响CPU使用
@@ -3465,12 +3590,116 @@ LUA_API int lua_gc(lua_State *L, int what, int data)
             g->gcstepmul = data;
             break;
         }
+        case LUA_GCGEN: {
+            res = isgenerational(g) ? LUA_GCGEN : LUA_GCINC;
+            if (data > 0)
+                g->genminormul = data;
+            luaC_changemode(L, KGC_GEN);
+            break;
+        }
+        case LUA_GCINC: {
+            res = isgenerational(g) ? LUA_GCGEN : LUA_GCINC;
+            luaC_changemode(L, KGC_INC);
+            break;
+        }
+        case LUA_GCPARMARK: {
+#if defined(LUA_USE_PARMARK)
+            res = luaC_parmark(L, data);
+#else
+            res = 0;
+#endif
+            break;
+        }
+        case LUA_GCBGFREE: {
+#if defined(LUA_USE_BGFREE)
+            res = luaM_bgfree(L, data);
+#else
+            res = 0;
+#endif
+            break;
+        }
+        case LUA_GCSETBUDGET: {
+            res = g->gcbudget;
+            if (data >= 0)
+                g->gcbudget = data;
+            break;
+        }
+        case LUA_GCMAXSTEP: {
+            res = (g->gcmaxstep > (lu_mem)MAX_INT) ? MAX_INT
+                                                   : cast_int(g->gcmaxstep);
+            g->gcmaxstep = 0;
+            if (data != 0)
+                g->gcstats = (data > 0);
+            break;
+        }
+        case LUA_GCHEAPPROF: {
+            res = luaR_heapprof(L, data);
+            break;
+        }
+        case LUA_GCSLABSIZE:
+        case LUA_GCSLABUSED:
+        case LUA_GCSLABFREE: {
+#if defined(LUA_USE_SLAB)
+            res = luaM_slabstat(L, what, data);
+#else
+            res = 0;
+#endif
+            break;
+        }
         default: res = -1;
     }
     lua_unlock(L);
     return res;
 }
 
+
+/**
+ * @brief JIT控制函数
+ *
+ * 读写global_State中的JIT参数；未启用LUA_USE_JIT时所有操作返回-1。
+ *
+ * @see lua_jit
+ */
+LUA_API int lua_jit(lua_State *L, int what, int data)
+{
+#if defined(LUA_USE_JIT)
+    int res;
+    global_State *g;
+    lua_lock(L);
+    g = G(L);
+    switch (what) {
+        case LUA_JITOFF: {
+            res = g->jiton;
+            g->jiton = 0;
+            break;
+        }
+        case LUA_JITON: {
+            res = g->jiton;
+            g->jiton = 1;
+            break;
+        }
+        case LUA_JITHOT: {
+            res = g->jithot;
+            if (data > 0)
+                g->jithot = data;
+            break;
+        }
+        case LUA_JITCOUNT: {
+            res = g->jitcount;
+            break;
+        }
+        default: res = -1;
+    }
+    lua_unlock(L);
+    return res;
+#else
+    UNUSED(L);
+    UNUSED(what);
+    UNUSED(data);
+    return -1;
+#endif
+}
+
 /** @} */
 
 
@@ -3847,12 +4076,14 @@ LUA_API void *lua_newuserdata(lua_State *L, size_t size)
  * @param fi 函数在栈中的位置
  * @param n 上值索引（从1开始）
  * @param val 用于返回上值指针
+ * @param owner 用于返回保存该值的对象（C闭包或UpVal），写屏障针对它
  * @return 上值名称，失败时返回NULL
  *
  * @since C89
  * @see lua_getupvalue, lua_setupvalue
  */
-static const char *aux_upvalue(StkId fi, int n, TValue **val)
+static const char *aux_upvalue(StkId fi, int n, TValue **val,
+                               GCObject **owner)
 {
     Closure *f;
     if (!ttisfunction(fi)) return NULL;
@@ -3860,12 +4091,14 @@ static const char *aux_upvalue(StkId fi, int n, TValue **val)
     if (f->c.isC) {
         if (!(1 <= n && n <= f->c.nupvalues)) return NULL;
         *val = &f->c.upvalue[n-1];
+        *owner = obj2gco(f);
         return "";
     }
     else {
         Proto *p = f->l.p;
         if (!(1 <= n && n <= p->sizeupvalues)) return NULL;
         *val = f->l.upvals[n-1]->v;
+        *owner = obj2gco(f->l.upvals[n-1]);
         return getstr(p->upvalues[n-1]);
     }
 }
@@ -3920,11 +4153,13 @@ LUA_API const char *lua_getupvalue(lua_State *L, int funcindex, int n)
 {
     const char *name;
     TValue *val;
+    GCObject *owner;
     lua_lock(L);
-    name = aux_upvalue(index2adr(L, funcindex), n, &val);
+    name = aux_upvalue(index2adr(L, funcindex), n, &val, &owner);
     if (name) {
         setobj2s(L, L->top, val);
         api_incr_top(L);
+        luaS_flatobj(L, L->top - 1);    // Lua闭包的上值可能是rope
     }
     lua_unlock(L);
     return name;
@@ -3985,15 +4220,16 @@ LUA_API const char *lua_setupvalue(lua_State *L, int funcindex, int n)
 {
     const char *name;
     TValue *val;
+    GCObject *owner;
     StkId fi;
     lua_lock(L);
     fi = index2adr(L, funcindex);
     api_checknelems(L, 1);
-    name = aux_upvalue(fi, n, &val);
+    name = aux_upvalue(fi, n, &val, &owner);
     if (name) {
         L->top--;
         setobj(L, val, L->top);
-        luaC_barrier(L, clvalue(fi), L->top);
+        luaC_barrier(L, owner, L->top);
     }
     lua_unlock(L);
     return name;
@@ -781,6 +781,90 @@ LUALIB_API const char *luaL_findtable(lua_State *L, int idx,
 */
 
 
+#if defined(LUA_USE_GROWBUFFER)
+
+/*
+** LUA_USE_GROWBUFFER：内容先写在结构体自带的buffer中；放不下时改用一个
+** 用户数据作为存储区，每次不够时按两倍（至少够用）换一个更大的，旧的
+** 留给回收器。这个用户数据在栈顶（luaL_addvalue执行期间在待加入的值
+** 之上），lvl为1。出错时存储区随栈一起被回收，不需要额外的清理。
+*/
+#define bufflen(B)      ((size_t)((B)->p - (B)->b))
+#define buffonstack(B)  ((B)->lvl != 0)
+
+
+LUALIB_API char *luaL_prepbuffsize(luaL_Buffer *B, size_t sz) {
+    size_t len = bufflen(B);
+    if (B->size - len < sz) {  /* 空间不够？ */
+        lua_State *L = B->L;
+        char *newbuff;
+        size_t newsize = B->size * 2;
+        if (newsize - len < sz) {
+            newsize = len + sz;
+        }
+        if (newsize < len || newsize - len < sz) {
+            luaL_error(L, "buffer too large");
+        }
+        newbuff = (char *)lua_newuserdata(L, newsize);
+        memcpy(newbuff, B->b, len);
+        if (buffonstack(B)) {
+            lua_remove(L, -2);  /* 移除旧的存储区 */
+        }
+        B->b = newbuff;
+        B->p = newbuff + len;
+        B->size = newsize;
+        B->lvl = 1;
+    }
+    return B->p;
+}
+
+
+LUALIB_API char *luaL_prepbuffer(luaL_Buffer *B) {
+    return luaL_prepbuffsize(B, LUAL_BUFFERSIZE);
+}
+
+LUALIB_API void luaL_addlstring(luaL_Buffer *B, const char *s, size_t l) {
+    if (l > 0) {
+        memcpy(luaL_prepbuffsize(B, l), s, l);
+        luaL_addsize(B, l);
+    }
+}
+
+LUALIB_API void luaL_pushresult(luaL_Buffer *B) {
+    lua_State *L = B->L;
+    lua_pushlstring(L, B->b, bufflen(B));
+    if (buffonstack(B)) {
+        lua_remove(L, -2);  /* 移除存储区 */
+    }
+    B->lvl = 0;
+}
+
+LUALIB_API void luaL_addvalue(luaL_Buffer *B) {
+    lua_State *L = B->L;
+    size_t vl;
+    const char *s = lua_tolstring(L, -1, &vl);
+    if (buffonstack(B)) {
+        lua_insert(L, -2);  /* 值放到存储区下面 */
+    }
+    luaL_addlstring(B, s, vl);
+    lua_remove(L, buffonstack(B) ? -2 : -1);  /* 移除值 */
+}
+
+LUALIB_API void luaL_buffinit(lua_State *L, luaL_Buffer *B) {
+    B->L = L;
+    B->b = B->p = B->buffer;
+    B->size = LUAL_BUFFERSIZE;
+    B->lvl = 0;
+}
+
+LUALIB_API char *luaL_buffinitsize(lua_State *L, luaL_Buffer *B, size_t sz) {
+    luaL_buffinit(L, B);
+    return luaL_prepbuffsize(B, sz);
+}
+
+
+#else
+
 #define bufflen(B)     ((B)->p - (B)->buffer)
 #define bufffree(B)     ((size_t)(LUAL_BUFFERSIZE - bufflen(B)))
 #define LIMIT           (LUA_MINSTACK/2)
@@ -830,10 +914,6 @@ LUALIB_API void luaL_addlstring(luaL_Buffer *B, const char *s, size_t l) {
     }
 }
 
-LUALIB_API void luaL_addstring(luaL_Buffer *B, const char *s) {
-    luaL_addlstring(B, s, strlen(s));
-}
-
 LUALIB_API void luaL_pushresult(luaL_Buffer *B) {
     emptybuffer(B);
     lua_concat(B->L, B->lvl);
@@ -864,6 +944,12 @@ LUALIB_API void luaL_buffinit(lua_State *L, luaL_Buffer *B) {
 }
 
 
+#endif
+
+LUALIB_API void luaL_addstring(luaL_Buffer *B, const char *s) {
+    luaL_addlstring(B, s, strlen(s));
+}
+
 LUALIB_API int luaL_ref(lua_State *L, int t) {
     int ref;
     t = abs_index(L, t);
@@ -1025,7 +1111,7 @@ static int panic(lua_State *L) {
 }
 
 LUALIB_API lua_State *luaL_newstate(void) {
-    lua_State *L = lua_newstate(l_alloc, NULL);
+    lua_State *L = lua_newslabstate(l_alloc, NULL);
     if (L) {
         lua_atpanic(L, &panic);
     }
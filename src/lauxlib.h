@@ -1774,7 +1774,8 @@ LUALIB_API int (luaL_loadstring) (lua_State *L, const char *s);
  *
  * 详细说明：
  * 创建一个新的Lua状态机，使用标准的内存分配器。
- * 这是luaL_newstate的便利版本。
+ * 这是luaL_newstate的便利版本。启用LUA_USE_SLAB时小内存块由
+ * 状态机自己的内存池分配（见lua_newslabstate）。
  *
  * @return 新的Lua状态机指针
  * @retval 非NULL 成功创建的状态机
@@ -1782,7 +1783,7 @@ LUALIB_API int (luaL_loadstring) (lua_State *L, const char *s);
  *
  * @note 新状态机不包含标准库，需要手动加载
  * @since C89
- * @see lua_newstate(), lua_close()
+ * @see lua_newstate(), lua_newslabstate(), lua_close()
  */
 LUALIB_API lua_State *(luaL_newstate) (void);
 
@@ -2194,20 +2195,38 @@ LUALIB_API const char *(luaL_findtable) (lua_State *L, int idx,
  *
  * 详细说明：
  * luaL_Buffer提供了一个高效的字符串构建机制，避免了频繁的
- * 内存分配和字符串连接操作。它使用内部缓冲区和Lua栈来
- * 管理字符串片段。
+ * 内存分配和字符串连接操作。有两种工作方式，由luaconf.h中的
+ * LUA_USE_GROWBUFFER选择。
  *
  * 结构体成员：
  * - p: 当前写入位置指针
- * - lvl: 栈中字符串片段的数量
+ * - lvl: 栈中字符串片段的数量；LUA_USE_GROWBUFFER下为存储区是否
+ *   在栈上（1或0）
  * - L: 关联的Lua状态机
+ * - b: 当前存储区（buffer或栈上的用户数据），仅LUA_USE_GROWBUFFER
+ * - size: 存储区容量，仅LUA_USE_GROWBUFFER
  * - buffer: 内部缓冲区
  *
- * 工作原理：
+ * 工作原理（默认）：
  * 1. 小的字符串片段写入内部缓冲区
  * 2. 缓冲区满时，内容推入Lua栈
  * 3. 最终合并所有片段为完整字符串
  *
+ * 工作原理（LUA_USE_GROWBUFFER）：
+ * 1. 内容先写入内部缓冲区
+ * 2. 放不下时换成栈顶的一个用户数据，以后每次不够时容量加倍，
+ *    不再把字符串片段压栈再连接
+ * 3. luaL_pushresult用存储区的内容创建结果字符串并移除存储区
+ * 4. 事先知道大致长度时可用luaL_buffinitsize或luaL_prepbuffsize
+ *    预留容量，省去中间的加倍
+ *
+ * 二进制兼容性：
+ * LUA_USE_GROWBUFFER在buffer之前加入b和size两个成员，luaL_addchar
+ * 也改为检查b+size。按标准布局编译的C模块在自己的栈上只留出较小的
+ * 结构体，luaL_buffinit会写出界，其luaL_addchar在内容移到用户数据后
+ * 也会越界写入。因此打开这个选项时，所有C模块都必须用同一个
+ * luaconf.h重新编译；默认布局与标准Lua 5.1相同。
+ *
  * 使用模式：
  * @code
  * luaL_Buffer b;
@@ -2219,9 +2238,8 @@ LUALIB_API const char *(luaL_findtable) (lua_State *L, int idx,
  * @endcode
  *
  * 性能优势：
- * - 减少内存分配次数
- * - 避免中间字符串的创建
- * - 利用Lua的字符串内部化机制
+ * - 减少内存分配次数（LUA_USE_GROWBUFFER下长度为n的结果只需
+ *   O(log n)次扩容，且不创建中间字符串）
  * - 支持任意长度的字符串构建
  *
  * @since C89
@@ -2231,6 +2249,10 @@ typedef struct luaL_Buffer {
     char *p;                        /**< 当前写入位置指针 */
     int lvl;                        /**< 栈中字符串片段数量 */
     lua_State *L;                   /**< 关联的Lua状态机 */
+#if defined(LUA_USE_GROWBUFFER)
+    char *b;                        /**< 当前存储区 */
+    size_t size;                    /**< 存储区容量 */
+#endif
     char buffer[LUAL_BUFFERSIZE];   /**< 内部缓冲区 */
 } luaL_Buffer;
 
@@ -2240,7 +2262,8 @@ typedef struct luaL_Buffer {
  * 详细说明：
  * 高效地向缓冲区添加单个字符。这是缓冲区系统中最基础的操作，
  * 针对单字符添加进行了优化。如果缓冲区已满，会自动调用
- * luaL_prepbuffer进行扩展，确保操作总是成功。
+ * luaL_prepbuffer（LUA_USE_GROWBUFFER下为luaL_prepbuffsize）进行
+ * 扩展，确保操作总是成功。
  *
  * 实现细节：
  * - 首先检查缓冲区是否有足够空间（边界检查）
@@ -2257,7 +2280,8 @@ typedef struct luaL_Buffer {
  * 内存管理：
  * - 自动处理缓冲区扩展
  * - 无需手动内存分配
- * - 缓冲区满时内容推入Lua栈
+ * - 缓冲区满时内容推入Lua栈（LUA_USE_GROWBUFFER下换成容量加倍的
+ *   存储区）
  * - 利用Lua的垃圾回收机制
  *
  * 错误处理：
@@ -2361,9 +2385,15 @@ typedef struct luaL_Buffer {
  * @since C89
  * @see luaL_prepbuffer(), luaL_addstring(), luaL_addlstring(), luaL_buffinit()
  */
+#if defined(LUA_USE_GROWBUFFER)
+#define luaL_addchar(B,c) \
+    ((void)((B)->p < ((B)->b+(B)->size) || luaL_prepbuffsize(B, 1)), \
+     (*(B)->p++ = (char)(c)))
+#else
 #define luaL_addchar(B,c) \
     ((void)((B)->p < ((B)->buffer+LUAL_BUFFERSIZE) || luaL_prepbuffer(B)), \
      (*(B)->p++ = (char)(c)))
+#endif
 
 /**
  * @brief 向缓冲区添加字符（兼容性宏）
@@ -2428,7 +2458,8 @@ LUALIB_API void (luaL_buffinit) (lua_State *L, luaL_Buffer *B);
  *
  * 详细说明：
  * 确保缓冲区有足够的空间进行写入。如果当前缓冲区已满，
- * 会将内容推入Lua栈并重置缓冲区。
+ * 会将内容推入Lua栈并重置缓冲区。LUA_USE_GROWBUFFER下
+ * 等价于luaL_prepbuffsize(B, LUAL_BUFFERSIZE)。
  *
  * 空间管理：
  * - 检查当前缓冲区剩余空间
@@ -2447,6 +2478,45 @@ LUALIB_API void (luaL_buffinit) (lua_State *L, luaL_Buffer *B);
  */
 LUALIB_API char *(luaL_prepbuffer) (luaL_Buffer *B);
 
+#if defined(LUA_USE_GROWBUFFER)
+/**
+ * @brief 初始化字符串缓冲区并预留容量
+ *
+ * 详细说明：
+ * 相当于luaL_buffinit后调用luaL_prepbuffsize(B, sz)。结果长度事先
+ * 大致已知时使用，整个构建过程只分配一次存储区。
+ *
+ * @param[in] L Lua状态机指针，不能为NULL
+ * @param[out] B 要初始化的缓冲区，不能为NULL
+ * @param[in] sz 预留的字节数
+ *
+ * @return 可写入的位置，其后至少有sz字节
+ * @note 仅在定义LUA_USE_GROWBUFFER时提供
+ * @see luaL_buffinit(), luaL_prepbuffsize()
+ */
+LUALIB_API char *(luaL_buffinitsize) (lua_State *L, luaL_Buffer *B, size_t sz);
+
+/**
+ * @brief 预留缓冲区空间
+ *
+ * 详细说明：
+ * 保证当前写入位置之后至少有sz字节可写，返回写入位置。空间不足时
+ * 换成一个更大的存储区（至少是原来的两倍），已写入的内容随之复制。
+ * 写入后用luaL_addsize提交实际写入的字节数。
+ *
+ * @param[in,out] B 缓冲区指针，不能为NULL
+ * @param[in] sz 需要的字节数
+ *
+ * @return 可写入的位置
+ *
+ * @note 存储区可能变化，之前取得的写入位置随之失效
+ * @note 总长度超出size_t时抛出"buffer too large"错误
+ * @note 仅在定义LUA_USE_GROWBUFFER时提供
+ * @see luaL_prepbuffer(), luaL_addsize(), luaL_buffinitsize()
+ */
+LUALIB_API char *(luaL_prepbuffsize) (luaL_Buffer *B, size_t sz);
+#endif
+
 /**
  * @brief 向缓冲区添加指定长度的字符串
  *
@@ -2506,6 +2576,9 @@ LUALIB_API void (luaL_addvalue) (luaL_Buffer *B);
  * - 将最终结果推入栈顶
  * - 清理中间数据
  *
+ * LUA_USE_GROWBUFFER下只用存储区的全部内容创建一个字符串（只复制
+ * 一次），然后从栈上移除用户数据存储区（如果有）。
+ *
  * @param[in,out] B 缓冲区指针，不能为NULL
  *
  * @note 栈增长1个位置（最终字符串）
@@ -725,10 +725,21 @@ static int luaB_gcinfo (lua_State *L) {
  * - "step"：执行一步增量垃圾回收
  * - "setpause"：设置垃圾回收暂停参数
  * - "setstepmul"：设置垃圾回收步长倍数
+ * - "generational"：切换到分代模式，参数2为次要回收间隔（可选）
+ * - "incremental"：切换到增量模式
+ * - "parmark"：设置并行标记的辅助线程数（0关闭），返回之前的线程数
+ * - "bgfree"：开关清扫阶段的后台释放（1开启，0关闭），返回之前的状态
+ * - "slab"：返回内存池各大小类的统计，数组元素为{size, used, free}表
+ * - "setbudget"：设置每次步进的时间预算（微秒，0关闭），返回之前的预算
+ * - "maxstep"：返回上次查询以来最长一次步进的耗时（微秒），参数2为1时
+ *   开始统计没有时间预算的步进，为-1时停止
+ * - "heapprof"：开启堆分析器，参数2为平均采样间隔（字节，默认
+ *   LUAI_PROFINTERVAL，0关闭），返回之前的间隔；报告见debug.heapdump
  *
  * 返回值说明：
  * - "count"：返回精确的内存使用量（KB）
  * - "step"：返回布尔值（是否完成一个回收周期）
+ * - "generational"/"incremental"：返回之前的模式名
  * - 其他：返回操作相关的数值
  *
  * 性能调优：
@@ -750,11 +761,16 @@ static int luaB_gcinfo (lua_State *L) {
  */
 static int luaB_collectgarbage (lua_State *L) {
     static const char *const opts[] = {"stop", "restart", "collect",
-        "count", "step", "setpause", "setstepmul", NULL};
+        "count", "step", "setpause", "setstepmul", "generational",
+        "incremental", "parmark", "bgfree", "slab", "setbudget",
+        "maxstep", "heapprof", NULL};
     static const int optsnum[] = {LUA_GCSTOP, LUA_GCRESTART, LUA_GCCOLLECT,
-        LUA_GCCOUNT, LUA_GCSTEP, LUA_GCSETPAUSE, LUA_GCSETSTEPMUL};
+        LUA_GCCOUNT, LUA_GCSTEP, LUA_GCSETPAUSE, LUA_GCSETSTEPMUL,
+        LUA_GCGEN, LUA_GCINC, LUA_GCPARMARK, LUA_GCBGFREE, LUA_GCSLABSIZE,
+        LUA_GCSETBUDGET, LUA_GCMAXSTEP, LUA_GCHEAPPROF};
     int o = luaL_checkoption(L, 1, "collect", opts);
-    int ex = luaL_optint(L, 2, 0);
+    int ex = luaL_optint(L, 2,
+        optsnum[o] == LUA_GCHEAPPROF ? LUAI_PROFINTERVAL : 0);
     int res = lua_gc(L, optsnum[o], ex);
     switch (optsnum[o]) {
         case LUA_GCCOUNT: {
@@ -766,6 +782,26 @@ static int luaB_collectgarbage (lua_State *L) {
             lua_pushboolean(L, res);
             return 1;
         }
+        case LUA_GCGEN:
+        case LUA_GCINC: {
+            lua_pushstring(L, res == LUA_GCGEN ? "generational" : "incremental");
+            return 1;
+        }
+        case LUA_GCSLABSIZE: {
+            int k;
+            lua_newtable(L);
+            for (k = 0; (res = lua_gc(L, LUA_GCSLABSIZE, k)) > 0; k++) {
+                lua_createtable(L, 0, 3);
+                lua_pushinteger(L, res);
+                lua_setfield(L, -2, "size");
+                lua_pushinteger(L, lua_gc(L, LUA_GCSLABUSED, k));
+                lua_setfield(L, -2, "used");
+                lua_pushinteger(L, lua_gc(L, LUA_GCSLABFREE, k));
+                lua_setfield(L, -2, "free");
+                lua_rawseti(L, -2, k + 1);
+            }
+            return 1;
+        }
         default: {
             lua_pushnumber(L, res);
             return 1;
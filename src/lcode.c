@@ -1060,7 +1060,7 @@ int luaK_stringK (FuncState *fs, TString *s) {
  */
 int luaK_numberK (FuncState *fs, lua_Number r) {
     TValue o;
-    setnvalue(&o, r);
+    setnumvalue(&o, r);  /* 整数常量使用整数子类型 */
     return addk(fs, &o, &o);
 }
 
@@ -3027,5 +3027,57 @@ void luaK_setlist (FuncState *fs, int base, int nelems, int tostore) {
     fs->freereg = base + 1;  /* 释放包含列表值的寄存器 */
 }
 
+
+/**
+ * @brief 窥孔优化：把常见指令对融合为超级指令
+ *
+ * 详细说明：
+ * 在函数的代码全部生成之后（close_func和加载字节码时）扫描一遍，
+ * 对luaP_fusedops中列出的指令对，把第一条指令的操作码改写为对应的
+ * 融合指令，操作数和第二条指令都不变。因此这一遍不移动任何指令，
+ * 跳转偏移、行号表和调试信息无需修正。
+ *
+ * 不在luaK_code中即时融合：代码生成器会在指令发出后回头修改它
+ * （重定位A寄存器、回填跳转），融合必须等这些都结束之后进行。
+ *
+ * 规则：
+ * - 已经作为第二条指令使用的位置不再作为下一对的第一条，
+ *   保证每条融合指令后面紧跟的都是原始操作码
+ * - 跳过SETLIST的计数数据字和CLOSURE后面的上值伪指令
+ * - 已融合的代码（例如加载的字节码）保持不变
+ *
+ * @param f 函数原型
+ *
+ * @see luaP_fusedops, luaV_execute
+ */
+void luaK_fuse (Proto *f) {
+    int pc;
+    for (pc = 0; pc + 1 < f->sizecode; pc++) {
+        Instruction i = f->code[pc];
+        OpCode o1 = GET_OPCODE(i);
+        OpCode o2 = GET_OPCODE(f->code[pc + 1]);
+        int k;
+        if (isfusedop(o1)) {
+            pc++;  /* 保留它的第二条指令 */
+            continue;
+        }
+        if (o1 == OP_SETLIST && GETARG_C(i) == 0) {
+            pc++;  /* 跳过计数数据字 */
+            continue;
+        }
+        if (o1 == OP_CLOSURE) {
+            pc += f->p[GETARG_Bx(i)]->nups;  /* 跳过上值伪指令 */
+            continue;
+        }
+        for (k = 0; k < NUM_OPCODES - NUM_STOCKOPCODES; k++) {
+            if (luaP_fusedops[k][0] == o1 && luaP_fusedops[k][1] == o2) {
+                SET_OPCODE(f->code[pc], cast(OpCode, NUM_STOCKOPCODES + k));
+                pc++;
+                break;
+            }
+        }
+    }
+}
+
 /** @} */ /* 结束代码生成基础设施文档组 */
 
@@ -553,4 +553,14 @@ LUAI_FUNC void luaK_posfix(FuncState *fs, BinOpr op, expdesc *v1, expdesc *v2);
  */
 LUAI_FUNC void luaK_setlist(FuncState *fs, int base, int nelems, int tostore);
 
+/**
+ * @brief 把常见指令对融合为超级指令
+ *
+ * 在函数原型的代码生成（或加载）完成后调用，只改写指令对中第一条
+ * 指令的操作码，不移动任何指令。
+ *
+ * @param f 函数原型
+ */
+LUAI_FUNC void luaK_fuse(Proto *f);
+
 #endif
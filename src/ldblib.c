@@ -947,6 +947,42 @@ static int db_setupvalue(lua_State *L) {
     return auxupvalue(L, 0);
 }
 
+/**
+ * @brief lua_heapdump的写入器：把报告追加到字符串缓冲区
+ */
+static int heapwriter(lua_State *L, const void *b, size_t size, void *B) {
+    (void)L;
+    luaL_addlstring((luaL_Buffer *)B, (const char *)b, size);
+    return 0;
+}
+
+/**
+ * @brief 堆分析报告：debug.heapdump([what])
+ *
+ * 详细说明：
+ * 返回堆分析器（collectgarbage("heapprof", n)开启）的报告字符串，
+ * 火焰图folded格式，每行"调用栈 字节数"。what为"live"（默认）时
+ * 统计仍然存活的采样内存，用于查找泄漏；为"alloc"时统计累计分配量。
+ * 分析器未开启时返回空字符串。
+ *
+ * @example
+ * collectgarbage("heapprof", 64 * 1024)
+ * ...
+ * io.open("heap.folded", "w"):write(debug.heapdump())
+ * -- flamegraph.pl heap.folded > heap.svg
+ *
+ * @see lua_heapdump()
+ */
+static int db_heapdump(lua_State *L) {
+    static const char *const opts[] = {"live", "alloc", NULL};
+    int what = luaL_checkoption(L, 1, "live", opts);
+    luaL_Buffer b;
+    luaL_buffinit(L, &b);
+    lua_heapdump(L, heapwriter, &b, what);
+    luaL_pushresult(&b);
+    return 1;
+}
+
 
 
 /**
@@ -1687,6 +1723,7 @@ static const luaL_Reg dblib[] = {
     {"debug", db_debug},
     {"getfenv", db_getfenv},
     {"gethook", db_gethook},
+    {"heapdump", db_heapdump},
     {"getinfo", db_getinfo},
     {"getlocal", db_getlocal},
     {"getregistry", db_getregistry},
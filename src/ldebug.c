@@ -62,6 +62,7 @@
 
 #include <stdarg.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 
 #define ldebug_c
@@ -172,6 +173,8 @@ static int currentline (lua_State *L, CallInfo *ci) {
  *
  * @note 此函数可以异步调用（例如在信号处理中）
  * @note 设置func为NULL或mask为0将禁用所有钩子
+ * @note 正在运行的luaV_execute在下一个安全点（跳转、调用、返回或受保护
+ *       的操作之后）才切换到带钩子检查的执行变体
  *
  * @see lua_Hook, lua_gethook, resethookcount
  *
@@ -449,8 +452,10 @@ LUA_API const char *lua_getlocal (lua_State *L, const lua_Debug *ar, int n) {
     CallInfo *ci = L->base_ci + ar->i_ci;
     const char *name = findlocal(L, ci, n);
     lua_lock(L);
-    if (name)
+    if (name) {
         luaA_pushobject(L, ci->base + (n - 1));
+        luaS_flatobj(L, L->top - 1);    // 交给C的值不能是rope
+    }
     lua_unlock(L);
     return name;
 }
@@ -1141,9 +1146,14 @@ static Instruction symbexec (const Proto *pt, int lastpc, int reg) {
             check(pc+2 < pt->sizecode);  /* 检查跳过 */
             check(GET_OPCODE(pt->code[pc+1]) == OP_JMP);
         }
+        /* 超级指令后面必须紧跟它融合的第二条指令 */
+        if (isfusedop(op)) {
+            check(pc+1 < pt->sizecode);
+            check(GET_OPCODE(pt->code[pc+1]) == fusednext(op));
+        }
 
         /* 特殊指令的详细检查 */
-        switch (op) {
+        switch (stockop(op)) {
             case OP_LOADBOOL: {
                 if (c == 1) {  /* 是否跳转？ */
                     check(pc+2 < pt->sizecode);  /* 检查跳转 */
@@ -1389,7 +1399,7 @@ static const char *getobjname (lua_State *L, CallInfo *ci, int stackpos,
             return "local";
         i = symbexec(p, pc, stackpos);  /* 尝试符号执行 */
         lua_assert(pc != -1);
-        switch (GET_OPCODE(i)) {
+        switch (stockop(GET_OPCODE(i))) {
             case OP_GETGLOBAL: {
                 int g = GETARG_Bx(i);  /* 全局变量索引 */
                 lua_assert(ttisstring(&p->k[g]));
@@ -1552,7 +1562,7 @@ static int isinstack (CallInfo *ci, const TValue *o) {
  */
 void luaG_typeerror (lua_State *L, const TValue *o, const char *op) {
     const char *name = NULL;
-    const char *t = luaT_typenames[ttype(o)];
+    const char *t = luaT_typenames[basetype(o)];
     const char *kind = (isinstack(L->ci, o)) ?
                            getobjname(L, L->ci, cast_int(o - L->base), &name) :
                            NULL;
@@ -1657,8 +1667,8 @@ void luaG_aritherror (lua_State *L, const TValue *p1, const TValue *p2) {
  * - 表排序中的比较函数
  */
 int luaG_ordererror (lua_State *L, const TValue *p1, const TValue *p2) {
-    const char *t1 = luaT_typenames[ttype(p1)];
-    const char *t2 = luaT_typenames[ttype(p2)];
+    const char *t1 = luaT_typenames[basetype(p1)];
+    const char *t2 = luaT_typenames[basetype(p2)];
     if (t1[2] == t2[2])
         luaG_runerror(L, "attempt to compare two %s values", t1);
     else
@@ -1796,3 +1806,93 @@ void luaG_runerror (lua_State *L, const char *fmt, ...) {
     luaG_errormsg(L);
 }
 
+
+/**
+ * @brief 向调用栈键中追加字符串，空间不足时截断
+ *
+ * 名字里的';'和换行会破坏folded格式，分别替换为','和空格。
+ */
+static void addkey (char *buff, size_t size, size_t *n, const char *s) {
+    for (; *s != '\0' && *n + 1 < size; s++)
+        buff[(*n)++] = (*s == ';') ? ',' : (*s == '\n') ? ' ' : *s;
+    buff[*n] = '\0';
+}
+
+/**
+ * @brief 调用信息对应的pc，不在函数原型的代码范围内时返回-1
+ *
+ * 与currentpc不同，不把L->savedpc写回调用信息：最内层的Lua函数读
+ * L->savedpc，其他层读ci->savedpc。由机器码执行的函数可能还没有写回
+ * savedpc，这时不查找行号和名字；虚拟机只在可能出错或调用的指令前
+ * 写回L->savedpc，所以最内层的行号是近似的。
+ */
+static int keypc (lua_State *L, CallInfo *ci) {
+    const Instruction *pc;
+    Proto *p;
+    if (!ttisfunction(ci->func) || !isLua(ci)) return -1;
+    p = ci_func(ci)->l.p;
+    pc = (ci == L->ci) ? L->savedpc : ci->savedpc;
+    if (pc == NULL || pc <= p->code || pc > p->code + p->sizecode) return -1;
+    return pcRel(pc, p);
+}
+
+/**
+ * @brief 生成当前调用栈的文本键（堆分析器使用）
+ *
+ * 详细说明：
+ * 从最外层到最内层列出调用栈的每一层，用';'分隔，即火焰图工具的
+ * "folded"格式：
+ * - Lua函数："名字@源文件:当前行"，没有名字时为"源文件:当前行"
+ * - C函数："名字[C]"或"[C]"
+ * 超过LUAI_PROFDEPTH层时只保留最内层，外层记为"..."。
+ *
+ * 不分配内存，也不抛出错误，也不修改调用信息，可以在luaM_realloc_中
+ * 调用。调用者必须保证栈和调用信息数组处于一致状态（例如在重新分配
+ * 它们之前）。最内层Lua函数的行号是近似的，见keypc。
+ *
+ * @param L Lua状态机指针
+ * @param buff 输出缓冲区
+ * @param size 缓冲区大小，包括结尾的'\0'
+ * @return 键的长度
+ */
+size_t luaG_stackkey (lua_State *L, char *buff, size_t size) {
+    CallInfo *ci;
+    size_t n = 0;
+    buff[0] = '\0';
+    if (L->ci == NULL) return 0;
+    ci = L->base_ci + 1;
+    if (L->ci - ci >= LUAI_PROFDEPTH) {
+        ci = L->ci - (LUAI_PROFDEPTH - 1);
+        addkey(buff, size, &n, "...");
+    }
+    for (; ci <= L->ci; ci++) {
+        const char *name = NULL;
+        char line[LUA_IDSIZE + 32];
+        if (n > 0 && n + 1 < size) {
+            buff[n++] = ';';
+            buff[n] = '\0';
+        }
+        if (!ttisfunction(ci->func)) {
+            addkey(buff, size, &n, "?");
+            continue;
+        }
+        if (ci - 1 > L->base_ci && keypc(L, ci - 1) >= 0)
+            getfuncname(L, ci, &name);
+        if (name != NULL) {
+            addkey(buff, size, &n, name);
+            addkey(buff, size, &n, isLua(ci) ? "@" : "");
+        }
+        if (!isLua(ci)) {
+            addkey(buff, size, &n, "[C]");
+        }
+        else {
+            Proto *p = ci_func(ci)->l.p;
+            int pc = keypc(L, ci);
+            luaO_chunkid(line, getstr(p->source), LUA_IDSIZE);
+            addkey(buff, size, &n, line);
+            sprintf(line, ":%d", pc >= 0 ? getline(p, pc) : 0);
+            addkey(buff, size, &n, line);
+        }
+    }
+    return n;
+}
@@ -646,4 +646,20 @@ LUAI_FUNC int luaG_checkcode(const Proto *pt);
  */
 LUAI_FUNC int luaG_checkopenop(Instruction i);
 
+/**
+ * @brief 生成当前调用栈的文本键
+ *
+ * 详细说明：
+ * 按火焰图的folded格式从外到内列出调用栈，用';'分隔。不分配内存，
+ * 供堆分析器在luaM_realloc_中记录分配位置。
+ *
+ * @param L Lua状态机指针
+ * @param buff 输出缓冲区
+ * @param size 缓冲区大小
+ * @return 键的长度
+ *
+ * @see luaR_before()
+ */
+LUAI_FUNC size_t luaG_stackkey(lua_State *L, char *buff, size_t size);
+
 #endif
@@ -70,6 +70,7 @@
 #include "ldo.h"
 #include "lfunc.h"
 #include "lgc.h"
+#include "ljit.h"
 #include "lmem.h"
 #include "lobject.h"
 #include "lopcodes.h"
@@ -828,6 +829,7 @@ static StkId adjust_varargs(lua_State *L, Proto *p, int actual) {
         // 创建arg表并填充额外参数
         htab = luaH_new(L, nvar, 1);
         for (i = 0; i < nvar; i++) {
+            luaS_flatobj(L, L->top - nvar + i);    // 表中不保存rope
             setobj2n(L, luaH_setnum(L, htab, i + 1), L->top - nvar + i);
         }
         // 设置n字段为额外参数数量
@@ -1069,6 +1071,11 @@ int luaD_precall(lua_State *L, StkId func, int nresults) {
         }
         L->top = ci->top;
 
+#if defined(LUA_USE_JIT)
+        // 统计调用热度，达到阈值时编译（栈帧已完整建立，内存错误可安全抛出）
+        luaJ_hot(L, p);
+#endif
+
         // 调用函数调用钩子
         if (L->hookmask & LUA_MASKCALL) {
             L->savedpc++;                       // 钩子假设PC已递增
@@ -1079,8 +1086,14 @@ int luaD_precall(lua_State *L, StkId func, int nresults) {
     } else {
         // C函数调用处理
         CallInfo *ci;
+        StkId arg;
         int n;
 
+        // C函数看不到rope：参数先压平
+        for (arg = func + 1; arg < L->top; arg++) {
+            luaS_flatobj(L, arg);
+        }
+
         luaD_checkstack(L, LUA_MINSTACK);       // 确保最小栈空间
         ci = inc_ci(L);                         // 创建调用信息
         ci->func = restorestack(L, funcr);      // 设置函数
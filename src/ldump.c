@@ -95,6 +95,7 @@
 #include "lua.h"
 
 #include "lobject.h"
+#include "lopcodes.h"
 #include "lstate.h"
 #include "lundump.h"
 
@@ -175,6 +176,7 @@ typedef struct {
     lua_Writer writer;         /**< 用户提供的写入回调函数 */
     void *data;                /**< 传递给写入器的用户数据 */
     int strip;                 /**< 调试信息剥离标志 */
+    int fused;                 /**< 保留超级指令（不还原为原始操作码） */
     int status;                /**< 序列化状态码 */
 } DumpState;
 
@@ -481,6 +483,28 @@ static void DumpString(const TString *s, DumpState *D)
  */
 #define DumpCode(f, D)           DumpVector(f->code, f->sizecode, sizeof(Instruction), D)
 
+/**
+ * @brief 以原始操作码序列化字节码
+ *
+ * 把超级指令还原为它的第一条原始指令后逐条写出，输出的字节码可以被
+ * 不认识融合操作码的标准Lua 5.1加载。
+ *
+ * @param f Proto函数原型指针
+ * @param D DumpState序列化状态指针
+ *
+ * @see luaK_fuse
+ */
+static void DumpStockCode(const Proto *f, DumpState *D)
+{
+    int n;
+    DumpInt(f->sizecode, D);
+    for (n = 0; n < f->sizecode; n++) {
+        Instruction i = f->code[n];
+        SET_OPCODE(i, stockop(GET_OPCODE(i)));
+        DumpBlock(&i, sizeof(Instruction), D);
+    }
+}
+
 /**
  * @brief 函数原型序列化函数：递归序列化嵌套的函数定义
  * 
@@ -544,10 +568,11 @@ static void DumpConstants(const Proto *f, DumpState *D)
         const TValue *o = &f->k[i];
         
         // 序列化常量类型：写入Lua值类型标识
-        DumpChar(ttype(o), D);
+        // 整数子类型按LUA_TNUMBER写出，字节码格式不变
+        DumpChar(basetype(o), D);
         
         // 根据常量类型进行不同的序列化处理
-        switch (ttype(o)) {
+        switch (basetype(o)) {
         case LUA_TNIL:
             // nil值：只需要类型信息，无附加数据
             break;
@@ -731,7 +756,10 @@ static void DumpFunction(const Proto *f, const TString *p, DumpState *D)
     DumpChar(f->maxstacksize, D);      // 最大栈大小需求
     
     // 序列化函数字节码：函数的核心执行逻辑
-    DumpCode(f, D);
+    if (D->fused)
+        DumpCode(f, D);
+    else
+        DumpStockCode(f, D);
     
     // 序列化常量表和嵌套函数：函数依赖的数据和子函数
     DumpConstants(f, D);
@@ -873,7 +901,8 @@ int luaU_dump(lua_State *L, const Proto *f, lua_Writer w, void *data, int strip)
     D.L = L;                // Lua虚拟机状态
     D.writer = w;           // 用户提供的写入器
     D.data = data;          // 传递给写入器的用户数据
-    D.strip = strip;        // 调试信息剥离选项
+    D.strip = strip & LUAU_DUMPSTRIP;   // 调试信息剥离选项
+    D.fused = strip & LUAU_DUMPFUSED;   // 保留超级指令选项
     D.status = 0;           // 初始状态为成功
     
     // 写入字节码文件头：包含版本和兼容性信息
@@ -52,6 +52,7 @@
 
 #include "lfunc.h"
 #include "lgc.h"
+#include "ljit.h"
 #include "lmem.h"
 #include "lobject.h"
 #include "lstate.h"
@@ -508,6 +509,17 @@ Proto *luaF_newproto(lua_State *L) {
     f->sizeupvalues = 0;
     f->nups = 0;
 
+    // 初始化内联缓存
+    f->icache = NULL;
+    f->sizeicache = 0;
+
+#if defined(LUA_USE_JIT)
+    // 初始化JIT状态
+    f->jitcode = NULL;
+    f->hotcount = 0;
+    f->jitstate = JIT_NONE;
+#endif
+
     // 初始化调试信息
     f->lineinfo = NULL;
     f->sizelineinfo = 0;
@@ -572,9 +584,41 @@ void luaF_freeproto(lua_State *L, Proto *f) {
     luaM_freearray(L, f->lineinfo, f->sizelineinfo, int);
     luaM_freearray(L, f->locvars, f->sizelocvars, struct LocVar);
     luaM_freearray(L, f->upvalues, f->sizeupvalues, TString *);
+    luaM_freearray(L, f->icache, f->sizeicache, int);
+#if defined(LUA_USE_JIT)
+    luaJ_free(L, f);
+#endif
     luaM_free(L, f);
 }
 
+
+/**
+ * @brief 为函数原型分配内联缓存
+ * @param L Lua状态机指针
+ * @param f 字节码已经定型的函数原型
+ *
+ * 详细说明：
+ * 内联缓存是与f->code平行的槽位提示数组，每条指令一项。
+ * OP_GETTABLE、OP_SETTABLE、OP_SELF和OP_GETGLOBAL在键为字符串常量时，
+ * 把上次找到该键的哈希节点下标记录在对应项中，下次执行先直接检查
+ * 该节点，命中则跳过哈希链遍历。
+ *
+ * 有效性：
+ * 缓存只是提示，使用时总会校验节点中的键是否就是要找的字符串，
+ * 因此表的rehash或resize不会导致错误结果，只会导致一次未命中。
+ *
+ * @note 由编译器（close_func）和字节码加载器（LoadFunction）调用
+ * @see luaH_getstrhint
+ */
+void luaF_initcache(lua_State *L, Proto *f) {
+    int i;
+    lua_assert(f->icache == NULL);
+    f->icache = luaM_newvector(L, f->sizecode, int);
+    f->sizeicache = f->sizecode;
+    for (i = 0; i < f->sizecode; i++)
+        f->icache[i] = 0;
+}
+
 /**
  * @brief 释放闭包对象
  * @param L Lua状态机指针
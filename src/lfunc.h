@@ -905,6 +905,20 @@ LUAI_FUNC void luaF_close(lua_State *L, StkId level);
  */
 LUAI_FUNC void luaF_freeproto(lua_State *L, Proto *f);
 
+/**
+ * @brief 为函数原型分配内联缓存
+ *
+ * 详细说明：
+ * 按f->sizecode分配与字节码平行的槽位提示数组，并全部清零。
+ * 必须在字节码定型之后调用。
+ *
+ * @param L Lua状态机指针
+ * @param f 函数原型
+ *
+ * @see luaH_getstrhint(), Proto::icache
+ */
+LUAI_FUNC void luaF_initcache(lua_State *L, Proto *f);
+
 /**
  * @brief 释放闭包对象及其关联资源
  * 
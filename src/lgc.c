@@ -60,6 +60,12 @@
 #include "ltable.h"
 #include "ltm.h"
 
+#if defined(LUA_USE_PARMARK)
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
 // 垃圾回收器配置常量
 #define GCSTEPSIZE      1024u    // 每次GC步进处理的字节数
 #define GCSWEEPMAX      40       // 每次清除阶段处理的最大对象数
@@ -154,6 +160,28 @@
  */
 #define setthreshold(g) (g->GCthreshold = (g->estimate / 100) * g->gcpause)
 
+/**
+ * @brief 设置分代模式的回收阈值
+ *
+ * 堆比估计使用量增长genminormul%后触发下一次次要回收。
+ */
+#define setminorthreshold(g) \
+    (g->GCthreshold = g->estimate + (g->estimate / 100) * g->genminormul)
+
+/**
+ * @brief 写屏障是否必须维持"黑色对象不引用白色对象"
+ *
+ * 增量模式下只有传播阶段需要；分代模式下老对象在回收之间保持黑色，
+ * 任何时候都需要。
+ */
+#define keepinvariant(g) (isgenerational(g) || (g)->gcstate == GCSpropagate)
+
+/**
+ * @brief 记录老对象边界：清扫结束时两个对象链表的头部
+ */
+#define setgenboundary(g) \
+    ((g)->genold = (g)->rootgc, (g)->genoldud = (g)->mainthread->next)
+
 /**
  * @brief 移除表中的空条目
  * @param n 要处理的节点指针
@@ -199,6 +227,7 @@ static void removeentry(Node *n) {
  * - STRING: 字符串不包含引用，直接返回（隐式转为黑色）
  * - USERDATA: 标记元表和环境，直接转为黑色
  * - UPVAL: 标记值，如果是闭合的upvalue则转为黑色
+ * - ROPE: 标记压平的结果和整条左半部分链，直接转为黑色
  * - FUNCTION/TABLE/THREAD/PROTO: 加入灰色列表，延迟处理
  *
  * 性能特征：
@@ -275,6 +304,27 @@ static void reallymarkobject(global_State *g, GCObject *o) {
             break;
         }
 
+        case LUA_TROPE: {
+            // rope：标记压平的结果和左半部分后直接转为黑色；
+            // 向左延伸的rope链就地迭代，链再长也不会递归
+            Rope *r = gco2rope(o);
+            for (;;) {
+                GCObject *l = r->left;
+                gray2black(obj2gco(r));
+                if (r->flat != NULL) {
+                    stringmark(r->flat);
+                }
+                if (l == NULL || !iswhite(l)) {
+                    return;
+                }
+                white2gray(l);
+                if (l->gch.tt != LUA_TROPE) {
+                    return;    // 字符串
+                }
+                r = gco2rope(l);
+            }
+        }
+
         default:
             lua_assert(0);    // 不应该到达这里
     }
@@ -382,6 +432,39 @@ size_t luaC_separateudata(lua_State *L, int all) {
 }
 
 
+/**
+ * @brief 标记一段哈希节点的键和值
+ * @param g 全局状态指针
+ * @param node 节点数组
+ * @param size 要遍历的节点数
+ * @param weakkey 是否为弱键表（不标记键）
+ * @param weakvalue 是否为弱值表（不标记值）
+ *
+ * 值为nil的条目清理键，见removeentry()。
+ */
+static void traversenodes(global_State *g, Node *node, int size,
+                          int weakkey, int weakvalue) {
+    while (size--) {
+        Node *n = &node[size];
+        lua_assert(ttype(gkey(n)) != LUA_TDEADKEY || ttisnil(gval(n)));
+
+        if (ttisnil(gval(n))) {
+            // 值为nil的条目，清理键
+            removeentry(n);
+        } else {
+            // 有效条目，根据弱引用类型选择性标记
+            lua_assert(!ttisnil(gkey(n)));
+            if (!weakkey) {
+                markvalue(g, gkey(n));    // 标记键（如果不是弱键）
+            }
+            if (!weakvalue) {
+                markvalue(g, gval(n));    // 标记值（如果不是弱值）
+            }
+        }
+    }
+}
+
+
 /**
  * @brief 遍历表对象并标记其内容
  * @param g 全局状态指针
@@ -467,25 +550,13 @@ static int traversetable(global_State *g, Table *h) {
     }
 
     // 遍历哈希部分
-    i = sizenode(h);
-    while (i--) {
-        Node *n = gnode(h, i);
-        lua_assert(ttype(gkey(n)) != LUA_TDEADKEY || ttisnil(gval(n)));
-
-        if (ttisnil(gval(n))) {
-            // 值为nil的条目，清理键
-            removeentry(n);
-        } else {
-            // 有效条目，根据弱引用类型选择性标记
-            lua_assert(!ttisnil(gkey(n)));
-            if (!weakkey) {
-                markvalue(g, gkey(n));    // 标记键（如果不是弱键）
-            }
-            if (!weakvalue) {
-                markvalue(g, gval(n));    // 标记值（如果不是弱值）
-            }
-        }
+    traversenodes(g, h->node, sizenode(h), weakkey, weakvalue);
+#if defined(LUA_USE_INCREHASH)
+    // 增量重哈希迁移中：还没迁移的旧节点
+    if (h->incrstate == INCR_MOVE) {
+        traversenodes(g, h->incrnode, h->incrpos, weakkey, weakvalue);
     }
+#endif
 
     return weakkey || weakvalue;
 }
@@ -905,6 +976,611 @@ static l_mem propagatemark(global_State *g) {
     }
 }
 
+#if defined(LUA_USE_PARMARK)
+
+/**
+ * @name 并行标记
+ * @brief 用多个线程传播灰色列表
+ *
+ * 详细说明：
+ * 原子阶段和完整回收中，propagateall把灰色列表交给主线程和
+ * g->parmarkthreads个辅助线程一起处理。每个工作线程有一个私有灰色栈，
+ * 仍然通过gclist链接，不需要额外内存。标记位用原子操作修改：把白色
+ * 对象变灰的那一次原子"与"决定对象归哪个线程遍历，所以每个对象只被
+ * 遍历一次。私有栈较长而有线程空闲时，拥有者把一批对象移到自己的共享
+ * 列表中，空闲线程从其他线程的共享列表中整批窃取。
+ *
+ * 与串行标记器的区别：
+ * - 线程对象由主线程在每轮结束后串行遍历（traversestack会调整栈大小）
+ * - 弱表先收集到各工作线程的列表中，每轮结束时并入g->weak
+ * - __mode直接在元表中查找，不写入元表的flags缓存
+ * - 不把值为nil的节点的键改成死键（其他线程可能正在查找这个表），
+ *   下一次串行遍历会补上
+ *
+ * 可达对象集合是根集合的传递闭包，与遍历顺序无关，所以并行标记释放
+ * 的对象与串行标记完全相同；只有g->weak中弱表的顺序可能不同。
+ *
+ * @note 修改traversetable、traverseclosure、traverseproto时要同步修改
+ *       这里对应的函数
+ * @{
+ */
+
+#define PM_BATCH        64      // 一次移到共享列表的最大对象数
+
+// 标记位的原子访问
+#define pm_marked(o) \
+    __atomic_load_n(&(o)->gch.marked, __ATOMIC_RELAXED)
+#define pm_setbits(o, m) \
+    __atomic_fetch_or(&(o)->gch.marked, cast_byte(m), __ATOMIC_RELAXED)
+#define pm_resetbits(o, m) \
+    __atomic_fetch_and(&(o)->gch.marked, cast_byte(~(m)), __ATOMIC_RELAXED)
+
+#define pm_load(x)      __atomic_load_n(&(x), __ATOMIC_SEQ_CST)
+#define pm_store(x, v)  __atomic_store_n(&(x), (v), __ATOMIC_SEQ_CST)
+#define pm_add(x, v)    __atomic_add_fetch(&(x), (v), __ATOMIC_SEQ_CST)
+
+/**
+ * @brief 一个标记工作线程的状态
+ */
+typedef struct MarkWorker {
+    struct ParMark *pm;
+    pthread_t thread;
+    pthread_mutex_t lock;       // 保护shared和nshared
+    int id;                     // 在ParMark::w中的下标，0是主线程
+    int nlocal;
+    GCObject *local;            // 私有灰色栈
+    GCObject *shared;           // 可被其他线程窃取的一批灰色对象
+    int nshared;
+    GCObject *weak;             // 本轮遇到的弱表
+    GCObject *threads;          // 留给主线程遍历的线程对象
+    size_t work;                // 本轮遍历的内存大小
+} MarkWorker;
+
+/**
+ * @brief 并行标记的线程池，按需创建，挂在global_State::parmark上
+ *
+ * 辅助线程在start上等待epoch变化，完成一轮后增加finished并通知done。
+ * idle是空闲的工作线程数：等于n时所有私有栈和共享列表都为空，本轮结束。
+ */
+typedef struct ParMark {
+    global_State *g;
+    size_t size;                // 分配的字节数
+    pthread_mutex_t lock;       // 保护epoch、finished和quit
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned epoch;
+    int finished;
+    int quit;
+    int idle;
+    int n;                      // 工作线程数（含主线程）
+    MarkWorker w[1];
+} ParMark;
+
+static GCObject **pm_gclist(GCObject *o) {
+    switch (o->gch.tt) {
+        case LUA_TTABLE: return &gco2h(o)->gclist;
+        case LUA_TFUNCTION: return &gco2cl(o)->c.gclist;
+        case LUA_TTHREAD: return &gco2th(o)->gclist;
+        case LUA_TPROTO: return &gco2p(o)->gclist;
+        default: lua_assert(0); return NULL;
+    }
+}
+
+static void pm_mark(MarkWorker *w, GCObject *o);
+
+#define pm_markvalue(w, o) { \
+    checkconsistency(o); \
+    if (iscollectable(o)) \
+        pm_mark(w, gcvalue(o)); \
+}
+
+#define pm_markobject(w, t)     pm_mark(w, obj2gco(t))
+
+/**
+ * @brief reallymarkobject的并行版本
+ *
+ * 只有把对象从白色变灰的线程继续处理它；对象已经不是白色，或者被
+ * 其他线程抢先，直接返回。
+ */
+static void pm_mark(MarkWorker *w, GCObject *o) {
+    if (!testbits(pm_marked(o), WHITEBITS) ||
+        !testbits(pm_resetbits(o, WHITEBITS), WHITEBITS)) {
+        return;
+    }
+
+    switch (o->gch.tt) {
+        case LUA_TSTRING: {
+            return;
+        }
+        case LUA_TUSERDATA: {
+            Table *mt = gco2u(o)->metatable;
+            pm_setbits(o, bitmask(BLACKBIT));
+            if (mt) {
+                pm_markobject(w, mt);
+            }
+            pm_markobject(w, gco2u(o)->env);
+            return;
+        }
+        case LUA_TUPVAL: {
+            UpVal *uv = gco2uv(o);
+            pm_markvalue(w, uv->v);
+            if (uv->v == &uv->u.value) {
+                pm_setbits(o, bitmask(BLACKBIT));
+            }
+            return;
+        }
+        case LUA_TROPE: {
+            Rope *r = gco2rope(o);
+            for (;;) {
+                GCObject *l = r->left;
+                pm_setbits(obj2gco(r), bitmask(BLACKBIT));
+                if (r->flat != NULL) {
+                    pm_resetbits(obj2gco(r->flat), WHITEBITS);
+                }
+                if (l == NULL || !testbits(pm_marked(l), WHITEBITS) ||
+                    !testbits(pm_resetbits(l, WHITEBITS), WHITEBITS) ||
+                    l->gch.tt != LUA_TROPE) {
+                    return;
+                }
+                r = gco2rope(l);
+            }
+        }
+        default: {
+            *pm_gclist(o) = w->local;
+            w->local = o;
+            w->nlocal++;
+        }
+    }
+}
+
+static void pm_traversenodes(MarkWorker *w, Node *node, int size,
+                             int weakkey, int weakvalue) {
+    while (size--) {
+        Node *n = &node[size];
+        if (!ttisnil(gval(n))) {
+            if (!weakkey) {
+                pm_markvalue(w, gkey(n));
+            }
+            if (!weakvalue) {
+                pm_markvalue(w, gval(n));
+            }
+        }
+    }
+}
+
+static int pm_traversetable(MarkWorker *w, Table *h) {
+    global_State *g = w->pm->g;
+    Table *mt = h->metatable;
+    const TValue *mode = NULL;
+    int weakkey = 0;
+    int weakvalue = 0;
+    int i;
+
+    if (mt) {
+        pm_markobject(w, mt);
+        // 不经过gfasttm：它会把"没有__mode"缓存到mt->flags中
+        if (!(mt->flags & (1u << TM_MODE))) {
+            mode = luaH_getstr(mt, g->tmname[TM_MODE]);
+        }
+    }
+    if (mode && ttisstring(mode)) {
+        weakkey = (strchr(svalue(mode), 'k') != NULL);
+        weakvalue = (strchr(svalue(mode), 'v') != NULL);
+        if (weakkey || weakvalue) {
+            pm_resetbits(obj2gco(h), KEYWEAK | VALUEWEAK);
+            pm_setbits(obj2gco(h), (weakkey << KEYWEAKBIT) |
+                                   (weakvalue << VALUEWEAKBIT));
+            h->gclist = w->weak;
+            w->weak = obj2gco(h);
+        }
+    }
+    if (weakkey && weakvalue) {
+        return 1;
+    }
+    if (!weakvalue) {
+        i = h->sizearray;
+        while (i--) {
+            pm_markvalue(w, &h->array[i]);
+        }
+    }
+    pm_traversenodes(w, h->node, sizenode(h), weakkey, weakvalue);
+#if defined(LUA_USE_INCREHASH)
+    if (h->incrstate == INCR_MOVE) {
+        pm_traversenodes(w, h->incrnode, h->incrpos, weakkey, weakvalue);
+    }
+#endif
+    return weakkey || weakvalue;
+}
+
+static void pm_traverseproto(MarkWorker *w, Proto *f) {
+    int i;
+    if (f->source) {
+        pm_markobject(w, f->source);
+    }
+    for (i = 0; i < f->sizek; i++) {
+        pm_markvalue(w, &f->k[i]);
+    }
+    for (i = 0; i < f->sizeupvalues; i++) {
+        if (f->upvalues[i]) {
+            pm_markobject(w, f->upvalues[i]);
+        }
+    }
+    for (i = 0; i < f->sizep; i++) {
+        if (f->p[i]) {
+            pm_markobject(w, f->p[i]);
+        }
+    }
+    for (i = 0; i < f->sizelocvars; i++) {
+        if (f->locvars[i].varname) {
+            pm_markobject(w, f->locvars[i].varname);
+        }
+    }
+}
+
+static void pm_traverseclosure(MarkWorker *w, Closure *cl) {
+    int i;
+    pm_markobject(w, cl->c.env);
+    if (cl->c.isC) {
+        for (i = 0; i < cl->c.nupvalues; i++) {
+            pm_markvalue(w, &cl->c.upvalue[i]);
+        }
+    } else {
+        lua_assert(cl->l.nupvalues == cl->l.p->nups);
+        pm_markobject(w, cl->l.p);
+        for (i = 0; i < cl->l.nupvalues; i++) {
+            pm_markobject(w, cl->l.upvals[i]);
+        }
+    }
+}
+
+/**
+ * @brief propagatemark的并行版本：遍历一个已出栈的灰色对象
+ * @return 遍历的内存大小（线程对象推迟到主线程，返回0）
+ */
+static size_t pm_propagate(MarkWorker *w, GCObject *o) {
+    switch (o->gch.tt) {
+        case LUA_TTABLE: {
+            Table *h = gco2h(o);
+            pm_setbits(o, bitmask(BLACKBIT));
+            if (pm_traversetable(w, h)) {
+                pm_resetbits(o, bitmask(BLACKBIT));
+            }
+            return sizeof(Table) + sizeof(TValue) * h->sizearray +
+                                   sizeof(Node) * sizenode(h);
+        }
+        case LUA_TFUNCTION: {
+            Closure *cl = gco2cl(o);
+            pm_setbits(o, bitmask(BLACKBIT));
+            pm_traverseclosure(w, cl);
+            return (cl->c.isC) ? sizeCclosure(cl->c.nupvalues) :
+                                 sizeLclosure(cl->l.nupvalues);
+        }
+        case LUA_TTHREAD: {
+            gco2th(o)->gclist = w->threads;
+            w->threads = o;
+            return 0;
+        }
+        case LUA_TPROTO: {
+            Proto *p = gco2p(o);
+            pm_setbits(o, bitmask(BLACKBIT));
+            pm_traverseproto(w, p);
+            return sizeof(Proto) + sizeof(Instruction) * p->sizecode +
+                                   sizeof(Proto *) * p->sizep +
+                                   sizeof(TValue) * p->sizek +
+                                   sizeof(int) * p->sizelineinfo +
+                                   sizeof(LocVar) * p->sizelocvars +
+                                   sizeof(TString *) * p->sizeupvalues;
+        }
+        default:
+            lua_assert(0);
+            return 0;
+    }
+}
+
+/**
+ * @brief 把私有栈顶部的一批对象移到共享列表
+ */
+static void pm_share(MarkWorker *w) {
+    GCObject *first = w->local;
+    GCObject *last = first;
+    int k = w->nlocal / 2;
+    int i;
+
+    if (k > PM_BATCH) {
+        k = PM_BATCH;
+    }
+    for (i = 1; i < k; i++) {
+        last = *pm_gclist(last);
+    }
+    w->local = *pm_gclist(last);
+    w->nlocal -= k;
+
+    pthread_mutex_lock(&w->lock);
+    *pm_gclist(last) = w->shared;
+    w->shared = first;
+    pm_store(w->nshared, w->nshared + k);
+    pthread_mutex_unlock(&w->lock);
+}
+
+/**
+ * @brief 取走v的整个共享列表作为w的私有栈（w的私有栈必须为空）
+ * @return 是否取到对象
+ */
+static int pm_take(MarkWorker *w, MarkWorker *v) {
+    int got = 0;
+    lua_assert(w->local == NULL);
+    pthread_mutex_lock(&v->lock);
+    if (v->shared) {
+        w->local = v->shared;
+        w->nlocal = v->nshared;
+        v->shared = NULL;
+        pm_store(v->nshared, 0);
+        got = 1;
+    }
+    pthread_mutex_unlock(&v->lock);
+    return got;
+}
+
+static int pm_steal(ParMark *pm, MarkWorker *w) {
+    int i;
+    for (i = 1; i < pm->n; i++) {
+        MarkWorker *v = &pm->w[(w->id + i) % pm->n];
+        if (pm_load(v->nshared) > 0 && pm_take(w, v)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int pm_haswork(ParMark *pm) {
+    int i;
+    for (i = 0; i < pm->n; i++) {
+        if (pm_load(pm->w[i].nshared) > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 工作线程的主循环：处理私有栈，空了就窃取，直到所有线程都空闲
+ * @param active 是否从活动状态开始（辅助线程开始时计入idle）
+ *
+ * 空闲线程的私有栈和共享列表总是空的，并且只有活动线程会产生新的
+ * 灰色对象，所以idle等于n时标记已经完成。窃取之前先退出空闲状态，
+ * 保证持有对象的线程不会被计为空闲。
+ */
+static void pm_drain(ParMark *pm, MarkWorker *w, int active) {
+    for (;;) {
+        if (active) {
+            while (w->local) {
+                GCObject *o = w->local;
+                w->local = *pm_gclist(o);
+                w->nlocal--;
+                w->work += pm_propagate(w, o);
+                if (w->nlocal > 1 && pm_load(w->nshared) == 0 &&
+                    pm_load(pm->idle) > 0) {
+                    pm_share(w);
+                }
+            }
+            if (pm_take(w, w) || pm_steal(pm, w)) {
+                continue;
+            }
+            pm_add(pm->idle, 1);
+            active = 0;
+        }
+        if (pm_load(pm->idle) == pm->n) {
+            return;
+        }
+        if (pm_haswork(pm)) {
+            pm_add(pm->idle, -1);
+            if (pm_steal(pm, w)) {
+                active = 1;
+            } else {
+                pm_add(pm->idle, 1);
+            }
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+static void *pm_helper(void *ud) {
+    MarkWorker *w = (MarkWorker *)ud;
+    ParMark *pm = w->pm;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&pm->lock);
+    for (;;) {
+        while (pm->epoch == seen && !pm->quit) {
+            pthread_cond_wait(&pm->start, &pm->lock);
+        }
+        if (pm->quit) {
+            break;
+        }
+        seen = pm->epoch;
+        pthread_mutex_unlock(&pm->lock);
+
+        pm_drain(pm, w, 0);
+
+        pthread_mutex_lock(&pm->lock);
+        if (++pm->finished == pm->n - 1) {
+            pthread_cond_signal(&pm->done);
+        }
+    }
+    pthread_mutex_unlock(&pm->lock);
+    return NULL;
+}
+
+/**
+ * @brief 确定默认的辅助线程数
+ *
+ * global_State::parmarkthreads为负表示还没有确定：取LUAI_PARMARKTHREADS，
+ * 但不超过其他在线CPU的数目，单CPU机器上不使用并行标记。
+ */
+static void pm_default(global_State *g) {
+    if (g->parmarkthreads < 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        g->parmarkthreads = LUAI_PARMARKTHREADS;
+        if (ncpu >= 1 && g->parmarkthreads > ncpu - 1) {
+            g->parmarkthreads = cast_int(ncpu - 1);
+        }
+    }
+}
+
+/**
+ * @brief 取得线程池，第一次使用时创建
+ * @return 线程池；内存不足时返回NULL，调用者退回串行标记
+ *
+ * 线程池直接使用g->frealloc分配，不计入totalbytes，也不会在回收
+ * 过程中抛出内存错误。创建辅助线程失败时使用已经创建的线程。
+ */
+static ParMark *pm_get(global_State *g) {
+    ParMark *pm = g->parmark;
+    size_t size;
+    int n, i;
+
+    if (pm) {
+        return pm;
+    }
+    pm_default(g);
+    if (g->parmarkthreads == 0) {
+        return NULL;
+    }
+    n = g->parmarkthreads + 1;
+    size = sizeof(ParMark) + sizeof(MarkWorker) * (n - 1);
+    pm = (ParMark *)(*g->frealloc)(g->ud, NULL, 0, size);
+    if (pm == NULL) {
+        return NULL;
+    }
+    memset(pm, 0, size);
+    pm->g = g;
+    pm->size = size;
+    pthread_mutex_init(&pm->lock, NULL);
+    pthread_cond_init(&pm->start, NULL);
+    pthread_cond_init(&pm->done, NULL);
+    pm->n = 1;
+    for (i = 0; i < n; i++) {
+        MarkWorker *w = &pm->w[i];
+        w->pm = pm;
+        w->id = i;
+        pthread_mutex_init(&w->lock, NULL);
+        if (i > 0) {
+            if (pthread_create(&w->thread, NULL, pm_helper, w) != 0) {
+                pthread_mutex_destroy(&w->lock);
+                break;
+            }
+            pm->n++;
+        }
+    }
+    g->parmark = pm;
+    return pm;
+}
+
+/**
+ * @brief 结束辅助线程并释放线程池
+ */
+static void pm_stop(global_State *g) {
+    ParMark *pm = g->parmark;
+    int i;
+
+    if (pm == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&pm->lock);
+    pm->quit = 1;
+    pthread_cond_broadcast(&pm->start);
+    pthread_mutex_unlock(&pm->lock);
+    for (i = 0; i < pm->n; i++) {
+        if (i > 0) {
+            pthread_join(pm->w[i].thread, NULL);
+        }
+        pthread_mutex_destroy(&pm->w[i].lock);
+    }
+    pthread_cond_destroy(&pm->done);
+    pthread_cond_destroy(&pm->start);
+    pthread_mutex_destroy(&pm->lock);
+    (*g->frealloc)(g->ud, pm, pm->size, 0);
+    g->parmark = NULL;
+}
+
+/**
+ * @brief 并行处理一次当前的灰色列表
+ * @return 遍历的内存大小
+ *
+ * 主线程从整个灰色列表开始，辅助线程从窃取开始。所有线程结束后，
+ * 把各自的弱表并入g->weak，再串行遍历推迟的线程对象；线程栈上新
+ * 标记的对象留在g->gray中，由调用者开始下一轮。
+ */
+static size_t pm_round(ParMark *pm) {
+    global_State *g = pm->g;
+    MarkWorker *w0 = &pm->w[0];
+    GCObject *o;
+    size_t m = 0;
+    int i;
+
+    for (i = 0; i < pm->n; i++) {
+        MarkWorker *w = &pm->w[i];
+        w->local = w->shared = w->weak = w->threads = NULL;
+        w->nlocal = w->nshared = 0;
+        w->work = 0;
+    }
+    for (o = g->gray; o; o = *pm_gclist(o)) {
+        w0->nlocal++;
+    }
+    w0->local = g->gray;
+    g->gray = NULL;
+
+    pthread_mutex_lock(&pm->lock);
+    pm->idle = pm->n - 1;
+    pm->finished = 0;
+    pm->epoch++;
+    pthread_cond_broadcast(&pm->start);
+    pthread_mutex_unlock(&pm->lock);
+
+    pm_drain(pm, w0, 1);
+
+    pthread_mutex_lock(&pm->lock);
+    while (pm->finished < pm->n - 1) {
+        pthread_cond_wait(&pm->done, &pm->lock);
+    }
+    pthread_mutex_unlock(&pm->lock);
+
+    for (i = 0; i < pm->n; i++) {
+        MarkWorker *w = &pm->w[i];
+        m += w->work;
+        while ((o = w->weak) != NULL) {
+            w->weak = gco2h(o)->gclist;
+            gco2h(o)->gclist = g->weak;
+            g->weak = o;
+        }
+        while ((o = w->threads) != NULL) {
+            w->threads = gco2th(o)->gclist;
+            gco2th(o)->gclist = g->gray;
+            g->gray = o;
+            m += propagatemark(g);
+        }
+    }
+    return m;
+}
+
+/**
+ * @brief 用线程池传播整个灰色列表；线程池不可用时串行处理
+ */
+static size_t parpropagate(global_State *g) {
+    ParMark *pm = pm_get(g);
+    size_t m = 0;
+
+    while (g->gray) {
+        m += pm ? pm_round(pm) : (size_t)propagatemark(g);
+    }
+    return m;
+}
+
+/** @} */
+
+#endif
+
 
 /**
  * @brief 传播所有标记：处理完整个灰色列表
@@ -929,6 +1605,12 @@ static l_mem propagatemark(global_State *g) {
  */
 static size_t propagateall(global_State *g) {
     size_t m = 0;
+#if defined(LUA_USE_PARMARK)
+    if (g->gray && g->parmarkthreads != 0 &&
+        g->totalbytes >= LUAI_PARMARKMIN) {
+        return parpropagate(g);
+    }
+#endif
     while (g->gray) {
         m += propagatemark(g);
     }
@@ -989,6 +1671,26 @@ static int iscleared(const TValue *o, int iskey) {
 }
 
 
+/**
+ * @brief 清理一段哈希节点中键或值已被回收的条目
+ * @param node 节点数组
+ * @param size 要清理的节点数
+ */
+static void clearnodes(Node *node, int size) {
+    while (size--) {
+        Node *n = &node[size];
+
+        // 检查非空条目
+        if (!ttisnil(gval(n)) &&
+            (iscleared(key2tval(n), 1) || iscleared(gval(n), 0))) {
+            // 键或值被回收，清理整个条目
+            setnilvalue(gval(n));    // 移除值
+            removeentry(n);          // 清理键，维护表结构
+        }
+    }
+}
+
+
 /**
  * @brief 清理弱引用表中已被回收的条目
  * @param l 弱引用表链表的头指针
@@ -1059,18 +1761,12 @@ static void cleartable(GCObject *l) {
         }
 
         // 清理哈希部分
-        i = sizenode(h);
-        while (i--) {
-            Node *n = gnode(h, i);
-
-            // 检查非空条目
-            if (!ttisnil(gval(n)) &&
-                (iscleared(key2tval(n), 1) || iscleared(gval(n), 0))) {
-                // 键或值被回收，清理整个条目
-                setnilvalue(gval(n));    // 移除值
-                removeentry(n);          // 清理键，维护表结构
-            }
+        clearnodes(h->node, sizenode(h));
+#if defined(LUA_USE_INCREHASH)
+        if (h->incrstate == INCR_MOVE) {
+            clearnodes(h->incrnode, h->incrpos);    // 还没迁移的旧节点
         }
+#endif
 
         // 移动到链表中的下一个弱引用表
         l = h->gclist;
@@ -1151,8 +1847,10 @@ static void freeobj(lua_State *L, GCObject *o) {
         }
 
         case LUA_TSTRING: {
-            // 更新字符串表的使用计数
-            G(L)->strt.nuse--;
+            // 更新字符串表的使用计数（长字符串不在字符串表中）
+            if (!islngstr(rawgco2ts(o))) {
+                G(L)->strt.nuse--;
+            }
             luaM_freemem(L, o, sizestring(gco2ts(o)));
             break;
         }
@@ -1162,6 +1860,11 @@ static void freeobj(lua_State *L, GCObject *o) {
             break;
         }
 
+        case LUA_TROPE: {
+            luaM_freemem(L, o, sizerope(gco2rope(o)));
+            break;
+        }
+
         default:
             lua_assert(0);    // 不应该到达这里
     }
@@ -1237,6 +1940,10 @@ static GCObject **sweeplist(lua_State *L, GCObject **p, lu_mem count) {
     GCObject *curr;
     global_State *g = G(L);
     int deadmask = otherwhite(g);    // 当前周期的死亡白色标记
+#if defined(LUA_USE_BGFREE)
+    lu_byte bgsweeping = g->bgsweeping;
+    g->bgsweeping = (g->bgfree != NULL);    // 释放的内存块交给后台线程
+#endif
 
     while ((curr = *p) != NULL && count-- > 0) {
         // 特殊处理：线程对象需要清扫其开放上值列表
@@ -1246,9 +1953,14 @@ static GCObject **sweeplist(lua_State *L, GCObject **p, lu_mem count) {
 
         // 检查对象是否存活
         if ((curr->gch.marked ^ WHITEBITS) & deadmask) {
-            // 对象存活：重新标记为白色，准备下一轮GC
             lua_assert(!isdead(g, curr) || testbit(curr->gch.marked, FIXEDBIT));
-            makewhite(g, curr);
+            if (!isgenerational(g)) {
+                // 对象存活：重新标记为白色，准备下一轮GC
+                makewhite(g, curr);
+            } else if (testbit(curr->gch.marked, FIXEDBIT)) {
+                // 分代模式：存活对象保持颜色成为老对象，固定对象也视为老对象
+                white2gray(curr);
+            }
             p = &curr->gch.next;
         } else {
             // 对象死亡：从链表中移除并释放
@@ -1264,6 +1976,9 @@ static GCObject **sweeplist(lua_State *L, GCObject **p, lu_mem count) {
         }
     }
 
+#if defined(LUA_USE_BGFREE)
+    g->bgsweeping = bgsweeping;
+#endif
     return p;    // 返回下一个未处理对象的位置
 }
 
@@ -1411,7 +2126,11 @@ static void GCTM(lua_State *L) {
     // 将用户数据重新加入主对象列表
     udata->uv.next = g->mainthread->next;
     g->mainthread->next = o;
-    makewhite(g, o);    // 重新标记为白色
+    if (!isgenerational(g)) {
+        // 重新标记为白色；分代模式下它和被它复活的对象一起保持为老对象，
+        // 否则这些老对象会引用一个不在记忆集中的年轻对象
+        makewhite(g, o);
+    }
 
     // 查找__gc元方法
     tm = fasttm(L, udata->uv.metatable, TM_GC);
@@ -1503,6 +2222,10 @@ void luaC_freeall(lua_State *L) {
     global_State *g = G(L);
     int i;
 
+#if defined(LUA_USE_PARMARK)
+    pm_stop(g);
+#endif
+
     // 设置特殊标记，使所有对象都被视为垃圾
     g->currentwhite = WHITEBITS | bitmask(SFIXEDBIT);
 
@@ -1513,6 +2236,11 @@ void luaC_freeall(lua_State *L) {
     for (i = 0; i < g->strt.size; i++) {
         sweepwholelist(L, &g->strt.hash[i]);
     }
+
+#if defined(LUA_USE_BGFREE)
+    // 等待后台线程释放完所有内存块
+    luaM_bgfree(L, 0);
+#endif
 }
 
 /**
@@ -1579,10 +2307,12 @@ static void markmt(global_State *g) {
 static void markroot(lua_State *L) {
     global_State *g = G(L);
 
-    // 初始化标记列表
-    g->gray = NULL;
-    g->grayagain = NULL;
-    g->weak = NULL;
+    // 初始化标记列表；分代模式下这些列表是记忆集，必须保留
+    if (!isgenerational(g)) {
+        g->gray = NULL;
+        g->grayagain = NULL;
+        g->weak = NULL;
+    }
 
     // 标记主线程
     markobject(g, g->mainthread);
@@ -1847,7 +2577,11 @@ static l_mem singlestep(lua_State *L) {
 
             if (*g->sweepgc == NULL) {
                 // 对象清扫完成，检查大小并转到终结状态
+#if defined(LUA_USE_BGFREE)
+                luaM_bgflush(L);
+#endif
                 checkSizes(L);
+                setgenboundary(g);
                 g->gcstate = GCSfinalize;
             }
 
@@ -1879,6 +2613,191 @@ static l_mem singlestep(lua_State *L) {
 }
 
 
+/**
+ * @brief 清扫整个堆，把存活对象变回白色
+ * @param L Lua状态机指针
+ *
+ * 详细说明：
+ * 如果当前在标记阶段，丢弃已有的标记和灰色列表，直接进入清扫；
+ * 否则完成正在进行的清扫。返回时处于GCSfinalize状态，所有存活对象
+ * 都是当前白色。调用时必须处于增量模式，否则清扫会保留老对象的颜色。
+ *
+ * @see luaC_fullgc(), fullgen()
+ */
+static void whitenall(lua_State *L) {
+    global_State *g = G(L);
+    lua_assert(!isgenerational(g));
+
+    // 如果当前在标记阶段，跳过到清扫阶段
+    if (g->gcstate <= GCSpropagate) {
+        // 重置清扫标记，准备清扫所有元素
+        g->sweepstrgc = 0;
+        g->sweepgc = &g->rootgc;
+
+        // 重置收集器列表
+        g->gray = NULL;
+        g->grayagain = NULL;
+        g->weak = NULL;
+        g->gcstate = GCSsweepstring;
+    }
+
+    lua_assert(g->gcstate != GCSpause && g->gcstate != GCSpropagate);
+
+    while (g->gcstate != GCSfinalize) {
+        lua_assert(g->gcstate == GCSsweepstring || g->gcstate == GCSsweep);
+        singlestep(L);
+    }
+
+    // 清扫阶段中写屏障链入grayagain的表和上次原子阶段留下的弱表链表
+    // 已经过时；分代模式的markroot不会重置它们
+    g->grayagain = NULL;
+    g->weak = NULL;
+}
+
+/**
+ * @brief 清扫链表中上次分代回收之后链入的部分
+ * @param L Lua状态机指针
+ * @param p 链表头指针的指针
+ * @param old 老对象边界，NULL表示清扫整个链表
+ *
+ * 新对象总是插入链表头部，边界之后只有老对象，次要回收不会释放
+ * 它们。边界对象本身是老对象，不会在次要回收中被释放。
+ */
+static void sweepyoung(lua_State *L, GCObject **p, GCObject *old) {
+    while (*p != old) {
+        p = sweeplist(L, p, 1);
+    }
+}
+
+/**
+ * @brief 分代模式的次要回收
+ * @param L Lua状态机指针
+ *
+ * 详细说明：
+ * 一次性完成一个只处理年轻对象的周期：
+ * 1. markroot保留记忆集：g->gray中被前向屏障标记的对象、grayagain中
+ *    被后向屏障记录的表和上个周期遍历过的所有线程、weak中的弱表
+ * 2. 传播和原子阶段只会遍历白色（年轻）对象和记忆集，老对象已经是
+ *    黑色，markobject会跳过它们
+ * 3. 字符串表整体清扫（字符串按哈希桶组织，没有年龄顺序）
+ * 4. 对象链表只清扫到上次记录的边界
+ * 5. 执行终结器
+ *
+ * 存活的年轻对象保持标记颜色，从此成为老对象。
+ *
+ * @see fullgen(), markroot(), sweepyoung()
+ */
+static void youngcollection(lua_State *L) {
+    global_State *g = G(L);
+    lu_mem old;
+    lua_assert(g->gcstate == GCSpause);
+
+    markroot(L);
+    propagateall(g);
+    while (g->gcstate == GCSpropagate || g->gcstate == GCSsweepstring) {
+        singlestep(L);
+    }
+
+    old = g->totalbytes;
+    sweepyoung(L, &g->rootgc, g->genold);
+    sweepyoung(L, &g->mainthread->next, g->genoldud);
+    lua_assert(old >= g->totalbytes);
+    g->estimate -= old - g->totalbytes;
+#if defined(LUA_USE_BGFREE)
+    luaM_bgflush(L);
+#endif
+    checkSizes(L);
+    setgenboundary(g);
+    g->gcstate = GCSfinalize;
+
+    while (g->gcstate != GCSpause) {
+        singlestep(L);
+    }
+}
+
+/**
+ * @brief 分代模式的主要回收
+ * @param L Lua状态机指针
+ *
+ * 详细说明：
+ * 先按增量模式清扫整个堆，让老对象变回白色，再在分代模式下完成一个
+ * 完整周期：从头标记所有可达对象，清扫整个堆，存活对象全部成为老
+ * 对象。之后按本次的估计使用量重新设置主要回收阈值。
+ *
+ * @see youngcollection(), whitenall()
+ */
+static void fullgen(lua_State *L) {
+    global_State *g = G(L);
+
+    g->gckind = KGC_INC;
+    whitenall(L);
+    g->gckind = KGC_GEN;
+
+    markroot(L);
+    propagateall(g);
+    while (g->gcstate != GCSpause) {
+        singlestep(L);
+    }
+    g->genmajor = (g->estimate / 100) * (100 + LUAI_GENMAJORMUL);
+}
+
+/**
+ * @brief 分代模式下的一次回收
+ * @param L Lua状态机指针
+ *
+ * 估计使用量超过主要回收阈值时执行完整回收，否则执行次要回收。
+ * 终结器中请求的回收只完成当前周期。
+ */
+static void genstep(lua_State *L) {
+    global_State *g = G(L);
+
+    if (g->gcstate != GCSpause) {
+        while (g->gcstate != GCSpause) {
+            singlestep(L);
+        }
+    } else if (g->estimate > g->genmajor) {
+        fullgen(L);
+    } else {
+        youngcollection(L);
+    }
+    setminorthreshold(g);
+}
+
+void luaC_changemode(lua_State *L, int kind) {
+    global_State *g = G(L);
+
+    if (kind == g->gckind) {
+        return;
+    }
+    if (kind == KGC_GEN) {
+        // 从一次完整回收开始，存活对象全部成为老对象
+        fullgen(L);
+        setminorthreshold(g);
+    } else {
+        // 老对象变回白色，丢弃记忆集，下一个增量周期从头标记
+        g->gckind = KGC_INC;
+        whitenall(L);
+        setthreshold(g);
+    }
+}
+
+#if defined(LUA_USE_PARMARK)
+int luaC_parmark(lua_State *L, int n) {
+    global_State *g = G(L);
+    int old;
+
+    pm_default(g);
+    old = g->parmarkthreads;
+    if (n >= 0 && n != old) {
+        // 线程池按新的线程数在下次使用时重建
+        pm_stop(g);
+        g->parmarkthreads = n;
+    }
+    return old;
+}
+#endif
+
+
 /**
  * @brief 执行增量垃圾回收步进
  * @param L Lua状态机指针
@@ -1930,14 +2849,14 @@ static l_mem singlestep(lua_State *L) {
  * @pre L必须是有效的Lua状态机
  * @post 执行了适量的垃圾回收工作，阈值被适当调整
  *
- * @note 这是增量垃圾回收的用户接口
  * @see singlestep(), setthreshold()
  */
-void luaC_step(lua_State *L) {
+static void incstep(lua_State *L) {
     global_State *g = G(L);
+    l_mem lim;
 
     // 计算本次步进的工作量限制
-    l_mem lim = (GCSTEPSIZE / 100) * g->gcstepmul;
+    lim = (GCSTEPSIZE / 100) * g->gcstepmul;
     if (lim == 0) {
         lim = (MAX_LUMEM - 1) / 2;    // 无限制
     }
@@ -1970,6 +2889,120 @@ void luaC_step(lua_State *L) {
     }
 }
 
+/**
+ * @brief 记录一次步进的耗时
+ */
+#define notestep(g,d)   { if ((d) > (g)->gcmaxstep) (g)->gcmaxstep = (d); }
+
+/**
+ * @brief 按时间预算执行增量步进
+ * @param L Lua状态机指针
+ *
+ * 详细说明：
+ * 执行单步回收直到周期结束或用完g->gcbudget微秒。读时钟的间隔按
+ * 测得的回收速度g->gcrate取预算的八分之一左右的工作量；每次读时钟后
+ * 假设下一段与上一段耗时相同，放不进剩余的预算就停止，所以正常情况下
+ * 不会超出预算。单步本身不可分割（例如原子阶段或释放一大块内存），
+ * 这类单步仍然会超出预算。
+ *
+ * 阈值调整：
+ * 与按工作量步进一样，回收工作与分配量之比保持为gcstepmul%：本次
+ * 完成了work个单位的工作，可以抵偿work * 100 / gcstepmul字节的分配。
+ * 越过阈值后多分配的字节累计在gcdept中，先用本次的工作抵偿；抵偿
+ * 不完时阈值设为当前用量，下次分配就继续步进，每次仍然受预算限制。
+ */
+static void budgetstep(lua_State *L) {
+    global_State *g = G(L);
+    lu_mem budget = (lu_mem)g->gcbudget;
+    lu_mem work = 0, checked = 0, t0, t, last;
+    lu_mem chunk = g->gcrate * budget / 8000;    // 预计预算的1/8
+
+    if (chunk < GCSWEEPCOST) {
+        chunk = GCSWEEPCOST;
+    } else if (chunk > GCSTEPSIZE) {
+        chunk = GCSTEPSIZE;
+    }
+
+    // 累积垃圾回收债务
+    g->gcdept += g->totalbytes - g->GCthreshold;
+
+    luai_gcclock(t0);
+    last = t0;
+    do {
+        work += singlestep(L);
+        if (g->gcstate == GCSpause) {
+            break;    // 回收周期结束
+        }
+        if (work - checked >= chunk) {
+            luai_gcclock(t);
+            if ((t - t0) + (t - last) >= budget) {
+                break;    // 下一段放不进剩余的预算
+            }
+            checked = work;
+            last = t;
+        }
+    } while (1);
+    luai_gcclock(t);
+    notestep(g, t - t0);
+
+    // 更新回收速度（只在有足够的测量时，取新旧两次的平均值）
+    if (t - t0 > 0 && work >= chunk) {
+        lu_mem rate = work * 1000 / (t - t0);
+        g->gcrate = (g->gcrate == 0) ? rate : (g->gcrate + rate) / 2;
+    }
+
+    if (g->gcstate != GCSpause) {
+        lu_mem credit = (g->gcstepmul > 0) ? (work / g->gcstepmul) * 100
+                                           : GCSTEPSIZE;
+        if (g->gcdept >= credit) {
+            // 债务抵偿不完，下次分配时继续步进
+            g->gcdept -= credit;
+            g->GCthreshold = g->totalbytes;
+        } else {
+            credit -= g->gcdept;
+            g->gcdept = 0;
+            g->GCthreshold = g->totalbytes +
+                             (credit > GCSTEPSIZE ? credit : GCSTEPSIZE);
+        }
+    } else {
+        setthreshold(g);
+    }
+}
+
+/**
+ * @brief 执行一次垃圾回收步进
+ * @param L Lua状态机指针
+ *
+ * 详细说明：
+ * 内存使用超过GCthreshold时由luaC_checkGC调用。分代模式执行一次
+ * 次要或主要回收；增量模式设置了时间预算时按时间步进，否则按
+ * gcstepmul计算的工作量步进。按时间步进时耗时总是计入g->gcmaxstep；
+ * 其他步进只在用LUA_GCMAXSTEP开启统计后才读时钟。
+ *
+ * @see incstep(), budgetstep(), genstep()
+ */
+void luaC_step(lua_State *L) {
+    global_State *g = G(L);
+    lu_mem t0 = 0, t1;
+
+    if (!isgenerational(g) && g->gcbudget > 0) {
+        budgetstep(L);
+        return;
+    }
+    if (g->gcstats) {
+        luai_gcclock(t0);
+    }
+    if (isgenerational(g)) {
+        genstep(L);
+    } else {
+        incstep(L);
+    }
+    if (g->gcstats) {
+        luai_gcclock(t1);
+        notestep(g, t1 - t0);
+    }
+}
+
 
 /**
  * @brief 执行完整的垃圾回收周期
@@ -2027,29 +3060,19 @@ void luaC_step(lua_State *L) {
 void luaC_fullgc(lua_State *L) {
     global_State *g = G(L);
 
-    // 如果当前在标记阶段，跳过到清扫阶段
-    if (g->gcstate <= GCSpropagate) {
-        // 重置清扫标记，准备清扫所有元素
-        g->sweepstrgc = 0;
-        g->sweepgc = &g->rootgc;
-
-        // 重置收集器列表
-        g->gray = NULL;
-        g->grayagain = NULL;
-        g->weak = NULL;
-        g->gcstate = GCSsweepstring;
+    if (isgenerational(g)) {
+        fullgen(L);
+        setminorthreshold(g);
+        return;
     }
 
-    lua_assert(g->gcstate != GCSpause && g->gcstate != GCSpropagate);
-
     // 第一阶段：完成任何待处理的清扫工作
-    while (g->gcstate != GCSfinalize) {
-        lua_assert(g->gcstate == GCSsweepstring || g->gcstate == GCSsweep);
-        singlestep(L);
-    }
+    whitenall(L);
 
-    // 第二阶段：开始新的完整回收周期
+    // 第二阶段：开始新的完整回收周期；不需要增量执行，一次传播完
+    // 灰色列表（启用并行标记时由多个线程完成）
     markroot(L);
+    propagateall(g);
     while (g->gcstate != GCSpause) {
         singlestep(L);
     }
@@ -2099,12 +3122,13 @@ void luaC_fullgc(lua_State *L) {
 void luaC_barrierf(lua_State *L, GCObject *o, GCObject *v) {
     global_State *g = G(L);
     lua_assert(isblack(o) && iswhite(v) && !isdead(g, v) && !isdead(g, o));
-    lua_assert(g->gcstate != GCSfinalize && g->gcstate != GCSpause);
-    lua_assert(ttype(&o->gch) != LUA_TTABLE);
+    lua_assert(isgenerational(g) ||
+               (g->gcstate != GCSfinalize && g->gcstate != GCSpause));
+    lua_assert(o->gch.tt != LUA_TTABLE);
 
     // 根据垃圾回收状态选择策略
-    if (g->gcstate == GCSpropagate) {
-        // 传播阶段：标记白色对象，恢复不变式
+    if (keepinvariant(g)) {
+        // 传播阶段或分代模式：标记白色对象，恢复不变式
         reallymarkobject(g, v);
     } else {
         // 其他阶段：将黑色对象标记为白色，避免后续屏障
@@ -2149,9 +3173,10 @@ void luaC_barrierback(lua_State *L, Table *t) {
     global_State *g = G(L);
     GCObject *o = obj2gco(t);
     lua_assert(isblack(o) && !isdead(g, o));
-    lua_assert(g->gcstate != GCSfinalize && g->gcstate != GCSpause);
+    lua_assert(isgenerational(g) ||
+               (g->gcstate != GCSfinalize && g->gcstate != GCSpause));
 
-    // 将表重新标记为灰色
+    // 将表重新标记为灰色；分代模式下grayagain同时是老表的记忆集
     black2gray(o);
 
     // 加入grayagain列表，等待原子阶段重新处理
@@ -2234,8 +3259,8 @@ void luaC_linkupval(lua_State *L, UpVal *uv) {
 
     // 如果上值是灰色的，需要特殊处理
     if (isgray(o)) {
-        if (g->gcstate == GCSpropagate) {
-            // 传播阶段：转为黑色，闭合上值需要屏障
+        if (keepinvariant(g)) {
+            // 传播阶段或分代模式（老的开放上值）：转为黑色，闭合上值需要屏障
             gray2black(o);
             luaC_barrier(L, uv, uv->v);
         } else {
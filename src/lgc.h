@@ -144,6 +144,25 @@
  */
 #define GCSfinalize     4
 
+/**
+ * @name 回收器模式
+ * @brief global_State::gckind的取值
+ *
+ * 详细说明：
+ * 分代模式下，经历过一次回收的对象保持黑色（或灰色），成为老对象；
+ * 新分配的对象是白色的年轻对象。次要回收只从根、记忆集（grayagain上
+ * 被后向屏障记录的表、所有线程和弱表）以及屏障标记过的对象出发标记，
+ * 不重新遍历老对象，清扫时也只清扫rootgc和用户数据链表中上次回收
+ * 之后新链入的那一段。老对象的内存只由主要回收（完整周期）释放。
+ * @{
+ */
+#define KGC_INC         0   /**< 增量模式：每个周期标记整个堆 */
+#define KGC_GEN         1   /**< 分代模式：次要回收只处理年轻对象 */
+/** @} */
+
+/** @brief 是否处于分代模式 */
+#define isgenerational(g)   ((g)->gckind == KGC_GEN)
+
 /**
  * @brief 位操作工具宏集合：提供高效的位掩码操作功能
  * 
@@ -731,7 +750,7 @@ LUAI_FUNC void luaC_freeall(lua_State *L);
  * 
  * 工作量控制：
  * - 每步的工作量由GC参数控制
- * - 根据可用时间动态调整工作量
+ * - 设置了时间预算（LUA_GCSETBUDGET）时按时钟限制每步的时间
  * - 平衡GC效率和程序响应性
  * 
  * 自适应策略：
@@ -787,6 +806,38 @@ LUAI_FUNC void luaC_step(lua_State *L);
  */
 LUAI_FUNC void luaC_fullgc(lua_State *L);
 
+/**
+ * @brief 切换回收器模式
+ *
+ * 详细说明：
+ * 切换到分代模式时先执行一次完整回收，所有存活对象成为老对象；
+ * 切换回增量模式时清扫整个堆，把老对象变回白色，下一个增量周期
+ * 从头标记。模式不变时什么都不做。
+ *
+ * @param L lua_State指针，当前Lua虚拟机状态
+ * @param kind KGC_INC或KGC_GEN
+ *
+ * @see lua_gc(), LUA_GCGEN, LUA_GCINC
+ */
+LUAI_FUNC void luaC_changemode(lua_State *L, int kind);
+
+#if defined(LUA_USE_PARMARK)
+/**
+ * @brief 设置并行标记的辅助线程数
+ *
+ * 详细说明：
+ * n为0时关闭并行标记，负数只查询。线程数改变时结束现有的辅助线程，
+ * 下次需要时按新的数目创建。
+ *
+ * @param L lua_State指针，当前Lua虚拟机状态
+ * @param n 辅助线程数
+ * @return 之前的辅助线程数
+ *
+ * @see lua_gc(), LUA_GCPARMARK, LUAI_PARMARKTHREADS
+ */
+LUAI_FUNC int luaC_parmark(lua_State *L, int n);
+#endif
+
 /**
  * @brief 链接对象到GC：将新创建的对象加入垃圾收集管理
  * 
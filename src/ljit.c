@@ -0,0 +1,1153 @@
+﻿/**
+ * @file ljit.c
+ * @brief 基线模板JIT：把热点函数原型翻译为x86-64机器码
+ *
+ * 详细说明：
+ * 翻译以指令为单位，一条字节码对应一段固定的机器码模板，模板之间
+ * 按字节码顺序排列，跳转直接连到目标指令的模板。没有寄存器分配：
+ * Lua寄存器始终保存在Lua栈上，机器码只在固定的宿主寄存器里保存
+ * 几个基址。
+ *
+ * 宿主寄存器约定（均为被调用者保存寄存器，C辅助函数不会破坏）：
+ * - rbx：lua_State *L
+ * - r12：L->base，每次调用辅助函数后重新加载（栈可能被重新分配）
+ * - r13：常量表k
+ * - r14：当前LClosure
+ *
+ * 指令分三类：
+ * 1. 内联模板：MOVE、LOADK、LOADBOOL、LOADNIL、GETUPVAL、JMP、
+ *    FORLOOP，以及数字操作数上的ADD/SUB/MUL/DIV、EQ/LT/LE、TEST/TESTSET
+ *    （类型不符时转入辅助函数）
+ * 2. 辅助函数：表访问、全局变量、闭包、连接等，C函数的实现与lvm.c中
+ *    对应分支逐行一致，并像Protect一样设置L->savedpc
+ * 3. 退出：CALL、TAILCALL、RETURN以及LEN的元方法路径，把当前指令
+ *    写入L->savedpc后返回，由解释器执行该指令
+ *
+ * 钩子：
+ * 机器码不检查行钩子和计数钩子。向后跳转前、以及可能执行Lua代码的
+ * 辅助函数返回后检查L->hookmask，一旦设置了这两种钩子就在下一条
+ * 指令处退出，解释器随后以插桩变体继续执行。检查位置与解释器刷新
+ * 钩子陷阱的安全点相同。
+ *
+ * 可执行内存：
+ * 每个原型一块独立的匿名映射，写入完成后改为只读可执行（W^X）。
+ * 辅助表（入口偏移、跳转修正）从Lua分配器申请并计入totalbytes。
+ *
+ * @author Lua开发团队
+ * @version 5.1.5
+ *
+ * @see ljit.h, lvm.c
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#define ljit_c
+#define LUA_CORE
+
+#include "lua.h"
+
+#if defined(LUA_USE_JIT)
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ldebug.h"
+#include "ldo.h"
+#include "lfunc.h"
+#include "lgc.h"
+#include "ljit.h"
+#include "lmem.h"
+#include "lobject.h"
+#include "lopcodes.h"
+#include "lstate.h"
+#include "lstring.h"
+#include "ltable.h"
+#include "ltm.h"
+#include "lvm.h"
+
+
+/**
+ * @name 编译结果
+ * @{
+ */
+
+/** @brief 机器码入口：prologue保存寄存器后跳转到entry */
+typedef void (*JitFunc)(lua_State *L, const void *entry, TValue *k,
+                        LClosure *cl);
+
+/** @brief 向前跳转的修正项：rel32字段位置和目标指令 */
+typedef struct JitFixup {
+    int pos;
+    int target;
+} JitFixup;
+
+/**
+ * @brief 一个函数原型的编译结果
+ *
+ * entry与code平行，记录每条指令模板在mcode中的偏移；SETLIST的数据字
+ * 和CLOSURE后面的上值伪指令不可进入，记为-1。fix只在编译期间使用。
+ */
+typedef struct JitCode {
+    unsigned char *mcode;   /* 机器码映射 */
+    size_t msize;           /* 映射大小 */
+    JitFunc fn;             /* mcode的函数指针形式 */
+    int *entry;             /* 指令入口偏移 */
+    int sizeentry;
+    JitFixup *fix;          /* 跳转修正表（编译期间） */
+    int sizefix;
+} JitCode;
+
+/** @} */
+
+
+/**
+ * @name 机器码缓冲与编码
+ * @{
+ */
+
+/** @brief 单条指令模板的长度上限（LOADNIL按寄存器数另算） */
+#define JIT_MAXINS      384
+
+/** @brief prologue与epilogue的长度上限 */
+#define JIT_HEADSIZE    64
+
+/** @brief 单条指令最多产生的跳转修正项数 */
+#define JIT_MAXFIX      4
+
+typedef struct JitState {
+    Proto *p;
+    JitCode *jc;
+    unsigned char *code;    /* 写入中的映射 */
+    size_t pos;             /* 当前写入位置 */
+    int nfix;               /* 已使用的修正项 */
+    int epilogue;           /* epilogue偏移 */
+} JitState;
+
+/* 宿主寄存器编号 */
+#define RAX     0
+#define RBX     3
+#define R12     12
+#define R13     13
+#define R14     14
+
+#define RL      RBX     /* lua_State *L */
+#define RBASE   R12     /* L->base */
+#define RK      R13     /* 常量表 */
+#define RCL     R14     /* 当前闭包 */
+
+/* 条件码（Jcc的低4位） */
+#define CC_B    0x2
+#define CC_AE   0x3
+#define CC_E    0x4
+#define CC_NE   0x5
+#define CC_BE   0x6
+#define CC_A    0x7
+#define CC_P    0xA
+
+#define TVOFF(r)    (cast_int(sizeof(TValue)) * (r))
+#define TTOFF       cast_int(offsetof(TValue, tt))
+#define LOFF(f)     cast_int(offsetof(lua_State, f))
+
+static void e8(JitState *J, int b)
+{
+    J->code[J->pos++] = cast(unsigned char, b);
+}
+
+static void e32(JitState *J, int v)
+{
+    memcpy(J->code + J->pos, &v, 4);
+    J->pos += 4;
+}
+
+static void e64(JitState *J, size_t v)
+{
+    memcpy(J->code + J->pos, &v, 8);
+    J->pos += 8;
+}
+
+/**
+ * @brief 编码"寄存器/内存"形式的指令：op reg, [base+disp32]
+ *
+ * @param pfx 强制前缀（0x66/0xF2/0xF3），0表示无
+ * @param w 是否为64位操作（REX.W）
+ * @param op1 操作码第一字节
+ * @param op2 操作码第二字节，-1表示单字节操作码
+ * @param reg ModRM.reg字段（寄存器或/digit扩展）
+ * @param base 基址寄存器
+ * @param disp 偏移
+ */
+static void emit_rm(JitState *J, int pfx, int w, int op1, int op2,
+                    int reg, int base, int disp)
+{
+    int rex = (w ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((base & 8) ? 1 : 0);
+    if (pfx)
+        e8(J, pfx);
+    if (rex)
+        e8(J, 0x40 | rex);
+    e8(J, op1);
+    if (op2 >= 0)
+        e8(J, op2);
+    e8(J, 0x80 | ((reg & 7) << 3) | (base & 7));
+    if ((base & 7) == 4)
+        e8(J, 0x24);        /* r12需要SIB字节 */
+    e32(J, disp);
+}
+
+#define movdqu_ld(J,x,b,d)  emit_rm(J, 0xF3, 0, 0x0F, 0x6F, x, b, d)
+#define movdqu_st(J,b,d,x)  emit_rm(J, 0xF3, 0, 0x0F, 0x7F, x, b, d)
+#define movsd_ld(J,x,b,d)   emit_rm(J, 0xF2, 0, 0x0F, 0x10, x, b, d)
+#define movsd_st(J,b,d,x)   emit_rm(J, 0xF2, 0, 0x0F, 0x11, x, b, d)
+#define sse_arith(J,o,x,b,d) emit_rm(J, 0xF2, 0, 0x0F, o, x, b, d)
+#define ucomisd_m(J,x,b,d)  emit_rm(J, 0x66, 0, 0x0F, 0x2E, x, b, d)
+#define mov_ld(J,r,b,d)     emit_rm(J, 0, 1, 0x8B, -1, r, b, d)
+#define mov_st(J,b,d,r)     emit_rm(J, 0, 1, 0x89, -1, r, b, d)
+#define cmp32_i8(J,b,d,v)   (emit_rm(J, 0, 0, 0x83, -1, 7, b, d), e8(J, v))
+#define mov32_i32(J,b,d,v)  (emit_rm(J, 0, 0, 0xC7, -1, 0, b, d), e32(J, v))
+#define test8_i8(J,b,d,v)   (emit_rm(J, 0, 0, 0xF6, -1, 0, b, d), e8(J, v))
+
+/* ucomisd xmm_a, xmm_b */
+#define ucomisd_rr(J,a,b) \
+    (e8(J, 0x66), e8(J, 0x0F), e8(J, 0x2E), e8(J, 0xC0 | ((a) << 3) | (b)))
+
+/** @brief 函数内部的向前条件跳转，返回待修正的rel32位置 */
+static int jcc_fwd(JitState *J, int cc)
+{
+    e8(J, 0x0F);
+    e8(J, 0x80 | cc);
+    e32(J, 0);
+    return cast_int(J->pos) - 4;
+}
+
+/** @brief 函数内部的向前无条件跳转 */
+static int jmp_fwd(JitState *J)
+{
+    e8(J, 0xE9);
+    e32(J, 0);
+    return cast_int(J->pos) - 4;
+}
+
+/** @brief 把向前跳转连到当前位置 */
+static void here(JitState *J, int at)
+{
+    int rel = cast_int(J->pos) - (at + 4);
+    memcpy(J->code + at, &rel, 4);
+}
+
+/** @brief 记录一个跳到字节码target处的rel32，编译结束后统一修正 */
+static void addfixup(JitState *J, int target)
+{
+    JitFixup *f;
+    lua_assert(J->nfix < J->jc->sizefix);
+    f = &J->jc->fix[J->nfix++];
+    f->pos = cast_int(J->pos) - 4;
+    f->target = target;
+}
+
+static void jmp_pc(JitState *J, int target)
+{
+    e8(J, 0xE9);
+    e32(J, 0);
+    addfixup(J, target);
+}
+
+/**
+ * @brief 退出到解释器：L->savedpc = &code[n]，然后经epilogue返回
+ */
+static void emit_exit(JitState *J, int n)
+{
+    e8(J, 0x48);
+    e8(J, 0xB8);
+    e64(J, cast(size_t, J->p->code + n));   /* mov rax, pc */
+    mov_st(J, RL, LOFF(savedpc), RAX);
+    e8(J, 0xE9);
+    e32(J, J->epilogue - (cast_int(J->pos) + 4));
+}
+
+/**
+ * @brief 设置了行/计数钩子时在字节码n处退出
+ *
+ * 放在可能执行任意Lua代码（元方法、终结器）的辅助函数之后，对应
+ * 解释器Protect中的updatetrap。
+ */
+static void emit_hookexit(JitState *J, int n)
+{
+    int go;
+    test8_i8(J, RL, LOFF(hookmask), LUA_MASKLINE | LUA_MASKCOUNT);
+    go = jcc_fwd(J, CC_E);
+    emit_exit(J, n);
+    here(J, go);
+}
+
+/**
+ * @brief 跳转到字节码target
+ *
+ * 向后跳转（循环回跳）前检查行/计数钩子，设置了就在目标处退出，
+ * 对应解释器dojump中的updatetrap。
+ */
+static void emit_goto(JitState *J, int target, int n)
+{
+    if (target <= n)
+        emit_hookexit(J, target);
+    jmp_pc(J, target);
+}
+
+/**
+ * @brief 调用辅助函数 fn(L, i, pc)，pc指向下一条指令，返回后重新加载base
+ */
+static void emit_call(JitState *J, const void *fn, int n)
+{
+    e8(J, 0x48); e8(J, 0x89); e8(J, 0xDF);              /* mov rdi, rbx */
+    e8(J, 0xBE); e32(J, cast_int(J->p->code[n]));       /* mov esi, i */
+    e8(J, 0x48); e8(J, 0xBA);
+    e64(J, cast(size_t, J->p->code + n + 1));           /* mov rdx, pc */
+    e8(J, 0x48); e8(J, 0xB8);
+    e64(J, cast(size_t, fn));                           /* mov rax, fn */
+    e8(J, 0xFF); e8(J, 0xD0);                           /* call rax */
+    mov_ld(J, RBASE, RL, LOFF(base));
+}
+
+/** @brief 下一条指令：跳过SETLIST的数据字和CLOSURE的上值伪指令 */
+static int nextins(const Proto *p, int n)
+{
+    Instruction i = p->code[n];
+    if (GET_OPCODE(i) == OP_SETLIST && GETARG_C(i) == 0)
+        return n + 2;
+    else if (GET_OPCODE(i) == OP_CLOSURE)
+        return n + 1 + p->p[GETARG_Bx(i)]->nups;
+    return n + 1;
+}
+
+/* 不会执行Lua代码的辅助函数 */
+#define emit_leaf(J,f,n)    emit_call(J, cast(const void *, (size_t)(f)), n)
+
+/* 可能执行Lua代码的辅助函数：返回后检查钩子 */
+#define emit_helper(J,f,n) \
+    (emit_leaf(J, f, n), emit_hookexit(J, nextins((J)->p, n)))
+
+/* test eax, eax */
+#define test_eax(J)     (e8(J, 0x85), e8(J, 0xC0))
+
+/** @} */
+
+
+/**
+ * @name 辅助函数
+ * @brief 非内联指令的C实现，与lvm.c中的对应分支保持一致
+ *
+ * 参数统一为(L, i, pc)：i是当前指令，pc指向下一条指令（与解释器中
+ * 执行该指令时的pc相同）。
+ * @{
+ */
+
+#define curcl(L)    (&clvalue((L)->ci->func)->l)
+
+#define RA(i)   (base+GETARG_A(i))
+#define RB(i)   (base+GETARG_B(i))
+#define RKB(i)  (ISK(GETARG_B(i)) ? k+INDEXK(GETARG_B(i)) : base+GETARG_B(i))
+#define RKC(i)  (ISK(GETARG_C(i)) ? k+INDEXK(GETARG_C(i)) : base+GETARG_C(i))
+#define KBx(i)  (k+GETARG_Bx(i))
+#define ICACHE() (cl->p->icache + (pc - cl->p->code - 1))
+
+/* 内联缓存探测，与lvm.c中的icprobe相同 */
+static const TValue *icprobe(Table *h, TString *key, const int *ic)
+{
+    Node *n = gnode(h, lmod(*ic, sizenode(h)));
+    if (ttisstring(gkey(n)) && rawtsvalue(gkey(n)) == key && !ttisnil(gval(n)))
+        return gval(n);
+    return NULL;
+}
+
+static void jit_getglobal(lua_State *L, Instruction i, const Instruction *pc)
+{
+    LClosure *cl = curcl(L);
+    StkId base = L->base;
+    TValue *k = cl->p->k;
+    const TValue *res = icprobe(cl->env, rawtsvalue(KBx(i)), ICACHE());
+    TValue g;
+    if (res != NULL) {
+        setobj2s(L, RA(i), res);
+        return;
+    }
+    sethvalue(L, &g, cl->env);
+    L->savedpc = pc;
+    luaV_gettablestr(L, &g, KBx(i), RA(i), ICACHE());
+}
+
+static void jit_gettable(lua_State *L, Instruction i, const Instruction *pc)
+{
+    LClosure *cl = curcl(L);
+    StkId base = L->base;
+    TValue *k = cl->p->k;
+    StkId rb = RB(i);
+    TValue *rc = RKC(i);
+    L->savedpc = pc;
+    if (ISK(GETARG_C(i)) && ttisstring(rc)) {
+        const TValue *res;
+        if (ttistable(rb) &&
+            (res = icprobe(hvalue(rb), rawtsvalue(rc), ICACHE())) != NULL) {
+            setobj2s(L, RA(i), res);
+        }
+        else
+            luaV_gettablestr(L, rb, rc, RA(i), ICACHE());
+    }
+    else
+        luaV_gettable(L, rb, rc, RA(i));
+}
+
+static void jit_setglobal(lua_State *L, Instruction i, const Instruction *pc)
+{
+    LClosure *cl = curcl(L);
+    StkId base = L->base;
+    TValue *k = cl->p->k;
+    TValue g;
+    sethvalue(L, &g, cl->env);
+    L->savedpc = pc;
+    luaV_settable(L, &g, KBx(i), RA(i));
+}
+
+static void jit_setupval(lua_State *L, Instruction i, const Instruction *pc)
+{
+    LClosure *cl = curcl(L);
+    StkId base = L->base;
+    UpVal *uv = cl->upvals[GETARG_B(i)];
+    L->savedpc = pc;
+    setobj(L, uv->v, RA(i));
+    luaC_barrier(L, uv, RA(i));
+}
+
+static void jit_settable(lua_State *L, Instruction i, const Instruction *pc)
+{
+    LClosure *cl = curcl(L);
+    StkId base = L->base;
+    TValue *k = cl->p->k;
+    StkId ra = RA(i);
+    TValue *rb = RKB(i);
+    TValue *rc = RKC(i);
+    L->savedpc = pc;
+    if (ISK(GETARG_B(i)) && ttisstring(rb) && ttistable(ra) &&
+        !ttisrope(rc)) {
+        /* 已存在的键：原地赋值 */
+        Table *h = hvalue(ra);
+        TValue *oldval = cast(TValue *,
+            luaH_getstrhint(h, rawtsvalue(rb), ICACHE()));
+        if (!ttisnil(oldval)) {
+            setobj2t(L, oldval, rc);
+            h->flags = 0;
+            luaC_barriert(L, h, rc);
+            return;
+        }
+    }
+    luaV_settable(L, ra, rb, rc);
+}
+
+static void jit_newtable(lua_State *L, Instruction i, const Instruction *pc)
+{
+    StkId base = L->base;
+    int b = GETARG_B(i);
+    int c = GETARG_C(i);
+    L->savedpc = pc;
+    sethvalue(L, RA(i), luaH_new(L, luaO_fb2int(b), luaO_fb2int(c)));
+    luaC_checkGC(L);
+}
+
+static void jit_self(lua_State *L, Instruction i, const Instruction *pc)
+{
+    LClosure *cl = curcl(L);
+    StkId base = L->base;
+    TValue *k = cl->p->k;
+    StkId ra = RA(i);
+    StkId rb = RB(i);
+    TValue *rc = RKC(i);
+    L->savedpc = pc;
+    setobjs2s(L, ra + 1, rb);
+    if (ISK(GETARG_C(i)) && ttisstring(rc)) {
+        const TValue *res;
+        if (ttistable(rb) &&
+            (res = icprobe(hvalue(rb), rawtsvalue(rc), ICACHE())) != NULL) {
+            setobj2s(L, ra, res);
+        }
+        else
+            luaV_gettablestr(L, rb, rc, ra, ICACHE());
+    }
+    else
+        luaV_gettable(L, rb, rc, ra);
+}
+
+/* ADD至UNM：操作码与元方法事件的顺序相同 */
+static void jit_arith(lua_State *L, Instruction i, const Instruction *pc)
+{
+    LClosure *cl = curcl(L);
+    StkId base = L->base;
+    TValue *k = cl->p->k;
+    OpCode op = GET_OPCODE(i);
+    TValue *rb = RKB(i);
+    TValue *rc = (op == OP_UNM) ? rb : RKC(i);
+    L->savedpc = pc;
+    luaV_arith(L, RA(i), rb, rc, cast(TMS, TM_ADD + (op - OP_ADD)));
+}
+
+static void jit_not(lua_State *L, Instruction i, const Instruction *pc)
+{
+    StkId base = L->base;
+    int res = l_isfalse(RB(i));
+    UNUSED(pc);
+    setbvalue(RA(i), res);
+}
+
+/* 返回0表示需要元方法，由解释器执行 */
+static int jit_len(lua_State *L, Instruction i, const Instruction *pc)
+{
+    StkId base = L->base;
+    const TValue *rb = RB(i);
+    L->savedpc = pc;
+    switch (ttype(rb)) {
+        case LUA_TTABLE: {
+            setnvalue(RA(i), cast_num(luaH_getn(hvalue(rb))));
+            return 1;
+        }
+        case LUA_TSTRING: {
+            setnvalue(RA(i), cast_num(tsvalue(rb)->len));
+            return 1;
+        }
+        case LUA_TROPE: {
+            setnvalue(RA(i), cast_num(ropevalue(rb)->len));
+            return 1;
+        }
+        default: {
+            return 0;
+        }
+    }
+}
+
+static void jit_concat(lua_State *L, Instruction i, const Instruction *pc)
+{
+    StkId base;
+    int b = GETARG_B(i);
+    int c = GETARG_C(i);
+    L->savedpc = pc;
+    luaV_lazyconcat(L, c - b + 1, c);
+    luaC_checkGC(L);
+    base = L->base;
+    setobjs2s(L, RA(i), base + b);
+}
+
+static int jit_eq(lua_State *L, Instruction i, const Instruction *pc)
+{
+    LClosure *cl = curcl(L);
+    StkId base = L->base;
+    TValue *k = cl->p->k;
+    L->savedpc = pc;
+    return equalobj(L, RKB(i), RKC(i)) == GETARG_A(i);
+}
+
+static int jit_lt(lua_State *L, Instruction i, const Instruction *pc)
+{
+    LClosure *cl = curcl(L);
+    StkId base = L->base;
+    TValue *k = cl->p->k;
+    L->savedpc = pc;
+    return luaV_lessthan(L, RKB(i), RKC(i)) == GETARG_A(i);
+}
+
+static int jit_le(lua_State *L, Instruction i, const Instruction *pc)
+{
+    LClosure *cl = curcl(L);
+    StkId base = L->base;
+    TValue *k = cl->p->k;
+    L->savedpc = pc;
+    return luaV_lessequal(L, RKB(i), RKC(i)) == GETARG_A(i);
+}
+
+static void jit_forprep(lua_State *L, Instruction i, const Instruction *pc)
+{
+    StkId base = L->base;
+    StkId ra = RA(i);
+    const TValue *init = ra;
+    const TValue *plimit = ra + 1;
+    const TValue *pstep = ra + 2;
+    L->savedpc = pc;
+    luaS_flatobj(L, ra);
+    luaS_flatobj(L, ra + 1);
+    luaS_flatobj(L, ra + 2);
+    if (!tonumber(init, ra))
+        luaG_runerror(L, LUA_QL("for") " initial value must be a number");
+    else if (!tonumber(plimit, ra + 1))
+        luaG_runerror(L, LUA_QL("for") " limit must be a number");
+    else if (!tonumber(pstep, ra + 2))
+        luaG_runerror(L, LUA_QL("for") " step must be a number");
+    setnvalue(ra, luai_numsub(nvalue(ra), nvalue(pstep)));
+}
+
+/* 返回1表示继续循环 */
+static int jit_tforloop(lua_State *L, Instruction i, const Instruction *pc)
+{
+    StkId base = L->base;
+    StkId ra = RA(i);
+    StkId cb = ra + 3;
+    setobjs2s(L, cb + 2, ra + 2);
+    setobjs2s(L, cb + 1, ra + 1);
+    setobjs2s(L, cb, ra);
+    L->top = cb + 3;
+    L->savedpc = pc;
+    luaD_call(L, cb, GETARG_C(i));
+    L->top = L->ci->top;
+    base = L->base;
+    cb = RA(i) + 3;
+    if (!ttisnil(cb)) {
+        setobjs2s(L, cb - 1, cb);
+        return 1;
+    }
+    return 0;
+}
+
+static void jit_setlist(lua_State *L, Instruction i, const Instruction *pc)
+{
+    StkId base = L->base;
+    StkId ra = RA(i);
+    int n = GETARG_B(i);
+    int c = GETARG_C(i);
+    int last;
+    Table *h;
+    L->savedpc = pc;
+    if (n == 0) {
+        n = cast_int(L->top - ra) - 1;
+        L->top = L->ci->top;
+    }
+    if (c == 0)
+        c = cast_int(*pc);
+    if (!ttistable(ra))
+        return;
+    h = hvalue(ra);
+    last = ((c - 1) * LFIELDS_PER_FLUSH) + n;
+    if (last > h->sizearray)
+        luaH_resizearray(L, h, last);
+    for (; n > 0; n--) {
+        TValue *val = ra + n;
+        luaS_flatobj(L, val);
+        setobj2t(L, luaH_setnum(L, h, last--), val);
+        luaC_barriert(L, h, val);
+    }
+}
+
+static void jit_close(lua_State *L, Instruction i, const Instruction *pc)
+{
+    StkId base = L->base;
+    L->savedpc = pc;
+    luaF_close(L, RA(i));
+}
+
+static void jit_closure(lua_State *L, Instruction i, const Instruction *pc)
+{
+    LClosure *cl = curcl(L);
+    StkId base = L->base;
+    Proto *p = cl->p->p[GETARG_Bx(i)];
+    int nup = p->nups;
+    Closure *ncl;
+    int j;
+    L->savedpc = pc;
+    ncl = luaF_newLclosure(L, nup, cl->env);
+    ncl->l.p = p;
+    for (j = 0; j < nup; j++, pc++) {
+        if (GET_OPCODE(*pc) == OP_GETUPVAL)
+            ncl->l.upvals[j] = cl->upvals[GETARG_B(*pc)];
+        else {
+            lua_assert(GET_OPCODE(*pc) == OP_MOVE);
+            ncl->l.upvals[j] = luaF_findupval(L, base + GETARG_B(*pc));
+        }
+    }
+    setclvalue(L, RA(i), ncl);
+    L->savedpc = pc;
+    luaC_checkGC(L);
+}
+
+static void jit_vararg(lua_State *L, Instruction i, const Instruction *pc)
+{
+    LClosure *cl = curcl(L);
+    StkId base = L->base;
+    StkId ra = RA(i);
+    CallInfo *ci = L->ci;
+    int b = GETARG_B(i) - 1;
+    int n = cast_int(ci->base - ci->func) - cl->p->numparams - 1;
+    int j;
+    L->savedpc = pc;
+    if (b == LUA_MULTRET) {
+        luaD_checkstack(L, n);
+        base = L->base;
+        ra = RA(i);
+        b = n;
+        L->top = ra + n;
+    }
+    for (j = 0; j < b; j++) {
+        if (j < n) {
+            setobjs2s(L, ra + j, ci->base - n + j);
+        }
+        else {
+            setnilvalue(ra + j);
+        }
+    }
+}
+
+/** @} */
+
+
+/**
+ * @name 指令模板
+ * @{
+ */
+
+/** @brief 取RK操作数的地址：常量在r13，寄存器在r12 */
+static void rkaddr(int x, int *reg, int *disp)
+{
+    if (ISK(x)) {
+        *reg = RK;
+        *disp = TVOFF(INDEXK(x));
+    }
+    else {
+        *reg = RBASE;
+        *disp = TVOFF(x);
+    }
+}
+
+/** @brief RK操作数是否可能是数字（非数字常量永远走辅助函数） */
+static int maybenum(const Proto *p, int x)
+{
+    return !ISK(x) || ttisnumber(&p->k[INDEXK(x)]);
+}
+
+/**
+ * @brief 检查寄存器操作数是否为数字，不是则跳到slow（常量已静态确认）
+ */
+static void checknum(JitState *J, int x, int *slow, int *nslow)
+{
+    if (!ISK(x)) {
+        cmp32_i8(J, RBASE, TVOFF(x) + TTOFF, LUA_TNUMBER);
+        slow[(*nslow)++] = jcc_fwd(J, CC_NE);
+    }
+}
+
+/** @brief ADD/SUB/MUL/DIV：两个数字时用SSE2计算，否则jit_arith */
+static void emit_arith(JitState *J, int n, int sseop)
+{
+    Instruction i = J->p->code[n];
+    int b = GETARG_B(i), c = GETARG_C(i);
+    int slow[2], nslow = 0, done, k;
+    int rb, db, rc, dc;
+    if (!maybenum(J->p, b) || !maybenum(J->p, c)) {
+        emit_helper(J, jit_arith, n);
+        return;
+    }
+    rkaddr(b, &rb, &db);
+    rkaddr(c, &rc, &dc);
+    checknum(J, b, slow, &nslow);
+    checknum(J, c, slow, &nslow);
+    movsd_ld(J, 0, rb, db);
+    sse_arith(J, sseop, 0, rc, dc);
+    movsd_st(J, RBASE, TVOFF(GETARG_A(i)), 0);
+    mov32_i32(J, RBASE, TVOFF(GETARG_A(i)) + TTOFF, LUA_TNUMBER);
+    if (nslow == 0)
+        return;
+    done = jmp_fwd(J);
+    for (k = 0; k < nslow; k++)
+        here(J, slow[k]);
+    emit_helper(J, jit_arith, n);
+    here(J, done);
+}
+
+/**
+ * @brief EQ/LT/LE与其后的JMP
+ *
+ * 条件成立（与A相符）时跳到JMP的目标，否则跳过JMP。数字比较用
+ * ucomisd，操作数顺序和条件码的选择保证任何一方为NaN时比较结果为假，
+ * 与C中的<、<=、==一致。
+ */
+static void emit_compare(JitState *J, int n)
+{
+    Instruction i = J->p->code[n];
+    OpCode op = GET_OPCODE(i);
+    int a = GETARG_A(i), b = GETARG_B(i), c = GETARG_C(i);
+    int target = n + 2 + GETARG_sBx(J->p->code[n + 1]);
+    int take[3], ntake = 0, slow[2], nslow = 0, k;
+    if (maybenum(J->p, b) && maybenum(J->p, c)) {
+        int rb, db, rc, dc;
+        rkaddr(b, &rb, &db);
+        rkaddr(c, &rc, &dc);
+        checknum(J, b, slow, &nslow);
+        checknum(J, c, slow, &nslow);
+        if (op == OP_EQ) {
+            movsd_ld(J, 0, rb, db);
+            ucomisd_m(J, 0, rc, dc);
+            if (a) {
+                int ne = jcc_fwd(J, CC_P);
+                take[ntake++] = jcc_fwd(J, CC_E);
+                here(J, ne);
+            }
+            else {
+                take[ntake++] = jcc_fwd(J, CC_P);
+                take[ntake++] = jcc_fwd(J, CC_NE);
+            }
+        }
+        else {
+            /* c与b比较：b < c即c > b（A），b <= c即c >= b（AE） */
+            int cc = (op == OP_LT) ? CC_A : CC_AE;
+            movsd_ld(J, 0, rc, dc);
+            ucomisd_m(J, 0, rb, db);
+            take[ntake++] = jcc_fwd(J, a ? cc : (cc ^ 1));
+        }
+        jmp_pc(J, n + 2);
+    }
+    if (ntake > 0) {
+        for (k = 0; k < ntake; k++)
+            here(J, take[k]);
+        emit_goto(J, target, n);
+    }
+    if (nslow > 0 || ntake == 0) {
+        /* 元方法可能设置钩子，两个出口都要检查 */
+        int t;
+        for (k = 0; k < nslow; k++)
+            here(J, slow[k]);
+        if (op == OP_EQ)
+            emit_leaf(J, jit_eq, n);
+        else if (op == OP_LT)
+            emit_leaf(J, jit_lt, n);
+        else
+            emit_leaf(J, jit_le, n);
+        test_eax(J);
+        t = jcc_fwd(J, CC_NE);
+        emit_hookexit(J, n + 2);
+        jmp_pc(J, n + 2);
+        here(J, t);
+        emit_hookexit(J, target);
+        jmp_pc(J, target);
+    }
+}
+
+/**
+ * @brief TEST/TESTSET与其后的JMP
+ *
+ * l_isfalse(r) != C时跳转；TESTSET在跳转前把R(B)复制到R(A)。
+ */
+static void emit_test(JitState *J, int n)
+{
+    Instruction i = J->p->code[n];
+    int testset = GET_OPCODE(i) == OP_TESTSET;
+    int r = testset ? GETARG_B(i) : GETARG_A(i);
+    int target = n + 2 + GETARG_sBx(J->p->code[n + 1]);
+    int f1, f2, t1;
+    cmp32_i8(J, RBASE, TVOFF(r) + TTOFF, LUA_TNIL);
+    f1 = jcc_fwd(J, CC_E);
+    cmp32_i8(J, RBASE, TVOFF(r) + TTOFF, LUA_TBOOLEAN);
+    t1 = jcc_fwd(J, CC_NE);
+    cmp32_i8(J, RBASE, TVOFF(r), 0);
+    f2 = jcc_fwd(J, CC_E);
+    here(J, t1);
+    if (GETARG_C(i)) {
+        /* 真值时跳转 */
+        if (testset) {
+            movdqu_ld(J, 0, RBASE, TVOFF(r));
+            movdqu_st(J, RBASE, TVOFF(GETARG_A(i)), 0);
+        }
+        emit_goto(J, target, n);
+        here(J, f1);
+        here(J, f2);
+        jmp_pc(J, n + 2);
+    }
+    else {
+        /* 假值时跳转 */
+        jmp_pc(J, n + 2);
+        here(J, f1);
+        here(J, f2);
+        if (testset) {
+            movdqu_ld(J, 0, RBASE, TVOFF(r));
+            movdqu_st(J, RBASE, TVOFF(GETARG_A(i)), 0);
+        }
+        emit_goto(J, target, n);
+    }
+}
+
+/**
+ * @brief FORLOOP：xmm0=idx+step，xmm1=limit，xmm2=step
+ *
+ * step > 0时要求idx <= limit，否则要求limit <= idx；任一比较遇到NaN
+ * 都结束循环，与解释器一致。
+ */
+static void emit_forloop(JitState *J, int n)
+{
+    Instruction i = J->p->code[n];
+    int a = GETARG_A(i);
+    int neg, loop, out1, out2;
+    movsd_ld(J, 0, RBASE, TVOFF(a));
+    sse_arith(J, 0x58, 0, RBASE, TVOFF(a + 2));         /* addsd */
+    movsd_ld(J, 1, RBASE, TVOFF(a + 1));
+    movsd_ld(J, 2, RBASE, TVOFF(a + 2));
+    e8(J, 0x66); e8(J, 0x0F); e8(J, 0x57); e8(J, 0xDB); /* xorpd xmm3, xmm3 */
+    ucomisd_rr(J, 2, 3);
+    neg = jcc_fwd(J, CC_BE);                            /* !(0 < step) */
+    ucomisd_rr(J, 1, 0);
+    loop = jcc_fwd(J, CC_AE);                           /* limit >= idx */
+    out1 = jmp_fwd(J);
+    here(J, neg);
+    ucomisd_rr(J, 0, 1);
+    out2 = jcc_fwd(J, CC_B);                            /* !(idx >= limit) */
+    here(J, loop);
+    movsd_st(J, RBASE, TVOFF(a), 0);
+    movsd_st(J, RBASE, TVOFF(a + 3), 0);
+    mov32_i32(J, RBASE, TVOFF(a + 3) + TTOFF, LUA_TNUMBER);
+    emit_goto(J, n + 1 + GETARG_sBx(i), n);
+    here(J, out1);
+    here(J, out2);
+}
+
+/**
+ * @brief 翻译一条指令
+ *
+ * @return 成功返回1；遇到不认识的操作码返回0，整个原型放弃编译
+ */
+static int emit_ins(JitState *J, int n)
+{
+    Instruction i = J->p->code[n];
+    int a = GETARG_A(i);
+    switch (stockop(GET_OPCODE(i))) {
+        case OP_MOVE: {
+            movdqu_ld(J, 0, RBASE, TVOFF(GETARG_B(i)));
+            movdqu_st(J, RBASE, TVOFF(a), 0);
+            break;
+        }
+        case OP_LOADK: {
+            movdqu_ld(J, 0, RK, TVOFF(GETARG_Bx(i)));
+            movdqu_st(J, RBASE, TVOFF(a), 0);
+            break;
+        }
+        case OP_LOADBOOL: {
+            mov32_i32(J, RBASE, TVOFF(a), GETARG_B(i));
+            mov32_i32(J, RBASE, TVOFF(a) + TTOFF, LUA_TBOOLEAN);
+            if (GETARG_C(i))
+                jmp_pc(J, n + 2);
+            break;
+        }
+        case OP_LOADNIL: {
+            int r;
+            for (r = a; r <= GETARG_B(i); r++)
+                mov32_i32(J, RBASE, TVOFF(r) + TTOFF, LUA_TNIL);
+            break;
+        }
+        case OP_GETUPVAL: {
+            mov_ld(J, RAX, RCL, cast_int(offsetof(LClosure, upvals)) +
+                   GETARG_B(i) * cast_int(sizeof(UpVal *)));
+            mov_ld(J, RAX, RAX, cast_int(offsetof(UpVal, v)));
+            movdqu_ld(J, 0, RAX, 0);
+            movdqu_st(J, RBASE, TVOFF(a), 0);
+            break;
+        }
+        case OP_GETGLOBAL: emit_helper(J, jit_getglobal, n); break;
+        case OP_GETTABLE: emit_helper(J, jit_gettable, n); break;
+        case OP_SETGLOBAL: emit_helper(J, jit_setglobal, n); break;
+        case OP_SETUPVAL: emit_leaf(J, jit_setupval, n); break;
+        case OP_SETTABLE: emit_helper(J, jit_settable, n); break;
+        case OP_NEWTABLE: emit_helper(J, jit_newtable, n); break;
+        case OP_SELF: emit_helper(J, jit_self, n); break;
+        case OP_ADD: emit_arith(J, n, 0x58); break;
+        case OP_SUB: emit_arith(J, n, 0x5C); break;
+        case OP_MUL: emit_arith(J, n, 0x59); break;
+        case OP_DIV: emit_arith(J, n, 0x5E); break;
+        case OP_MOD:
+        case OP_POW:
+        case OP_UNM: emit_helper(J, jit_arith, n); break;
+        case OP_NOT: emit_leaf(J, jit_not, n); break;
+        case OP_LEN: {
+            int ok;
+            emit_leaf(J, jit_len, n);
+            test_eax(J);
+            ok = jcc_fwd(J, CC_NE);
+            emit_exit(J, n);
+            here(J, ok);
+            break;
+        }
+        case OP_CONCAT: emit_helper(J, jit_concat, n); break;
+        case OP_JMP: {
+            emit_goto(J, n + 1 + GETARG_sBx(i), n);
+            break;
+        }
+        case OP_EQ:
+        case OP_LT:
+        case OP_LE: emit_compare(J, n); break;
+        case OP_TEST:
+        case OP_TESTSET: emit_test(J, n); break;
+        case OP_CALL:
+        case OP_TAILCALL:
+        case OP_RETURN: emit_exit(J, n); break;
+        case OP_FORLOOP: emit_forloop(J, n); break;
+        case OP_FORPREP: {
+            emit_leaf(J, jit_forprep, n);
+            jmp_pc(J, n + 1 + GETARG_sBx(i));
+            break;
+        }
+        case OP_TFORLOOP: {
+            int cont;
+            emit_leaf(J, jit_tforloop, n);
+            test_eax(J);
+            cont = jcc_fwd(J, CC_NE);
+            emit_hookexit(J, n + 2);
+            jmp_pc(J, n + 2);
+            here(J, cont);
+            emit_goto(J, n + 2 + GETARG_sBx(J->p->code[n + 1]), n);
+            break;
+        }
+        case OP_SETLIST: emit_leaf(J, jit_setlist, n); break;
+        case OP_CLOSE: emit_leaf(J, jit_close, n); break;
+        case OP_CLOSURE: emit_helper(J, jit_closure, n); break;
+        case OP_VARARG: emit_leaf(J, jit_vararg, n); break;
+        default: return 0;
+    }
+    return 1;
+}
+
+/** @brief 机器码大小的上界（按页取整） */
+static size_t jitsize(const Proto *p)
+{
+    size_t size = JIT_HEADSIZE;
+    size_t page = cast(size_t, sysconf(_SC_PAGESIZE));
+    int n;
+    for (n = 0; n < p->sizecode; n++) {
+        Instruction i = p->code[n];
+        if (GET_OPCODE(i) == OP_LOADNIL)
+            size += 16 + 12 * cast(size_t, GETARG_B(i) - GETARG_A(i) + 1);
+        else
+            size += JIT_MAXINS;
+    }
+    return (size + page - 1) & ~(page - 1);
+}
+
+/**
+ * @brief prologue与epilogue
+ *
+ * 入口：保存rbx、r12-r15（5次压栈使栈保持16字节对齐），设置宿主寄存器后
+ * 跳转到rsi指定的指令模板。epilogue紧随其后，所有退出都跳到这里。
+ */
+static void emit_head(JitState *J)
+{
+    e8(J, 0x53);                                /* push rbx */
+    e8(J, 0x41); e8(J, 0x54);                   /* push r12 */
+    e8(J, 0x41); e8(J, 0x55);                   /* push r13 */
+    e8(J, 0x41); e8(J, 0x56);                   /* push r14 */
+    e8(J, 0x41); e8(J, 0x57);                   /* push r15 */
+    e8(J, 0x48); e8(J, 0x89); e8(J, 0xFB);      /* mov rbx, rdi */
+    e8(J, 0x49); e8(J, 0x89); e8(J, 0xD5);      /* mov r13, rdx */
+    e8(J, 0x49); e8(J, 0x89); e8(J, 0xCE);      /* mov r14, rcx */
+    mov_ld(J, RBASE, RL, LOFF(base));
+    e8(J, 0xFF); e8(J, 0xE6);                   /* jmp rsi */
+    J->epilogue = cast_int(J->pos);
+    e8(J, 0x41); e8(J, 0x5F);                   /* pop r15 */
+    e8(J, 0x41); e8(J, 0x5E);                   /* pop r14 */
+    e8(J, 0x41); e8(J, 0x5D);                   /* pop r13 */
+    e8(J, 0x41); e8(J, 0x5C);                   /* pop r12 */
+    e8(J, 0x5B);                                /* pop rbx */
+    e8(J, 0xC3);                                /* ret */
+    lua_assert(J->pos <= JIT_HEADSIZE);
+}
+
+/** @} */
+
+
+/**
+ * @name 对外接口
+ * @{
+ */
+
+int luaJ_compile(lua_State *L, Proto *p)
+{
+    JitState J;
+    JitCode *jc;
+    union { void *p; JitFunc f; } u;
+    int n, k;
+    lua_assert(p->jitstate == JIT_NONE && p->jitcode == NULL);
+    // 先标记为失败：编译中途抛出内存错误时不再重试，已分配的部分由luaJ_free回收
+    p->jitstate = JIT_FAILED;
+    jc = luaM_new(L, JitCode);
+    jc->mcode = NULL;
+    jc->msize = 0;
+    jc->entry = NULL;
+    jc->sizeentry = 0;
+    jc->fix = NULL;
+    jc->sizefix = 0;
+    p->jitcode = jc;
+    jc->entry = luaM_newvector(L, p->sizecode, int);
+    jc->sizeentry = p->sizecode;
+    jc->fix = luaM_newvector(L, JIT_MAXFIX * p->sizecode, JitFixup);
+    jc->sizefix = JIT_MAXFIX * p->sizecode;
+    jc->msize = jitsize(p);
+    u.p = mmap(NULL, jc->msize, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (u.p == MAP_FAILED) {
+        luaJ_free(L, p);
+        return 0;
+    }
+    jc->mcode = cast(unsigned char *, u.p);
+    J.p = p;
+    J.jc = jc;
+    J.code = jc->mcode;
+    J.pos = 0;
+    J.nfix = 0;
+    for (n = 0; n < p->sizecode; n++)
+        jc->entry[n] = -1;
+    emit_head(&J);
+    for (n = 0; n < p->sizecode; n = nextins(p, n)) {
+        jc->entry[n] = cast_int(J.pos);
+        if (!emit_ins(&J, n)) {
+            luaJ_free(L, p);
+            return 0;
+        }
+    }
+    lua_assert(J.pos <= jc->msize);
+    for (k = 0; k < J.nfix; k++) {
+        JitFixup *f = &jc->fix[k];
+        int rel;
+        lua_assert(0 <= f->target && f->target < p->sizecode &&
+                   jc->entry[f->target] >= 0);
+        rel = jc->entry[f->target] - (f->pos + 4);
+        memcpy(jc->mcode + f->pos, &rel, 4);
+    }
+    luaM_freearray(L, jc->fix, jc->sizefix, JitFixup);
+    jc->fix = NULL;
+    jc->sizefix = 0;
+    if (mprotect(jc->mcode, jc->msize, PROT_READ | PROT_EXEC) != 0) {
+        luaJ_free(L, p);
+        return 0;
+    }
+    jc->fn = u.f;
+    p->jitstate = JIT_READY;
+    G(L)->jitcount++;
+    return 1;
+}
+
+
+void luaJ_run(lua_State *L, LClosure *cl, const Instruction *pc)
+{
+    Proto *p = cl->p;
+    JitCode *jc = cast(JitCode *, p->jitcode);
+    int off = jc->entry[pc - p->code];
+    L->savedpc = pc;
+    lua_assert(off >= 0);
+    if (off >= 0)
+        jc->fn(L, jc->mcode + off, p->k, cl);
+}
+
+
+void luaJ_free(lua_State *L, Proto *p)
+{
+    JitCode *jc = cast(JitCode *, p->jitcode);
+    if (jc == NULL)
+        return;
+    if (jc->mcode != NULL)
+        munmap(jc->mcode, jc->msize);
+    luaM_freearray(L, jc->entry, jc->sizeentry, int);
+    luaM_freearray(L, jc->fix, jc->sizefix, JitFixup);
+    luaM_free(L, jc);
+    p->jitcode = NULL;
+    if (p->jitstate == JIT_READY)
+        G(L)->jitcount--;
+}
+
+/** @} */
+
+#endif
@@ -0,0 +1,86 @@
+﻿/**
+ * @file ljit.h
+ * @brief 基线模板JIT接口：热度统计、编译与机器码入口
+ *
+ * 详细说明：
+ * 本模块把热点函数原型翻译为x86-64机器码。翻译按指令逐条进行，
+ * 没有寄存器分配和跨指令优化：常见指令展开为固定模板，其余指令
+ * 调用与解释器语义一致的C辅助函数（调用线索化，call threading）。
+ *
+ * 与解释器的协作：
+ * - 机器码与解释器共享同一个Lua栈和CallInfo，栈帧格式不变
+ * - 机器码只执行当前函数内部的指令，CALL、TAILCALL、RETURN以及
+ *   需要行/计数钩子的回跳都把退出位置写回L->savedpc后返回解释器
+ * - 解释器在reentry、C函数调用返回后和循环回跳处调用luaJ_run，
+ *   所以被调函数返回后调用者可以继续在机器码中执行
+ *
+ * 仅在定义LUA_USE_JIT时编译，见luaconf.h。
+ *
+ * @author Lua开发团队
+ * @version 5.1.5
+ *
+ * @see ljit.c, lvm.c
+ */
+
+#ifndef ljit_h
+#define ljit_h
+
+#include "lobject.h"
+#include "lstate.h"
+
+#if defined(LUA_USE_JIT)
+
+/**
+ * @name 编译状态
+ * @brief Proto::jitstate的取值
+ * @{
+ */
+#define JIT_NONE        0   /**< 尚未编译 */
+#define JIT_READY       1   /**< 已编译，jitcode有效 */
+#define JIT_FAILED      2   /**< 编译失败，不再尝试 */
+/** @} */
+
+/**
+ * @brief 统计热度并在达到阈值时编译
+ *
+ * 在函数调用（luaD_precall）和解释器循环回跳处调用。
+ */
+#define luaJ_hot(L,p) \
+    ((void)((p)->jitstate == JIT_NONE && G(L)->jiton && \
+            ++(p)->hotcount >= G(L)->jithot && luaJ_compile(L, p)))
+
+/**
+ * @brief 编译函数原型
+ *
+ * 成功时设置jitstate为JIT_READY并返回1；遇到无法翻译的情况或映射
+ * 可执行内存失败时设置为JIT_FAILED并返回0，该原型之后一直解释执行。
+ * 辅助表从Lua分配器申请，内存不足时抛出LUA_ERRMEM。
+ *
+ * @param L Lua状态机指针
+ * @param p 要编译的函数原型
+ * @return 成功返回1，失败返回0
+ */
+LUAI_FUNC int luaJ_compile(lua_State *L, Proto *p);
+
+/**
+ * @brief 从指定位置执行机器码
+ *
+ * pc必须是当前栈帧（L->ci）中函数的一条指令。返回时L->savedpc是
+ * 解释器应该继续执行的指令。
+ *
+ * @param L Lua状态机指针
+ * @param cl 当前执行的Lua闭包
+ * @param pc 入口指令
+ */
+LUAI_FUNC void luaJ_run(lua_State *L, LClosure *cl, const Instruction *pc);
+
+/**
+ * @brief 释放函数原型的机器码
+ *
+ * 由luaF_freeproto调用，未编译时什么都不做。
+ */
+LUAI_FUNC void luaJ_free(lua_State *L, Proto *p);
+
+#endif
+
+#endif
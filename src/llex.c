@@ -628,6 +628,10 @@ TString *luaX_newstring(LexState *ls, const char *str, size_t l) {
     if (ttisnil(o)) {
         setbvalue(o, 1);
         luaC_checkGC(L);
+    } else if (islngstr(ts)) {
+        // 长字符串不内部化：改用表中已有的键，它有锚定，同一函数里
+        // 同名的长标识符也就是同一个对象（i_val是Node的第一个成员）
+        ts = rawtsvalue(key2tval(cast(Node *, o)));
     }
 
     return ts;
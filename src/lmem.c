@@ -59,6 +59,12 @@
 
 #include <stddef.h>
 
+#include <string.h>
+
+#if defined(LUA_USE_BGFREE)
+#include <pthread.h>
+#endif
+
 #define lmem_c
 #define LUA_CORE
 
@@ -68,6 +74,7 @@
 #include "ldo.h"
 #include "lmem.h"
 #include "lobject.h"
+#include "lprof.h"
 #include "lstate.h"
 
 // ============================================================================
@@ -214,6 +221,387 @@ void *luaM_toobig(lua_State *L) {
 
 
 
+#if defined(LUA_USE_BGFREE)
+// ============================================================================
+// 后台释放
+// ============================================================================
+
+/**
+ * @brief 一批等待后台线程释放的内存块
+ */
+typedef struct FreeBatch {
+    int n;                                  // 块数
+    void *block[LUAI_BGFREEBATCH];
+    size_t size[LUAI_BGFREEBATCH];
+} FreeBatch;
+
+/**
+ * @brief 后台释放线程
+ *
+ * 详细说明：
+ * 各批组成环形队列。主线程只写fill指向的批，写满后把nqueued加一交给
+ * 后台线程并前进到下一批；后台线程从first开始按顺序释放排队的批，
+ * 每释放完一批先清空它，再把nqueued减一。nqueued等于批数时fill指向的
+ * 批还在排队，主线程改为直接释放。
+ *
+ * nqueued用原子操作访问，只有交接和等待时才加锁，每批一次。
+ */
+typedef struct BgFree {
+    lua_Alloc frealloc;                     // 创建时的分配器
+    void *ud;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;                    // 有新的批或要求退出
+    int nqueued;                            // 排队的批数
+    int quit;
+    int fill;                               // 正在填写的批（主线程私有）
+    int first;                              // 下一个释放的批（后台线程私有）
+    FreeBatch batch[LUAI_BGFREEBATCHES];
+} BgFree;
+
+/**
+ * @brief 后台线程主循环：释放排队的批，收到退出请求并且队列为空时返回
+ */
+static void *bgf_thread(void *arg) {
+    BgFree *bf = (BgFree *)arg;
+
+    pthread_mutex_lock(&bf->lock);
+    for (;;) {
+        FreeBatch *b;
+        int i;
+
+        while (__atomic_load_n(&bf->nqueued, __ATOMIC_ACQUIRE) == 0 &&
+               !bf->quit) {
+            pthread_cond_wait(&bf->wake, &bf->lock);
+        }
+        if (__atomic_load_n(&bf->nqueued, __ATOMIC_ACQUIRE) == 0) {
+            break;
+        }
+        pthread_mutex_unlock(&bf->lock);
+
+        b = &bf->batch[bf->first];
+        for (i = 0; i < b->n; i++) {
+            (*bf->frealloc)(bf->ud, b->block[i], b->size[i], 0);
+        }
+        b->n = 0;
+        bf->first = (bf->first + 1) % LUAI_BGFREEBATCHES;
+        __atomic_sub_fetch(&bf->nqueued, 1, __ATOMIC_RELEASE);
+
+        pthread_mutex_lock(&bf->lock);
+    }
+    pthread_mutex_unlock(&bf->lock);
+    return NULL;
+}
+
+/**
+ * @brief 把正在填写的批交给后台线程
+ *
+ * 所有批都在排队时fill指向的批属于后台线程，不能再提交；空批也不提交。
+ */
+static void bgf_submit(BgFree *bf) {
+    if (__atomic_load_n(&bf->nqueued, __ATOMIC_ACQUIRE) ==
+            LUAI_BGFREEBATCHES ||
+        bf->batch[bf->fill].n == 0) {
+        return;
+    }
+    bf->fill = (bf->fill + 1) % LUAI_BGFREEBATCHES;
+    pthread_mutex_lock(&bf->lock);
+    __atomic_add_fetch(&bf->nqueued, 1, __ATOMIC_RELEASE);
+    pthread_cond_signal(&bf->wake);
+    pthread_mutex_unlock(&bf->lock);
+}
+
+/**
+ * @brief 把一个内存块放入当前批
+ * @return 所有批都在排队时返回0，由调用者直接释放
+ */
+static int bgf_push(BgFree *bf, void *block, size_t size) {
+    FreeBatch *b;
+
+    if (__atomic_load_n(&bf->nqueued, __ATOMIC_ACQUIRE) ==
+        LUAI_BGFREEBATCHES) {
+        return 0;
+    }
+    b = &bf->batch[bf->fill];
+    b->block[b->n] = block;
+    b->size[b->n] = size;
+    if (++b->n == LUAI_BGFREEBATCH) {
+        bgf_submit(bf);
+    }
+    return 1;
+}
+
+/**
+ * @brief 释放剩下的内存块，结束后台线程
+ */
+static void bgf_stop(global_State *g) {
+    BgFree *bf = g->bgfree;
+
+    bgf_submit(bf);
+    pthread_mutex_lock(&bf->lock);
+    bf->quit = 1;
+    pthread_cond_signal(&bf->wake);
+    pthread_mutex_unlock(&bf->lock);
+    pthread_join(bf->thread, NULL);
+    pthread_cond_destroy(&bf->wake);
+    pthread_mutex_destroy(&bf->lock);
+    (*g->frealloc)(g->ud, bf, sizeof(BgFree), 0);
+    g->bgfree = NULL;
+}
+
+int luaM_bgfree(lua_State *L, int on) {
+    global_State *g = G(L);
+    int old = (g->bgfree != NULL);
+    BgFree *bf;
+
+    lua_assert(!g->bgsweeping);
+    if (on < 0 || (on > 0) == old) {
+        return old;
+    }
+    if (!on) {
+        bgf_stop(g);
+        return old;
+    }
+    bf = (BgFree *)(*g->frealloc)(g->ud, NULL, 0, sizeof(BgFree));
+    if (bf == NULL) {
+        return old;
+    }
+    memset(bf, 0, sizeof(BgFree));
+    bf->frealloc = g->frealloc;
+    bf->ud = g->ud;
+    pthread_mutex_init(&bf->lock, NULL);
+    pthread_cond_init(&bf->wake, NULL);
+    if (pthread_create(&bf->thread, NULL, bgf_thread, bf) != 0) {
+        pthread_cond_destroy(&bf->wake);
+        pthread_mutex_destroy(&bf->lock);
+        (*g->frealloc)(g->ud, bf, sizeof(BgFree), 0);
+        return old;
+    }
+    g->bgfree = bf;
+    return old;
+}
+
+void luaM_bgflush(lua_State *L) {
+    global_State *g = G(L);
+
+    if (g->bgfree != NULL) {
+        bgf_submit(g->bgfree);
+    }
+}
+#endif
+
+#if defined(LUA_USE_SLAB)
+// ============================================================================
+// 分级内存池
+// ============================================================================
+
+#define SLABCLASSES     (LUAI_SLABMAX / LUAI_SLABSTEP)
+
+// 大小为s的块是否由内存池分配（s为0时回绕成最大值，不属于内存池）
+#define slabsize(s)     ((size_t)(s) - 1 < LUAI_SLABMAX)
+
+// 大小为s的块所属的大小类
+#define slabclass(s)    (((s) - 1) / LUAI_SLABSTEP)
+
+/**
+ * @brief 一个大小类
+ *
+ * 空闲块的第一个字指向下一个空闲块。空闲链表为空时从当前块区
+ * [next, end)切分。
+ */
+typedef struct SlabClass {
+    void *free;                             // 空闲链表
+    char *next;                             // 当前块区未切分部分
+    char *end;
+    int nused;                              // 使用中的块数
+    int nfree;                              // 空闲链表中的块数
+} SlabClass;
+
+/**
+ * @brief 状态机的分级内存池
+ *
+ * 块区的开头LUAI_SLABSTEP字节用来把所有块区链接起来，关闭时一起释放。
+ */
+typedef struct Slab {
+    void *chunks;                           // 块区链表
+    SlabClass c[SLABCLASSES];
+} Slab;
+
+/**
+ * @brief 从大小类分配一块，块区用完时向分配器申请新的块区
+ * @return 内存不足时返回NULL
+ */
+static void *slab_alloc(global_State *g, size_t size) {
+    Slab *s = g->slab;
+    SlabClass *c = &s->c[slabclass(size)];
+    void *p = c->free;
+
+    if (p != NULL) {
+        c->free = *(void **)p;
+        c->nfree--;
+    } else {
+        size_t bsize = (slabclass(size) + 1) * LUAI_SLABSTEP;
+        if ((size_t)(c->end - c->next) < bsize) {
+            char *chunk = (char *)(*g->frealloc)(g->ud, NULL, 0, LUAI_SLABCHUNK);
+            if (chunk == NULL) {
+                return NULL;
+            }
+            *(void **)chunk = s->chunks;
+            s->chunks = chunk;
+            c->next = chunk + LUAI_SLABSTEP;
+            c->end = chunk + LUAI_SLABCHUNK;
+        }
+        p = c->next;
+        c->next += bsize;
+    }
+    c->nused++;
+    return p;
+}
+
+/**
+ * @brief 把一块放回大小类的空闲链表
+ */
+static void slab_free(global_State *g, void *block, size_t size) {
+    SlabClass *c = &g->slab->c[slabclass(size)];
+
+    *(void **)block = c->free;
+    c->free = block;
+    c->nfree++;
+    c->nused--;
+}
+
+/**
+ * @brief 旧块或新块属于内存池时的重分配
+ *
+ * 同一大小类内的调整直接返回原块；否则分配新块、复制内容、释放旧块。
+ * 分配失败时返回NULL，旧块不变。
+ */
+static void *slab_realloc(global_State *g, void *block, size_t osize,
+                          size_t nsize) {
+    void *nblock = NULL;
+
+    if (slabsize(osize) && slabsize(nsize) &&
+        slabclass(osize) == slabclass(nsize)) {
+        return block;
+    }
+    if (slabsize(nsize)) {
+        nblock = slab_alloc(g, nsize);
+    } else if (nsize > 0) {
+        nblock = (*g->frealloc)(g->ud, NULL, 0, nsize);
+    }
+    if (nblock == NULL && nsize > 0) {
+        return NULL;
+    }
+    if (block != NULL) {
+        if (nblock != NULL) {
+            memcpy(nblock, block, osize < nsize ? osize : nsize);
+        }
+        if (slabsize(osize)) {
+            slab_free(g, block, osize);
+        } else {
+            (*g->frealloc)(g->ud, block, osize, 0);
+        }
+    }
+    return nblock;
+}
+
+int luaM_slabopen(lua_State *L) {
+    global_State *g = G(L);
+    Slab *s = (Slab *)(*g->frealloc)(g->ud, NULL, 0, sizeof(Slab));
+
+    if (s == NULL) {
+        return 0;
+    }
+    memset(s, 0, sizeof(Slab));
+    g->slab = s;
+    return 1;
+}
+
+void luaM_slabclose(lua_State *L) {
+    global_State *g = G(L);
+    Slab *s = g->slab;
+    void *chunk;
+
+    if (s == NULL) {
+        return;
+    }
+    chunk = s->chunks;
+    while (chunk != NULL) {
+        void *next = *(void **)chunk;
+        (*g->frealloc)(g->ud, chunk, LUAI_SLABCHUNK, 0);
+        chunk = next;
+    }
+    (*g->frealloc)(g->ud, s, sizeof(Slab), 0);
+    g->slab = NULL;
+}
+
+int luaM_slabstat(lua_State *L, int what, int k) {
+    global_State *g = G(L);
+    SlabClass *c;
+
+    if (g->slab == NULL || k < 0 || k >= SLABCLASSES) {
+        return 0;
+    }
+    c = &g->slab->c[k];
+    switch (what) {
+        case LUA_GCSLABSIZE: return (k + 1) * LUAI_SLABSTEP;
+        case LUA_GCSLABUSED: return c->nused;
+        case LUA_GCSLABFREE: return c->nfree;
+        default: return 0;
+    }
+}
+#endif
+
+/**
+ * @brief luaM_realloc_的实际分配：内存池、后台释放或用户分配器
+ *
+ * 失败时抛出LUA_ERRMEM，并维护totalbytes。
+ */
+static void *memrealloc(lua_State *L, void *block, size_t osize,
+                        size_t nsize) {
+    global_State *g = G(L);
+
+    // 验证调用约定：空指针当且仅当大小为0
+    lua_assert((osize == 0) == (block == NULL));
+
+#if defined(LUA_USE_SLAB)
+    // 小块由内存池分配和释放，不调用分配器，也不交给后台线程
+    if (g->slab != NULL && (slabsize(osize) || slabsize(nsize))) {
+        block = slab_realloc(g, block, osize, nsize);
+        if (block == NULL && nsize > 0) {
+            luaD_throw(L, LUA_ERRMEM);
+        }
+        g->totalbytes = (g->totalbytes - osize) + nsize;
+        return block;
+    }
+#endif
+
+#if defined(LUA_USE_BGFREE)
+    // 清扫阶段的释放交给后台线程，内存统计立即减少
+    if (g->bgsweeping && nsize == 0 && block != NULL &&
+        bgf_push(g->bgfree, block, osize)) {
+        g->totalbytes -= osize;
+        return NULL;
+    }
+#endif
+
+    // 调用用户提供的内存分配器
+    block = (*g->frealloc)(g->ud, block, osize, nsize);
+
+    // 检查分配失败的情况
+    if (block == NULL && nsize > 0) {
+        luaD_throw(L, LUA_ERRMEM);    // 抛出内存错误异常
+    }
+
+    // 验证返回值约定：空指针当且仅当新大小为0
+    lua_assert((nsize == 0) == (block == NULL));
+
+    // 更新全局内存使用统计
+    g->totalbytes = (g->totalbytes - osize) + nsize;
+
+    return block;
+}
+
 /**
  * @brief 通用内存重分配函数（Lua内存管理的核心）
  * @param L Lua状态机指针
@@ -279,25 +667,16 @@ void *luaM_toobig(lua_State *L) {
  * @see luaM_malloc, luaM_free, luaM_realloc宏
  */
 void *luaM_realloc_(lua_State *L, void *block, size_t osize, size_t nsize) {
-    global_State *g = G(L);
-
-    // 验证调用约定：空指针当且仅当大小为0
-    lua_assert((osize == 0) == (block == NULL));
+    struct ProfSite *site;
+    void *nblock;
 
-    // 调用用户提供的内存分配器
-    block = (*g->frealloc)(g->ud, block, osize, nsize);
-
-    // 检查分配失败的情况
-    if (block == NULL && nsize > 0) {
-        luaD_throw(L, LUA_ERRMEM);    // 抛出内存错误异常
+    if (G(L)->heapprof == NULL) {
+        return memrealloc(L, block, osize, nsize);
     }
-
-    // 验证返回值约定：空指针当且仅当新大小为0
-    lua_assert((nsize == 0) == (block == NULL));
-
-    // 更新全局内存使用统计
-    g->totalbytes = (g->totalbytes - osize) + nsize;
-
-    return block;
+    // 堆分析：调用栈必须在分配之前记录，栈本身可能正在被重新分配
+    site = luaR_before(L, osize, nsize);
+    nblock = memrealloc(L, block, osize, nsize);
+    luaR_after(L, site, block, nblock);
+    return nblock;
 }
 
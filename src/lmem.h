@@ -421,5 +421,55 @@ LUAI_FUNC void *luaM_growaux_(lua_State *L, void *block, int *size,
                                size_t size_elem, int limit,
                                const char *errormsg);
 
+#if defined(LUA_USE_BGFREE)
+/**
+ * @brief 开关后台释放
+ *
+ * 详细说明：
+ * on大于0时创建后台释放线程，0时把排队的内存块全部释放后结束它，
+ * 负数只查询。线程创建失败时保持关闭。
+ *
+ * @param L lua_State指针，当前Lua虚拟机状态
+ * @param on 开关
+ * @return 之前的状态（1或0）
+ *
+ * @see lua_gc(), LUA_GCBGFREE
+ */
+LUAI_FUNC int luaM_bgfree(lua_State *L, int on);
+
+/**
+ * @brief 把未满的一批内存块交给后台线程
+ *
+ * 清扫阶段结束时调用，避免死亡对象的内存一直留在未满的批中。
+ */
+LUAI_FUNC void luaM_bgflush(lua_State *L);
+#endif
+
+#if defined(LUA_USE_SLAB)
+/**
+ * @brief 为新状态机建立分级内存池
+ *
+ * 只能在第一次通过luaM分配之前调用。
+ *
+ * @param L 主线程，全局状态的frealloc和ud已经设置
+ * @return 成功返回1，内存不足返回0
+ */
+LUAI_FUNC int luaM_slabopen(lua_State *L);
+
+/**
+ * @brief 把内存池的所有块区归还分配器
+ *
+ * 关闭状态机时在所有对象释放之后调用。
+ */
+LUAI_FUNC void luaM_slabclose(lua_State *L);
+
+/**
+ * @brief 查询内存池第k个大小类的统计
+ * @param what LUA_GCSLABSIZE、LUA_GCSLABUSED或LUA_GCSLABFREE
+ * @return 块大小、使用中的块数或空闲块数；没有这个大小类时返回0
+ */
+LUAI_FUNC int luaM_slabstat(lua_State *L, int what, int k);
+#endif
+
 #endif
 
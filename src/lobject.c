@@ -81,7 +81,7 @@
  * - 比较效率：可以使用指针比较
  * - 类型安全：确保nil值的一致性
  */
-const TValue luaO_nilobject_ = {{NULL}, LUA_TNIL};
+const TValue luaO_nilobject_ = {NILFIELDS};
 
 /**
  * @brief 将整数转换为浮点字节表示
@@ -304,17 +304,19 @@ int luaO_log2(unsigned int x) {
  * @see luaV_equalval(), 元方法系统
  */
 int luaO_rawequalObj(const TValue *t1, const TValue *t2) {
-    // 首先比较类型
-    if (ttype(t1) != ttype(t2)) {
+    // 首先比较类型（两种数字表示属于同一类型）
+    if (basetype(t1) != basetype(t2)) {
         return 0;
     }
 
     // 根据类型进行相应的比较
-    switch (ttype(t1)) {
+    switch (basetype(t1)) {
         case LUA_TNIL:
             return 1;  // 所有nil都相等
 
         case LUA_TNUMBER:
+            if (ttisint(t1) && ttisint(t2))
+                return ivalue(t1) == ivalue(t2);
             return luai_numeq(nvalue(t1), nvalue(t2));  // 数值相等性
 
         case LUA_TBOOLEAN:
@@ -323,6 +325,9 @@ int luaO_rawequalObj(const TValue *t1, const TValue *t2) {
         case LUA_TLIGHTUSERDATA:
             return pvalue(t1) == pvalue(t2);  // 指针值比较
 
+        case LUA_TSTRING:
+            return luaS_eqstr(rawtsvalue(t1), rawtsvalue(t2));  // 长字符串比较内容
+
         default:
             // 可回收对象：比较对象指针（引用相等性）
             lua_assert(iscollectable(t1));
@@ -154,6 +154,31 @@
  */
 #define LUA_TDEADKEY	(LAST_TAG+3)
 
+/**
+ * @brief 延迟连接字符串标签：尚未压平的字符串（Rope）
+ *
+ * 详细说明：
+ * 与LUA_TINT之于数字一样，rope只是LUA_TSTRING的另一种表示：type()、
+ * 类型名和元表都按字符串处理（basetype）。rope只会出现在Lua函数的
+ * 寄存器和上值里，离开这些位置（存入表、传给C函数、返回给C）之前，
+ * 以及需要字符串内容（哈希、比较）时都会被压平，见luaS_flatten。
+ */
+#define LUA_TROPE	(LAST_TAG+4)
+
+/**
+ * @brief 整数子类型标签：以int存储的数字
+ *
+ * 详细说明：
+ * 定义LUA_USE_INTNUM时，能用int精确表示的数字（数组下标、循环计数、
+ * 整数常量等）以value.i存储，省去double与int之间的来回转换。
+ * 它只是LUA_TNUMBER的另一种表示，对Lua脚本和C API不可见：
+ * type()、lua_type、比较和表键都把两种表示视为同一个数字。
+ *
+ * 取负值是为了落在iscollectable的范围之外，并且不会被当作
+ * G(L)->mt、luaT_typenames等按类型索引的数组下标（这些位置用basetype）。
+ */
+#define LUA_TINT	(-2)
+
 
 /**
  * =====================================================================
@@ -252,7 +277,8 @@ typedef struct GCheader {
 typedef union {
     GCObject *gc;     /* 垃圾回收对象指针：字符串、表、函数等 */
     void *p;          /* 轻量级用户数据指针：C指针 */
-    lua_Number n;     /* 数值：整数或浮点数 */
+    lua_Number n;     /* 数值：浮点数 */
+    int i;            /* 数值：整数子类型（LUA_TINT） */
     int b;            /* 布尔值：0表示false，非0表示true */
 } Value;
 
@@ -272,8 +298,101 @@ typedef union {
  * - 可维护性：字段定义的变更可以集中管理
  * - 扩展性：便于在需要时添加新的字段或修改现有字段
  */
+#if defined(LUA_USE_NANBOX)
+
+/**
+ * @brief NaN装箱的值字（见luaconf.h中的LUA_USE_NANBOX）
+ *
+ * 详细说明：
+ * 整个TValue是一个64位字。不落在标签区的位模式就是double本身；
+ * 标签区是最高17位取0x1FFF1..0x1FFFF的负quiet NaN，最高17位减去
+ * NB_TAGBASE得到类型标签，低47位是载荷：
+ * - GC对象和轻量级用户数据：指针（x86-64 Linux用户空间地址不超过47位）
+ * - 布尔值和整数子类型：低32位
+ * - nil和死键：载荷无意义（死键保留原来的指针供next遍历比较）
+ *
+ * 运算可能产生落在标签区的NaN，setnvalue把它们规范化为0xFFF8...，
+ * 所以浮点数的判断只需要一次无符号比较。
+ */
+typedef unsigned long long lu_nanbox;
+
+#define NB_TAGSHIFT	47
+#define NB_PAYLOAD	((((lu_nanbox)1) << NB_TAGSHIFT) - 1)
+#define NB_TAGBASE	0x1FFF3
+#define nb_tagbits(t)	(((lu_nanbox)(NB_TAGBASE + (t))) << NB_TAGSHIFT)
+#define NB_MINTAG	nb_tagbits(LUA_TINT)
+#define NB_NAN		(((lu_nanbox)0xFFF8) << 48)
+
+#define TValuefields	union { lu_nanbox u; lua_Number n; } nb
+
+#define NILFIELDS	{nb_tagbits(LUA_TNIL)}
+
+#define ttisfloat(o)	((o)->nb.u < NB_MINTAG)
+#define checktag(o,t)	(((o)->nb.u >> NB_TAGSHIFT) == NB_TAGBASE + (t))
+#define rawtt(o) \
+  (ttisfloat(o) ? LUA_TNUMBER : cast_int((o)->nb.u >> NB_TAGSHIFT) - NB_TAGBASE)
+#define iscollectable(o)	((o)->nb.u >= nb_tagbits(LUA_TSTRING))
+
+#define val_gc(o)	cast(GCObject *, cast(size_t, (o)->nb.u & NB_PAYLOAD))
+#define val_p(o)	cast(void *, cast(size_t, (o)->nb.u & NB_PAYLOAD))
+#define val_n(o)	((o)->nb.n)
+#define val_i(o)	cast_int(cast(unsigned int, (o)->nb.u))
+#define val_b(o)	val_i(o)
+
+#define setnil_(o)	((o)->nb.u = nb_tagbits(LUA_TNIL))
+#define setn_(o,x) \
+  { (o)->nb.n = (x); if ((o)->nb.u >= NB_MINTAG) (o)->nb.u = NB_NAN; }
+#define seti_(o,x) \
+  ((o)->nb.u = nb_tagbits(LUA_TINT) | cast(unsigned int, (x)))
+#define setb_(o,x) \
+  ((o)->nb.u = nb_tagbits(LUA_TBOOLEAN) | cast(unsigned int, (x)))
+#define setp_(o,x) \
+  { lu_nanbox p_x = cast(lu_nanbox, cast(size_t, (x))); \
+    lua_assert((p_x & ~NB_PAYLOAD) == 0); \
+    (o)->nb.u = nb_tagbits(LUA_TLIGHTUSERDATA) | p_x; }
+#define setgc_(o,x,t) \
+  ((o)->nb.u = nb_tagbits(t) | cast(lu_nanbox, cast(size_t, (x))))
+#define copy_(o1,o2)	((o1)->nb.u = (o2)->nb.u)
+#define settt_(o,t) \
+  ((o)->nb.u = ((o)->nb.u & NB_PAYLOAD) | nb_tagbits(t))
+
+#else
+
 #define TValuefields	Value value; int tt
 
+/**
+ * @brief 静态初始化用的nil字段，对应TValuefields的布局
+ */
+#define NILFIELDS	{NULL}, LUA_TNIL
+
+/*
+ * 表示层原语：下面的类型检查、取值和赋值宏只通过这些原语访问
+ * TValue的字段，换一种表示（LUA_USE_NANBOX）只需替换这一组定义。
+ * checktag不能用于LUA_TNUMBER，浮点数用ttisfloat判断。
+ */
+#define ttisfloat(o)	((o)->tt == LUA_TNUMBER)
+#define checktag(o,t)	((o)->tt == (t))
+#define rawtt(o)	((o)->tt)
+#define iscollectable(o)	((o)->tt >= LUA_TSTRING)
+
+#define val_gc(o)	((o)->value.gc)
+#define val_p(o)	((o)->value.p)
+#define val_n(o)	((o)->value.n)
+#define val_i(o)	((o)->value.i)
+#define val_b(o)	((o)->value.b)
+
+#define setnil_(o)	((o)->tt = LUA_TNIL)
+#define setn_(o,x)	{ (o)->value.n = (x); (o)->tt = LUA_TNUMBER; }
+#define seti_(o,x)	{ (o)->value.i = (x); (o)->tt = LUA_TINT; }
+#define setb_(o,x)	{ (o)->value.b = (x); (o)->tt = LUA_TBOOLEAN; }
+#define setp_(o,x)	{ (o)->value.p = (x); (o)->tt = LUA_TLIGHTUSERDATA; }
+#define setgc_(o,x,t) \
+  { (o)->value.gc = cast(GCObject *, (x)); (o)->tt = (t); }
+#define copy_(o1,o2)	{ (o1)->value = (o2)->value; (o1)->tt = (o2)->tt; }
+#define settt_(o,t)	((o)->tt = (t))
+
+#endif
+
 /**
  * @brief Lua值结构：动态类型系统的核心实现
  * 
@@ -323,7 +442,7 @@ typedef struct lua_TValue {
  * - 函数参数的可选性检查
  * - 条件语句中的真假判断（nil为假）
  */
-#define ttisnil(o)	(ttype(o) == LUA_TNIL)
+#define ttisnil(o)	checktag(o, LUA_TNIL)
 
 /**
  * @brief 布尔类型检查：判断值是否为布尔类型
@@ -331,15 +450,28 @@ typedef struct lua_TValue {
  * 在Lua中，布尔类型包括true和false两个值。这个宏用于检查
  * 一个值是否属于布尔类型，而不关心具体是true还是false。
  */
-#define ttisboolean(o)	(ttype(o) == LUA_TBOOLEAN)
+#define ttisboolean(o)	checktag(o, LUA_TBOOLEAN)
 
 /**
  * @brief 数值类型检查：判断值是否为数字
  * 
  * Lua中的数字类型通常是双精度浮点数，这个宏用于检查
- * 一个值是否可以进行数学运算。
+ * 一个值是否可以进行数学运算。启用整数子类型时，两种表示都算数字。
  */
-#define ttisnumber(o)	(ttype(o) == LUA_TNUMBER)
+#if defined(LUA_USE_INTNUM)
+#define ttisnumber(o)	(ttisfloat(o) || ttisint(o))
+#else
+#define ttisnumber(o)	ttisfloat(o)
+#endif
+
+/** @brief 浮点表示的数字（ttisfloat）由上面的表示层定义 */
+
+/** @brief 整数子类型的数字：value.i有效，未启用整数子类型时恒为假 */
+#if defined(LUA_USE_INTNUM)
+#define ttisint(o)	checktag(o, LUA_TINT)
+#else
+#define ttisint(o)	0
+#endif
 
 /**
  * @brief 字符串类型检查：判断值是否为字符串
@@ -347,7 +479,7 @@ typedef struct lua_TValue {
  * 字符串是Lua中的基本数据类型之一，这个宏用于检查
  * 一个值是否为字符串类型。
  */
-#define ttisstring(o)	(ttype(o) == LUA_TSTRING)
+#define ttisstring(o)	checktag(o, LUA_TSTRING)
 
 /**
  * @brief 表类型检查：判断值是否为表
@@ -355,35 +487,38 @@ typedef struct lua_TValue {
  * 表是Lua中唯一的复合数据结构，这个宏用于检查
  * 一个值是否为表类型。
  */
-#define ttistable(o)	(ttype(o) == LUA_TTABLE)
+#define ttistable(o)	checktag(o, LUA_TTABLE)
 
 /**
  * @brief 函数类型检查：判断值是否为函数
  * 
  * 这个宏检查值是否为Lua函数（包括Lua函数和C函数）。
  */
-#define ttisfunction(o)	(ttype(o) == LUA_TFUNCTION)
+#define ttisfunction(o)	checktag(o, LUA_TFUNCTION)
 
 /**
  * @brief 用户数据类型检查：判断值是否为完整用户数据
  * 
  * 完整用户数据是由Lua管理内存的用户自定义数据类型。
  */
-#define ttisuserdata(o)	(ttype(o) == LUA_TUSERDATA)
+#define ttisuserdata(o)	checktag(o, LUA_TUSERDATA)
 
 /**
  * @brief 线程类型检查：判断值是否为线程（协程）
  * 
  * 线程类型用于实现Lua的协程功能。
  */
-#define ttisthread(o)	(ttype(o) == LUA_TTHREAD)
+#define ttisthread(o)	checktag(o, LUA_TTHREAD)
 
 /**
  * @brief 轻量级用户数据检查：判断值是否为轻量级用户数据
  * 
  * 轻量级用户数据是指向C数据的指针，不受垃圾回收管理。
  */
-#define ttislightuserdata(o)	(ttype(o) == LUA_TLIGHTUSERDATA)
+#define ttislightuserdata(o)	checktag(o, LUA_TLIGHTUSERDATA)
+
+/** @brief 尚未压平的字符串（LUA_TROPE） */
+#define ttisrope(o)	checktag(o, LUA_TROPE)
 
 /**
  * =====================================================================
@@ -397,7 +532,20 @@ typedef struct lua_TValue {
  * 这个宏直接访问TValue结构中的类型标签字段，是所有类型检查
  * 和值访问操作的基础。
  */
-#define ttype(o)	((o)->tt)
+#define ttype(o)	rawtt(o)
+
+/**
+ * @brief 公共类型：整数子类型归为LUA_TNUMBER，rope归为LUA_TSTRING
+ *
+ * 用于返回给C API的类型、按类型索引的数组（元表、类型名）以及
+ * 需要把两种数字（字符串）表示视为同一类型的比较。
+ */
+#if defined(LUA_USE_INTNUM)
+#define basetype(o) \
+  (ttisint(o) ? LUA_TNUMBER : ttisrope(o) ? LUA_TSTRING : ttype(o))
+#else
+#define basetype(o)	(ttisrope(o) ? LUA_TSTRING : ttype(o))
+#endif
 
 /**
  * @brief 垃圾回收对象访问：安全地获取GC对象指针
@@ -408,7 +556,7 @@ typedef struct lua_TValue {
  * 
  * 适用类型：字符串、表、函数、完整用户数据、线程等。
  */
-#define gcvalue(o)	check_exp(iscollectable(o), (o)->value.gc)
+#define gcvalue(o)	check_exp(iscollectable(o), val_gc(o))
 
 /**
  * @brief 轻量级用户数据访问：获取C指针值
@@ -416,15 +564,26 @@ typedef struct lua_TValue {
  * 轻量级用户数据存储的是原始的C指针，不受垃圾回收管理。
  * 这个宏确保只有轻量级用户数据类型才会返回指针值。
  */
-#define pvalue(o)	check_exp(ttislightuserdata(o), (o)->value.p)
+#define pvalue(o)	check_exp(ttislightuserdata(o), val_p(o))
 
 /**
  * @brief 数值访问：获取数字值
  * 
  * 从TValue中提取lua_Number类型的数值。lua_Number通常定义
- * 为double，用于表示Lua中的所有数字。
- */
-#define nvalue(o)	check_exp(ttisnumber(o), (o)->value.n)
+ * 为double，用于表示Lua中的所有数字；整数子类型在这里转换为lua_Number。
+ * 已知是浮点表示时用fltvalue，已知是整数子类型时用ivalue。
+ */
+#if defined(LUA_USE_INTNUM)
+#define nvalue(o) \
+  (ttisint(o) ? cast_num(val_i(o)) : check_exp(ttisfloat(o), val_n(o)))
+#define ivalue(o)	check_exp(ttisint(o), val_i(o))
+#else
+#define nvalue(o)	check_exp(ttisnumber(o), val_n(o))
+#define ivalue(o)	cast_int(nvalue(o))
+#endif
+
+/** @brief 浮点数访问：调用者已确认ttisfloat */
+#define fltvalue(o)	check_exp(ttisfloat(o), val_n(o))
 
 /**
  * @brief 原始字符串访问：获取TString对象指针
@@ -432,7 +591,7 @@ typedef struct lua_TValue {
  * 这个宏返回指向完整TString结构的指针，包含字符串的元数据
  * （如长度、哈希值等）。
  */
-#define rawtsvalue(o)	check_exp(ttisstring(o), &(o)->value.gc->ts)
+#define rawtsvalue(o)	check_exp(ttisstring(o), &val_gc(o)->ts)
 
 /**
  * @brief 字符串值访问：获取字符串的实际数据部分
@@ -442,12 +601,15 @@ typedef struct lua_TValue {
  */
 #define tsvalue(o)	(&rawtsvalue(o)->tsv)
 
+/** @brief rope访问：获取Rope对象指针 */
+#define ropevalue(o)	check_exp(ttisrope(o), &val_gc(o)->rp)
+
 /**
  * @brief 原始用户数据访问：获取Udata对象指针
  * 
  * 返回指向完整Udata结构的指针，包含用户数据的元数据。
  */
-#define rawuvalue(o)	check_exp(ttisuserdata(o), &(o)->value.gc->u)
+#define rawuvalue(o)	check_exp(ttisuserdata(o), &val_gc(o)->u)
 
 /**
  * @brief 用户数据值访问：获取用户数据的实际数据部分
@@ -461,28 +623,28 @@ typedef struct lua_TValue {
  * 
  * 从TValue中提取函数对象，可能是Lua闭包或C闭包。
  */
-#define clvalue(o)	check_exp(ttisfunction(o), &(o)->value.gc->cl)
+#define clvalue(o)	check_exp(ttisfunction(o), &val_gc(o)->cl)
 
 /**
  * @brief 表访问：获取表对象
  * 
  * 从TValue中提取表对象的指针，用于表操作。
  */
-#define hvalue(o)	check_exp(ttistable(o), &(o)->value.gc->h)
+#define hvalue(o)	check_exp(ttistable(o), &val_gc(o)->h)
 
 /**
  * @brief 布尔值访问：获取布尔值
  * 
  * 从TValue中提取布尔值，返回int类型（0表示false，非0表示true）。
  */
-#define bvalue(o)	check_exp(ttisboolean(o), (o)->value.b)
+#define bvalue(o)	check_exp(ttisboolean(o), val_b(o))
 
 /**
  * @brief 线程访问：获取线程（协程）对象
  * 
  * 从TValue中提取线程对象，用于协程操作。
  */
-#define thvalue(o)	check_exp(ttisthread(o), &(o)->value.gc->th)
+#define thvalue(o)	check_exp(ttisthread(o), &val_gc(o)->th)
 
 /**
  * @brief 假值检查：判断值在逻辑上是否为假
@@ -518,7 +680,7 @@ typedef struct lua_TValue {
  * 注意：这个宏只在调试模式下生效，发布版本中会被优化掉。
  */
 #define checkconsistency(obj) \
-  lua_assert(!iscollectable(obj) || (ttype(obj) == (obj)->value.gc->gch.tt))
+  lua_assert(!iscollectable(obj) || (ttype(obj) == val_gc(obj)->gch.tt))
 
 /**
  * @brief 存活性检查：验证对象的垃圾回收状态
@@ -527,7 +689,7 @@ typedef struct lua_TValue {
  */
 #define checkliveness(g,obj) \
   lua_assert(!iscollectable(obj) || \
-  ((ttype(obj) == (obj)->value.gc->gch.tt) && !isdead(g, (obj)->value.gc)))
+  ((ttype(obj) == val_gc(obj)->gch.tt) && !isdead(g, val_gc(obj))))
 
 
 /**
@@ -541,7 +703,7 @@ typedef struct lua_TValue {
  * 
  * 这是最简单的值设置操作，只需要设置类型标签，因为nil没有关联的数据。
  */
-#define setnilvalue(obj) ((obj)->tt=LUA_TNIL)
+#define setnilvalue(obj) setnil_(obj)
 
 /**
  * @brief 设置数值：将TValue设置为数字类型
@@ -560,7 +722,39 @@ typedef struct lua_TValue {
  * 3. 设置类型标签为LUA_TNUMBER
  */
 #define setnvalue(obj,x) \
-  { TValue *i_o=(obj); i_o->value.n=(x); i_o->tt=LUA_TNUMBER; }
+  { TValue *i_o=(obj); setn_(i_o, x); }
+
+/**
+ * @brief 设置整数：将TValue设置为int值
+ *
+ * 启用整数子类型时使用LUA_TINT表示，否则退化为setnvalue。
+ */
+#if defined(LUA_USE_INTNUM)
+#define setivalue(obj,x) \
+  { TValue *i_o=(obj); seti_(i_o, x); }
+#else
+#define setivalue(obj,x)	setnvalue(obj, cast_num(x))
+#endif
+
+/**
+ * @brief 设置数字并尽量使用整数子类型
+ *
+ * 详细说明：
+ * x能用int精确表示时存为整数子类型，否则存为浮点数。-0不能用int
+ * 表示（1/-0与1/0不同），NaN和超出int范围的值也保持浮点。
+ * 用于常量、API压入的整数等来源不确定的数字。
+ */
+#if defined(LUA_USE_INTNUM)
+#define setnumvalue(obj,x) \
+  { TValue *n_o=(obj); lua_Number n_x=(x); int n_i; \
+    lua_number2int(n_i, n_x); \
+    if (cast_num(n_i) == n_x && (n_i != 0 || luai_numdiv(1, n_x) > 0)) \
+      { setivalue(n_o, n_i); } \
+    else \
+      { setnvalue(n_o, n_x); } }
+#else
+#define setnumvalue(obj,x)	setnvalue(obj,x)
+#endif
 
 /**
  * @brief 设置轻量级用户数据：将TValue设置为C指针
@@ -569,7 +763,7 @@ typedef struct lua_TValue {
  * 这种类型适合存储不需要内存管理的C数据指针。
  */
 #define setpvalue(obj,x) \
-  { TValue *i_o=(obj); i_o->value.p=(x); i_o->tt=LUA_TLIGHTUSERDATA; }
+  { TValue *i_o=(obj); setp_(i_o, x); }
 
 /**
  * @brief 设置布尔值：将TValue设置为布尔类型
@@ -577,7 +771,7 @@ typedef struct lua_TValue {
  * 在Lua中，布尔值使用int类型存储，0表示false，非0表示true。
  */
 #define setbvalue(obj,x) \
-  { TValue *i_o=(obj); i_o->value.b=(x); i_o->tt=LUA_TBOOLEAN; }
+  { TValue *i_o=(obj); setb_(i_o, x); }
 
 /**
  * @brief 设置字符串值：将TValue设置为字符串类型
@@ -593,7 +787,7 @@ typedef struct lua_TValue {
  */
 #define setsvalue(L,obj,x) \
   { TValue *i_o=(obj); \
-    i_o->value.gc=cast(GCObject *, (x)); i_o->tt=LUA_TSTRING; \
+    setgc_(i_o, x, LUA_TSTRING); \
     checkliveness(G(L),i_o); }
 
 /**
@@ -603,7 +797,7 @@ typedef struct lua_TValue {
  */
 #define setuvalue(L,obj,x) \
   { TValue *i_o=(obj); \
-    i_o->value.gc=cast(GCObject *, (x)); i_o->tt=LUA_TUSERDATA; \
+    setgc_(i_o, x, LUA_TUSERDATA); \
     checkliveness(G(L),i_o); }
 
 /**
@@ -613,7 +807,7 @@ typedef struct lua_TValue {
  */
 #define setthvalue(L,obj,x) \
   { TValue *i_o=(obj); \
-    i_o->value.gc=cast(GCObject *, (x)); i_o->tt=LUA_TTHREAD; \
+    setgc_(i_o, x, LUA_TTHREAD); \
     checkliveness(G(L),i_o); }
 
 /**
@@ -623,7 +817,7 @@ typedef struct lua_TValue {
  */
 #define setclvalue(L,obj,x) \
   { TValue *i_o=(obj); \
-    i_o->value.gc=cast(GCObject *, (x)); i_o->tt=LUA_TFUNCTION; \
+    setgc_(i_o, x, LUA_TFUNCTION); \
     checkliveness(G(L),i_o); }
 
 /**
@@ -631,9 +825,14 @@ typedef struct lua_TValue {
  * 
  * 表是Lua中的复合数据结构，用于实现数组、字典等功能。
  */
+#define setropevalue(L,obj,x) \
+  { TValue *i_o=(obj); \
+    setgc_(i_o, x, LUA_TROPE); \
+    checkliveness(G(L),i_o); }
+
 #define sethvalue(L,obj,x) \
   { TValue *i_o=(obj); \
-    i_o->value.gc=cast(GCObject *, (x)); i_o->tt=LUA_TTABLE; \
+    setgc_(i_o, x, LUA_TTABLE); \
     checkliveness(G(L),i_o); }
 
 /**
@@ -645,7 +844,7 @@ typedef struct lua_TValue {
  */
 #define setptvalue(L,obj,x) \
   { TValue *i_o=(obj); \
-    i_o->value.gc=cast(GCObject *, (x)); i_o->tt=LUA_TPROTO; \
+    setgc_(i_o, x, LUA_TPROTO); \
     checkliveness(G(L),i_o); }
 
 /**
@@ -674,7 +873,7 @@ typedef struct lua_TValue {
  */
 #define setobj(L,obj1,obj2) \
   { const TValue *o2=(obj2); TValue *o1=(obj1); \
-    o1->value = o2->value; o1->tt=o2->tt; \
+    copy_(o1, o2); \
     checkliveness(G(L),o1); }
 
 /**
@@ -733,21 +932,13 @@ typedef struct lua_TValue {
  * 这个宏允许直接修改TValue的类型标签，主要用于类型转换或
  * 特殊的内部操作。使用时需要确保值数据与新类型匹配。
  */
-#define setttype(obj, tt) (ttype(obj) = (tt))
+#define setttype(obj, tt) settt_(obj, tt)
 
-/**
- * @brief 可回收性检查：判断对象是否需要垃圾回收
- * 
- * 详细说明：
- * 这个宏通过检查类型标签来判断对象是否是垃圾回收对象。
- * 在Lua的类型系统中，数字、布尔值、nil和轻量级用户数据不需要GC，
- * 而字符串、表、函数、完整用户数据和线程需要GC管理。
- * 
- * 判断规则：
- * 类型标签 >= LUA_TSTRING 的对象都是可垃圾回收的对象。
+/*
+ * 可回收性检查iscollectable(o)由TValuefields处的表示层定义：类型标签
+ * >= LUA_TSTRING的值（字符串、表、函数、完整用户数据、线程等）由GC管理，
  * 这利用了类型常量的定义顺序。
  */
-#define iscollectable(o)	(ttype(o) >= LUA_TSTRING)
 
 /**
  * =====================================================================
@@ -811,6 +1002,7 @@ typedef union TString {
     struct {
         CommonHeader;           /* 垃圾回收对象的公共头部 */
         lu_byte reserved;       /* 保留字段：用于将来的扩展或特殊标记 */
+        lu_byte hashed;         /* hash是否有效：长字符串第一次用作表键时才计算 */
         unsigned int hash;      /* 哈希值：预计算的字符串哈希，用于快速比较和查找 */
         size_t len;            /* 长度：字符串的字节长度（不包括终止符） */
     } tsv;
@@ -838,6 +1030,30 @@ typedef union TString {
  */
 #define svalue(o)       getstr(rawtsvalue(o))
 
+/**
+ * @brief 延迟连接的字符串（rope）
+ *
+ * 详细说明：
+ * OP_CONCAT的左操作数已经是rope，或者是不短于LUAI_ROPEMIN的字符串
+ * 时，结果不复制左边，而是记为"左半部分 + 本节点的右半部分"，右半
+ * 部分（其余操作数连接的结果）的字符紧跟在结构体之后。循环中反复
+ * 执行s = s .. piece时每次只复制piece，左边形成一条向左延伸的链。
+ *
+ * 第一次需要字符串内容时（luaS_flatten）沿链把所有部分复制成一个
+ * 内部化的字符串，记在flat中并丢掉left，之后的压平都直接返回flat。
+ * 除了设置flat（需要写屏障）之外rope不会被修改。
+ */
+typedef struct Rope {
+    CommonHeader;
+    GCObject *left;         /* 左半部分：字符串或rope；压平后为NULL */
+    union TString *flat;    /* 压平的结果，尚未压平时为NULL */
+    size_t len;             /* 总长度 */
+    size_t rlen;            /* 右半部分的长度 */
+} Rope;
+
+/** @brief rope右半部分的字符 */
+#define getrope(r)	cast(char *, (r) + 1)
+
 /**
  * =====================================================================
  * 用户数据对象系统 - 自定义数据类型的容器
@@ -915,6 +1131,13 @@ typedef struct Proto {
     int linedefined;              /* 定义行号：函数在源码中的起始行号 */
     int lastlinedefined;          /* 结束行号：函数在源码中的结束行号 */
     GCObject *gclist;             /* 垃圾回收链表：用于GC遍历的链接指针 */
+    int *icache;                  /* 内联缓存：与code平行，记录字符串常量键命中的节点槽位 */
+    int sizeicache;               /* 内联缓存大小：icache数组的大小 */
+#if defined(LUA_USE_JIT)
+    void *jitcode;                /* 机器码：ljit.c生成的代码块，未编译时为NULL */
+    int hotcount;                 /* 热度计数：调用和循环回跳次数 */
+    lu_byte jitstate;             /* 编译状态：JIT_NONE、JIT_READY或JIT_FAILED */
+#endif
     lu_byte nups;                 /* 上值数量：函数引用的外部变量个数 */
     lu_byte numparams;            /* 参数数量：函数的固定参数个数 */
     lu_byte is_vararg;            /* 可变参数标志：函数是否接受可变数量的参数 */
@@ -1156,7 +1379,9 @@ typedef union Closure {
 typedef union TKey {
     struct {
         TValuefields;            /* 键的值和类型信息 */
+#if !defined(LUA_USE_SWISSTABLE)
         struct Node *next;       /* 链表指针：指向下一个具有相同哈希值的节点 */
+#endif
     } nk;
     /**
      * @brief TValue视图：将键作为普通TValue访问
@@ -1211,12 +1436,25 @@ typedef struct Table {
     CommonHeader;                /* 垃圾回收对象的公共头部 */
     lu_byte flags;              /* 元方法标志：1<<p 表示元方法p不存在，用于优化元方法查找 */
     lu_byte lsizenode;          /* 节点数组大小的对数：log2(node数组大小) */
+#if defined(LUA_USE_INCREHASH)
+    lu_byte incrstate;          /* 增量重哈希的状态（INCR_*，见ltable.h） */
+    lu_byte incrlsize;          /* incrnode大小的对数 */
+#endif
     struct Table *metatable;    /* 元表：定义表的操作行为和方法 */
     TValue *array;              /* 数组部分：存储数值索引的连续数组 */
     Node *node;                 /* 哈希部分：存储非数值索引的哈希表节点数组 */
+#if defined(LUA_USE_SWISSTABLE)
+    int hfree;                  /* 重哈希之前哈希部分还能占用的空槽数 */
+#else
     Node *lastfree;             /* 空闲位置标记：指向最后一个空闲位置之前的位置 */
+#endif
+#if defined(LUA_USE_INCREHASH)
+    Node *incrnode;             /* 增量重哈希中正在初始化的新数组或正在迁移的旧数组 */
+    int incrpos;                /* 新数组已初始化的节点数，或旧数组还没有迁移的节点数 */
+#endif
     GCObject *gclist;           /* 垃圾回收链表：用于GC遍历的链接指针 */
     int sizearray;              /* 数组大小：array数组的实际大小 */
+    int lenhint;                /* 上次求得的长度：luaH_getn验证后复用 */
 } Table;
 
 /**
@@ -217,6 +217,9 @@ const char *const luaP_opnames[NUM_OPCODES+1] = {
     "CLOSE",
     "CLOSURE",
     "VARARG",
+    "GETGLOBAL_CALL",
+    "GETGLOBAL_GETTABLE",
+    "GETTABLE_GETTABLE",
     NULL
 };
 
@@ -354,5 +357,23 @@ const lu_byte luaP_opmodes[NUM_OPCODES] = {
     opmode(0, 0, OpArgN, OpArgN, iABC),        /* OP_CLOSE */
     opmode(0, 1, OpArgU, OpArgN, iABx),        /* OP_CLOSURE */
     opmode(0, 1, OpArgU, OpArgN, iABC),        /* OP_VARARG */
+    opmode(0, 1, OpArgK, OpArgN, iABx),        /* OP_GETGLOBAL_CALL */
+    opmode(0, 1, OpArgK, OpArgN, iABx),        /* OP_GETGLOBAL_GETTABLE */
+    opmode(0, 1, OpArgR, OpArgK, iABC),        /* OP_GETTABLE_GETTABLE */
+};
+
+
+/**
+ * @brief 融合指令表
+ *
+ * 与lopcodes.h中融合指令的顺序一致，每行是{第一条, 第二条}。
+ * 融合指令的模式（luaP_opmodes）与第一条指令相同。
+ *
+ * @see luaK_fuse, stockop, fusednext
+ */
+const lu_byte luaP_fusedops[NUM_OPCODES - NUM_STOCKOPCODES][2] = {
+    {OP_GETGLOBAL, OP_CALL},                   /* OP_GETGLOBAL_CALL */
+    {OP_GETGLOBAL, OP_GETTABLE},               /* OP_GETGLOBAL_GETTABLE */
+    {OP_GETTABLE, OP_GETTABLE},                /* OP_GETTABLE_GETTABLE */
 };
 
@@ -1758,7 +1758,31 @@ typedef enum {
      * - 动态参数数量的处理
      * - 与固定参数的统一处理
      */
-    OP_VARARG
+    OP_VARARG,
+
+    /*==================================================================
+     * 融合指令组（超级指令）
+     *==================================================================*/
+
+    /**
+     * @brief 融合指令
+     *
+     * 由luaK_fuse在函数编译完成后把常见指令对的第一条改写而成，
+     * 操作数与第一条指令完全相同，第二条指令原样保留在下一个位置。
+     * 执行时先完成第一条指令，再不经分发直接转入第二条指令的处理器，
+     * 省去一次间接跳转。
+     *
+     * 因为第二条指令保持不变：
+     * - 跳转目标、行号信息和调试信息都不受影响
+     * - 跳到第二条指令的控制流照常执行
+     * - 钩子开启时退化为普通的逐条分发
+     *
+     * luaG_checkcode要求每条融合指令后面紧跟fusednext()规定的操作码。
+     * ldump.c默认把它们还原为原始操作码（LUAU_DUMPFUSED时保留）。
+     */
+    OP_GETGLOBAL_CALL,      /**< GETGLOBAL后接CALL：f(...)调用全局函数 */
+    OP_GETGLOBAL_GETTABLE,  /**< GETGLOBAL后接GETTABLE：math.floor等模块访问 */
+    OP_GETTABLE_GETTABLE    /**< GETTABLE后接GETTABLE：a.b.c链式访问 */
 } OpCode;
 
 
@@ -1766,7 +1790,7 @@ typedef enum {
  * @brief 操作码总数常量
  * 
  * 计算虚拟机支持的操作码总数，用于数组大小分配和循环边界检查。
- * 值为OP_VARARG+1，当前为38个操作码。
+ * 值为最后一个融合指令+1，包括38个原始操作码和融合指令。
  * 
  * 使用场景：
  * - 操作码属性表的大小定义
@@ -1774,7 +1798,34 @@ typedef enum {
  * - 调试工具的指令遍历
  * - 性能分析的指令计数
  */
-#define NUM_OPCODES (cast(int, OP_VARARG) + 1)
+#define NUM_OPCODES (cast(int, OP_GETTABLE_GETTABLE) + 1)
+
+/**
+ * @brief 原始操作码数量
+ *
+ * 标准Lua 5.1字节码中的操作码数量（OP_MOVE到OP_VARARG），
+ * 之后的编号都是融合指令。
+ */
+#define NUM_STOCKOPCODES (cast(int, OP_VARARG) + 1)
+
+/** @brief 是否为融合指令 */
+#define isfusedop(o)    (cast(int, o) >= NUM_STOCKOPCODES)
+
+/**
+ * @brief 融合指令对应的原始指令对
+ *
+ * 第一列是被改写的第一条指令，第二列是后面必须紧跟的指令。
+ * 由lopcodes.c定义。
+ */
+LUAI_DATA const lu_byte luaP_fusedops[NUM_OPCODES - NUM_STOCKOPCODES][2];
+
+/** @brief 原始操作码：融合指令返回其第一条指令，其他操作码不变 */
+#define stockop(o)  (isfusedop(o) ? \
+    cast(OpCode, luaP_fusedops[cast(int, o) - NUM_STOCKOPCODES][0]) : (o))
+
+/** @brief 融合指令后面必须紧跟的操作码 */
+#define fusednext(o) \
+    cast(OpCode, luaP_fusedops[cast(int, o) - NUM_STOCKOPCODES][1])
 
 /**
  * @brief 操作数类型枚举：定义指令参数的使用模式
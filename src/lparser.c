@@ -1225,7 +1225,7 @@ static int indexupvalue (FuncState *fs, TString *name, expdesc *v) {
 static int searchvar (FuncState *fs, TString *n) {
     int i;
     for (i=fs->nactvar-1; i >= 0; i--) {
-        if (n == getlocvar(fs, i).varname)
+        if (luaS_eqstr(n, getlocvar(fs, i).varname))
             return i;
     }
     return -1;
@@ -2203,6 +2203,8 @@ static void close_func (LexState *ls) {
     f->sizelocvars = fs->nlocvars;
     luaM_reallocvector(L, f->upvalues, f->sizeupvalues, f->nups, TString *);
     f->sizeupvalues = f->nups;
+    luaF_initcache(L, f);
+    luaK_fuse(f);
     lua_assert(luaG_checkcode(f));
     lua_assert(fs->bl == NULL);
     ls->fs = fs->prev;
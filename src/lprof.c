@@ -0,0 +1,382 @@
+﻿/**
+ * @file lprof.c
+ * @brief 堆分析器：采样分配、跟踪释放、按调用栈输出报告
+ *
+ * 详细说明：
+ * 数据结构：
+ * - 分配位置（ProfSite）：以调用栈文本为键的哈希表，累计该位置的
+ *   样本数和字节数，以及仍然存活的部分
+ * - 样本（ProfSample）：以内存块地址为键的哈希表，每个被采样且尚未
+ *   释放的块一项，记录它属于哪个分配位置和代表的字节数
+ *
+ * 采样间隔在[interval/2, interval*3/2)内随机选取，避免与程序中固定
+ * 的分配模式同步。每个样本的权重是自上次采样以来分配的字节数。
+ *
+ * @author Lua开发团队
+ * @version 5.1.5
+ *
+ * @see lprof.h, lmem.c, ldebug.c
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#define lprof_c
+#define LUA_CORE
+
+#include "lua.h"
+
+#include "ldebug.h"
+#include "ldo.h"
+#include "lmem.h"
+#include "lprof.h"
+#include "lstate.h"
+
+// 调用栈键的最大长度
+#define PROFKEYSIZE     4096
+
+// 哈希表的初始大小（必须是2的幂）
+#define MINSITES        64
+#define MINSAMPLES      256
+
+/**
+ * @brief 一个分配位置
+ */
+typedef struct ProfSite {
+    struct ProfSite *next;                  // 哈希链
+    unsigned int hash;
+    lu_mem bytes;                           // 累计分配字节（估计）
+    lu_mem livebytes;                       // 存活字节（估计）
+    size_t len;
+    char key[1];                            // 调用栈文本，以'\0'结尾
+} ProfSite;
+
+/**
+ * @brief 一个被采样且尚未释放的内存块
+ */
+typedef struct ProfSample {
+    struct ProfSample *next;                // 哈希链
+    void *block;
+    lu_mem weight;                          // 代表的字节数
+    ProfSite *site;
+} ProfSample;
+
+/**
+ * @brief 堆分析器状态
+ */
+typedef struct HeapProf {
+    lu_mem interval;                        // 平均采样间隔
+    lu_mem accum;                           // 上次采样以来分配的字节
+    lu_mem next;                            // 下次采样的间隔
+    lu_mem weight;                          // luaR_before记下的样本权重
+    unsigned int seed;                      // 随机间隔的种子
+    int dumping;                            // 输出报告期间不采样
+    ProfSite **sites;
+    int nsites, sizesites;
+    ProfSample **samples;
+    int nsamples, sizesamples;
+} HeapProf;
+
+#define rawalloc(g,n)       ((*(g)->frealloc)((g)->ud, NULL, 0, (n)))
+#define rawfree(g,p,n)      ((void)(*(g)->frealloc)((g)->ud, (p), (n), 0))
+
+#define samplehash(p)       ((unsigned int)((size_t)(p) >> 4))
+
+/**
+ * @brief 选取下一个采样间隔
+ */
+static void nextinterval(HeapProf *hp) {
+    hp->seed = hp->seed * 1103515245u + 12345u;
+    hp->next = hp->interval / 2 + ((hp->seed >> 8) % (hp->interval + 1));
+}
+
+/**
+ * @brief 把哈希表扩大一倍，失败时保持原样
+ */
+static void growsites(global_State *g, HeapProf *hp) {
+    int size = hp->sizesites * 2, i;
+    ProfSite **t = (ProfSite **)rawalloc(g, size * sizeof(ProfSite *));
+    if (t == NULL) {
+        return;
+    }
+    memset(t, 0, size * sizeof(ProfSite *));
+    for (i = 0; i < hp->sizesites; i++) {
+        ProfSite *s = hp->sites[i];
+        while (s != NULL) {
+            ProfSite *next = s->next;
+            s->next = t[s->hash & (size - 1)];
+            t[s->hash & (size - 1)] = s;
+            s = next;
+        }
+    }
+    rawfree(g, hp->sites, hp->sizesites * sizeof(ProfSite *));
+    hp->sites = t;
+    hp->sizesites = size;
+}
+
+static void growsamples(global_State *g, HeapProf *hp) {
+    int size = hp->sizesamples * 2, i;
+    ProfSample **t = (ProfSample **)rawalloc(g, size * sizeof(ProfSample *));
+    if (t == NULL) {
+        return;
+    }
+    memset(t, 0, size * sizeof(ProfSample *));
+    for (i = 0; i < hp->sizesamples; i++) {
+        ProfSample *s = hp->samples[i];
+        while (s != NULL) {
+            ProfSample *next = s->next;
+            unsigned int h = samplehash(s->block) & (size - 1);
+            s->next = t[h];
+            t[h] = s;
+            s = next;
+        }
+    }
+    rawfree(g, hp->samples, hp->sizesamples * sizeof(ProfSample *));
+    hp->samples = t;
+    hp->sizesamples = size;
+}
+
+/**
+ * @brief 查找或建立调用栈键对应的分配位置
+ */
+static ProfSite *getsite(global_State *g, HeapProf *hp, const char *key,
+                         size_t len) {
+    unsigned int h = (unsigned int)len;
+    size_t i;
+    ProfSite *s;
+
+    for (i = 0; i < len; i++) {
+        h = h ^ ((h << 5) + (h >> 2) + (unsigned char)key[i]);
+    }
+    for (s = hp->sites[h & (hp->sizesites - 1)]; s != NULL; s = s->next) {
+        if (s->hash == h && s->len == len && memcmp(s->key, key, len) == 0) {
+            return s;
+        }
+    }
+    s = (ProfSite *)rawalloc(g, sizeof(ProfSite) + len);
+    if (s == NULL) {
+        return NULL;
+    }
+    s->hash = h;
+    s->bytes = s->livebytes = 0;
+    s->len = len;
+    memcpy(s->key, key, len + 1);
+    s->next = hp->sites[h & (hp->sizesites - 1)];
+    hp->sites[h & (hp->sizesites - 1)] = s;
+    if (++hp->nsites > hp->sizesites) {
+        growsites(g, hp);
+    }
+    return s;
+}
+
+/**
+ * @brief 查找内存块的样本
+ * @return 指向链表中该样本的指针，没有时返回NULL
+ */
+static ProfSample **findsample(HeapProf *hp, void *block) {
+    ProfSample **p = &hp->samples[samplehash(block) & (hp->sizesamples - 1)];
+    for (; *p != NULL; p = &(*p)->next) {
+        if ((*p)->block == block) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+struct ProfSite *luaR_before(lua_State *L, size_t osize, size_t nsize) {
+    HeapProf *hp = G(L)->heapprof;
+    char key[PROFKEYSIZE];
+    size_t len;
+
+    if (nsize <= osize) {
+        return NULL;
+    }
+    hp->accum += nsize - osize;
+    if (hp->accum < hp->next || hp->dumping) {
+        return NULL;
+    }
+    hp->weight = hp->accum;
+    hp->accum = 0;
+    nextinterval(hp);
+    len = luaG_stackkey(L, key, sizeof(key));
+    return getsite(G(L), hp, key, len);
+}
+
+void luaR_after(lua_State *L, struct ProfSite *site, void *block,
+                void *nblock) {
+    global_State *g = G(L);
+    HeapProf *hp = g->heapprof;
+    ProfSample *s;
+    ProfSample **p;
+
+    if (block != NULL && hp->nsamples > 0 &&
+        (p = findsample(hp, block)) != NULL) {
+        s = *p;
+        if (site != NULL) {
+            // 被采样的块又增长到了采样间隔：权重计入原来的分配位置
+            s->weight += hp->weight;
+            s->site->bytes += hp->weight;
+            s->site->livebytes += hp->weight;
+        }
+        if (nblock == block) {
+            return;
+        }
+        *p = s->next;
+        if (nblock != NULL) {
+            // 块被移动：样本跟随新地址
+            unsigned int h = samplehash(nblock) & (hp->sizesamples - 1);
+            s->block = nblock;
+            s->next = hp->samples[h];
+            hp->samples[h] = s;
+        } else {
+            s->site->livebytes -= s->weight;
+            rawfree(g, s, sizeof(ProfSample));
+            hp->nsamples--;
+        }
+        return;
+    }
+    if (site == NULL || nblock == NULL) {
+        return;
+    }
+    site->bytes += hp->weight;
+    s = (ProfSample *)rawalloc(g, sizeof(ProfSample));
+    if (s == NULL) {
+        return;
+    }
+    s->block = nblock;
+    s->weight = hp->weight;
+    s->site = site;
+    site->livebytes += s->weight;
+    s->next = hp->samples[samplehash(nblock) & (hp->sizesamples - 1)];
+    hp->samples[samplehash(nblock) & (hp->sizesamples - 1)] = s;
+    if (++hp->nsamples > hp->sizesamples) {
+        growsamples(g, hp);
+    }
+}
+
+/**
+ * @brief 释放分析器的全部数据
+ */
+static void freeprof(global_State *g, HeapProf *hp) {
+    int i;
+
+    for (i = 0; i < hp->sizesamples; i++) {
+        ProfSample *s = hp->samples[i];
+        while (s != NULL) {
+            ProfSample *next = s->next;
+            rawfree(g, s, sizeof(ProfSample));
+            s = next;
+        }
+    }
+    for (i = 0; i < hp->sizesites; i++) {
+        ProfSite *s = hp->sites[i];
+        while (s != NULL) {
+            ProfSite *next = s->next;
+            rawfree(g, s, sizeof(ProfSite) + s->len);
+            s = next;
+        }
+    }
+    rawfree(g, hp->samples, hp->sizesamples * sizeof(ProfSample *));
+    rawfree(g, hp->sites, hp->sizesites * sizeof(ProfSite *));
+    rawfree(g, hp, sizeof(HeapProf));
+}
+
+int luaR_heapprof(lua_State *L, int interval) {
+    global_State *g = G(L);
+    HeapProf *hp = g->heapprof;
+    int old = (hp != NULL) ? (int)hp->interval : 0;
+
+    if (interval < 0) {
+        return old;
+    }
+    if (interval == 0) {
+        if (hp != NULL) {
+            g->heapprof = NULL;
+            freeprof(g, hp);
+        }
+        return old;
+    }
+    if (hp == NULL) {
+        hp = (HeapProf *)rawalloc(g, sizeof(HeapProf));
+        if (hp == NULL) {
+            return old;
+        }
+        memset(hp, 0, sizeof(HeapProf));
+        hp->sites = (ProfSite **)rawalloc(g, MINSITES * sizeof(ProfSite *));
+        hp->samples = (ProfSample **)rawalloc(g,
+                                              MINSAMPLES * sizeof(ProfSample *));
+        if (hp->sites == NULL || hp->samples == NULL) {
+            if (hp->sites != NULL) {
+                rawfree(g, hp->sites, MINSITES * sizeof(ProfSite *));
+            }
+            if (hp->samples != NULL) {
+                rawfree(g, hp->samples, MINSAMPLES * sizeof(ProfSample *));
+            }
+            rawfree(g, hp, sizeof(HeapProf));
+            return old;
+        }
+        memset(hp->sites, 0, MINSITES * sizeof(ProfSite *));
+        memset(hp->samples, 0, MINSAMPLES * sizeof(ProfSample *));
+        hp->sizesites = MINSITES;
+        hp->sizesamples = MINSAMPLES;
+        hp->seed = (unsigned int)(size_t)hp;
+        g->heapprof = hp;
+    }
+    hp->interval = (lu_mem)interval;
+    nextinterval(hp);
+    return old;
+}
+
+/**
+ * @brief luaR_dump的参数，在保护模式下执行的dumpsites使用
+ */
+typedef struct DumpState {
+    HeapProf *hp;
+    lua_Writer writer;
+    void *data;
+    int what;
+    int status;                             // writer返回的第一个非0值
+} DumpState;
+
+static void dumpsites(lua_State *L, void *ud) {
+    DumpState *d = (DumpState *)ud;
+    HeapProf *hp = d->hp;
+    char line[PROFKEYSIZE + 32];
+    int i;
+
+    for (i = 0; i < hp->sizesites && d->status == 0; i++) {
+        ProfSite *s;
+        for (s = hp->sites[i]; s != NULL && d->status == 0; s = s->next) {
+            lu_mem v = d->what ? s->bytes : s->livebytes;
+            if (v > 0) {
+                int n = sprintf(line, "%s %lu\n", s->key[0] ? s->key : "?",
+                                (unsigned long)v);
+                d->status = d->writer(L, line, (size_t)n, d->data);
+            }
+        }
+    }
+}
+
+int luaR_dump(lua_State *L, lua_Writer writer, void *data, int what) {
+    HeapProf *hp = G(L)->heapprof;
+    DumpState d;
+    int err;
+
+    if (hp == NULL) {
+        return 0;
+    }
+    d.hp = hp;
+    d.writer = writer;
+    d.data = data;
+    d.what = what;
+    d.status = 0;
+    // writer可能分配内存；这期间不建立新的分配位置，哈希表保持不变。
+    // writer抛出的错误先在这里截住，恢复采样后再原样抛出
+    hp->dumping = 1;
+    err = luaD_rawrunprotected(L, dumpsites, &d);
+    hp->dumping = 0;
+    if (err != 0) {
+        luaD_throw(L, err);
+    }
+    return d.status;
+}
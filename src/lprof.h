@@ -0,0 +1,72 @@
+﻿/**
+ * @file lprof.h
+ * @brief 堆分析器：按分配位置统计存活内存
+ *
+ * 详细说明：
+ * 启用后（collectgarbage("heapprof", n)或lua_gc的LUA_GCHEAPPROF），
+ * luaM_realloc_平均每分配n字节采样一次，记录当时的调用栈（见
+ * luaG_stackkey），并跟踪被采样的内存块直到释放。每个样本代表自上次
+ * 采样以来分配的全部字节，所以按调用栈汇总的样本字节数是分配量的
+ * 无偏估计。
+ *
+ * lua_heapdump按火焰图工具的folded格式输出报告，每行一个调用栈：
+ * "外层;...;内层 字节数"。可以直接交给flamegraph.pl、speedscope，
+ * 或用pprof等工具转换后查看。
+ *
+ * 分析器的数据结构直接从g->frealloc分配，不计入totalbytes，也不会
+ * 抛出错误；内存不足时只是丢失样本。
+ *
+ * @author Lua开发团队
+ * @version 5.1.5
+ *
+ * @see lprof.c, lmem.c, ldebug.c
+ */
+
+#ifndef lprof_h
+#define lprof_h
+
+#include "lobject.h"
+#include "lstate.h"
+
+/**
+ * @brief 分配前的采样判断
+ *
+ * 在luaM_realloc_真正分配之前调用（栈和调用信息数组可能正要被重新
+ * 分配，之后旧的指针就失效了）。本次分配达到采样间隔时记录调用栈，
+ * 返回对应的分配位置，否则返回NULL。
+ *
+ * @see luaR_after()
+ */
+LUAI_FUNC struct ProfSite *luaR_before(lua_State *L, size_t osize,
+                                       size_t nsize);
+
+/**
+ * @brief 分配后的记录
+ *
+ * 旧块是被采样的块时，释放则删除样本，移动则更新样本；site不为NULL
+ * 时为新块建立样本。
+ */
+LUAI_FUNC void luaR_after(lua_State *L, struct ProfSite *site, void *block,
+                          void *nblock);
+
+/**
+ * @brief 开启、调整或关闭堆分析器
+ *
+ * @param L lua_State指针
+ * @param interval 采样间隔（字节）；0关闭并丢弃所有数据，负数只查询
+ * @return 之前的采样间隔，未开启时为0
+ */
+LUAI_FUNC int luaR_heapprof(lua_State *L, int interval);
+
+/**
+ * @brief 按调用栈输出报告
+ *
+ * @param what 0输出存活内存（用于查找泄漏），1输出累计分配量
+ * @return writer返回的第一个非0值，全部成功时为0
+ *
+ * @see lua_heapdump()
+ */
+LUAI_FUNC int luaR_dump(lua_State *L, lua_Writer writer, void *data,
+                        int what);
+
+#endif
@@ -50,6 +50,7 @@
  */
 
 #include <stddef.h>
+#include <string.h>
 
 #define lstate_c
 #define LUA_CORE
@@ -62,6 +63,7 @@
 #include "lgc.h"
 #include "llex.h"
 #include "lmem.h"
+#include "lprof.h"
 #include "lstate.h"
 #include "lstring.h"
 #include "ltable.h"
@@ -79,6 +81,19 @@
  */
 #define state_size(x)   (sizeof(x) + LUAI_EXTRASPACE)
 
+/**
+ * @brief 字符串哈希种子的随机来源
+ *
+ * 详细说明：
+ * 默认使用当前时间，makeseed再混入几个地址。嵌入程序可以把它定义为
+ * 更好的随机源；定义为常量则得到可重现的哈希值和遍历顺序（只应在
+ * 调试时这样做）。
+ */
+#if !defined(luai_makeseed)
+#include <time.h>
+#define luai_makeseed()     cast(unsigned int, time(NULL))
+#endif
+
 /**
  * @brief 从状态指针获取实际内存起始地址
  * @param l 状态指针
@@ -342,6 +357,7 @@ static void preinit_state(lua_State *L, global_State *g) {
 static void close_state(lua_State *L) {
     global_State *g = G(L);
     luaF_close(L, L->stack);                                    // 关闭所有上值
+    luaR_heapprof(L, 0);                                        // 关闭堆分析器
     luaC_freeall(L);                                            // 回收所有对象
     lua_assert(g->rootgc == obj2gco(L));                        // 只剩主线程
     lua_assert(g->strt.nuse == 0);                              // 字符串表为空
@@ -349,6 +365,9 @@ static void close_state(lua_State *L) {
     luaZ_freebuffer(L, &g->buff);                               // 释放全局缓冲区
     freestack(L, L);                                            // 释放调用栈
     lua_assert(g->totalbytes == sizeof(LG));                    // 内存计数正确
+#if defined(LUA_USE_SLAB)
+    luaM_slabclose(L);                                          // 归还内存池的块区
+#endif
     (*g->frealloc)(g->ud, fromstate(L), state_size(LG), 0);    // 释放状态对象
 }
 
@@ -442,6 +461,32 @@ void luaE_freethread(lua_State *L, lua_State *L1) {
 }
 
 
+/** @brief 把值e的字节追加到makeseed的缓冲区b的位置p */
+#define addbuff(b, p, e) \
+    { size_t t = cast(size_t, e); memcpy((b) + (p), &t, sizeof(t)); (p) += sizeof(t); }
+
+/**
+ * @brief 生成字符串哈希的随机种子
+ * @param L 正在创建的主线程
+ * @return 种子
+ *
+ * 详细说明：
+ * 把luai_makeseed()与状态机（堆）、局部变量（栈）、静态对象（数据段）
+ * 和lua_newstate（代码段）的地址一起哈希。启用了地址空间随机化时，
+ * 即使两个进程在同一秒启动，种子也不同。
+ */
+static unsigned int makeseed(lua_State *L) {
+    char buff[4 * sizeof(size_t)];
+    unsigned int h = luai_makeseed();
+    int p = 0;
+    addbuff(buff, p, L);
+    addbuff(buff, p, &h);
+    addbuff(buff, p, luaO_nilobject);
+    addbuff(buff, p, &lua_newstate);
+    lua_assert(p == sizeof(buff));
+    return luaS_hash(buff, p, h);
+}
+
 /**
  * @brief 创建新的Lua状态（主要API函数）
  * @param f 内存分配函数
@@ -480,10 +525,10 @@ void luaE_freethread(lua_State *L, lua_State *L1) {
  * @pre f必须是有效的内存分配函数
  * @post 返回完全初始化的Lua状态或NULL
  *
- * @note 这是Lua C API的入口点
+ * @note lua_newstate和lua_newslabstate的共同实现
  * @see lua_close(), luaL_newstate()
  */
-LUA_API lua_State *lua_newstate(lua_Alloc f, void *ud) {
+static lua_State *newstate(lua_Alloc f, void *ud, int useslab) {
     int i;
     lua_State *L;
     global_State *g;
@@ -508,6 +553,16 @@ LUA_API lua_State *lua_newstate(lua_Alloc f, void *ud) {
     // 初始化全局状态
     g->frealloc = f;                            // 内存分配器
     g->ud = ud;                                 // 用户数据
+#if defined(LUA_USE_SLAB)
+    // 内存池必须在第一次luaM分配之前建立
+    g->slab = NULL;
+    if (useslab && !luaM_slabopen(L)) {
+        (*f)(ud, l, state_size(LG), 0);
+        return NULL;
+    }
+#else
+    UNUSED(useslab);
+#endif
     g->mainthread = L;                          // 主线程引用
     g->uvhead.u.l.prev = &g->uvhead;           // 上值链表头
     g->uvhead.u.l.next = &g->uvhead;
@@ -515,6 +570,7 @@ LUA_API lua_State *lua_newstate(lua_Alloc f, void *ud) {
     g->strt.size = 0;                           // 字符串表大小
     g->strt.nuse = 0;                           // 字符串表使用数
     g->strt.hash = NULL;                        // 字符串表哈希数组
+    g->seed = makeseed(L);                      // 字符串哈希种子
     setnilvalue(registry(L));                   // 注册表初始化为nil
     luaZ_initbuffer(L, &g->buff);               // 初始化全局缓冲区
     g->panic = NULL;                            // 恐慌函数
@@ -531,7 +587,30 @@ LUA_API lua_State *lua_newstate(lua_Alloc f, void *ud) {
     g->totalbytes = sizeof(LG);                 // 总内存使用量
     g->gcpause = LUAI_GCPAUSE;                  // GC暂停参数
     g->gcstepmul = LUAI_GCMUL;                  // GC步进倍数
+    g->gcbudget = 0;                            // 时间预算：不使用
+    g->gcmaxstep = 0;                           // 最长步进时间
+    g->gcrate = 0;                              // 回收速度：尚未测量
+    g->gcstats = 0;                             // 步进耗时统计：关闭
+    g->heapprof = NULL;                         // 堆分析器：未开启
     g->gcdept = 0;                              // GC债务
+    g->gckind = KGC_INC;                        // 回收器模式
+    g->genminormul = LUAI_GENMINORMUL;          // 次要回收间隔
+    g->genmajor = 0;                            // 主要回收阈值
+    g->genold = NULL;                           // 老对象边界
+    g->genoldud = NULL;
+#if defined(LUA_USE_PARMARK)
+    g->parmark = NULL;                          // 标记线程池
+    g->parmarkthreads = -1;                     // 辅助线程数：首次使用时确定
+#endif
+#if defined(LUA_USE_BGFREE)
+    g->bgfree = NULL;                           // 后台释放线程
+    g->bgsweeping = 0;
+#endif
+#if defined(LUA_USE_JIT)
+    g->jiton = 1;                               // JIT开关
+    g->jithot = LUAI_JITHOT;                    // 热度阈值
+    g->jitcount = 0;                            // 已编译原型数
+#endif
 
     // 初始化元方法表
     for (i = 0; i < NUM_TAGS; i++) {
@@ -549,6 +628,22 @@ LUA_API lua_State *lua_newstate(lua_Alloc f, void *ud) {
     return L;
 }
 
+/**
+ * @brief 创建新的Lua状态（主要API函数）
+ * @see newstate()
+ */
+LUA_API lua_State *lua_newstate(lua_Alloc f, void *ud) {
+    return newstate(f, ud, 0);
+}
+
+/**
+ * @brief 创建使用分级内存池的Lua状态
+ * @see newstate(), luaM_slabopen()
+ */
+LUA_API lua_State *lua_newslabstate(lua_Alloc f, void *ud) {
+    return newstate(f, ud, 1);
+}
+
 /**
  * @brief 调用所有垃圾回收元方法的受保护函数
  * @param L Lua状态机指针
@@ -328,6 +328,14 @@ typedef struct global_State {
      */
     stringtable strt;
 
+    /**
+     * @brief 字符串哈希的随机种子
+     *
+     * lua_newstate时生成，参与所有字符串哈希值的计算。每个状态机、每次
+     * 运行的种子都不同，攻击者无法预先构造出哈希冲突的键。
+     */
+    unsigned int seed;
+
     /**
      * @brief 内存分配器：自定义内存管理函数
      * 
@@ -460,6 +468,57 @@ typedef struct global_State {
      */
     int gcstepmul;
 
+    /**
+     * @brief 时间预算：增量模式下每次步进的时间上限（微秒），0表示按
+     *        gcstepmul计算的工作量步进
+     */
+    int gcbudget;
+
+    /**
+     * @brief 最长步进时间（微秒）：上次查询以来luaC_step的最长一次耗时
+     */
+    lu_mem gcmaxstep;
+
+    /**
+     * @brief 回收速度（每毫秒的工作单位）：按时间预算步进时测得的平滑值，
+     *        用来决定多少工作之后读一次时钟
+     */
+    lu_mem gcrate;
+
+    /**
+     * @brief 是否统计没有时间预算时的步进耗时（LUA_GCMAXSTEP开启）
+     */
+    lu_byte gcstats;
+
+    /**
+     * @brief 堆分析器（lprof.c私有），未开启时为NULL
+     */
+    struct HeapProf *heapprof;
+
+    /**
+     * @brief 回收器模式：KGC_INC或KGC_GEN
+     */
+    lu_byte gckind;
+
+    /**
+     * @brief 次要回收间隔：分代模式下两次次要回收之间堆增长的百分比
+     */
+    int genminormul;
+
+    /**
+     * @brief 主要回收阈值：分代模式下估计使用量超过此值时执行完整回收
+     */
+    lu_mem genmajor;
+
+    /**
+     * @brief 老对象边界：上次分代回收清扫结束时rootgc和用户数据链表的头
+     *
+     * 新对象总是插入链表头部，所以边界之前的对象都是之后分配的年轻
+     * 对象，次要回收清扫到边界为止。
+     */
+    GCObject *genold;
+    GCObject *genoldud;
+
     /**
      * @brief 恐慌函数：无保护错误时调用的函数
      * 
@@ -501,6 +560,45 @@ typedef struct global_State {
      * 存储了所有元方法名称的字符串对象，如"__index"、"__newindex"等。
      */
     TString *tmname[TM_N];
+
+#if defined(LUA_USE_PARMARK)
+    /**
+     * @brief 并行标记：线程池（lgc.c私有，按需创建）和辅助线程数
+     *
+     * 线程数为负表示使用默认值，第一次需要时确定。
+     */
+    struct ParMark *parmark;
+    int parmarkthreads;
+#endif
+
+#if defined(LUA_USE_BGFREE)
+    /**
+     * @brief 后台释放：释放线程（lmem.c私有，开启时创建）和清扫标志
+     *
+     * bgsweeping只在清扫链表期间非0，此时luaM_realloc_把释放的内存块
+     * 交给后台线程。
+     */
+    struct BgFree *bgfree;
+    lu_byte bgsweeping;
+#endif
+
+#if defined(LUA_USE_SLAB)
+    /**
+     * @brief 分级内存池（lmem.c私有），不使用时为NULL
+     */
+    struct Slab *slab;
+#endif
+
+#if defined(LUA_USE_JIT)
+    /**
+     * @brief JIT控制：开关、热度阈值和已编译的函数原型数量
+     *
+     * 由lua_jit读写，ljit.c据此决定何时编译。
+     */
+    lu_byte jiton;
+    int jithot;
+    int jitcount;
+#endif
 } global_State;
 
 /**
@@ -743,6 +841,7 @@ union GCObject {
     struct Proto p;        /**< 函数原型对象 */
     struct UpVal uv;       /**< upvalue对象 */
     struct lua_State th;   /**< 线程对象 */
+    struct Rope rp;        /**< 延迟连接的字符串 */
 };
 
 /* GCObject到具体类型的安全转换宏 */
@@ -828,6 +927,11 @@ union GCObject {
  */
 #define gco2th(o)       check_exp((o)->gch.tt == LUA_TTHREAD, &((o)->th))
 
+/**
+ * @brief 转换为rope：将GCObject转换为Rope结构体
+ */
+#define gco2rope(o)     check_exp((o)->gch.tt == LUA_TROPE, &((o)->rp))
+
 /**
  * @brief 对象转GC对象：将任意Lua对象转换为GCObject指针
  * 
@@ -12,6 +12,8 @@
  * 2. 哈希表管理：使用哈希表快速查找和存储字符串
  * 3. 垃圾回收集成：字符串对象完全集成到GC系统中
  * 4. 动态调整：字符串表可以根据负载动态调整大小
+ * 5. 长字符串：超过LUAI_MAXSHORTLEN的字符串不内部化，不进字符串表，
+ *    哈希值在第一次用作表键时才计算
  *
  * 技术优势：
  * - 内存效率：避免重复字符串的内存浪费
@@ -20,8 +22,8 @@
  * - 缓存友好：字符串数据紧凑存储，提高缓存命中率
  *
  * 字符串哈希算法：
- * 采用改进的字符串哈希算法，对于长字符串采用采样策略，
- * 在哈希质量和计算效率之间取得平衡。
+ * 带每个状态机随机种子的按字哈希，默认读取全部内容（见luaS_hash），
+ * 构造冲突键的攻击无法预先进行。
  *
  * 应用场景：
  * - 变量名和函数名的存储
@@ -43,10 +45,12 @@
 
 #include "lua.h"
 
+#include "lgc.h"
 #include "lmem.h"
 #include "lobject.h"
 #include "lstate.h"
 #include "lstring.h"
+#include "lzio.h"
 
 /**
  * @brief 调整字符串表的大小
@@ -198,6 +202,7 @@ static TString *newlstr(lua_State *L, const char *str, size_t l,
     ts->tsv.marked = luaC_white(G(L));      // 垃圾回收标记（白色）
     ts->tsv.tt = LUA_TSTRING;               // 类型标记
     ts->tsv.reserved = 0;                   // 保留字段（非关键字）
+    ts->tsv.hashed = 1;
 
     // 复制字符串数据（字符串数据紧跟在TString结构后面）
     memcpy(ts + 1, str, l * sizeof(char));
@@ -218,6 +223,124 @@ static TString *newlstr(lua_State *L, const char *str, size_t l,
     return ts;
 }
 
+/** @brief 32位循环左移 */
+#define rotl32(x, r)    (((x) << (r)) | ((x) >> (32 - (r))))
+
+/** @brief 把一个32位的字打乱后混入h */
+#define hashword(h, k) { \
+    (k) *= 0xcc9e2d51u; (k) = rotl32(k, 15); (k) *= 0x1b873593u; \
+    (h) ^= (k); }
+
+/**
+ * @brief 计算字符串的哈希值
+ * @param str 字符串内容
+ * @param l 长度
+ * @param seed 种子，通常是G(L)->seed
+ * @return 哈希值
+ *
+ * 详细说明：
+ * 每次读取4个字节（memcpy按字载入，不要求对齐），做两次乘法和循环移位
+ * 后混入状态，剩下的不足4个字节和长度最后混入，再经过一轮雪崩
+ * （MurmurHash3的32位结构）。与逐字节的旧哈希相比，短字符串的速度
+ * 相当，长字符串快几倍。
+ *
+ * 种子是每个状态机随机生成的，旧哈希只取样约32个字节并且没有种子，
+ * 攻击者改动不参与哈希的字节就能造出任意多个冲突的键；现在默认读取
+ * 全部内容。超过LUAI_HASHLIMIT的字符串只按固定间隔读取约这么多字节。
+ * 长字符串只在第一次用作表键时计算哈希，全长哈希的代价不落在每次
+ * 创建上。
+ *
+ * 字节序不同的机器上哈希值不同，这不影响任何外部可见的行为。
+ */
+unsigned int luaS_hash(const char *str, size_t l, unsigned int seed) {
+    lu_int32 h = cast(lu_int32, seed) ^ cast(lu_int32, l);
+    lu_int32 k;
+    size_t stride = 4;
+    size_t i;
+
+    if (l > LUAI_HASHLIMIT) {
+        stride = (l / LUAI_HASHLIMIT + 1) * 4;    // 只读取约LUAI_HASHLIMIT个字节
+    }
+    for (i = 0; i + 4 <= l; i += stride) {
+        memcpy(&k, str + i, 4);
+        hashword(h, k);
+        h = rotl32(h, 13);
+        h = h * 5 + 0xe6546b64u;
+    }
+    // 末尾不足4个字节的部分
+    i = l & ~cast(size_t, 3);
+    if ((l & 3) != 0) {
+        k = cast(unsigned char, str[i]);
+        if ((l & 3) >= 2) {
+            k ^= cast(lu_int32, cast(unsigned char, str[i + 1])) << 8;
+        }
+        if ((l & 3) == 3) {
+            k ^= cast(lu_int32, cast(unsigned char, str[i + 2])) << 16;
+        }
+        hashword(h, k);
+    }
+    // 雪崩：每个输入位影响每个输出位
+    h ^= cast(lu_int32, l);
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return cast(unsigned int, h);
+}
+
+/**
+ * @brief 创建长字符串对象，内容由调用者填写
+ * @param L Lua状态机指针
+ * @param l 字符串长度，必须大于LUAI_MAXSHORTLEN
+ * @return 新字符串，只写好了结尾的'\0'
+ *
+ * 详细说明：
+ * 长字符串和其他可回收对象一样链接到rootgc，不进字符串表；哈希值
+ * 留到第一次用作表键时由luaS_hashlngstr计算。
+ */
+static TString *newlngstr(lua_State *L, size_t l) {
+    TString *ts;
+    if (l + 1 > (MAX_SIZET - sizeof(TString)) / sizeof(char)) {
+        luaM_toobig(L);
+    }
+    ts = cast(TString *, luaM_malloc(L, (l + 1) * sizeof(char) + sizeof(TString)));
+    luaC_link(L, obj2gco(ts), LUA_TSTRING);
+    ts->tsv.len = l;
+    ts->tsv.hash = G(L)->seed;    // 计算哈希值之前保存种子
+    ts->tsv.reserved = 0;
+    ts->tsv.hashed = 0;
+    ((char *)(ts + 1))[l] = '\0';
+    return ts;
+}
+
+/**
+ * @brief 比较长字符串a和字符串b的内容
+ */
+int luaS_eqlngstr(TString *a, TString *b) {
+    size_t len = a->tsv.len;
+    lua_assert(islngstr(a));
+    if (a == b) {
+        return 1;
+    }
+    if (len != b->tsv.len ||
+        (a->tsv.hashed && b->tsv.hashed && a->tsv.hash != b->tsv.hash)) {
+        return 0;
+    }
+    return memcmp(getstr(a), getstr(b), len) == 0;
+}
+
+/**
+ * @brief 计算并缓存长字符串的哈希值
+ */
+unsigned int luaS_hashlngstr(TString *ts) {
+    if (!ts->tsv.hashed) {
+        ts->tsv.hash = luaS_hash(getstr(ts), ts->tsv.len, ts->tsv.hash);
+        ts->tsv.hashed = 1;
+    }
+    return ts->tsv.hash;
+}
+
 /**
  * @brief 创建或查找指定长度的字符串（字符串内部化的主接口）
  * @param L Lua状态机指针
@@ -228,6 +351,7 @@ static TString *newlstr(lua_State *L, const char *str, size_t l,
  * 详细说明：
  * 这是Lua字符串内部化的主要接口函数，实现了字符串的查找或创建。
  * 如果相同内容的字符串已存在，直接返回现有对象；否则创建新对象。
+ * 超过LUAI_MAXSHORTLEN的长字符串例外：总是创建新对象，不进字符串表。
  *
  * 字符串内部化优势：
  * 1. 内存节省：相同内容的字符串只存储一份
@@ -235,15 +359,7 @@ static TString *newlstr(lua_State *L, const char *str, size_t l,
  * 3. 哈希高效：预计算哈希值，避免重复计算
  *
  * 哈希算法：
- * 采用改进的字符串哈希算法，具有以下特点：
- * - 初始种子：使用字符串长度作为初始哈希值
- * - 采样策略：对于长字符串，每32个字符采样一个，平衡质量和效率
- * - 位运算优化：使用位移和异或操作，计算效率高
- * - 字符分布：考虑字符在不同位置的贡献
- *
- * 哈希公式：
- * h = h ^ ((h << 5) + (h >> 2) + char)
- * 这个公式在哈希质量和计算速度之间取得了良好平衡。
+ * luaS_hash，以G(L)->seed为种子，每次读取4个字节。
  *
  * 查找过程：
  * 1. 计算字符串的哈希值
@@ -256,7 +372,7 @@ static TString *newlstr(lua_State *L, const char *str, size_t l,
  * 需要将其重新标记为"活"，因为现在又有引用了。
  *
  * 性能特征：
- * - 哈希计算：O(字符串长度/32)，对长字符串友好
+ * - 哈希计算：O(字符串长度)，短字符串不超过LUAI_MAXSHORTLEN字节
  * - 查找时间：平均O(1)，最坏O(冲突链长度)
  * - 内存使用：最优（无重复）
  *
@@ -273,15 +389,17 @@ static TString *newlstr(lua_State *L, const char *str, size_t l,
  */
 TString *luaS_newlstr(lua_State *L, const char *str, size_t l) {
     GCObject *o;
-    unsigned int h = cast(unsigned int, l);     // 使用长度作为哈希种子
-    size_t step = (l >> 5) + 1;                 // 采样步长：长字符串每32字符采样一个
-    size_t l1;
+    unsigned int h;
 
-    // 计算字符串哈希值（采样策略）
-    for (l1 = l; l1 >= step; l1 -= step) {
-        h = h ^ ((h << 5) + (h >> 2) + cast(unsigned char, str[l1 - 1]));
+    // 长字符串不内部化，也不计算哈希
+    if (l > LUAI_MAXSHORTLEN) {
+        TString *ts = newlngstr(L, l);
+        memcpy(ts + 1, str, l * sizeof(char));
+        return ts;
     }
 
+    h = luaS_hash(str, l, G(L)->seed);
+
     // 在字符串表中查找现有的字符串
     for (o = G(L)->strt.hash[lmod(h, G(L)->strt.size)];
          o != NULL;
@@ -388,3 +506,83 @@ Udata *luaS_newudata(lua_State *L, size_t s, Table *e) {
     return u;
 }
 
+/**
+ * @brief 创建rope节点
+ * @param L Lua状态机指针
+ * @param left 左半部分（字符串或rope）
+ * @param len 总长度
+ * @param rlen 右半部分的长度
+ * @return 新的rope，右半部分的字符（getrope）由调用者填写
+ *
+ * 详细说明：
+ * 调用者填写右半部分之前不能触发垃圾回收；left必须在调用者的
+ * 栈上可达，直到新rope存入寄存器。
+ *
+ * @see luaV_lazyconcat(), luaS_flatten()
+ */
+Rope *luaS_newrope(lua_State *L, GCObject *left, size_t len, size_t rlen) {
+    Rope *r;
+    if (rlen > MAX_SIZET - sizeof(Rope)) {
+        luaM_toobig(L);
+    }
+    r = cast(Rope *, luaM_malloc(L, sizeof(Rope) + rlen));
+    luaC_link(L, obj2gco(r), LUA_TROPE);
+    r->left = left;
+    r->flat = NULL;
+    r->len = len;
+    r->rlen = rlen;
+    return r;
+}
+
+/**
+ * @brief 压平rope，返回内容相同的字符串
+ * @param L Lua状态机指针
+ * @param r rope
+ * @return 压平的字符串
+ *
+ * 详细说明：
+ * 从r开始沿左半部分向下走，把各节点的右半部分从后往前复制到结果
+ * 中，遇到字符串或已经压平的rope时复制它的全部内容后停止，所以
+ * 不需要递归。结果记在r->flat中并丢掉r->left，左边的链不再被r引用，
+ * 可以被回收；再次压平直接返回r->flat。
+ *
+ * 时间复杂度：O(r->len)，每个rope只压平一次。
+ *
+ * @see luaS_newrope(), luaS_flatobj()
+ */
+TString *luaS_flatten(lua_State *L, Rope *r) {
+    if (r->flat == NULL) {
+        TString *ts = NULL;
+        char *buff;
+        size_t pos = r->len;
+        Rope *p = r;
+        // 长结果直接写进新字符串；短结果先拼在缓冲区里再内部化
+        if (r->len > LUAI_MAXSHORTLEN) {
+            ts = newlngstr(L, r->len);
+            buff = cast(char *, ts + 1);
+        } else {
+            buff = luaZ_openspace(L, &G(L)->buff, r->len);
+        }
+        for (;;) {
+            GCObject *l;
+            if (p->flat != NULL) {
+                lua_assert(p->flat->tsv.len == pos);
+                memcpy(buff, getstr(p->flat), pos);
+                break;
+            }
+            pos -= p->rlen;
+            memcpy(buff + pos, getrope(p), p->rlen);
+            l = p->left;
+            if (l->gch.tt != LUA_TROPE) {
+                lua_assert(gco2ts(l)->len == pos);
+                memcpy(buff, getstr(rawgco2ts(l)), pos);
+                break;
+            }
+            p = gco2rope(l);
+        }
+        r->flat = (ts != NULL) ? ts : luaS_newlstr(L, buff, r->len);
+        r->left = NULL;
+        luaC_objbarrier(L, r, r->flat);
+    }
+    return r->flat;
+}
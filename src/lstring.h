@@ -167,6 +167,52 @@
  */
 #define sizeudata(u)     (sizeof(union Udata) + (u)->len)
 
+/**
+ * @brief 计算rope对象大小：Rope结构加上右半部分的字符
+ *
+ * @see luaS_newrope()
+ */
+#define sizerope(r)      (sizeof(Rope) + (r)->rlen)
+
+/**
+ * @brief 判断字符串是否为长字符串
+ *
+ * 详细说明：
+ * 长度超过LUAI_MAXSHORTLEN的字符串不内部化，内容相同的长字符串
+ * 可能是不同的对象。
+ */
+#define islngstr(ts)     ((ts)->tsv.len > LUAI_MAXSHORTLEN)
+
+/**
+ * @brief 字符串相等比较
+ *
+ * 详细说明：
+ * 短字符串是内部化的，指针相同才相等；长字符串指针不同时还要
+ * 比较长度和内容。
+ *
+ * @see luaS_eqlngstr()
+ */
+#define luaS_eqstr(a, b) ((a) == (b) || (islngstr(a) && luaS_eqlngstr(a, b)))
+
+/**
+ * @brief 取字符串的哈希值，长字符串第一次取时才计算
+ *
+ * @see luaS_hashlngstr()
+ */
+#define luaS_hashstr(ts)     ((ts)->tsv.hashed ? (ts)->tsv.hash : luaS_hashlngstr(ts))
+
+/**
+ * @brief 把o处的rope换成压平的字符串
+ *
+ * 详细说明：
+ * o必须是可以改写的位置（栈上的值）。rope离开Lua寄存器之前
+ * （存入表、传给C函数、返回给C）用它压平；o不是rope时什么都不做。
+ *
+ * @see luaS_flatten()
+ */
+#define luaS_flatobj(L, o) \
+    { if (ttisrope(o)) setsvalue(L, (o), luaS_flatten(L, ropevalue(o))); }
+
 /**
  * @brief 创建新字符串：从C字符串创建Lua字符串对象的便利宏
  * 
@@ -434,7 +480,8 @@ LUAI_FUNC Udata *luaS_newudata(lua_State *L, size_t s, Table *e);
  * - 必要时触发哈希表调整
  * 
  * 性能优化：
- * - 短字符串和长字符串使用不同策略
+ * - 短字符串和长字符串使用不同策略：超过LUAI_MAXSHORTLEN的字符串
+ *   不进字符串表，每次调用都创建新对象
  * - 缓存常用字符串的哈希值
  * - 优化内存分配和复制操作
  * 
@@ -460,4 +507,69 @@ LUAI_FUNC Udata *luaS_newudata(lua_State *L, size_t s, Table *e);
  */
 LUAI_FUNC TString *luaS_newlstr(lua_State *L, const char *str, size_t l);
 
+/**
+ * @brief 计算字符串的哈希值
+ *
+ * 详细说明：
+ * 带种子的按字哈希，默认读取全部内容。字符串表和表键使用
+ * G(L)->seed作种子。
+ *
+ * @see LUAI_HASHLIMIT
+ */
+LUAI_FUNC unsigned int luaS_hash(const char *str, size_t l, unsigned int seed);
+
+/**
+ * @brief 比较长字符串a和字符串b的内容
+ *
+ * 详细说明：
+ * 两边的哈希值都已经计算过并且不同时不必比较内容。
+ *
+ * @see luaS_eqstr
+ */
+LUAI_FUNC int luaS_eqlngstr(TString *a, TString *b);
+
+/**
+ * @brief 计算并缓存长字符串的哈希值
+ *
+ * 详细说明：
+ * 只写字符串自己的hash和hashed字段。并行标记的辅助线程只查找短的
+ * 元方法名，不会走到这里。
+ *
+ * @see luaS_hashstr
+ */
+LUAI_FUNC unsigned int luaS_hashlngstr(TString *ts);
+
+/**
+ * @brief 创建rope节点：记录"left + 右半部分"而不复制left
+ *
+ * 详细说明：
+ * 右半部分的rlen个字符紧跟在结构体之后，由调用者填写。只有
+ * OP_CONCAT（luaV_lazyconcat）创建rope。
+ *
+ * @param L lua_State指针
+ * @param left 左半部分：字符串或rope
+ * @param len 总长度
+ * @param rlen 右半部分的长度
+ * @return 新的rope对象
+ *
+ * @see luaS_flatten(), LUAI_ROPEMIN
+ */
+LUAI_FUNC Rope *luaS_newrope(lua_State *L, GCObject *left, size_t len,
+                             size_t rlen);
+
+/**
+ * @brief 压平rope：返回内容相同的字符串
+ *
+ * 详细说明：
+ * 第一次调用时把整条链复制成一个字符串并缓存在rope中，之后直接
+ * 返回缓存的结果。
+ *
+ * @param L lua_State指针
+ * @param r rope对象
+ * @return 压平的字符串
+ *
+ * @see luaS_newrope(), luaS_flatobj
+ */
+LUAI_FUNC TString *luaS_flatten(lua_State *L, Rope *r);
+
 #endif
@@ -69,6 +69,8 @@
  */
 
 #include <ctype.h>
+#include <limits.h>
+#include <locale.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -82,6 +84,10 @@
 #include "lauxlib.h"
 #include "lualib.h"
 
+#if defined(LUA_USE_SIMDSTR)
+#include <immintrin.h>
+#endif
+
 /**
  * @brief 字符无符号转换宏：将有符号字符安全转换为无符号字符
  * 
@@ -315,28 +321,109 @@ static int str_sub(lua_State *L) {
 }
 
 
+/**
+ * @brief 为已知长度的结果预留空间
+ *
+ * 详细说明：
+ * reverse、lower、upper、rep和char的结果长度事先就知道，直接写进一块
+ * 连续的内存，最后只生成一次结果字符串。定义了LUA_USE_GROWBUFFER时
+ * 用luaL_buffinitsize预留；否则不超过LUAL_BUFFERSIZE时使用B自带的
+ * buffer，更长时分配一个用户数据（留在栈上，出错时由回收器释放）。
+ *
+ * @param[in] L Lua状态
+ * @param[out] B 调用者栈上的缓冲区
+ * @param[in] sz 需要的字节数
+ * @return 至少sz字节的可写内存
+ * @see pushresbuff()
+ */
+static char *resbuffinit(lua_State *L, luaL_Buffer *B, size_t sz) {
+#if defined(LUA_USE_GROWBUFFER)
+    return luaL_buffinitsize(L, B, sz);
+#else
+    luaL_buffinit(L, B);
+    return (sz <= LUAL_BUFFERSIZE) ? B->buffer : (char *)lua_newuserdata(L, sz);
+#endif
+}
+
+
+/**
+ * @brief 用resbuffinit预留的空间生成结果字符串
+ *
+ * @param[in,out] B resbuffinit初始化的缓冲区
+ * @param[in] d resbuffinit返回的内存
+ * @param[in] sz 写入的字节数
+ */
+static void pushresbuff(luaL_Buffer *B, const char *d, size_t sz) {
+#if defined(LUA_USE_GROWBUFFER)
+    (void)d;
+    luaL_addsize(B, sz);
+    luaL_pushresult(B);
+#else
+    lua_pushlstring(B->L, d, sz);
+#endif
+}
+
+
+/**
+ * @brief 大小写转换的批量核心
+ *
+ * 详细说明：
+ * C locale下tolower/toupper只改变ASCII字母，可以不调用C库：大小写
+ * 字母只差0x20这一位，范围判断和翻转都能一次处理多个字节（定义了
+ * LUA_USE_SIMDSTR时每次16个字节）。其他locale逐字节调用C库函数。
+ *
+ * @param[out] d 目标，l字节
+ * @param[in] s 源字符串
+ * @param[in] l 长度
+ * @param[in] upper 非0转大写，0转小写
+ */
+static void casemap(char *d, const char *s, size_t l, int upper) {
+    const char *loc = setlocale(LC_CTYPE, NULL);
+    size_t i = 0;
+    if (loc != NULL && (strcmp(loc, "C") == 0 || strcmp(loc, "POSIX") == 0)) {
+        unsigned int first = upper ? 'a' : 'A';     // 要转换的26个字母的第一个
+#if defined(LUA_USE_SIMDSTR)
+        // 加上128-first后，要转换的字母恰好是最小的26个有符号字节
+        const __m128i shift = _mm_set1_epi8((char)(128 - first));
+        const __m128i limit = _mm_set1_epi8((char)(-128 + 26));
+        const __m128i flip = _mm_set1_epi8(0x20);
+        for (; i + 16 <= l; i += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i *)(s + i));
+            __m128i m = _mm_cmplt_epi8(_mm_add_epi8(x, shift), limit);
+            _mm_storeu_si128((__m128i *)(d + i),
+                             _mm_xor_si128(x, _mm_and_si128(m, flip)));
+        }
+#endif
+        for (; i < l; i++) {
+            unsigned int c = uchar(s[i]);
+            d[i] = (char)((c - first < 26) ? (c ^ 0x20) : c);
+        }
+    }
+    else if (upper) {
+        for (; i < l; i++) d[i] = (char)toupper(uchar(s[i]));
+    }
+    else {
+        for (; i < l; i++) d[i] = (char)tolower(uchar(s[i]));
+    }
+}
+
+
 /**
  * @brief 字符串反转：将字符串中的字符顺序完全颠倒
  * 
  * 详细说明：
- * 这个函数实现了Lua的string.reverse函数，通过逐个字符读取并反向添加到缓冲区
- * 的方式实现字符串反转。使用Lua的缓冲区系统（luaL_Buffer）来高效地构建结果
- * 字符串，避免频繁的内存分配操作。
+ * 这个函数实现了Lua的string.reverse函数，通过逐个字符读取并反向写入等长
+ * 预留空间的方式实现字符串反转，最后一次生成结果字符串。
  * 
  * 算法描述：
- * 1. 初始化Lua缓冲区系统
- * 2. 从字符串末尾开始，逐个字符向前遍历
- * 3. 将每个字符添加到缓冲区中
- * 4. 将构建完成的缓冲区内容作为结果返回
+ * 1. 用resbuffinit预留与原字符串等长的空间
+ * 2. 从字符串末尾开始，逐个字符向前遍历并写入预留空间
+ * 3. 用预留空间的内容生成结果字符串
  * 
  * 算法复杂度：
  * - 时间复杂度：O(n)，其中n为字符串长度，需要遍历每个字符
  * - 空间复杂度：O(n)，需要为反转后的字符串分配新的内存空间
  * 
- * 缓冲区优化：
- * 使用luaL_Buffer系统可以避免字符串拼接时的重复内存分配，显著提升性能。
- * 缓冲区会根据需要自动扩展，确保操作的高效性。
- * 
  * 使用示例：
  * @code
  * // Lua代码示例
@@ -358,7 +445,7 @@ static int str_sub(lua_State *L) {
  * 性能特征：
  * - 对于短字符串：性能优越，开销主要在函数调用
  * - 对于长字符串：线性时间复杂度，内存使用效率高
- * - 缓冲区机制减少了内存分配次数，提升整体性能
+ * - 结果长度已知，直接写入一块连续内存，不逐字节检查缓冲区边界
  * 
  * @param[in] L Lua虚拟机状态指针，包含函数调用的上下文信息
  *              栈位置1：要反转的字符串
@@ -371,24 +458,22 @@ static int str_sub(lua_State *L) {
  * 
  * @note 按字节进行反转，多字节字符编码需要特别注意
  * @note 空字符串反转后仍为空字符串
- * @note 使用缓冲区系统优化内存分配性能
  * 
  * @since Lua 5.0
- * @see luaL_Buffer, luaL_addchar(), luaL_pushresult()
+ * @see resbuffinit()
  */
 static int str_reverse(lua_State *L) {
-    size_t l;
+    size_t l, i;
     luaL_Buffer b;
     const char *s = luaL_checklstring(L, 1, &l);    // 获取字符串及其长度
+    char *d = resbuffinit(L, &b, l);                // 预留结果的空间
     
-    luaL_buffinit(L, &b);                           // 初始化字符串构建缓冲区
-    
-    // 从字符串末尾开始，逐个字符向前遍历并添加到缓冲区
-    while (l--) {
-        luaL_addchar(&b, s[l]);                     // 添加当前字符到缓冲区
+    // 从字符串末尾开始，逐个字符向前遍历并写入预留空间
+    for (i = 0; i < l; i++) {
+        d[i] = s[l - 1 - i];
     }
     
-    luaL_pushresult(&b);                            // 将缓冲区内容作为字符串推入栈
+    pushresbuff(&b, d, l);                          // 生成结果字符串
     return 1;
 }
 
@@ -399,14 +484,13 @@ static int str_reverse(lua_State *L) {
  * 详细说明：
  * 这个函数实现了Lua的string.lower函数，逐个检查字符串中的每个字符，
  * 使用标准C库的tolower函数将大写字母转换为小写字母，其他字符保持不变。
- * 使用缓冲区系统来高效地构建转换后的字符串。
+ * 结果直接写入用resbuffinit预留的等长空间。
  * 
  * 算法描述：
- * 1. 获取输入字符串并初始化缓冲区
- * 2. 遍历字符串中的每个字符
- * 3. 对每个字符应用tolower转换（通过uchar宏确保安全）
- * 4. 将转换后的字符添加到缓冲区
- * 5. 返回构建完成的结果字符串
+ * 1. 获取输入字符串并取得等长的预留空间
+ * 2. 用casemap转换全部字符：C locale下成批处理ASCII字母，
+ *    其他locale对每个字符应用tolower（通过uchar宏确保安全）
+ * 3. 用预留空间的内容生成结果字符串
  * 
  * 算法复杂度：
  * - 时间复杂度：O(n)，其中n为字符串长度
@@ -436,7 +520,7 @@ static int str_reverse(lua_State *L) {
  * 
  * 性能特征：
  * - 单次遍历，性能高效
- * - 缓冲区机制减少内存分配开销
+ * - C locale下按16字节一组转换（LUA_USE_SIMDSTR），不调用C库
  * - 对于ASCII字符处理速度最快
  * 
  * 注意事项：
@@ -462,19 +546,13 @@ static int str_reverse(lua_State *L) {
  */
 static int str_lower(lua_State *L) {
     size_t l;
-    size_t i;
     luaL_Buffer b;
     const char *s = luaL_checklstring(L, 1, &l);    // 获取字符串及其长度
+    char *d = resbuffinit(L, &b, l);                // 预留结果的空间
     
-    luaL_buffinit(L, &b);                           // 初始化字符串构建缓冲区
-    
-    // 遍历字符串中的每个字符并转换为小写
-    for (i = 0; i < l; i++) {
-        // 使用uchar宏确保字符为无符号，然后应用tolower转换
-        luaL_addchar(&b, tolower(uchar(s[i])));
-    }
+    casemap(d, s, l, 0);                            // 转换为小写
     
-    luaL_pushresult(&b);                            // 将缓冲区内容作为字符串推入栈
+    pushresbuff(&b, d, l);                          // 生成结果字符串
     return 1;
 }
 
@@ -484,14 +562,13 @@ static int str_lower(lua_State *L) {
  * 详细说明：
  * 这个函数实现了Lua的string.upper函数，与str_lower函数对应，用于将字符串
  * 中的小写字母转换为大写字母。实现机制完全相同，只是使用toupper函数替代
- * tolower函数。同样使用缓冲区系统来优化性能。
+ * tolower函数。结果同样直接写入等长的预留空间。
  * 
  * 算法描述：
- * 1. 获取输入字符串并初始化缓冲区
- * 2. 遍历字符串中的每个字符
- * 3. 对每个字符应用toupper转换（通过uchar宏确保安全）
- * 4. 将转换后的字符添加到缓冲区
- * 5. 返回构建完成的结果字符串
+ * 1. 获取输入字符串并取得等长的预留空间
+ * 2. 用casemap转换全部字符：C locale下成批处理ASCII字母，
+ *    其他locale对每个字符应用toupper（通过uchar宏确保安全）
+ * 3. 用预留空间的内容生成结果字符串
  * 
  * 算法复杂度：
  * - 时间复杂度：O(n)，其中n为字符串长度
@@ -529,19 +606,13 @@ static int str_lower(lua_State *L) {
  */
 static int str_upper(lua_State *L) {
     size_t l;
-    size_t i;
     luaL_Buffer b;
     const char *s = luaL_checklstring(L, 1, &l);    // 获取字符串及其长度
+    char *d = resbuffinit(L, &b, l);                // 预留结果的空间
     
-    luaL_buffinit(L, &b);                           // 初始化字符串构建缓冲区
-    
-    // 遍历字符串中的每个字符并转换为大写
-    for (i = 0; i < l; i++) {
-        // 使用uchar宏确保字符为无符号，然后应用toupper转换
-        luaL_addchar(&b, toupper(uchar(s[i])));
-    }
+    casemap(d, s, l, 1);                            // 转换为大写
     
-    luaL_pushresult(&b);                            // 将缓冲区内容作为字符串推入栈
+    pushresbuff(&b, d, l);                          // 生成结果字符串
     return 1;
 }
 
@@ -550,27 +621,28 @@ static int str_upper(lua_State *L) {
  * 
  * 详细说明：
  * 这个函数实现了Lua的string.rep函数，用于创建由原字符串重复多次组成的新字符串。
- * 它通过循环将原字符串多次添加到缓冲区中来实现，是一个非常实用的字符串生成工具。
+ * 结果长度n*m事先已知，直接写入预留的空间，是一个非常实用的字符串生成工具。
  * 常用于创建分隔符、填充字符或生成重复模式的文本。
  * 
  * 算法描述：
- * 1. 获取源字符串和重复次数
- * 2. 初始化字符串构建缓冲区
- * 3. 循环指定次数，每次将完整的源字符串添加到缓冲区
- * 4. 返回构建完成的结果字符串
+ * 1. 获取源字符串和重复次数，检查结果长度不溢出
+ * 2. 用resbuffinit预留整个结果的空间，复制一份源字符串
+ * 3. 把已写好的部分整体复制到其后，每次复制使已写长度加倍，
+ *    共约log2(n)次memcpy
+ * 4. 用预留空间的内容生成结果字符串
  * 
  * 算法复杂度：
- * - 时间复杂度：O(n*m)，其中n为重复次数，m为源字符串长度
+ * - 时间复杂度：O(n*m)的字节复制，其中n为重复次数，m为源字符串长度
  * - 空间复杂度：O(n*m)，结果字符串的大小
  * 
  * 边界处理：
  * - 重复次数为0：返回空字符串
- * - 重复次数为负数：由于循环条件，实际上也会返回空字符串
+ * - 重复次数为负数：返回空字符串
  * - 空字符串重复：返回空字符串
+ * - 结果长度超出size_t：抛出"resulting string too large"错误
  * 
  * 内存考虑：
- * 对于大字符串或大重复次数，可能消耗大量内存。缓冲区系统会自动管理内存分配，
- * 但仍需注意潜在的内存不足问题。
+ * 对于大字符串或大重复次数，可能消耗大量内存，预留空间和结果各占一份。
  * 
  * 使用示例：
  * @code
@@ -589,7 +661,7 @@ static int str_upper(lua_State *L) {
  * 性能特征：
  * - 对于小字符串和少量重复：性能优越
  * - 对于大量重复：内存使用呈线性增长
- * - 缓冲区机制优化了字符串拼接性能
+ * - 按倍增方式成块复制，不逐次检查缓冲区边界
  * 
  * 实际应用：
  * - 生成表格分隔线
@@ -609,25 +681,34 @@ static int str_upper(lua_State *L) {
  * 
  * @note 重复次数为0或负数时返回空字符串
  * @note 大量重复时需要注意内存使用量
- * @note 使用缓冲区系统优化性能
  * 
  * @since Lua 5.0
- * @see luaL_addlstring(), luaL_Buffer
+ * @see resbuffinit()
  */
 static int str_rep(lua_State *L) {
-    size_t l;
+    size_t l, total, done;
     luaL_Buffer b;
+    char *d;
     const char *s = luaL_checklstring(L, 1, &l);    // 获取源字符串和长度
     int n = luaL_checkint(L, 2);                    // 获取重复次数
     
-    luaL_buffinit(L, &b);                           // 初始化字符串构建缓冲区
+    if (n <= 0 || l == 0) {
+        lua_pushliteral(L, "");
+        return 1;
+    }
+    if (l > (~(size_t)0) / (size_t)n) {
+        return luaL_error(L, "resulting string too large");
+    }
+    total = l * (size_t)n;
+    d = resbuffinit(L, &b, total);
     
-    // 循环指定次数，每次添加完整的源字符串
-    while (n-- > 0) {
-        luaL_addlstring(&b, s, l);                  // 将源字符串添加到缓冲区
+    // 先复制一份，然后每次把已写好的部分复制到其后
+    memcpy(d, s, l);
+    for (done = l; done < total; done *= 2) {
+        memcpy(d + done, d, (total - done < done) ? total - done : done);
     }
     
-    luaL_pushresult(&b);                            // 将缓冲区内容作为字符串推入栈
+    pushresbuff(&b, d, total);                      // 生成结果字符串
     return 1;
 }
 
@@ -766,10 +847,9 @@ static int str_byte(lua_State *L) {
  * 
  * 算法描述：
  * 1. 获取参数数量（即要转换的字节值数量）
- * 2. 初始化字符串构建缓冲区
- * 3. 循环处理每个参数：验证范围并转换为字符
- * 4. 将所有字符组合成最终的字符串
- * 5. 返回构建完成的字符串
+ * 2. 用resbuffinit为每个参数预留一个字节
+ * 3. 循环处理每个参数：验证范围并写入对应的字节
+ * 4. 用预留空间的内容生成结果字符串
  * 
  * 算法复杂度：
  * - 时间复杂度：O(n)，其中n为参数数量
@@ -804,12 +884,12 @@ static int str_byte(lua_State *L) {
  * 错误处理：
  * - 无参数：返回空字符串
  * - 无效字节值：抛出参数错误
- * - 内存不足：由缓冲区系统处理
+ * - 内存不足：由lua_newuserdata或lua_pushlstring抛出内存错误
  * 
  * 性能特征：
  * - 少量字符：性能优越
  * - 大量字符：线性时间复杂度
- * - 缓冲区机制优化内存分配
+ * - 直接写入预留空间，不逐字节检查缓冲区边界
  * 
  * 实际应用：
  * - 二进制协议构建
@@ -841,8 +921,7 @@ static int str_char(lua_State *L) {
     int n = lua_gettop(L);                          // 获取参数数量
     int i;
     luaL_Buffer b;
-    
-    luaL_buffinit(L, &b);                           // 初始化字符串构建缓冲区
+    char *d = resbuffinit(L, &b, (size_t)n);        // 预留结果的空间
     
     // 循环处理每个参数
     for (i = 1; i <= n; i++) {
@@ -851,11 +930,11 @@ static int str_char(lua_State *L) {
         // 验证字节值在有效范围内（0-255）
         luaL_argcheck(L, uchar(c) == c, i, "invalid value");
         
-        // 将字节值作为字符添加到缓冲区
-        luaL_addchar(&b, uchar(c));
+        // 将字节值作为字符写入预留空间
+        d[i - 1] = (char)uchar(c);
     }
     
-    luaL_pushresult(&b);                            // 将缓冲区内容作为字符串推入栈
+    pushresbuff(&b, d, (size_t)n);                  // 生成结果字符串
     return 1;
 }
 
@@ -1052,6 +1131,7 @@ typedef struct MatchState {
         const char *init;                           /**< 捕获组的起始位置指针 */
         ptrdiff_t len;                              /**< 捕获组的长度，或特殊状态标记 */
     } capture[LUA_MAXCAPTURES];                     /**< 捕获组数组，固定大小避免动态分配 */
+    const unsigned char (*sets)[32];                /**< 已编译模式的字符类位图（只用于pmatch） */
 } MatchState;
 
 /**
@@ -1602,11 +1682,524 @@ static const char *match (MatchState *ms, const char *s, const char *p) {
 }
 
 
+/*
+** {======================================================
+** 编译的模式
+** 模式编译成PatItem数组，字符类（%a、[...]、%f[...]）预先算成256位的
+** 位图。pmatch与match逐项对应（回溯顺序、递归深度和运行时错误都相同），
+** 只是不再每次重新解析模式。编译结果按最近最少使用的顺序缓存在每个
+** 状态的PatCache中（find、match、gmatch和gsub的上值）。
+** =======================================================
+*/
+
+/* 模式项的类型 */
+enum {
+  PI_CHAR,      /* 单个字符c */
+  PI_ANY,       /* 任意字符（'.'，或包含全部字符的字符类） */
+  PI_SET,       /* 字符类，位图为sets[set] */
+  PI_OPEN,      /* '(' */
+  PI_POSITION,  /* '()' */
+  PI_CLOSE,     /* ')' */
+  PI_BALANCE,   /* %bxy，c和c2为x和y */
+  PI_FRONTIER,  /* %f[...]，位图为sets[set] */
+  PI_BACKREF,   /* %0-%9，c为数字字符 */
+  PI_DOLLAR,    /* 模式末尾的'$' */
+  PI_END        /* 模式结束 */
+};
+
+
+typedef struct PatItem {
+  unsigned char op;  /* PI_* */
+  unsigned char q;   /* 单字符项的量词：'?'、'*'、'+'、'-'，没有时为0 */
+  unsigned char c, c2;
+  int set;
+} PatItem;
+
+
+typedef unsigned char PatSet[32];
+
+#define setbit(s,c)	((s)[(c) >> 3] |= (unsigned char)(1 << ((c) & 7)))
+#define testbit(s,c)	((s)[(c) >> 3] & (1 << ((c) & 7)))
+
+
+/* 一个编译好的模式，与它的模式项、位图和模式文本放在同一个用户数据中 */
+typedef struct PatProg {
+  size_t plen;       /* 模式长度 */
+  int mode;          /* 1：开头的'^'是锚点（find、match、gsub）；0：gmatch */
+  int anchor;        /* mode为1且模式以'^'开头 */
+  int slot;          /* 在缓存中的槽位 */
+  PatItem *items;    /* NULL表示模式不能编译，由match解释执行 */
+  PatSet *sets;
+  char *pat;         /* 模式文本的副本 */
+  char *pre;         /* 字面前缀：开头没有量词的PI_CHAR项的字符 */
+  size_t npre;
+} PatProg;
+
+
+/* 已编译模式的缓存；PatProg用户数据保存在它的环境表中 */
+typedef struct PatCache {
+  unsigned long tick;               /* 每次查找加1 */
+  int n;                            /* 已用的槽位数 */
+  int last;                         /* 最近命中的槽位 */
+  char locale[64];                  /* 编译时的LC_CTYPE */
+  PatProg *prog[LUA_PATCACHE];
+  unsigned long used[LUA_PATCACHE]; /* 最后一次命中时的tick */
+} PatCache;
+
+
+/* 同classend，但模式不完整时返回NULL而不报错 */
+static const char *pclassend (const char *p) {
+  switch (*p++) {
+    case L_ESC:
+      return (*p == '\0') ? NULL : p+1;
+    case '[': {
+      if (*p == '^') p++;
+      do {
+        if (*p == '\0') return NULL;
+        if (*(p++) == L_ESC && *p != '\0') p++;
+      } while (*p != ']');
+      return p+1;
+    }
+    default:
+      return p;
+  }
+}
+
+
+/* 用singlematch算出字符类p（ep指向其后）的位图，返回其中的字符个数 */
+static int makeset (PatSet set, const char *p, const char *ep, int *last) {
+  int c, n = 0;
+  memset(set, 0, sizeof(PatSet));
+  for (c = 0; c <= UCHAR_MAX; c++) {
+    if (singlematch(c, p, ep)) {
+      setbit(set, c);
+      *last = c;
+      n++;
+    }
+  }
+  return n;
+}
+
+
+/*
+** 把模式p翻译成模式项，以PI_END结尾。prog为NULL时只计数（字符类个数
+** 是上界）。遇到执行到时才会报错的结构（不完整的'%'、缺少']'、%b或%f
+** 的参数不对）时返回0：这样的模式仍由match解释执行，错误在原来的时机
+** 报告；捕获相关的错误与状态有关，由pmatch在执行时报告。
+*/
+static int compile (const char *p, PatProg *prog, int *nitems, int *nsets) {
+  int ni = 0, ns = 0;
+  for (;;) {
+    PatItem it;
+    const char *ep;
+    it.q = it.c = it.c2 = 0;
+    it.set = 0;
+    switch (*p) {
+      case '(': {
+        if (*(p+1) == ')') { it.op = PI_POSITION; p += 2; }
+        else { it.op = PI_OPEN; p++; }
+        break;
+      }
+      case ')': {
+        it.op = PI_CLOSE; p++;
+        break;
+      }
+      case '\0': {
+        it.op = PI_END;
+        break;
+      }
+      case '$': {
+        if (*(p+1) == '\0') { it.op = PI_DOLLAR; p++; break; }
+        goto dflt;
+      }
+      case L_ESC: {
+        if (*(p+1) == 'b') {
+          if (*(p+2) == '\0' || *(p+3) == '\0') return 0;
+          it.op = PI_BALANCE;
+          it.c = uchar(*(p+2));
+          it.c2 = uchar(*(p+3));
+          p += 4;
+          break;
+        }
+        else if (*(p+1) == 'f') {
+          int last;
+          p += 2;
+          if (*p != '[' || (ep = pclassend(p)) == NULL) return 0;
+          it.op = PI_FRONTIER;
+          it.set = ns++;
+          if (prog) makeset(prog->sets[it.set], p, ep, &last);
+          p = ep;
+          break;
+        }
+        else if (isdigit(uchar(*(p+1)))) {
+          it.op = PI_BACKREF;
+          it.c = uchar(*(p+1));
+          p += 2;
+          break;
+        }
+        goto dflt;
+      }
+      default: dflt: {
+        if ((ep = pclassend(p)) == NULL) return 0;
+        if (*p == '.')
+          it.op = PI_ANY;
+        else if (*p == L_ESC || *p == '[') {
+          int last = 0;
+          int n = (prog) ? makeset(prog->sets[ns], p, ep, &last) : 0;
+          if (n == 1) { it.op = PI_CHAR; it.c = uchar(last); }
+          else if (n == UCHAR_MAX + 1) it.op = PI_ANY;
+          else { it.op = PI_SET; it.set = ns++; }
+        }
+        else {
+          it.op = PI_CHAR;
+          it.c = uchar(*p);
+        }
+        if (*ep == '?' || *ep == '*' || *ep == '+' || *ep == '-') {
+          it.q = uchar(*ep);
+          p = ep+1;
+        }
+        else p = ep;
+        break;
+      }
+    }
+    if (prog) prog->items[ni] = it;
+    ni++;
+    if (it.op == PI_END) break;
+  }
+  *nitems = ni;
+  *nsets = ns;
+  return 1;
+}
+
+
+static const char *pmatch (MatchState *ms, const char *s, const PatItem *pi);
+static const char *lmemfind (const char *s1, size_t l1,
+                               const char *s2, size_t l2);
+
+
+static int psingle (const MatchState *ms, const PatItem *pi, int c) {
+  switch (pi->op) {
+    case PI_CHAR: return (pi->c == c);
+    case PI_ANY: return 1;
+    default: return testbit(ms->sets[pi->set], c);
+  }
+}
+
+
+static const char *pmax_expand (MatchState *ms, const char *s,
+                                  const PatItem *pi) {
+  ptrdiff_t i = 0;
+  if (pi->op == PI_ANY)
+    i = ms->src_end - s;
+  else {
+    while ((s+i)<ms->src_end && psingle(ms, pi, uchar(*(s+i))))
+      i++;
+  }
+  while (i>=0) {
+    const char *res = pmatch(ms, (s+i), pi+1);
+    if (res) return res;
+    i--;
+  }
+  return NULL;
+}
+
+
+static const char *pmin_expand (MatchState *ms, const char *s,
+                                  const PatItem *pi) {
+  for (;;) {
+    const char *res = pmatch(ms, s, pi+1);
+    if (res != NULL)
+      return res;
+    else if (s<ms->src_end && psingle(ms, pi, uchar(*s)))
+      s++;
+    else return NULL;
+  }
+}
+
+
+static const char *pstart_capture (MatchState *ms, const char *s,
+                                     const PatItem *pi, int what) {
+  const char *res;
+  int level = ms->level;
+  if (level >= LUA_MAXCAPTURES) luaL_error(ms->L, "too many captures");
+  ms->capture[level].init = s;
+  ms->capture[level].len = what;
+  ms->level = level+1;
+  if ((res=pmatch(ms, s, pi)) == NULL)
+    ms->level--;
+  return res;
+}
+
+
+static const char *pend_capture (MatchState *ms, const char *s,
+                                   const PatItem *pi) {
+  int l = capture_to_close(ms);
+  const char *res;
+  ms->capture[l].len = s - ms->capture[l].init;
+  if ((res = pmatch(ms, s, pi)) == NULL)
+    ms->capture[l].len = CAP_UNFINISHED;
+  return res;
+}
+
+
+static const char *pmatch (MatchState *ms, const char *s, const PatItem *pi) {
+  init:
+  switch (pi->op) {
+    case PI_OPEN:
+      return pstart_capture(ms, s, pi+1, CAP_UNFINISHED);
+    case PI_POSITION:
+      return pstart_capture(ms, s, pi+1, CAP_POSITION);
+    case PI_CLOSE:
+      return pend_capture(ms, s, pi+1);
+    case PI_BALANCE: {
+      int cont = 1;
+      if (uchar(*s) != pi->c) return NULL;
+      while (++s < ms->src_end) {
+        if (uchar(*s) == pi->c2) {
+          if (--cont == 0) break;
+        }
+        else if (uchar(*s) == pi->c) cont++;
+      }
+      if (s >= ms->src_end) return NULL;  /* string ends out of balance */
+      s++; pi++; goto init;
+    }
+    case PI_FRONTIER: {
+      int previous = (s == ms->src_init) ? '\0' : uchar(*(s-1));
+      if (testbit(ms->sets[pi->set], previous) ||
+          !testbit(ms->sets[pi->set], uchar(*s))) return NULL;
+      pi++; goto init;
+    }
+    case PI_BACKREF: {
+      s = match_capture(ms, s, pi->c);
+      if (s == NULL) return NULL;
+      pi++; goto init;
+    }
+    case PI_END:
+      return s;
+    case PI_DOLLAR:
+      return (s == ms->src_end) ? s : NULL;
+    default: {
+      int m = s<ms->src_end && psingle(ms, pi, uchar(*s));
+      switch (pi->q) {
+        case '?': {
+          const char *res;
+          if (m && ((res=pmatch(ms, s+1, pi+1)) != NULL))
+            return res;
+          pi++; goto init;
+        }
+        case '*':
+          return pmax_expand(ms, s, pi);
+        case '+':
+          return (m ? pmax_expand(ms, s+1, pi) : NULL);
+        case '-':
+          return pmin_expand(ms, s, pi);
+        default: {
+          if (!m) return NULL;
+          s++; pi++; goto init;
+        }
+      }
+    }
+  }
+}
+
+
+/*
+** 第一项是必须出现的字符或字符类时，匹配只能从能匹配它的字符开始：
+** 返回s及其后第一个这样的位置，没有时返回NULL。模式以多个字面字符
+** 开头时查找整个前缀。
+*/
+static const char *pskip (const MatchState *ms, const PatProg *prog,
+                            const char *s) {
+  const PatItem *pi = prog->items;
+  if (prog->npre > 1)
+    return lmemfind(s, ms->src_end - s, prog->pre, prog->npre);
+  if (pi->q != 0 && pi->q != '+') return s;
+  if (pi->op == PI_CHAR)
+    return (const char *)memchr(s, pi->c, ms->src_end - s);
+  else if (pi->op == PI_SET) {
+    for (; s < ms->src_end; s++)
+      if (testbit(ms->sets[pi->set], uchar(*s))) return s;
+    return NULL;
+  }
+  return s;
+}
+
+
+static int patmatches (const PatProg *pg, const char *p, size_t lp,
+                         int mode) {
+  return pg->plen == lp && pg->mode == mode && memcmp(pg->pat, p, lp) == 0;
+}
+
+
+/*
+** 返回模式p（长度lp）按mode编译的结果，不在缓存中时编译并放入缓存，
+** 淘汰最久没有使用的一个。cache是PatCache的栈索引。模式不能编译时
+** 返回NULL，调用者改用match。
+*/
+static const PatProg *getprog (lua_State *L, int cache, const char *p,
+                                 size_t lp, int mode) {
+  PatCache *pc = (PatCache *)lua_touserdata(L, cache);
+  const char *loc = setlocale(LC_CTYPE, NULL);
+  PatProg *pg;
+  int i;
+  if (loc == NULL) loc = "";
+  if (strcmp(loc, pc->locale) != 0) {  /* 字符类的位图与locale有关 */
+    if (strlen(loc) >= sizeof(pc->locale)) return NULL;
+    strcpy(pc->locale, loc);
+    pc->n = 0;
+  }
+  if (pc->last < pc->n && patmatches(pc->prog[pc->last], p, lp, mode))
+    i = pc->last;
+  else {
+    for (i = 0; i < pc->n; i++)
+      if (patmatches(pc->prog[i], p, lp, mode)) break;
+    if (i == pc->n) {  /* 不在缓存中 */
+      const char *pp = (mode && *p == '^') ? p+1 : p;
+      int ni, ns, j;
+      if (!compile(pp, NULL, &ni, &ns))
+        ni = ns = 0;
+      pg = (PatProg *)lua_newuserdata(L, sizeof(PatProg) +
+                                 ni*sizeof(PatItem) + ns*sizeof(PatSet) + lp + ni);
+      pg->plen = lp;
+      pg->mode = mode;
+      pg->anchor = (pp != p);
+      pg->items = (ni > 0) ? (PatItem *)(pg + 1) : NULL;
+      pg->sets = (PatSet *)((char *)(pg + 1) + ni*sizeof(PatItem));
+      pg->pat = (char *)(pg->sets + ns);
+      memcpy(pg->pat, p, lp);
+      pg->pre = pg->pat + lp;
+      pg->npre = 0;
+      if (ni > 0) {
+        compile(pp, pg, &ni, &ns);
+        while (pg->items[pg->npre].op == PI_CHAR && pg->items[pg->npre].q == 0) {
+          pg->pre[pg->npre] = (char)pg->items[pg->npre].c;
+          pg->npre++;
+        }
+      }
+      if (pc->n < LUA_PATCACHE)
+        i = pc->n++;
+      else {
+        for (i = 0, j = 1; j < LUA_PATCACHE; j++)
+          if (pc->used[j] < pc->used[i]) i = j;
+      }
+      pg->slot = i;
+      pc->prog[i] = pg;
+      lua_getfenv(L, cache);
+      lua_pushvalue(L, -2);
+      lua_rawseti(L, -2, i+1);
+      lua_pop(L, 2);
+    }
+  }
+  pc->last = i;
+  pc->used[i] = ++pc->tick;
+  pg = pc->prog[i];
+  return (pg->items != NULL) ? pg : NULL;
+}
+
+
+/*
+** 把prog压栈。gsub在调用替换函数时缓存可能淘汰它，留在栈上的引用保证
+** 它在gsub结束前不被回收。
+*/
+static void pinprog (lua_State *L, int cache, const PatProg *prog) {
+  lua_getfenv(L, cache);
+  lua_rawgeti(L, -1, prog->slot+1);
+  lua_remove(L, -2);
+}
+
+
+static void newpatcache (lua_State *L) {
+  PatCache *pc = (PatCache *)lua_newuserdata(L, sizeof(PatCache));
+  pc->tick = 0;
+  pc->n = 0;
+  pc->last = 0;
+  pc->locale[0] = '\0';
+  lua_createtable(L, LUA_PATCACHE, 0);
+  lua_setfenv(L, -2);
+}
+
+
+/* 有编译结果时执行prog，否则解释执行模式p */
+#define domatch(ms,s,p,prog) \
+  ((prog) ? pmatch(ms, s, (prog)->items) : match(ms, s, p))
+
+/* }====================================================== */
+
+
+
+#if defined(LUA_USE_SIMDSTR)
+
+/*
+** 向量化的子串查找（2 <= l2 <= l1）。每次检查W个起点：s1[i]与s2的首
+** 字节、s1[i+l2-1]与末字节同时相等的位置才用memcmp比较中间部分。
+** 凑不满W个起点的尾部逐个检查。
+*/
+#define MEMFIND_BODY(W, vec, load, set1, cmpeq, and, movemask) \
+  const vec first = set1(s2[0]); \
+  const vec last = set1(s2[l2-1]); \
+  size_t n = l1 - l2 + 1;  /* 起点个数 */ \
+  size_t i; \
+  for (i = 0; i + W <= n; i += W) { \
+    vec a = load((const vec *)(s1 + i)); \
+    vec b = load((const vec *)(s1 + i + l2 - 1)); \
+    unsigned int mask = (unsigned int)movemask(and(cmpeq(a, first), \
+                                                   cmpeq(b, last))); \
+    while (mask != 0) { \
+      size_t j = i + (size_t)__builtin_ctz(mask); \
+      if (memcmp(s1 + j + 1, s2 + 1, l2 - 2) == 0) return s1 + j; \
+      mask &= mask - 1; \
+    } \
+  } \
+  for (; i < n; i++) { \
+    if (s1[i] == s2[0] && memcmp(s1 + i + 1, s2 + 1, l2 - 1) == 0) \
+      return s1 + i; \
+  } \
+  return NULL;
+
+static const char *memfind_sse2 (const char *s1, size_t l1,
+                                   const char *s2, size_t l2) {
+  MEMFIND_BODY(16, __m128i, _mm_loadu_si128, _mm_set1_epi8, _mm_cmpeq_epi8,
+               _mm_and_si128, _mm_movemask_epi8)
+}
+
+__attribute__((target("avx2")))
+static const char *memfind_avx2 (const char *s1, size_t l1,
+                                   const char *s2, size_t l2) {
+  MEMFIND_BODY(32, __m256i, _mm256_loadu_si256, _mm256_set1_epi8,
+               _mm256_cmpeq_epi8, _mm256_and_si256, _mm256_movemask_epi8)
+}
+
+typedef const char *(*MemFind) (const char *s1, size_t l1,
+                                const char *s2, size_t l2);
+
+/*
+** 第一次使用时按CPU选定。不同线程上的状态机可能同时第一次调用，
+** 因此用原子操作读写；各线程写入的值相同，relaxed即可。
+*/
+static MemFind memfind_vec = NULL;
+
+static const char *memfind_simd (const char *s1, size_t l1,
+                                   const char *s2, size_t l2) {
+  MemFind f = __atomic_load_n(&memfind_vec, __ATOMIC_RELAXED);
+  if (f == NULL) {
+    __builtin_cpu_init();
+    f = __builtin_cpu_supports("avx2") ? memfind_avx2 : memfind_sse2;
+    __atomic_store_n(&memfind_vec, f, __ATOMIC_RELAXED);
+  }
+  return f(s1, l1, s2, l2);
+}
+
+#endif
+
 
 static const char *lmemfind (const char *s1, size_t l1,
                                const char *s2, size_t l2) {
   if (l2 == 0) return s1;  /* empty strings are everywhere */
   else if (l2 > l1) return NULL;  /* avoids a negative `l1' */
+#if defined(LUA_USE_SIMDSTR)
+  else if (l2 > 1 && l1 - l2 >= 32)  /* 至少一个向量的起点 */
+    return memfind_simd(s1, l1, s2, l2);
+#endif
   else {
     const char *init;  /* to search for a `*s2' inside `s1' */
     l2--;  /* 1st char will be checked by `memchr' */
@@ -1673,15 +2266,19 @@ static int str_find_aux (lua_State *L, int find) {
   }
   else {
     MatchState ms;
+    const PatProg *prog = getprog(L, lua_upvalueindex(1), p, l2, 1);
     int anchor = (*p == '^') ? (p++, 1) : 0;
     const char *s1=s+init;
     ms.L = L;
     ms.src_init = s;
     ms.src_end = s+l1;
+    if (prog) ms.sets = prog->sets;
     do {
       const char *res;
+      if (prog && !anchor && (s1 = pskip(&ms, prog, s1)) == NULL)
+        break;
       ms.level = 0;
-      if ((res=match(&ms, s1, p)) != NULL) {
+      if ((res=domatch(&ms, s1, p, prog)) != NULL) {
         if (find) {
           lua_pushinteger(L, s1-s+1);  /* start */
           lua_pushinteger(L, res-s);   /* end */
@@ -1709,19 +2306,23 @@ static int str_match (lua_State *L) {
 
 static int gmatch_aux (lua_State *L) {
   MatchState ms;
-  size_t ls;
+  size_t ls, lp;
   const char *s = lua_tolstring(L, lua_upvalueindex(1), &ls);
-  const char *p = lua_tostring(L, lua_upvalueindex(2));
+  const char *p = lua_tolstring(L, lua_upvalueindex(2), &lp);
+  const PatProg *prog = getprog(L, lua_upvalueindex(4), p, lp, 0);
   const char *src;
   ms.L = L;
   ms.src_init = s;
   ms.src_end = s+ls;
+  if (prog) ms.sets = prog->sets;
   for (src = s + (size_t)lua_tointeger(L, lua_upvalueindex(3));
        src <= ms.src_end;
        src++) {
     const char *e;
+    if (prog && (src = pskip(&ms, prog, src)) == NULL)
+      break;
     ms.level = 0;
-    if ((e = match(&ms, src, p)) != NULL) {
+    if ((e = domatch(&ms, src, p, prog)) != NULL) {
       lua_Integer newstart = e-s;
       if (e == src) newstart++;  /* empty match? go at least one position */
       lua_pushinteger(L, newstart);
@@ -1738,7 +2339,8 @@ static int gmatch (lua_State *L) {
   luaL_checkstring(L, 2);
   lua_settop(L, 2);
   lua_pushinteger(L, 0);
-  lua_pushcclosure(L, gmatch_aux, 3);
+  lua_pushvalue(L, lua_upvalueindex(1));  /* 模式缓存 */
+  lua_pushcclosure(L, gmatch_aux, 4);
   return 1;
 }
 
@@ -1804,11 +2406,12 @@ static void add_value (MatchState *ms, luaL_Buffer *b, const char *s,
 
 
 static int str_gsub (lua_State *L) {
-  size_t srcl;
+  size_t srcl, lp;
   const char *src = luaL_checklstring(L, 1, &srcl);
-  const char *p = luaL_checkstring(L, 2);
+  const char *p = luaL_checklstring(L, 2, &lp);
   int  tr = lua_type(L, 3);
   int max_s = luaL_optint(L, 4, srcl+1);
+  const PatProg *prog;
   int anchor = (*p == '^') ? (p++, 1) : 0;
   int n = 0;
   MatchState ms;
@@ -1816,14 +2419,23 @@ static int str_gsub (lua_State *L) {
   luaL_argcheck(L, tr == LUA_TNUMBER || tr == LUA_TSTRING ||
                    tr == LUA_TFUNCTION || tr == LUA_TTABLE, 3,
                       "string/function/table expected");
+  prog = getprog(L, lua_upvalueindex(1), p - anchor, lp, 1);
+  if (prog) pinprog(L, lua_upvalueindex(1), prog);
   luaL_buffinit(L, &b);
   ms.L = L;
   ms.src_init = src;
   ms.src_end = src+srcl;
+  if (prog) ms.sets = prog->sets;
   while (n < max_s) {
     const char *e;
+    if (prog && !anchor) {
+      const char *next = pskip(&ms, prog, src);
+      if (next == NULL) break;  /* 剩下的部分不会再有匹配 */
+      luaL_addlstring(&b, src, next - src);
+      src = next;
+    }
     ms.level = 0;
-    e = match(&ms, src, p);
+    e = domatch(&ms, src, p, prog);
     if (e) {
       n++;
       add_value(&ms, &b, src, e);
@@ -1998,8 +2610,8 @@ static int str_format (lua_State *L) {
  * 1. 基本操作：len、sub、reverse、upper、lower、rep
  * 2. 字符转换：byte、char
  * 3. 序列化：dump
- * 4. 查找匹配：find、match、gmatch
- * 5. 替换操作：gsub
+ * 4. 查找匹配：find、match、gmatch（在patlib中注册）
+ * 5. 替换操作：gsub（在patlib中注册）
  * 6. 格式化：format
  * 7. 兼容性：gfind（已废弃，指向错误函数）
  * 
@@ -2018,14 +2630,10 @@ static const luaL_Reg strlib[] = {
     {"byte", str_byte},         /**< 获取字符的字节值 */
     {"char", str_char},         /**< 将字节值转换为字符 */
     {"dump", str_dump},         /**< 序列化函数为字节码 */
-    {"find", str_find},         /**< 查找模式匹配的位置 */
     {"format", str_format},     /**< 格式化字符串 */
     {"gfind", gfind_nodef},     /**< 已废弃，提示使用gmatch */
-    {"gmatch", gmatch},         /**< 全局模式匹配迭代器 */
-    {"gsub", str_gsub},         /**< 全局替换 */
     {"len", str_len},           /**< 获取字符串长度 */
     {"lower", str_lower},       /**< 转换为小写 */
-    {"match", str_match},       /**< 模式匹配 */
     {"rep", str_rep},           /**< 重复字符串 */
     {"reverse", str_reverse},   /**< 反转字符串 */
     {"sub", str_sub},           /**< 提取子字符串 */
@@ -2033,6 +2641,17 @@ static const luaL_Reg strlib[] = {
     {NULL, NULL}                /**< 数组结束标记 */
 };
 
+/**
+ * @brief 模式匹配函数：共用一个已编译模式的缓存作为上值1
+ */
+static const luaL_Reg patlib[] = {
+    {"find", str_find},         /**< 查找模式匹配的位置 */
+    {"gmatch", gmatch},         /**< 全局模式匹配迭代器 */
+    {"gsub", str_gsub},         /**< 全局替换 */
+    {"match", str_match},       /**< 模式匹配 */
+    {NULL, NULL}                /**< 数组结束标记 */
+};
+
 /**
  * @brief 创建字符串元表：为字符串类型设置元表和元方法
  * 
@@ -2090,7 +2709,7 @@ static void createmetatable(lua_State *L) {
  * 问题。这个函数遵循Lua C库的标准初始化模式。
  * 
  * 初始化步骤：
- * 1. 注册所有字符串函数到string表中
+ * 1. 注册所有字符串函数到string表中，模式匹配函数带上模式缓存
  * 2. 处理向后兼容性（gfind到gmatch的映射）
  * 3. 创建并设置字符串元表
  * 4. 返回字符串库表
@@ -2136,8 +2755,17 @@ static void createmetatable(lua_State *L) {
  * @see luaL_register(), createmetatable()
  */
 LUALIB_API int luaopen_string(lua_State *L) {
+    const luaL_Reg *f;
     // 注册所有字符串函数到string库中
     luaL_register(L, LUA_STRLIBNAME, strlib);
+    // 模式匹配函数带上每个状态一份的已编译模式缓存
+    newpatcache(L);
+    for (f = patlib; f->name; f++) {
+        lua_pushvalue(L, -1);
+        lua_pushcclosure(L, f->func, 1);
+        lua_setfield(L, -3, f->name);
+    }
+    lua_pop(L, 1);
     
 #if defined(LUA_COMPAT_GFIND)
     // 向后兼容：将gmatch也注册为gfind
@@ -29,6 +29,9 @@
  * 良好的性能。这是通过Brent变种算法实现的，该算法保证了
  * 主位置不变性：如果元素不在其主位置，那么冲突元素必在其主位置。
  *
+ * 定义LUA_USE_SWISSTABLE时哈希部分改为分组探测的开放寻址（见下文
+ * "分组探测的哈希部分"），节点数组的下标含义不变。
+ *
  * 应用场景：
  * - 数组：高效的整数索引访问
  * - 字典：任意类型键值对存储
@@ -56,7 +59,13 @@
 #include "lmem.h"
 #include "lobject.h"
 #include "lstate.h"
+#include "lstring.h"
 #include "ltable.h"
+#include "lvm.h"
+
+#if defined(LUA_USE_SWISSTABLE) && defined(__SSE2__) && !defined(LUA_ANSI)
+#include <emmintrin.h>
+#endif
 
 /**
  * @brief 数组部分的最大位数限制
@@ -95,7 +104,8 @@
  * @param t 表指针
  * @param str 字符串指针
  *
- * 利用字符串对象预计算的哈希值，避免重复计算。
+ * 利用字符串对象预计算的哈希值，避免重复计算。只用于短字符串；
+ * 长字符串的哈希值可能还没有计算，要经过luaS_hashstr。
  */
 #define hashstr(t, str)     hashpow2(t, (str)->tsv.hash)
 
@@ -134,12 +144,174 @@
  */
 #define numints             cast_int(sizeof(lua_Number) / sizeof(int))
 
+#if defined(LUA_USE_SWISSTABLE)
+
+// ============================================================================
+// 分组探测的哈希部分
+// ============================================================================
+
+/*
+ * 节点数组之后紧跟控制数组，每个槽位一个字节：CTRL_EMPTY表示从未使用，
+ * 否则是键的哈希值的低7位（h2）。键从h1 = 哈希值>>7选出的组开始按三角
+ * 数序列逐组探测，同一组的控制字节一次比较完，只有h2相同的槽位才比较
+ * 键；遇到含空槽的组即可确定键不存在。删除只把值置为nil，控制字节保持
+ * 占用，因此新键总是落在探测路径上第一个空槽之前的组里。少于一组的表
+ * 控制数组补足到一组，补齐的字节是CTRL_PAD，既不匹配任何h2也不是空槽。
+ * 空槽用完（hfree为0）时重哈希。
+ */
+
+#if defined(__SSE2__) && !defined(LUA_ANSI)
+#define SW_LGROUP   4
+#else
+#define SW_LGROUP   3
+#endif
+#define SW_GROUP    (1 << SW_LGROUP)    // 一组的槽位数
+
+#define CTRL_EMPTY  0x80
+#define CTRL_PAD    0xFF
+
+#define gctrl(t)    cast(lu_byte *, (t)->node + sizenode(t))
+#define swh1(h)     cast_int((h) >> 7)
+#define swh2(h)     cast_int((h) & 0x7F)
+
+/* 组数减1，用作组号的掩码 */
+#define swgmask(t)  ((t)->lsizenode > SW_LGROUP ? \
+                     twoto((t)->lsizenode - SW_LGROUP) - 1 : 0)
+
+/* 大小为size的哈希部分最多容纳的键数：不超过一组时可以填满 */
+#define swmaxload(size)     ((size) <= SW_GROUP ? (size) : (size) - (size) / 8)
+
+/* 节点数组和控制数组一起分配的字节数 */
+#define swnodebytes(size) \
+    (cast(size_t, size) * sizeof(Node) + ((size) < SW_GROUP ? SW_GROUP : (size)))
+
+#define freenodes(L, n, size)   luaM_freemem(L, n, swnodebytes(size))
+
+#if defined(__SSE2__) && !defined(LUA_ANSI)
+
+/* 组内控制字节等于b的槽位的位掩码 */
+static unsigned int swmatch(const lu_byte *c, int b) {
+    __m128i g = _mm_loadu_si128(cast(const __m128i *, c));
+    return cast(unsigned int,
+                _mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(cast(char, b)))));
+}
+
+#else
+
+static unsigned int swmatch(const lu_byte *c, int b) {
+    unsigned int m = 0;
+    int i;
+    for (i = 0; i < SW_GROUP; i++) {
+        if (c[i] == b) {
+            m |= 1u << i;
+        }
+    }
+    return m;
+}
+
+#endif
+
+#define swempty(c)  swmatch(c, CTRL_EMPTY)
+
+#if defined(__GNUC__)
+#define swfirst(m)  __builtin_ctz(m)
+#else
+static int swfirst(unsigned int m) {
+    int i = 0;
+    while ((m & 1) == 0) {
+        m >>= 1;
+        i++;
+    }
+    return i;
+}
+#endif
+
+/**
+ * @brief 遍历键的探测路径上h2相同的槽位
+ *
+ * 对每个候选槽位令n指向它的节点并执行stmt（通常在键相等时return）；
+ * 遇到含空槽的组或所有组都已探测时结束。
+ */
+#define swforeach(t, h, n, stmt) { \
+    const lu_byte *ctrl_ = gctrl(t); \
+    int gmask_ = swgmask(t); \
+    int g_ = swh1(h) & gmask_; \
+    int step_ = 0; \
+    for (;;) { \
+        const lu_byte *c_ = ctrl_ + g_ * SW_GROUP; \
+        unsigned int m_; \
+        for (m_ = swmatch(c_, swh2(h)); m_ != 0; m_ &= m_ - 1) { \
+            n = gnode(t, g_ * SW_GROUP + swfirst(m_)); \
+            stmt \
+        } \
+        if (swempty(c_) != 0 || step_ == gmask_) { \
+            break; \
+        } \
+        g_ = (g_ + ++step_) & gmask_; \
+    } \
+}
+
+/* 非字符串键的哈希值再经过一次混合，h1和h2都取自分布均匀的位 */
+static unsigned int swmix(unsigned int h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+/* 与hashnum相同的按位累加，-0和+0得到相同的值 */
+static unsigned int numhash(lua_Number n) {
+    unsigned int a[numints];
+    int i;
+
+    if (luai_numeq(n, 0)) {
+        return 0;
+    }
+    memcpy(a, &n, sizeof(a));
+    for (i = 1; i < numints; i++) {
+        a[0] += a[i];
+    }
+    return swmix(a[0]);
+}
+
+static unsigned int hashkey(const TValue *key) {
+    switch (ttype(key)) {
+        case LUA_TINT:     // 整数子类型与等值的浮点数哈希值相同
+        case LUA_TNUMBER:
+            return numhash(nvalue(key));
+
+        case LUA_TSTRING:
+            return luaS_hashstr(rawtsvalue(key));
+
+        case LUA_TBOOLEAN:
+            return swmix(cast(unsigned int, bvalue(key)));
+
+        case LUA_TLIGHTUSERDATA:
+            return swmix(IntPoint(pvalue(key)));
+
+        default:
+            return swmix(IntPoint(gcvalue(key)));
+    }
+}
+
+#else
+
+#define freenodes(L, n, size)   luaM_freearray(L, n, size, Node)
+
+#endif
+
 /**
  * @brief 虚拟节点指针
  *
  * 指向全局唯一的虚拟节点，用于表示空的哈希表状态。
  */
+#if defined(LUA_USE_SWISSTABLE)
+#define dummynode           (&dummynode_.n)
+#else
 #define dummynode           (&dummynode_)
+#endif
 
 /**
  * @brief 全局虚拟节点实例
@@ -157,10 +329,27 @@
  * 使用虚拟节点可以简化代码逻辑，所有哈希操作都可以统一处理，
  * 无需特殊判断空表的情况。
  */
+#if defined(LUA_USE_SWISSTABLE)
+/* 控制字节紧跟在节点之后，全部是填充：查找直接结束，hfree为0使插入先重哈希 */
+static const struct {
+    Node n;
+    lu_byte ctrl[SW_GROUP];
+} dummynode_ = {
+    {{NILFIELDS}, {{NILFIELDS}}},
+    {CTRL_PAD, CTRL_PAD, CTRL_PAD, CTRL_PAD, CTRL_PAD, CTRL_PAD, CTRL_PAD, CTRL_PAD
+#if SW_GROUP == 16
+    , CTRL_PAD, CTRL_PAD, CTRL_PAD, CTRL_PAD, CTRL_PAD, CTRL_PAD, CTRL_PAD, CTRL_PAD
+#endif
+    }
+};
+#else
 static const Node dummynode_ = {
-    {{NULL}, LUA_TNIL},         // 值部分：nil值
-    {{{NULL}, LUA_TNIL, NULL}}  // 键部分：nil键，无下一个节点
+    {NILFIELDS},                // 值部分：nil值
+    {{NILFIELDS, NULL}}         // 键部分：nil键，无下一个节点
 };
+#endif
+
+#if !defined(LUA_USE_SWISSTABLE)
 
 /**
  * @brief 计算数值的哈希位置
@@ -234,11 +423,12 @@ static Node *hashnum(const Table *t, lua_Number n) {
  */
 static Node *mainposition(const Table *t, const TValue *key) {
     switch (ttype(key)) {
+        case LUA_TINT:     // 整数子类型与等值的浮点数落在同一位置
         case LUA_TNUMBER:
             return hashnum(t, nvalue(key));
 
         case LUA_TSTRING:
-            return hashstr(t, rawtsvalue(key));
+            return hashpow2(t, luaS_hashstr(rawtsvalue(key)));
 
         case LUA_TBOOLEAN:
             return hashboolean(t, bvalue(key));
@@ -251,6 +441,8 @@ static Node *mainposition(const Table *t, const TValue *key) {
     }
 }
 
+#endif
+
 /**
  * @brief 判断键是否适合存储在数组部分
  * @param key 键值指针
@@ -273,6 +465,9 @@ static Node *mainposition(const Table *t, const TValue *key) {
  * 仔细处理浮点数到整数的转换，确保只有真正的整数才被接受。
  */
 static int arrayindex(const TValue *key) {
+    if (ttisint(key)) {
+        return ivalue(key);
+    }
     if (ttisnumber(key)) {
         lua_Number n = nvalue(key);
         int k;
@@ -285,6 +480,31 @@ static int arrayindex(const TValue *key) {
     return -1;    // 键不满足数组部分的条件
 }
 
+#if defined(LUA_USE_INCREHASH)
+
+static void incrfinish(lua_State *L, Table *t);
+
+/**
+ * @brief 增量重哈希中旧节点数组的表视图
+ * @param t 处于INCR_MOVE状态的表
+ * @param o 调用者提供的Table，被填成只有旧哈希部分的表
+ * @return o
+ *
+ * 详细说明：
+ * 视图没有数组部分，也不在重哈希中，查找函数和findindex可以原样用在
+ * 旧数组上。已迁移的节点键为nil，不会被找到；视图只用于查找，不能插入。
+ */
+static Table *oldview(const Table *t, Table *o) {
+    o->node = t->incrnode;
+    o->lsizenode = t->incrlsize;
+    o->incrstate = INCR_NONE;
+    o->array = NULL;
+    o->sizearray = 0;
+    return o;
+}
+
+#endif
+
 /**
  * @brief 查找键在表遍历中的索引位置
  * @param L Lua状态机指针
@@ -331,6 +551,17 @@ static int findindex(lua_State *L, Table *t, StkId key) {
         // 在数组部分，返回C风格索引（从0开始）
         return i - 1;
     } else {
+#if defined(LUA_USE_SWISSTABLE)
+        Node *n;
+        unsigned int h = hashkey(key);
+        // 键可能已经"死亡"，但在遍历中仍然有效
+        swforeach(t, h, n,
+            if (luaO_rawequalObj(key2tval(n), key) ||
+                (ttype(gkey(n)) == LUA_TDEADKEY && iscollectable(key) &&
+                 gcvalue(gkey(n)) == gcvalue(key))) {
+                return cast_int(n - gnode(t, 0)) + t->sizearray;
+            })
+#else
         // 在哈希部分，需要遍历冲突链查找
         Node *n = mainposition(t, key);
         do {
@@ -349,6 +580,15 @@ static int findindex(lua_State *L, Table *t, StkId key) {
                 n = gnext(n);
             }
         } while (n);
+#endif
+#if defined(LUA_USE_INCREHASH)
+        if (t->incrstate == INCR_MOVE) {
+            // 还没有迁移的旧节点的遍历索引排在新数组之后
+            Table o;
+            i = findindex(L, oldview(t, &o), key);
+            return i + t->sizearray + sizenode(t);
+        }
+#endif
 
         // 键未找到，这是一个错误
         luaG_runerror(L, "invalid key to " LUA_QL("next"));
@@ -407,7 +647,7 @@ int luaH_next(lua_State *L, Table *t, StkId key) {
     for (i++; i < t->sizearray; i++) {
         if (!ttisnil(&t->array[i])) {
             // 找到非nil值，设置键（Lua索引从1开始）
-            setnvalue(key, cast_num(i + 1));
+            setivalue(key, i + 1);
             // 设置对应的值
             setobj2s(L, key + 1, &t->array[i]);
             return 1;
@@ -425,6 +665,21 @@ int luaH_next(lua_State *L, Table *t, StkId key) {
         }
     }
 
+#if defined(LUA_USE_INCREHASH)
+    // 最后是还没有迁移的旧节点；只有插入新键才会推进迁移，遍历期间
+    // 两个数组的划分不变
+    if (t->incrstate == INCR_MOVE) {
+        for (i -= sizenode(t); i < t->incrpos; i++) {
+            Node *n = &t->incrnode[i];
+            if (!ttisnil(gval(n))) {
+                setobj2s(L, key, key2tval(n));
+                setobj2s(L, key + 1, gval(n));
+                return 1;
+            }
+        }
+    }
+#endif
+
     return 0;    // 没有更多元素
 }
 
@@ -758,12 +1013,31 @@ static void setnodevector(lua_State *L, Table *t, int size) {
 
         // 计算实际大小（向上调整到2的幂次）
         lsize = ceillog2(size);
+#if defined(LUA_USE_SWISSTABLE)
+        if (swmaxload(twoto(lsize)) < size) {
+            lsize++;    // 留出负载上限之外的空槽
+        }
+#endif
         if (lsize > MAXBITS) {
             luaG_runerror(L, "table overflow");
         }
 
         size = twoto(lsize);    // 2^lsize
 
+#if defined(LUA_USE_SWISSTABLE)
+        // 节点数组和控制数组一起分配
+        t->node = cast(Node *, luaM_malloc(L, swnodebytes(size)));
+        memset(t->node + size, CTRL_EMPTY, size);
+        if (size < SW_GROUP) {
+            memset(cast(lu_byte *, t->node + size) + size, CTRL_PAD,
+                   SW_GROUP - size);
+        }
+        for (i = 0; i < size; i++) {
+            Node *n = gnode(t, i);
+            setnilvalue(gkey(n));
+            setnilvalue(gval(n));
+        }
+#else
         // 分配哈希表内存
         t->node = luaM_newvector(L, size, Node);
 
@@ -774,9 +1048,14 @@ static void setnodevector(lua_State *L, Table *t, int size) {
             setnilvalue(gkey(n));   // 键为nil
             setnilvalue(gval(n));   // 值为nil
         }
+#endif
     }
     t->lsizenode = cast_byte(lsize);
+#if defined(LUA_USE_SWISSTABLE)
+    t->hfree = (t->node == dummynode) ? 0 : swmaxload(size);
+#else
     t->lastfree = gnode(t, size);    // 所有位置都是空闲的
+#endif
 }
 
 /**
@@ -821,9 +1100,16 @@ static void setnodevector(lua_State *L, Table *t, int size) {
  */
 static void resize(lua_State *L, Table *t, int nasize, int nhsize) {
     int i;
-    int oldasize = t->sizearray;
-    int oldhsize = t->lsizenode;
-    Node *nold = t->node;    // 保存旧的哈希表
+    int oldasize;
+    int oldhsize;
+    Node *nold;
+
+#if defined(LUA_USE_INCREHASH)
+    incrfinish(L, t);    // 先完成进行中的增量重哈希，内容只在node中
+#endif
+    oldasize = t->sizearray;
+    oldhsize = t->lsizenode;
+    nold = t->node;    // 保存旧的哈希表
 
     // 如果数组部分需要扩展，先扩展
     if (nasize > oldasize) {
@@ -832,6 +1118,9 @@ static void resize(lua_State *L, Table *t, int nasize, int nhsize) {
 
     // 创建新的哈希部分
     setnodevector(L, t, nhsize);
+#if defined(LUA_USE_INCREHASH)
+    t->incrstate = INCR_HOLD;    // 下面的重新插入不开始增量重哈希
+#endif
 
     // 如果数组部分需要收缩
     if (nasize < oldasize) {
@@ -858,8 +1147,11 @@ static void resize(lua_State *L, Table *t, int nasize, int nhsize) {
 
     // 释放旧的哈希表内存
     if (nold != dummynode) {
-        luaM_freearray(L, nold, twoto(oldhsize), Node);
+        freenodes(L, nold, twoto(oldhsize));
     }
+#if defined(LUA_USE_INCREHASH)
+    t->incrstate = INCR_NONE;
+#endif
 }
 
 
@@ -886,6 +1178,9 @@ static void resize(lua_State *L, Table *t, int nasize, int nhsize) {
  */
 void luaH_resizearray(lua_State *L, Table *t, int nasize) {
     int nsize = (t->node == dummynode) ? 0 : sizenode(t);
+#if defined(LUA_USE_SWISSTABLE)
+    nsize = swmaxload(nsize);    // 按键数计算大小，保持现有的容量
+#endif
     resize(L, t, nasize, nsize);
 }
 
@@ -1001,8 +1296,15 @@ Table *luaH_new(lua_State *L, int narray, int nhash) {
     // 临时值（只有在某些malloc失败时才保留）
     t->array = NULL;
     t->sizearray = 0;
+    t->lenhint = 0;
     t->lsizenode = 0;
     t->node = cast(Node *, dummynode);
+#if defined(LUA_USE_INCREHASH)
+    t->incrstate = INCR_NONE;
+    t->incrlsize = 0;
+    t->incrnode = NULL;
+    t->incrpos = 0;
+#endif
 
     // 设置初始大小
     setarrayvector(L, t, narray);
@@ -1040,8 +1342,13 @@ Table *luaH_new(lua_State *L, int narray, int nhash) {
 void luaH_free(lua_State *L, Table *t) {
     // 释放哈希部分（如果不是虚拟节点）
     if (t->node != dummynode) {
-        luaM_freearray(L, t->node, sizenode(t), Node);
+        freenodes(L, t->node, sizenode(t));
     }
+#if defined(LUA_USE_INCREHASH)
+    if (t->incrstate == INCR_INIT || t->incrstate == INCR_MOVE) {
+        luaM_freearray(L, t->incrnode, twoto(t->incrlsize), Node);
+    }
+#endif
 
     // 释放数组部分
     luaM_freearray(L, t->array, t->sizearray, TValue);
@@ -1050,6 +1357,495 @@ void luaH_free(lua_State *L, Table *t) {
     luaM_free(L, t);
 }
 
+/**
+ * @brief 清空表的内容，保留已分配的数组部分和哈希部分
+ * @param L Lua状态机指针
+ * @param t 要清空的表
+ *
+ * 详细说明：
+ * 数组部分的值全部置为nil；哈希部分的节点恢复成setnodevector刚分配
+ * 时的状态（键和值为nil，所有节点空闲）。之后重新填入不超过原来大小
+ * 的内容不需要分配内存。元表不变。
+ *
+ * 清空后以前的键都不在表中，所以不能在遍历中清空后继续调用next。
+ * 只去掉引用，不需要写屏障。
+ */
+void luaH_clear(lua_State *L, Table *t) {
+    int i;
+    int size = sizenode(t);
+
+#if defined(LUA_USE_INCREHASH)
+    // 进行中的增量重哈希直接放弃：保留node，丢掉另一个数组
+    if (t->incrstate == INCR_INIT || t->incrstate == INCR_MOVE) {
+        luaM_freearray(L, t->incrnode, twoto(t->incrlsize), Node);
+        t->incrnode = NULL;
+        t->incrstate = INCR_NONE;
+    }
+#else
+    UNUSED(L);
+#endif
+    for (i = 0; i < t->sizearray; i++) {
+        setnilvalue(&t->array[i]);
+    }
+    if (t->node != dummynode) {
+        for (i = 0; i < size; i++) {
+            Node *n = gnode(t, i);
+#if !defined(LUA_USE_SWISSTABLE)
+            gnext(n) = NULL;
+#endif
+            setnilvalue(gkey(n));
+            setnilvalue(gval(n));
+        }
+#if defined(LUA_USE_SWISSTABLE)
+        memset(gctrl(t), CTRL_EMPTY, cast(unsigned int, size));
+        t->hfree = swmaxload(size);
+#else
+        t->lastfree = gnode(t, size);
+#endif
+    }
+    t->lenhint = 0;
+}
+
+/**
+ * @brief 复制一段整数键：a2[t..t+e-f] = a1[f..e]
+ * @param L Lua状态机指针
+ * @param a1 源表
+ * @param f 源区间起点
+ * @param e 源区间终点，调用者保证f <= e
+ * @param t 目标区间起点
+ * @param a2 目标表，可以与a1相同（区间可以重叠）
+ *
+ * 详细说明：
+ * 两个区间都在各自的数组部分时用一次memmove复制，再对目标表做一次
+ * 写屏障（目标是黑色时退回灰色）。否则逐个元素原始地读写，区间重叠
+ * 且目标在后时从后往前复制。源中的nil会清除目标中已有的值，但不在
+ * 目标中创建新键。
+ */
+void luaH_move(lua_State *L, Table *a1, int f, int e, int t, Table *a2) {
+    int n = e - f;    // 元素数减一
+    int i;
+
+    lua_assert(f <= e);
+    if (f >= 1 && e <= a1->sizearray &&
+        t >= 1 && t <= a2->sizearray - n) {
+        memmove(&a2->array[t - 1], &a1->array[f - 1],
+                cast(size_t, n + 1) * sizeof(TValue));
+        if (isblack(obj2gco(a2))) {
+            luaC_barrierback(L, a2);
+        }
+        return;
+    }
+    for (i = 0; i <= n; i++) {
+        // 同一个表且目标区间在源区间之后：从后往前
+        int k = (a1 == a2 && t > f && t <= e) ? n - i : i;
+        TValue v;
+        setobj(L, &v, luaH_getnum(a1, f + k));
+        if (ttisnil(&v)) {
+            const TValue *p = luaH_getnum(a2, t + k);
+            if (p != luaO_nilobject) {
+                setnilvalue(cast(TValue *, p));
+            }
+        } else {
+            // v仍然在a1中，setnum引起的重哈希不会让它被回收
+            setobj2t(L, luaH_setnum(L, a2, t + k), &v);
+            luaC_barriert(L, a2, &v);
+        }
+    }
+}
+
+// ============================================================================
+// 数组部分的整块排序：table.sort没有比较函数时的快速路径
+// 与ltablib.c中的一般路径是同一个算法，区间阈值是luaconf.h中的LUAI_SORT*
+// ============================================================================
+
+#define SORT_INT        0      /* 元素全是整数子类型 */
+#define SORT_NUM        1      /* 元素全是数字，没有NaN */
+#define SORT_STR        2      /* 元素全是字符串 */
+
+#define sortswap(L, a, b) \
+    { TValue t_; setobj(L, &t_, (a)); setobj(L, (a), (b)); setobj(L, (b), &t_); }
+
+/**
+ * @brief 排序用的小于比较，对全是同一种元素的数组是全序
+ */
+static int sortlt(int kind, const TValue *a, const TValue *b) {
+    switch (kind) {
+        case SORT_INT:
+            return ivalue(a) < ivalue(b);
+        case SORT_NUM:
+            return luai_numlt(nvalue(a), nvalue(b));
+        default:
+            return rawtsvalue(a) != rawtsvalue(b) &&
+                   luaV_strcmp(rawtsvalue(a), rawtsvalue(b)) < 0;
+    }
+}
+
+/**
+ * @brief 插入排序[lo, hi)
+ */
+static void sortins(lua_State *L, int kind, TValue *lo, TValue *hi) {
+    TValue *i;
+
+    UNUSED(L);    // 只在setobj的检查中使用
+    for (i = lo + 1; i < hi; i++) {
+        if (sortlt(kind, i, i - 1)) {
+            TValue x;
+            TValue *j = i;
+            setobj(L, &x, i);
+            do {
+                setobj(L, j, j - 1);
+                j--;
+            } while (j > lo && sortlt(kind, &x, j - 1));
+            setobj(L, j, &x);
+        }
+    }
+}
+
+/**
+ * @brief 试探性的插入排序：移动超过LUAI_SORTPARTIAL个元素就放弃
+ * @return 区间已经排好时返回1
+ */
+static int sortpartial(lua_State *L, int kind, TValue *lo, TValue *hi) {
+    int moved = 0;
+    TValue *i;
+
+    UNUSED(L);
+    for (i = lo + 1; i < hi; i++) {
+        if (sortlt(kind, i, i - 1)) {
+            TValue x;
+            TValue *j = i;
+            setobj(L, &x, i);
+            do {
+                setobj(L, j, j - 1);
+                j--;
+            } while (j > lo && sortlt(kind, &x, j - 1));
+            setobj(L, j, &x);
+            moved += cast_int(i - j);
+            if (moved > LUAI_SORTPARTIAL) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief 把*a、*b、*c排成非降序
+ */
+static void sort3(lua_State *L, int kind, TValue *a, TValue *b, TValue *c) {
+    UNUSED(L);
+    if (sortlt(kind, b, a)) {
+        sortswap(L, a, b);
+    }
+    if (sortlt(kind, c, b)) {
+        sortswap(L, b, c);
+        if (sortlt(kind, b, a)) {
+            sortswap(L, a, b);
+        }
+    }
+}
+
+/**
+ * @brief 以*lo为枢轴P划分[lo, hi)
+ * @param done 划分前区间已经是划分好的（没有交换）时置为1
+ * @return P的最终位置p：[lo, p)中的元素 < P <= (p, hi)中的元素
+ */
+static TValue *sortpartright(lua_State *L, int kind, TValue *lo, TValue *hi,
+                             int *done) {
+    TValue p;
+    TValue *first = lo;
+    TValue *last = hi;
+
+    UNUSED(L);
+    setobj(L, &p, lo);
+    while (++first < hi && sortlt(kind, first, &p)) {
+    }
+    if (first - 1 == lo) {
+        while (first < last && !sortlt(kind, --last, &p)) {
+        }
+    } else {
+        while (--last > lo && !sortlt(kind, last, &p)) {
+        }
+    }
+    *done = (first >= last);
+    while (first < last) {
+        sortswap(L, first, last);
+        while (++first < hi && sortlt(kind, first, &p)) {
+        }
+        while (--last > lo && !sortlt(kind, last, &p)) {
+        }
+    }
+    setobj(L, lo, first - 1);
+    setobj(L, first - 1, &p);
+    return first - 1;
+}
+
+/**
+ * @brief 以*lo为枢轴P划分[lo, hi)，等于P的元素放到左边
+ * @return P的最终位置p：[lo, p]中的元素 <= P < (p, hi)中的元素
+ */
+static TValue *sortpartleft(lua_State *L, int kind, TValue *lo, TValue *hi) {
+    TValue p;
+    TValue *first = lo;
+    TValue *last = hi;
+
+    UNUSED(L);
+    setobj(L, &p, lo);
+    while (--last > lo && sortlt(kind, &p, last)) {
+    }
+    if (last + 1 == hi) {
+        while (first < last && !sortlt(kind, &p, ++first)) {
+        }
+    } else {
+        while (++first < hi && !sortlt(kind, &p, first)) {
+        }
+    }
+    while (first < last) {
+        sortswap(L, first, last);
+        while (--last > lo && sortlt(kind, &p, last)) {
+        }
+        while (++first < hi && !sortlt(kind, &p, first)) {
+        }
+    }
+    setobj(L, lo, last);
+    setobj(L, last, &p);
+    return last;
+}
+
+/**
+ * @brief 把a[i]下沉到大小为n的最大堆a中的位置
+ */
+static void sortsift(lua_State *L, int kind, TValue *a, int i, int n) {
+    UNUSED(L);
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= n) {
+            break;
+        }
+        if (c + 1 < n && sortlt(kind, &a[c], &a[c + 1])) {
+            c++;
+        }
+        if (!sortlt(kind, &a[i], &a[c])) {
+            break;
+        }
+        sortswap(L, &a[i], &a[c]);
+        i = c;
+    }
+}
+
+/**
+ * @brief 堆排序[lo, hi)，划分一直不平衡时的退路
+ */
+static void sortheap(lua_State *L, int kind, TValue *lo, TValue *hi) {
+    int n = cast_int(hi - lo);
+    int i;
+
+    for (i = n / 2 - 1; i >= 0; i--) {
+        sortsift(L, kind, lo, i, n);
+    }
+    for (i = n - 1; i > 0; i--) {
+        sortswap(L, &lo[0], &lo[i]);
+        sortsift(L, kind, lo, 0, i);
+    }
+}
+
+/**
+ * @brief 模式消除快速排序（pdqsort）的主循环
+ * @param bad 还允许的不平衡划分次数，用完后改用堆排序
+ * @param leftmost [lo, hi)左边没有元素时为1；否则lo[-1]不大于区间中
+ *        的任何元素
+ *
+ * 详细说明：
+ * 快速排序的基础上：九数取中选枢轴；枢轴等于左边界外的元素时把等于
+ * 枢轴的元素一次划分出去（大量重复元素是线性的）；划分没有交换时试探
+ * 插入排序（已经有序的输入是线性的）；划分不平衡时打乱几个元素破坏
+ * 对抗性的模式，不平衡次数超过log2(n)后改用堆排序，所以最坏O(n log n)。
+ * 只递归较短的一边，栈深度O(log n)。
+ */
+static void sortloop(lua_State *L, int kind, TValue *lo, TValue *hi,
+                     int bad, int leftmost) {
+    for (;;) {
+        int size = cast_int(hi - lo);
+        int s2 = size / 2;
+        int lsize, rsize, done;
+        TValue *p;
+
+        if (size < LUAI_SORTINSERTION) {
+            sortins(L, kind, lo, hi);
+            return;
+        }
+        // 枢轴放到*lo
+        if (size > LUAI_SORTNINTHER) {
+            sort3(L, kind, lo, lo + s2, hi - 1);
+            sort3(L, kind, lo + 1, lo + (s2 - 1), hi - 2);
+            sort3(L, kind, lo + 2, lo + (s2 + 1), hi - 3);
+            sort3(L, kind, lo + (s2 - 1), lo + s2, lo + (s2 + 1));
+            sortswap(L, lo, lo + s2);
+        } else {
+            sort3(L, kind, lo + s2, lo, hi - 1);
+        }
+        // 左边界外的元素（上一个枢轴）不小于枢轴：等于枢轴的元素已经到位
+        if (!leftmost && !sortlt(kind, lo - 1, lo)) {
+            lo = sortpartleft(L, kind, lo, hi) + 1;
+            continue;
+        }
+
+        p = sortpartright(L, kind, lo, hi, &done);
+        lsize = cast_int(p - lo);
+        rsize = cast_int(hi - (p + 1));
+        if (lsize < size / 8 || rsize < size / 8) {
+            if (--bad == 0) {
+                sortheap(L, kind, lo, hi);
+                return;
+            }
+            if (lsize >= LUAI_SORTINSERTION) {
+                sortswap(L, lo, lo + lsize / 4);
+                sortswap(L, p - 1, p - lsize / 4);
+                if (lsize > LUAI_SORTNINTHER) {
+                    sortswap(L, lo + 1, lo + (lsize / 4 + 1));
+                    sortswap(L, lo + 2, lo + (lsize / 4 + 2));
+                    sortswap(L, p - 2, p - (lsize / 4 + 1));
+                    sortswap(L, p - 3, p - (lsize / 4 + 2));
+                }
+            }
+            if (rsize >= LUAI_SORTINSERTION) {
+                sortswap(L, p + 1, p + (1 + rsize / 4));
+                sortswap(L, hi - 1, hi - rsize / 4);
+                if (rsize > LUAI_SORTNINTHER) {
+                    sortswap(L, p + 2, p + (2 + rsize / 4));
+                    sortswap(L, p + 3, p + (3 + rsize / 4));
+                    sortswap(L, hi - 2, hi - (1 + rsize / 4));
+                    sortswap(L, hi - 3, hi - (2 + rsize / 4));
+                }
+            }
+        } else if (done && sortpartial(L, kind, lo, p) &&
+                   sortpartial(L, kind, p + 1, hi)) {
+            return;
+        }
+
+        if (lsize < rsize) {
+            sortloop(L, kind, lo, p, bad, leftmost);
+            lo = p + 1;
+            leftmost = 0;
+        } else {
+            sortloop(L, kind, p + 1, hi, bad, 0);
+            hi = p;
+        }
+    }
+}
+
+/**
+ * @brief 直接排序数组部分中的t[1..n]
+ * @param L Lua状态机指针
+ * @param t 要排序的表
+ * @param n 元素个数
+ * @return 排好了返回1；不适用时返回0，表不变
+ *
+ * 详细说明：
+ * 只处理1..n都在数组部分、并且全是数字（没有NaN）或全是字符串的情况，
+ * 这时<是全序，不需要调用元方法，可以直接在TValue上比较和移动。其他
+ * 情况（包括空洞和类型混合时应当报告的比较错误）留给调用者逐个比较。
+ * 排序只在同一个数组内移动值，不分配内存，也不需要写屏障。
+ */
+int luaH_sort(lua_State *L, Table *t, int n) {
+    TValue *a = t->array;
+    int kind;
+    int bad = 0;
+    int i;
+
+    if (n > t->sizearray) {
+        return 0;
+    }
+    if (n < 2) {
+        return 1;
+    }
+    if (ttisstring(&a[0])) {
+        kind = SORT_STR;
+        for (i = 1; i < n; i++) {
+            if (!ttisstring(&a[i])) {
+                return 0;
+            }
+        }
+    } else {
+        kind = SORT_INT;
+        for (i = 0; i < n; i++) {
+            if (ttisint(&a[i])) {
+                continue;
+            }
+            if (!ttisfloat(&a[i]) || luai_numisnan(nvalue(&a[i]))) {
+                return 0;
+            }
+            kind = SORT_NUM;
+        }
+    }
+    for (i = n; i > 1; i >>= 1) {
+        bad++;    // log2(n)
+    }
+    sortloop(L, kind, a, a + n, bad, 1);
+    return 1;
+}
+
+#if defined(LUA_USE_SWISSTABLE)
+
+/**
+ * @brief 在哈希表中插入新键（分组探测）
+ * @param L Lua状态机指针
+ * @param t 目标表
+ * @param key 要插入的键，调用者已确认它不在表中
+ * @return 指向新键对应值位置的指针
+ *
+ * 详细说明：
+ * 新键占用探测路径上的第一个空槽，控制字节写为它的h2。空槽配额
+ * 用完时先重哈希再插入。值为nil的旧键一般不复用，由重哈希清除；
+ * 例外是垃圾回收器标记的死键：同一个对象再次插入时复用它原来的槽位，
+ * 否则死键和新键会同时出现在探测路径上，findindex可能先遇到死键，
+ * 遍历时把同一个键返回两次。
+ */
+static TValue *newkey(lua_State *L, Table *t, const TValue *key) {
+    unsigned int h, m;
+    lu_byte *ctrl;
+    int gmask, g, step, i;
+    Node *n;
+
+    h = hashkey(key);
+    if (iscollectable(key)) {
+        swforeach(t, h, n,
+            if (ttype(gkey(n)) == LUA_TDEADKEY && gcvalue(gkey(n)) == gcvalue(key)) {
+                lua_assert(ttisnil(gval(n)));
+                copy_(gkey(n), key);
+                luaC_barriert(L, t, key);
+                return gval(n);
+            })
+    }
+    if (t->hfree == 0) {
+        rehash(L, t, key);
+        return luaH_set(L, t, key);    // 在扩展后的表中重新插入
+    }
+
+    ctrl = gctrl(t);
+    gmask = swgmask(t);
+    g = swh1(h) & gmask;
+    step = 0;
+    // hfree大于0保证还有空槽，探测序列会访问所有的组
+    while ((m = swempty(ctrl + g * SW_GROUP)) == 0) {
+        lua_assert(step < gmask);
+        g = (g + ++step) & gmask;
+    }
+    i = g * SW_GROUP + swfirst(m);
+    lua_assert(i < sizenode(t));
+    ctrl[i] = cast_byte(swh2(h));
+    t->hfree--;
+
+    n = gnode(t, i);
+    copy_(gkey(n), key);
+    luaC_barriert(L, t, key);
+
+    lua_assert(ttisnil(gval(n)));
+    return gval(n);
+}
+
+#else
+
 /**
  * @brief 在哈希表中查找空闲位置
  * @param t 要搜索的表
@@ -1125,7 +1921,7 @@ static Node *getfreepos(Table *t) {
  * - 动态调整链表结构以维护不变式
  *
  * 空间不足处理：
- * 如果找不到空闲位置，触发重哈希操作，然后重新插入。
+ * 如果找不到空闲位置返回NULL，由newkey重哈希后重新插入。
  *
  * 性能保证：
  * - 平均查找时间：O(1)
@@ -1143,9 +1939,9 @@ static Node *getfreepos(Table *t) {
  * @post 键被插入表中，返回值位置的指针
  *
  * @note 这是Brent变种散列算法的经典实现
- * @see mainposition(), getfreepos(), rehash()
+ * @see mainposition(), getfreepos(), newkey()
  */
-static TValue *newkey(lua_State *L, Table *t, const TValue *key) {
+static TValue *insertkey(lua_State *L, Table *t, const TValue *key) {
     Node *mp = mainposition(t, key);    // 计算键的主位置
 
     // 检查主位置是否被占用或者是虚拟节点
@@ -1154,9 +1950,7 @@ static TValue *newkey(lua_State *L, Table *t, const TValue *key) {
         Node *n = getfreepos(t);    // 获取空闲位置
 
         if (n == NULL) {
-            // 没有空闲位置，需要重哈希
-            rehash(L, t, key);
-            return luaH_set(L, t, key);    // 在扩展后的表中重新插入
+            return NULL;    // 没有空闲位置，需要重哈希
         }
 
         lua_assert(n != dummynode);
@@ -1192,8 +1986,7 @@ static TValue *newkey(lua_State *L, Table *t, const TValue *key) {
     }
 
     // 设置新键
-    gkey(mp)->value = key->value;
-    gkey(mp)->tt = key->tt;
+    copy_(gkey(mp), key);
 
     // 垃圾回收屏障
     luaC_barriert(L, t, key);
@@ -1202,6 +1995,203 @@ static TValue *newkey(lua_State *L, Table *t, const TValue *key) {
     return gval(mp);    // 返回值的位置
 }
 
+#if defined(LUA_USE_INCREHASH)
+
+// ============================================================================
+// 增量重哈希：大表的重哈希分摊到后续的插入中
+// ============================================================================
+
+/* 正在初始化新数组或迁移旧数组 */
+#define incrbusy(t) ((t)->incrstate == INCR_INIT || (t)->incrstate == INCR_MOVE)
+
+/**
+ * @brief 开始增量重哈希
+ * @param L Lua状态机指针
+ * @param t 哈希部分的空闲节点快用完的大表
+ * @return 如果已经一次完成了重哈希则返回1，否则返回0
+ *
+ * 详细说明：
+ * 像rehash一样统计键数。数组部分的大小要变或者新的哈希部分不够大时
+ * 直接resize；否则只分配新的节点数组，进入INCR_INIT。新数组除了现有
+ * 的键，还要容纳旧数组用完之前（最多四分之一）和迁移期间插入的键。
+ */
+static int incrstart(lua_State *L, Table *t) {
+    int nums[MAXBITS + 1];
+    int i, nasize, na, totaluse, lsize;
+
+    for (i = 0; i <= MAXBITS; i++) {
+        nums[i] = 0;
+    }
+    nasize = numusearray(t, nums);
+    totaluse = nasize + numusehash(t, nums, &nasize);
+    na = computesizes(nums, &nasize);
+    lsize = ceillog2(totaluse - na + sizenode(t) / 4 +
+                     sizenode(t) / LUAI_INCREHASHSTEP + 1);
+    if (nasize != t->sizearray || lsize < LUAI_INCREHASHBITS) {
+        resize(L, t, nasize, totaluse - na + 1);
+        return 1;
+    }
+    if (lsize > MAXBITS) {
+        luaG_runerror(L, "table overflow");
+    }
+    t->incrnode = luaM_newvector(L, twoto(lsize), Node);
+    t->incrlsize = cast_byte(lsize);
+    t->incrpos = 0;
+    t->incrstate = INCR_INIT;
+    return 0;
+}
+
+/**
+ * @brief 增量重哈希来不及完成时的退路
+ *
+ * 迁移途中新数组已满（迁移期间删除又插入了太多键）时，按两个数组中
+ * 的实际键数分配一个节点数组，一次重新插入全部键。
+ */
+static void incrflatten(lua_State *L, Table *t) {
+    Node *nnew = t->node;
+    Node *nold = t->incrnode;
+    int snew = sizenode(t);
+    int pos = t->incrpos;
+    int total = 0;
+    int i;
+
+    for (i = 0; i < snew; i++) {
+        total += !ttisnil(gval(&nnew[i]));
+    }
+    for (i = 0; i < pos; i++) {
+        total += !ttisnil(gval(&nold[i]));
+    }
+    setnodevector(L, t, total + 1);
+    for (i = 0; i < snew; i++) {
+        if (!ttisnil(gval(&nnew[i]))) {
+            TValue *v = insertkey(L, t, key2tval(&nnew[i]));
+            lua_assert(v != NULL);
+            setobjt2t(L, v, gval(&nnew[i]));
+        }
+    }
+    for (i = 0; i < pos; i++) {
+        if (!ttisnil(gval(&nold[i]))) {
+            TValue *v = insertkey(L, t, key2tval(&nold[i]));
+            lua_assert(v != NULL);
+            setobjt2t(L, v, gval(&nold[i]));
+        }
+    }
+    luaM_freearray(L, nnew, snew, Node);
+    luaM_freearray(L, nold, twoto(t->incrlsize), Node);
+    t->incrnode = NULL;
+    t->incrstate = INCR_NONE;
+}
+
+/**
+ * @brief 推进一步增量重哈希
+ *
+ * 详细说明：
+ * INCR_INIT时初始化新数组的4*LUAI_INCREHASHSTEP个节点，全部初始化后
+ * 新数组成为node，旧数组移到incrnode，进入INCR_MOVE。INCR_MOVE时从
+ * 后往前迁移LUAI_INCREHASHSTEP个旧节点：值不为nil的键值对插入新数组，
+ * 经过的节点键和值都置为nil（冲突链保持不变，剩下的旧节点照常查找）。
+ * 全部迁移后释放旧数组。
+ */
+static void incrstep(lua_State *L, Table *t) {
+    int k;
+
+    if (t->incrstate == INCR_INIT) {
+        int size = twoto(t->incrlsize);
+        for (k = 4 * LUAI_INCREHASHSTEP; k > 0 && t->incrpos < size; k--) {
+            Node *n = &t->incrnode[t->incrpos++];
+            gnext(n) = NULL;
+            setnilvalue(gkey(n));
+            setnilvalue(gval(n));
+        }
+        if (t->incrpos == size) {
+            Node *old = t->node;
+            int lold = t->lsizenode;
+            t->node = t->incrnode;
+            t->lsizenode = t->incrlsize;
+            t->lastfree = gnode(t, size);
+            t->incrnode = old;
+            t->incrlsize = cast_byte(lold);
+            t->incrpos = twoto(lold);
+            t->incrstate = INCR_MOVE;
+        }
+        return;
+    }
+
+    lua_assert(t->incrstate == INCR_MOVE);
+    for (k = LUAI_INCREHASHSTEP; k > 0 && t->incrpos > 0; k--) {
+        Node *o = &t->incrnode[t->incrpos - 1];
+        if (!ttisnil(gval(o))) {
+            TValue *v = insertkey(L, t, key2tval(o));
+            if (v == NULL) {
+                incrflatten(L, t);
+                return;
+            }
+            setobjt2t(L, v, gval(o));
+        }
+        setnilvalue(gkey(o));
+        setnilvalue(gval(o));
+        t->incrpos--;
+    }
+    if (t->incrpos == 0) {
+        luaM_freearray(L, t->incrnode, twoto(t->incrlsize), Node);
+        t->incrnode = NULL;
+        t->incrstate = INCR_NONE;
+    }
+}
+
+/**
+ * @brief 一次完成进行中的增量重哈希
+ */
+static void incrfinish(lua_State *L, Table *t) {
+    while (incrbusy(t)) {
+        incrstep(L, t);
+    }
+}
+
+#endif
+
+/**
+ * @brief 插入一个表中还没有的键
+ * @param L Lua状态机指针
+ * @param t 目标表
+ * @param key 要插入的键
+ * @return 指向新键对应值位置的指针
+ *
+ * 详细说明：
+ * 哈希部分没有空闲节点时重哈希，再经过luaH_set重新插入（键可能因此
+ * 落入数组部分）。启用增量重哈希时，大表在这里开始和推进重哈希。
+ */
+static TValue *newkey(lua_State *L, Table *t, const TValue *key) {
+    TValue *v;
+
+#if defined(LUA_USE_INCREHASH)
+    if (incrbusy(t)) {
+        incrstep(L, t);
+    } else if (t->incrstate == INCR_NONE &&
+               t->lsizenode >= LUAI_INCREHASHBITS &&
+               t->lastfree - t->node < sizenode(t) / 4) {
+        if (incrstart(L, t)) {
+            return luaH_set(L, t, key);
+        }
+    }
+#endif
+    v = insertkey(L, t, key);
+    if (v == NULL) {
+#if defined(LUA_USE_INCREHASH)
+        if (incrbusy(t)) {
+            incrfinish(L, t);    // 旧数组在初始化完成前用完了
+            return luaH_set(L, t, key);
+        }
+#endif
+        // 没有空闲位置，需要重哈希
+        rehash(L, t, key);
+        return luaH_set(L, t, key);    // 在扩展后的表中重新插入
+    }
+    return v;
+}
+
+#endif
+
 
 /**
  * @brief 整数键的专用查找函数
@@ -1246,21 +2236,88 @@ const TValue *luaH_getnum(Table *t, int key) {
     } else {
         // 在哈希部分搜索
         lua_Number nk = cast_num(key);
+#if defined(LUA_USE_SWISSTABLE)
+        Node *n;
+        unsigned int h = numhash(nk);
+
+        swforeach(t, h, n, {
+            const TValue *k = key2tval(n);
+            if (ttisint(k) ? ivalue(k) == key
+                           : ttisfloat(k) && luai_numeq(fltvalue(k), nk)) {
+                return gval(n);
+            }
+        })
+#else
         Node *n = hashnum(t, nk);
 
         do {
-            // 检查键是否匹配
-            if (ttisnumber(gkey(n)) && luai_numeq(nvalue(gkey(n)), nk)) {
+            // 检查键是否匹配（键可能是整数子类型或浮点表示）
+            const TValue *k = key2tval(n);
+            if (ttisint(k) ? ivalue(k) == key
+                           : ttisfloat(k) && luai_numeq(fltvalue(k), nk)) {
                 return gval(n);    // 找到了
             } else {
                 n = gnext(n);
             }
         } while (n);
+#endif
+#if defined(LUA_USE_INCREHASH)
+        if (t->incrstate == INCR_MOVE) {
+            Table o;
+            return luaH_getnum(oldview(t, &o), key);
+        }
+#endif
 
         return luaO_nilobject;    // 未找到
     }
 }
 
+/**
+ * @brief 长字符串键的查找
+ *
+ * 详细说明：
+ * 第一次查找时计算key的哈希值。表中的键插入时都已经算过哈希值，
+ * 所以链上的键先比较指针，再比较哈希值和长度，都相同才比较内容。
+ */
+static const TValue *getlngstr(Table *t, TString *key) {
+    unsigned int h = luaS_hashstr(key);
+#if defined(LUA_USE_SWISSTABLE)
+    Node *n;
+
+    swforeach(t, h, n,
+        if (ttisstring(gkey(n))) {
+            TString *k = rawtsvalue(gkey(n));
+            lua_assert(k->tsv.hashed);
+            if (k == key || (k->tsv.hash == h && k->tsv.len == key->tsv.len &&
+                             memcmp(getstr(k), getstr(key), key->tsv.len) == 0)) {
+                return gval(n);
+            }
+        })
+#else
+    Node *n = hashpow2(t, h);
+
+    do {
+        if (ttisstring(gkey(n))) {
+            TString *k = rawtsvalue(gkey(n));
+            lua_assert(k->tsv.hashed);
+            if (k == key || (k->tsv.hash == h && k->tsv.len == key->tsv.len &&
+                             memcmp(getstr(k), getstr(key), key->tsv.len) == 0)) {
+                return gval(n);
+            }
+        }
+        n = gnext(n);
+    } while (n);
+#endif
+#if defined(LUA_USE_INCREHASH)
+    if (t->incrstate == INCR_MOVE) {
+        Table o;
+        return getlngstr(oldview(t, &o), key);
+    }
+#endif
+
+    return luaO_nilobject;
+}
+
 /**
  * @brief 字符串键的专用查找函数
  * @param t 要搜索的表
@@ -1291,11 +2348,25 @@ const TValue *luaH_getnum(Table *t, int key) {
  * @pre t必须是有效的表指针，key必须是有效的字符串指针
  * @post 返回找到的值或nil对象
  *
+ * 长字符串不内部化，交给getlngstr按内容比较。
+ *
  * @note 利用了字符串内部化的优势
  * @see hashstr(), luaH_get()
  */
 const TValue *luaH_getstr(Table *t, TString *key) {
-    Node *n = hashstr(t, key);    // 使用字符串的预计算哈希值
+    Node *n;
+
+    if (islngstr(key)) {
+        return getlngstr(t, key);
+    }
+#if defined(LUA_USE_SWISSTABLE)
+    swforeach(t, key->tsv.hash, n,
+        if (ttisstring(gkey(n)) && rawtsvalue(gkey(n)) == key) {
+            return gval(n);
+        })
+    return luaO_nilobject;
+#else
+    n = hashstr(t, key);    // 使用字符串的预计算哈希值
 
     do {
         // 检查是否为字符串且指针相等（内部化字符串的优势）
@@ -1305,8 +2376,68 @@ const TValue *luaH_getstr(Table *t, TString *key) {
             n = gnext(n);
         }
     } while (n);
+#if defined(LUA_USE_INCREHASH)
+    if (t->incrstate == INCR_MOVE) {
+        Table o;
+        return luaH_getstr(oldview(t, &o), key);
+    }
+#endif
 
     return luaO_nilobject;    // 未找到
+#endif
+}
+
+
+/**
+ * @brief 带槽位提示的字符串键查找
+ * @param t 要搜索的表
+ * @param key 要查找的字符串键
+ * @param hint 槽位提示（内联缓存项），查找成功时被更新
+ * @return 找到的值指针，如果未找到则返回nil对象
+ *
+ * 详细说明：
+ * 先直接检查提示所指的节点，键相同即命中；否则退回luaH_getstr的
+ * 哈希链遍历，找到后把节点下标写回提示。
+ *
+ * 提示总是经过校验：下标按当前节点数组大小取模，并比较节点中的键，
+ * 所以表被rehash或resize之后旧提示最多造成一次未命中，不会返回错误值。
+ * 同一条指令访问不同的表时（例如对象和它的类），提示会跟随最近一次
+ * 找到键的那个表。
+ *
+ * @see luaH_getstr(), luaF_initcache()
+ */
+const TValue *luaH_getstrhint(Table *t, TString *key, int *hint) {
+    Node *n = gnode(t, lmod(*hint, sizenode(t)));
+
+    if (ttisstring(gkey(n)) && rawtsvalue(gkey(n)) == key)
+        return gval(n);    // 命中缓存
+
+    if (islngstr(key))
+        return getlngstr(t, key);
+#if defined(LUA_USE_SWISSTABLE)
+    swforeach(t, key->tsv.hash, n,
+        if (ttisstring(gkey(n)) && rawtsvalue(gkey(n)) == key) {
+            *hint = cast_int(n - t->node);    // 记录槽位
+            return gval(n);
+        })
+#else
+    n = hashstr(t, key);
+    do {
+        if (ttisstring(gkey(n)) && rawtsvalue(gkey(n)) == key) {
+            *hint = cast_int(n - t->node);    // 记录槽位
+            return gval(n);
+        }
+        n = gnext(n);
+    } while (n);
+#endif
+#if defined(LUA_USE_INCREHASH)
+    if (t->incrstate == INCR_MOVE) {
+        Table o;
+        return luaH_getstr(oldview(t, &o), key);    // 旧节点的槽位不记录
+    }
+#endif
+
+    return luaO_nilobject;
 }
 
 
@@ -1356,6 +2487,9 @@ const TValue *luaH_get(Table *t, const TValue *key) {
         case LUA_TSTRING:
             return luaH_getstr(t, rawtsvalue(key));    // 使用字符串专用函数
 
+        case LUA_TINT:
+            return luaH_getnum(t, ivalue(key));    // 整数子类型无需转换
+
         case LUA_TNUMBER: {
             int k;
             lua_Number n = nvalue(key);
@@ -1370,6 +2504,14 @@ const TValue *luaH_get(Table *t, const TValue *key) {
 
         default: {
             // 通用哈希查找
+#if defined(LUA_USE_SWISSTABLE)
+            Node *n;
+            unsigned int h = hashkey(key);
+            swforeach(t, h, n,
+                if (luaO_rawequalObj(key2tval(n), key)) {
+                    return gval(n);
+                })
+#else
             Node *n = mainposition(t, key);
             do {
                 // 检查键是否匹配
@@ -1379,6 +2521,13 @@ const TValue *luaH_get(Table *t, const TValue *key) {
                     n = gnext(n);
                 }
             } while (n);
+#endif
+#if defined(LUA_USE_INCREHASH)
+            if (t->incrstate == INCR_MOVE) {
+                Table o;
+                return luaH_get(oldview(t, &o), key);
+            }
+#endif
 
             return luaO_nilobject;    // 未找到
         }
@@ -1490,7 +2639,7 @@ TValue *luaH_setnum(lua_State *L, Table *t, int key) {
     } else {
         // 创建新键
         TValue k;
-        setnvalue(&k, cast_num(key));
+        setivalue(&k, key);
         return newkey(L, t, &k);
     }
 }
@@ -1640,14 +2789,21 @@ static int unbound_search(Table *t, unsigned int j) {
  * 如果边界不在数组部分，需要在哈希部分搜索。
  * 使用unbound_search函数处理这种情况。
  *
+ * 长度缓存：
+ * 搜索的结果记在lenhint中。下次先检查它、它加一和它减一是不是边界，
+ * 只需要两三次取值，所以t[#t+1] = v这样的追加和t[#t] = nil这样的
+ * 删除循环每次都是O(1)。写入不经过本文件（虚拟机直接写数组部分），
+ * 所以lenhint只是提示，每次使用前都重新验证。
+ *
  * 性能特征：
+ * - 边界在上次结果附近：O(1)
  * - 数组部分边界：O(log(数组大小))
  * - 哈希部分边界：O(log(边界位置))
  * - 空哈希部分：O(1)
  *
  * 语义注意：
  * 表的长度在有"洞"（nil值）的情况下可能不唯一，
- * 但算法会找到一个有效的边界。
+ * 但算法会找到一个有效的边界；有洞时可能是缓存的那个边界。
  *
  * @pre t必须是有效的表指针
  * @post 返回表的长度（边界位置）
@@ -1657,6 +2813,24 @@ static int unbound_search(Table *t, unsigned int j) {
  */
 int luaH_getn(Table *t) {
     unsigned int j = t->sizearray;
+    int h = (t->lenhint < MAX_INT - 1) ? t->lenhint : 0;    // h + 2不溢出
+
+    // 数组部分满且哈希部分为空，很简单
+    if ((j == 0 || !ttisnil(&t->array[j - 1])) && t->node == dummynode) {
+        return j;
+    }
+
+    // 验证上次的结果及其两侧
+    if (h == 0 || !ttisnil(luaH_getnum(t, h))) {
+        if (ttisnil(luaH_getnum(t, h + 1))) {
+            return h;
+        }
+        if (ttisnil(luaH_getnum(t, h + 2))) {
+            return t->lenhint = h + 1;    // 追加了一个元素
+        }
+    } else if (h == 1 || !ttisnil(luaH_getnum(t, h - 1))) {
+        return t->lenhint = h - 1;    // 删除了最后一个元素
+    }
 
     if (j > 0 && ttisnil(&t->array[j - 1])) {
         // 数组部分存在边界：二分搜索定位
@@ -1669,15 +2843,10 @@ int luaH_getn(Table *t) {
                 i = m;
             }
         }
-        return i;
+        return t->lenhint = cast_int(i);
     }
     // 否则必须在哈希部分查找边界
-    else if (t->node == dummynode) {
-        // 哈希部分为空，很简单
-        return j;
-    } else {
-        return unbound_search(t, j);
-    }
+    return t->lenhint = unbound_search(t, j);
 }
 
 // ============================================================================
@@ -1695,7 +2864,12 @@ int luaH_getn(Table *t) {
  * 这是mainposition函数的调试接口，用于测试和调试目的。
  */
 Node *luaH_mainposition(const Table *t, const TValue *key) {
+#if defined(LUA_USE_SWISSTABLE)
+    // 探测开始的组的第一个槽位
+    return gnode(t, (swh1(hashkey(key)) & swgmask(t)) * SW_GROUP);
+#else
     return mainposition(t, key);
+#endif
 }
 
 /**
@@ -167,7 +167,9 @@
  * @note next值0表示没有下一个节点（链表结束）
  * @see luaH_mainposition() 获取键的主位置
  */
+#if !defined(LUA_USE_SWISSTABLE)
 #define gnext(n)    ((n)->i_key.nk.next)
+#endif
 
 /**
  * @brief 键转TValue：将节点的键转换为TValue表示
@@ -182,6 +184,20 @@
  */
 #define key2tval(n)    (&(n)->i_key.tvk)
 
+#if defined(LUA_USE_INCREHASH)
+/**
+ * @brief 增量重哈希的状态（Table.incrstate）
+ *
+ * 只有INCR_MOVE时表的内容分布在两个节点数组中：node是新数组，
+ * incrnode的前incrpos个节点是还没有迁移的旧节点，已迁移的节点键和值
+ * 都是nil。垃圾回收器遍历表时要同时遍历这部分旧节点。
+ */
+#define INCR_NONE   0   /* 没有进行中的重哈希 */
+#define INCR_INIT   1   /* incrnode是正在初始化的新数组，前incrpos个节点已初始化 */
+#define INCR_MOVE   2   /* incrnode是正在迁移的旧数组 */
+#define INCR_HOLD   3   /* resize正在重新插入，暂不开始增量重哈希 */
+#endif
+
 /**
  * @brief 数值键查找：在表中查找指定的数值键
  * 
@@ -278,6 +294,22 @@ LUAI_FUNC TValue *luaH_setnum(lua_State *L, Table *t, int key);
  */
 LUAI_FUNC const TValue *luaH_getstr(Table *t, TString *key);
 
+/**
+ * @brief 带槽位提示的字符串键查找
+ *
+ * 详细说明：
+ * 虚拟机内联缓存使用的查找入口。先校验提示槽位，未命中时遍历哈希链，
+ * 并在找到键时更新提示。语义与luaH_getstr完全相同。
+ *
+ * @param t 目标表
+ * @param key 字符串键
+ * @param hint 槽位提示，可能被更新
+ * @return 值指针，未找到时返回luaO_nilobject
+ *
+ * @see luaH_getstr(), luaF_initcache()
+ */
+LUAI_FUNC const TValue *luaH_getstrhint(Table *t, TString *key, int *hint);
+
 /**
  * @brief 字符串键设置：设置或创建指定字符串键的值槽
  * 
@@ -530,6 +562,46 @@ LUAI_FUNC void luaH_resizearray(lua_State *L, Table *t, int nasize);
  */
 LUAI_FUNC void luaH_free(lua_State *L, Table *t);
 
+/**
+ * @brief 清空表：值全部置为nil，保留数组部分和哈希部分的内存
+ *
+ * table.clear和lua_cleartable的实现。
+ *
+ * @param L Lua状态机指针
+ * @param t 要清空的表
+ * @see luaH_free()
+ */
+LUAI_FUNC void luaH_clear(lua_State *L, Table *t);
+
+/**
+ * @brief 复制整数键区间：a2[t..t+e-f] = a1[f..e]
+ *
+ * table.move和lua_movetable的实现。原始读写，不调用元方法；两个区间
+ * 都在数组部分时整块复制。
+ *
+ * @param L Lua状态机指针
+ * @param a1 源表
+ * @param f 源区间起点
+ * @param e 源区间终点（f <= e）
+ * @param t 目标区间起点
+ * @param a2 目标表，可以与a1相同
+ */
+LUAI_FUNC void luaH_move(lua_State *L, Table *a1, int f, int e, int t,
+                         Table *a2);
+
+/**
+ * @brief 直接排序数组部分中的t[1..n]
+ *
+ * table.sort没有比较函数时的快速路径（lua_sortarray）。元素必须都在
+ * 数组部分，并且全是数字（没有NaN）或全是字符串。
+ *
+ * @param L Lua状态机指针
+ * @param t 要排序的表
+ * @param n 元素个数
+ * @return 排好了返回1；条件不满足时返回0，表不变
+ */
+LUAI_FUNC int luaH_sort(lua_State *L, Table *t, int n);
+
 /**
  * @brief 表迭代：获取表中指定键的下一个键值对
  * 
@@ -51,6 +51,7 @@
  * @see lua.h, lauxlib.h, lualib.h
  */
 
+#include <limits.h>
 #include <stddef.h>
 
 #define ltablib_c
@@ -622,6 +623,82 @@ static int tremove (lua_State *L) {
 
 /** @} */ /* 结束表修改操作文档组 */
 
+/**
+ * @defgroup TableReuse 表的预分配与复用
+ * @brief 预先分配大小、清空后复用和整段复制
+ *
+ * 热路径上可以预先分配好表，用完清空后继续使用，避免每次请求都分配
+ * 新表、再交给垃圾回收器。
+ * @{
+ */
+
+/**
+ * @brief 创建预先分配了大小的表
+ *
+ * table.new(narray, nhash)：数组部分预留narray个元素，哈希部分预留
+ * nhash个节点。两个参数都可以省略（默认为0）。
+ *
+ * @param L Lua状态机指针
+ * @return 1（新表）
+ * @see lua_createtable
+ */
+static int tnew (lua_State *L) {
+    int narray = luaL_optint(L, 1, 0);
+    int nhash = luaL_optint(L, 2, 0);
+    luaL_argcheck(L, narray >= 0, 1, "negative size");
+    luaL_argcheck(L, nhash >= 0, 2, "negative size");
+    lua_createtable(L, narray, nhash);
+    return 1;
+}
+
+/**
+ * @brief 清空表，保留已分配的内存
+ *
+ * table.clear(t)：删除所有键，数组部分和哈希部分的大小不变，之后重新
+ * 填入不超过原来数量的元素不需要分配内存。元表不变。不能在遍历t的
+ * 过程中调用。
+ *
+ * @param L Lua状态机指针
+ * @return 0
+ * @see lua_cleartable
+ */
+static int tclear (lua_State *L) {
+    luaL_checktype(L, 1, LUA_TTABLE);
+    lua_cleartable(L, 1);
+    return 0;
+}
+
+/**
+ * @brief 复制一段元素
+ *
+ * table.move(a1, f, e, t [,a2])：a2[t..t+e-f] = a1[f..e]，a2默认为a1，
+ * 返回a2。区间可以重叠。与本库的其他函数一样使用原始读写，不调用
+ * 元方法；两个区间都在数组部分时整块复制。
+ *
+ * @param L Lua状态机指针
+ * @return 1（目标表）
+ * @see lua_movetable
+ */
+static int tmove (lua_State *L) {
+    int f = luaL_checkint(L, 2);
+    int e = luaL_checkint(L, 3);
+    int t = luaL_checkint(L, 4);
+    int tt = !lua_isnoneornil(L, 5) ? 5 : 1;  /* 目标表 */
+    luaL_checktype(L, 1, LUA_TTABLE);
+    luaL_checktype(L, tt, LUA_TTABLE);
+    if (e >= f) {  /* 否则没有要复制的元素 */
+        luaL_argcheck(L, f > 0 || e < INT_MAX + f, 3,
+                      "too many elements to move");
+        luaL_argcheck(L, t <= INT_MAX - (e - f), 4,
+                      "destination wrap around");
+        lua_movetable(L, 1, f, e, t, tt);
+    }
+    lua_pushvalue(L, tt);
+    return 1;
+}
+
+/** @} */ /* 结束表的预分配与复用文档组 */
+
 /**
  * @defgroup TableConcatenation 表连接操作
  * @brief 表元素的字符串连接和缓冲区管理
@@ -775,15 +852,16 @@ static int tconcat (lua_State *L) {
  * @defgroup QuickSortAlgorithm 快速排序算法实现
  * @brief 高效的表排序算法和比较函数支持
  *
- * 快速排序算法实现基于Robert Sedgewick的《Algorithms in MODULA-3》
- * (Addison-Wesley, 1993)，提供了高效的表排序功能。
+ * 模式消除快速排序（pdqsort，Orson Peters），提供了高效的表排序功能。
  *
  * 算法特点：
  * - 平均时间复杂度：O(n log n)
- * - 最坏时间复杂度：O(n²)
- * - 空间复杂度：O(log n)（尾递归优化）
+ * - 最坏时间复杂度：O(n log n)（退化时改用堆排序）
+ * - 已经有序、逆序或大量重复的输入接近线性
+ * - 空间复杂度：O(log n)（只递归较短的一边）
  * - 原地排序算法
  * - 支持自定义比较函数
+ * - 没有比较函数时，数字或字符串数组直接在数组部分排序（lua_sortarray）
  * @{
  */
 
@@ -908,77 +986,253 @@ static int sort_comp (lua_State *L, int a, int b) {
         return lua_lessthan(L, a, b);
 }
 
-static void auxsort (lua_State *L, int l, int u) {
-  while (l < u) {  /* for tail recursion */
-    int i, j;
-    /* sort elements a[l], a[(l+u)/2] and a[u] */
-    lua_rawgeti(L, 1, l);
-    lua_rawgeti(L, 1, u);
-    if (sort_comp(L, -1, -2))  /* a[u] < a[l]? */
-      set2(L, l, u);  /* swap a[l] - a[u] */
-    else
-      lua_pop(L, 2);
-    if (u-l == 1) break;  /* only 2 elements */
-    i = (l+u)/2;
+/*
+** 下面是模式消除快速排序（pdqsort）：九数取中选枢轴；枢轴等于左边界外
+** 的元素时把等于枢轴的元素一次划分出去；划分没有交换时试探插入排序；
+** 划分不平衡时打乱几个元素，不平衡次数超过log2(n)后改用堆排序。
+** 元素通过lua_rawgeti/lua_rawseti访问，区间都是半开的[lo, hi)。
+** 与ltable.c中数组部分的快速路径是同一个算法，区间阈值都取自luaconf.h
+** 中的LUAI_SORT*，修改任何一边的划分或退路逻辑时两边要一起改。
+*/
+
+static void sorterror (lua_State *L) {
+    luaL_error(L, "invalid order function for sorting");
+}
+
+/* a[i] < a[j]? */
+static int lessij (lua_State *L, int i, int j) {
+    int res;
+    lua_rawgeti(L, 1, i);
+    lua_rawgeti(L, 1, j);
+    res = sort_comp(L, -2, -1);
+    lua_pop(L, 2);
+    return res;
+}
+
+/* a[i] < P?（枢轴P在栈顶） */
+static int lessp (lua_State *L, int i) {
+    int res;
+    lua_rawgeti(L, 1, i);
+    res = sort_comp(L, -1, -2);
+    lua_pop(L, 1);
+    return res;
+}
+
+/* P < a[i]?（枢轴P在栈顶） */
+static int plessi (lua_State *L, int i) {
+    int res;
     lua_rawgeti(L, 1, i);
-    lua_rawgeti(L, 1, l);
-    if (sort_comp(L, -2, -1))  /* a[i]<a[l]? */
-      set2(L, i, l);
+    res = sort_comp(L, -2, -1);
+    lua_pop(L, 1);
+    return res;
+}
+
+static void swapij (lua_State *L, int i, int j) {
+    lua_rawgeti(L, 1, i);
+    lua_rawgeti(L, 1, j);
+    set2(L, i, j);
+}
+
+/* 插入排序[lo, hi)；移动的元素超过limit个时放弃并返回0 */
+static int inssort (lua_State *L, int lo, int hi, int limit) {
+    int i, moved = 0;
+    for (i = lo + 1; i < hi; i++) {
+        int j = i;
+        lua_rawgeti(L, 1, i);  /* x = a[i] */
+        while (j > lo) {
+            lua_rawgeti(L, 1, j - 1);
+            if (!sort_comp(L, -2, -1)) {  /* x < a[j-1]? */
+                lua_pop(L, 1);
+                break;
+            }
+            lua_rawseti(L, 1, j);  /* a[j] = a[j-1] */
+            j--;
+        }
+        if (j != i)
+            lua_rawseti(L, 1, j);  /* a[j] = x */
+        else
+            lua_pop(L, 1);
+        moved += i - j;
+        if (moved > limit) return 0;
+    }
+    return 1;
+}
+
+/* 把a[i]、a[j]、a[k]排成非降序 */
+static void sort3 (lua_State *L, int i, int j, int k) {
+    if (lessij(L, j, i)) swapij(L, i, j);
+    if (lessij(L, k, j)) {
+        swapij(L, j, k);
+        if (lessij(L, j, i)) swapij(L, i, j);
+    }
+}
+
+/*
+** 以a[lo]为枢轴P划分[lo, hi)，返回P的最终位置p：
+** a[lo..p-1] < P <= a[p+1..hi-1]。划分前已经是划分好的（没有交换）时*done置为1。一致的比较函数不会让
+** 扫描越过区间两端，越过时报错。
+*/
+static int partright (lua_State *L, int lo, int hi, int *done) {
+    int first = lo, last = hi;
+    lua_rawgeti(L, 1, lo);  /* P */
+    while (++first < hi && lessp(L, first)) {}
+    if (first == hi) sorterror(L);
+    if (first - 1 == lo) {
+        while (first < last && !lessp(L, --last)) {}
+    }
     else {
-      lua_pop(L, 1);  /* remove a[l] */
-      lua_rawgeti(L, 1, u);
-      if (sort_comp(L, -1, -2))  /* a[u]<a[i]? */
-        set2(L, i, u);
-      else
-        lua_pop(L, 2);
+        while (--last > lo && !lessp(L, last)) {}
+        if (last == lo) sorterror(L);
     }
-    if (u-l == 2) break;  /* only 3 elements */
-    lua_rawgeti(L, 1, i);  /* Pivot */
-    lua_pushvalue(L, -1);
-    lua_rawgeti(L, 1, u-1);
-    set2(L, i, u-1);
-    /* a[l] <= P == a[u-1] <= a[u], only need to sort from l+1 to u-2 */
-    i = l; j = u-1;
-    for (;;) {  /* invariant: a[l..i] <= P <= a[j..u] */
-      /* repeat ++i until a[i] >= P */
-      while (lua_rawgeti(L, 1, ++i), sort_comp(L, -1, -2)) {
-        if (i>u) luaL_error(L, "invalid order function for sorting");
-        lua_pop(L, 1);  /* remove a[i] */
-      }
-      /* repeat --j until a[j] <= P */
-      while (lua_rawgeti(L, 1, --j), sort_comp(L, -3, -1)) {
-        if (j<l) luaL_error(L, "invalid order function for sorting");
-        lua_pop(L, 1);  /* remove a[j] */
-      }
-      if (j<i) {
-        lua_pop(L, 3);  /* pop pivot, a[i], a[j] */
-        break;
-      }
-      set2(L, i, j);
+    *done = (first >= last);
+    while (first < last) {
+        swapij(L, first, last);
+        while (++first < hi && lessp(L, first)) {}
+        while (--last > lo && !lessp(L, last)) {}
+        if (first == hi || last == lo) sorterror(L);
     }
-    lua_rawgeti(L, 1, u-1);
-    lua_rawgeti(L, 1, i);
-    set2(L, u-1, i);  /* swap pivot (a[u-1]) with a[i] */
-    /* a[l..i-1] <= a[i] == P <= a[i+1..u] */
-    /* adjust so that smaller half is in [j..i] and larger one in [l..u] */
-    if (i-l < u-i) {
-      j=l; i=i-1; l=i+2;
+    lua_pop(L, 1);  /* P */
+    swapij(L, lo, first - 1);
+    return first - 1;
+}
+
+/*
+** 以a[lo]为枢轴P划分[lo, hi)，等于P的元素放到左边。
+** 返回P的最终位置p：a[lo..p] <= P < a[p+1..hi-1]。
+*/
+static int partleft (lua_State *L, int lo, int hi) {
+    int first = lo, last = hi;
+    lua_rawgeti(L, 1, lo);  /* P */
+    while (--last > lo && plessi(L, last)) {}
+    if (last + 1 == hi) {
+        while (first < last && !plessi(L, ++first)) {}
     }
     else {
-      j=i+1; i=u; u=j-2;
+        while (++first < hi && !plessi(L, first)) {}
+        if (first == hi) sorterror(L);
+    }
+    while (first < last) {
+        swapij(L, first, last);
+        while (--last > lo && plessi(L, last)) {}
+        while (++first < hi && !plessi(L, first)) {}
+        if (first == hi) sorterror(L);
+    }
+    lua_pop(L, 1);  /* P */
+    swapij(L, lo, last);
+    return last;
+}
+
+/* 把a[lo+i]下沉到大小为n、从lo开始的最大堆中的位置 */
+static void sift (lua_State *L, int lo, int i, int n) {
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= n) break;
+        if (c + 1 < n && lessij(L, lo + c, lo + c + 1)) c++;
+        if (!lessij(L, lo + i, lo + c)) break;
+        swapij(L, lo + i, lo + c);
+        i = c;
+    }
+}
+
+/* 堆排序[lo, hi)，划分一直不平衡时的退路 */
+static void heapsort (lua_State *L, int lo, int hi) {
+    int n = hi - lo;
+    int i;
+    for (i = n / 2 - 1; i >= 0; i--)
+        sift(L, lo, i, n);
+    for (i = n - 1; i > 0; i--) {
+        swapij(L, lo, lo + i);
+        sift(L, lo, 0, i);
+    }
+}
+
+/*
+** pdqsort的主循环。bad是还允许的不平衡划分次数；leftmost为0时a[lo-1]
+** 不大于区间中的任何元素。只递归较短的一边，C栈深度O(log n)。
+*/
+static void auxsort (lua_State *L, int lo, int hi, int bad, int leftmost) {
+    for (;;) {
+        int size = hi - lo;
+        int s2 = size / 2;
+        int p, lsize, rsize, done;
+        if (size < LUAI_SORTINSERTION) {
+            inssort(L, lo, hi, INT_MAX);
+            return;
+        }
+        /* 枢轴放到a[lo] */
+        if (size > LUAI_SORTNINTHER) {
+            sort3(L, lo, lo + s2, hi - 1);
+            sort3(L, lo + 1, lo + s2 - 1, hi - 2);
+            sort3(L, lo + 2, lo + s2 + 1, hi - 3);
+            sort3(L, lo + s2 - 1, lo + s2, lo + s2 + 1);
+            swapij(L, lo, lo + s2);
+        }
+        else
+            sort3(L, lo + s2, lo, hi - 1);
+        /* 上一个枢轴a[lo-1]不小于枢轴：等于枢轴的元素已经到位 */
+        if (!leftmost && !lessij(L, lo - 1, lo)) {
+            lo = partleft(L, lo, hi) + 1;
+            continue;
+        }
+        p = partright(L, lo, hi, &done);
+        lsize = p - lo;
+        rsize = hi - (p + 1);
+        if (lsize < size / 8 || rsize < size / 8) {  /* 不平衡的划分 */
+            if (--bad == 0) {
+                heapsort(L, lo, hi);
+                return;
+            }
+            if (lsize >= LUAI_SORTINSERTION) {  /* 打乱几个元素 */
+                swapij(L, lo, lo + lsize / 4);
+                swapij(L, p - 1, p - lsize / 4);
+                if (lsize > LUAI_SORTNINTHER) {
+                    swapij(L, lo + 1, lo + lsize / 4 + 1);
+                    swapij(L, lo + 2, lo + lsize / 4 + 2);
+                    swapij(L, p - 2, p - lsize / 4 - 1);
+                    swapij(L, p - 3, p - lsize / 4 - 2);
+                }
+            }
+            if (rsize >= LUAI_SORTINSERTION) {
+                swapij(L, p + 1, p + 1 + rsize / 4);
+                swapij(L, hi - 1, hi - rsize / 4);
+                if (rsize > LUAI_SORTNINTHER) {
+                    swapij(L, p + 2, p + 2 + rsize / 4);
+                    swapij(L, p + 3, p + 3 + rsize / 4);
+                    swapij(L, hi - 2, hi - 1 - rsize / 4);
+                    swapij(L, hi - 3, hi - 2 - rsize / 4);
+                }
+            }
+        }
+        else if (done && inssort(L, lo, p, LUAI_SORTPARTIAL) &&
+                 inssort(L, p + 1, hi, LUAI_SORTPARTIAL))
+            return;  /* 已经有序 */
+        if (lsize < rsize) {
+            auxsort(L, lo, p, bad, leftmost);
+            lo = p + 1;
+            leftmost = 0;
+        }
+        else {
+            auxsort(L, p + 1, hi, bad, 0);
+            hi = p;
+        }
     }
-    auxsort(L, j, i);  /* call recursively the smaller one */
-  }  /* repeat the routine for the larger one */
 }
 
 static int sort (lua_State *L) {
-  int n = aux_getn(L, 1);
-  luaL_checkstack(L, 40, "");  /* assume array is smaller than 2^40 */
-  if (!lua_isnoneornil(L, 2))  /* is there a 2nd argument? */
-    luaL_checktype(L, 2, LUA_TFUNCTION);
-  lua_settop(L, 2);  /* make sure there is two arguments */
-  auxsort(L, 1, n);
-  return 0;
+    int n = aux_getn(L, 1);
+    int bad = 0;
+    int i;
+    luaL_checkstack(L, 40, "");  /* assume array is smaller than 2^40 */
+    if (!lua_isnoneornil(L, 2))  /* is there a 2nd argument? */
+        luaL_checktype(L, 2, LUA_TFUNCTION);
+    lua_settop(L, 2);  /* make sure there is two arguments */
+    /* 没有比较函数时，数字或字符串数组直接在数组部分排序 */
+    if (lua_isnil(L, 2) && lua_sortarray(L, 1, n))
+        return 0;
+    for (i = n; i > 1; i >>= 1)
+        bad++;  /* log2(n) */
+    auxsort(L, 1, n + 1, bad, 1);
+    return 0;
 }
 
 /* }====================================================== */
@@ -994,6 +1248,9 @@ static const luaL_Reg tab_funcs[] = {
   {"remove", tremove},
   {"setn", setn},
   {"sort", sort},
+  {"new", tnew},
+  {"clear", tclear},
+  {"move", tmove},
   {NULL, NULL}
 };
 
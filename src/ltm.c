@@ -375,7 +375,7 @@ const TValue *luaT_gettmbyobj(lua_State *L, const TValue *o, TMS event) {
             mt = uvalue(o)->metatable;
             break;
         default:
-            mt = G(L)->mt[ttype(o)];
+            mt = G(L)->mt[basetype(o)];
     }
     return (mt ? luaH_getstr(mt, G(L)->tmname[event]) : luaO_nilobject);
 }
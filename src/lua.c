@@ -236,6 +236,9 @@ static void print_usage (void) {
     "  -l name  require library " LUA_QL("name") "\n"
     "  -i       enter interactive mode after executing " LUA_QL("script") "\n"
     "  -v       show version information\n"
+    "  -jon     enable the JIT compiler (default when built in)\n"
+    "  -joff    disable the JIT compiler\n"
+    "  -jhot=n  compile functions after n calls or loop iterations\n"
     "  --       stop handling options\n"
     "  -        execute stdin and stop handling options\n"
     ,
@@ -1179,6 +1182,8 @@ static int collectargs (char **argv, int *pi, int *pv, int *pe) {
                 notail(argv[i]);
                 *pv = 1;
                 break;
+            case 'j':  /* 参数紧跟在选项后面，由runargs解析 */
+                break;
             case 'e':
                 *pe = 1;  /* 继续执行 */
             case 'l':
@@ -1224,6 +1229,7 @@ static int collectargs (char **argv, int *pi, int *pv, int *pe) {
  * 处理的选项：
  * - "-e code"：执行Lua代码字符串
  * - "-l library"：加载Lua库
+ * - "-jon"/"-joff"/"-jhot=n"：JIT开关与热度阈值
  *
  * 执行流程：
  * 1. 遍历从1到n-1的所有参数
@@ -1278,6 +1284,20 @@ static int runargs (lua_State *L, char **argv, int n) {
                     return 1;  /* 如果文件失败则停止 */
                 break;
             }
+            case 'j': {
+                const char *opt = argv[i] + 2;
+                if (strcmp(opt, "on") == 0)
+                    lua_jit(L, LUA_JITON, 0);
+                else if (strcmp(opt, "off") == 0)
+                    lua_jit(L, LUA_JITOFF, 0);
+                else if (strncmp(opt, "hot=", 4) == 0 && atoi(opt + 4) > 0)
+                    lua_jit(L, LUA_JITHOT, atoi(opt + 4));
+                else {
+                    l_message(progname, "invalid JIT option");
+                    return 1;
+                }
+                break;
+            }
             default: break;
         }
     }
@@ -449,6 +449,23 @@ typedef LUA_INTEGER lua_Integer;
  */
 LUA_API lua_State *(lua_newstate) (lua_Alloc f, void *ud);
 
+/**
+ * @brief 创建使用分级内存池的Lua状态机
+ *
+ * 详细说明：
+ * 与lua_newstate相同，但小内存块由状态机自己的大小类分配，只有块区
+ * 和大块才调用f。是否使用内存池必须在创建时决定：释放时按块大小判断
+ * 内存块是否属于内存池。未启用LUA_USE_SLAB时等同于lua_newstate。
+ *
+ * @param[in] f 内存分配器函数指针
+ * @param[in] ud 用户数据指针，传递给分配器函数
+ *
+ * @return 成功时返回新的状态机指针，失败时返回NULL
+ *
+ * @see lua_newstate(), LUA_GCSLABUSED, LUAI_SLABMAX
+ */
+LUA_API lua_State *(lua_newslabstate) (lua_Alloc f, void *ud);
+
 /**
  * @brief 关闭并销毁Lua状态机：释放所有相关资源
  *
@@ -2163,6 +2180,62 @@ LUA_API void  (lua_rawset) (lua_State *L, int idx);
  */
 LUA_API void  (lua_rawseti) (lua_State *L, int idx, int n);
 
+/**
+ * @brief 清空表，保留已分配的内存
+ *
+ * 详细说明：
+ * 删除栈中指定位置的表的所有键，数组部分和哈希部分的大小不变，之后
+ * 重新填入不超过原来数量的元素不需要分配内存。元表不变。不能在遍历
+ * 这个表的过程中调用。
+ *
+ * @param[in] L Lua状态机指针，不能为NULL
+ * @param[in] idx 表的栈索引
+ *
+ * @note 不调用元方法，栈不变
+ * @see lua_createtable(), lua_movetable()
+ */
+LUA_API void  (lua_cleartable) (lua_State *L, int idx);
+
+/**
+ * @brief 复制表的一段整数键
+ *
+ * 详细说明：
+ * 执行a2[t..t+e-f] = a1[f..e]，a1和a2分别是idx1和idx2处的表，可以是
+ * 同一个表，区间可以重叠。原始读写，不调用元方法。两个区间都在各自的
+ * 数组部分时整块复制。调用者保证t+e-f不溢出。
+ *
+ * @param[in] L Lua状态机指针，不能为NULL
+ * @param[in] idx1 源表的栈索引
+ * @param[in] f 源区间起点
+ * @param[in] e 源区间终点，小于f时什么也不做
+ * @param[in] t 目标区间起点
+ * @param[in] idx2 目标表的栈索引
+ *
+ * @note 栈不变
+ * @see lua_rawseti(), lua_cleartable()
+ */
+LUA_API void  (lua_movetable) (lua_State *L, int idx1, int f, int e, int t,
+                               int idx2);
+
+/**
+ * @brief 按<直接排序表的t[1..n]
+ *
+ * 详细说明：
+ * 当t[1..n]都在表的数组部分、并且全是数字（没有NaN）或全是字符串时，
+ * 不经过栈和元方法直接排序并返回1。否则什么也不做，返回0，调用者需要
+ * 自己逐个比较（例如用lua_lessthan）。table.sort没有比较函数时先调用它。
+ *
+ * @param[in] L Lua状态机指针，不能为NULL
+ * @param[in] idx 表的栈索引
+ * @param[in] n 元素个数
+ *
+ * @return 排好了返回1，不适用时返回0
+ *
+ * @note 栈不变，不会抛出错误
+ * @see lua_lessthan(), lua_movetable()
+ */
+LUA_API int   (lua_sortarray) (lua_State *L, int idx, int n);
+
 /**
  * @brief 设置对象的元表
  *
@@ -2454,6 +2527,26 @@ LUA_API int   (lua_load) (lua_State *L, lua_Reader reader, void *dt,
  */
 LUA_API int (lua_dump) (lua_State *L, lua_Writer writer, void *data);
 
+/**
+ * @brief 输出堆分析报告
+ *
+ * 详细说明：
+ * 堆分析器（LUA_GCHEAPPROF）按分配时的调用栈汇总采样到的内存。报告
+ * 使用火焰图工具的folded格式，每个调用栈一行："外层;...;内层 字节数"，
+ * 通过writer逐行输出，可以直接交给flamegraph.pl或speedscope。
+ *
+ * @param[in] L Lua状态机
+ * @param[in] writer 写入器函数
+ * @param[in] data 传递给写入器的用户数据
+ * @param[in] what 0：存活内存（查找泄漏）；1：累计分配量
+ *
+ * @return writer返回的第一个非0值，全部成功时为0
+ *
+ * @see LUA_GCHEAPPROF, lua_Writer
+ */
+LUA_API int (lua_heapdump) (lua_State *L, lua_Writer writer, void *data,
+                            int what);
+
 /** @} */
 
 /**
@@ -2620,6 +2713,16 @@ LUA_API int  (lua_status) (lua_State *L);
 #define LUA_GCSTEP          5    /**< 执行一步增量垃圾回收 */
 #define LUA_GCSETPAUSE      6    /**< 设置垃圾回收暂停参数 */
 #define LUA_GCSETSTEPMUL    7    /**< 设置垃圾回收步长倍数 */
+#define LUA_GCGEN           8    /**< 切换到分代模式 */
+#define LUA_GCINC           9    /**< 切换到增量模式 */
+#define LUA_GCPARMARK       10   /**< 设置并行标记的辅助线程数 */
+#define LUA_GCBGFREE        11   /**< 开关清扫阶段的后台释放 */
+#define LUA_GCSLABSIZE      12   /**< 获取内存池第data个大小类的块大小 */
+#define LUA_GCSLABUSED      13   /**< 获取内存池第data个大小类使用中的块数 */
+#define LUA_GCSLABFREE      14   /**< 获取内存池第data个大小类空闲的块数 */
+#define LUA_GCSETBUDGET     15   /**< 设置每次步进的时间预算（微秒） */
+#define LUA_GCMAXSTEP       16   /**< 获取并清零最长步进时间（微秒） */
+#define LUA_GCHEAPPROF      17   /**< 设置堆分析器的采样间隔（字节） */
 /** @} */
 
 /**
@@ -2644,6 +2747,24 @@ LUA_API int  (lua_status) (lua_State *L);
  * - LUA_GCSTEP: 执行一步增量垃圾回收
  * - LUA_GCSETPAUSE: 设置垃圾回收暂停参数
  * - LUA_GCSETSTEPMUL: 设置垃圾回收步长倍数
+ * - LUA_GCGEN: 切换到分代模式，data大于0时同时设置次要回收间隔（百分比），
+ *   返回之前的模式（LUA_GCGEN或LUA_GCINC）
+ * - LUA_GCINC: 切换到增量模式，返回之前的模式
+ * - LUA_GCPARMARK: 设置并行标记的辅助线程数（0关闭，负数只查询），
+ *   返回之前的线程数；未启用LUA_USE_PARMARK时返回0
+ * - LUA_GCBGFREE: data大于0时把清扫阶段的释放交给后台线程，0关闭，
+ *   负数只查询，返回之前的状态（1或0）；未启用LUA_USE_BGFREE时返回0
+ * - LUA_GCSLABSIZE/LUA_GCSLABUSED/LUA_GCSLABFREE: 返回内存池第data个
+ *   大小类（从0开始）的块大小、使用中的块数和空闲链表中的块数；没有
+ *   这个大小类或状态机不使用内存池时返回0
+ * - LUA_GCSETBUDGET: 设置增量模式下每次步进的时间预算（微秒，0表示按
+ *   工作量步进，负数只查询），返回之前的预算
+ * - LUA_GCMAXSTEP: 返回上次查询以来最长一次步进的耗时（微秒）并清零；
+ *   data大于0时开始统计、负数时停止统计没有时间预算的步进，0不改变。
+ *   设置了时间预算的步进总是统计；没有预算也没有开启统计时luaC_step
+ *   不读时钟
+ * - LUA_GCHEAPPROF: data大于0时以data字节为平均采样间隔开启堆分析器，
+ *   0关闭，负数只查询，返回之前的间隔（未开启时为0）
  *
  * 参数说明：
  * - data参数的含义取决于what参数
@@ -2661,6 +2782,35 @@ LUA_API int  (lua_status) (lua_State *L);
  */
 LUA_API int (lua_gc) (lua_State *L, int what, int data);
 
+/**
+ * @name JIT控制常量
+ * @brief lua_jit的what参数
+ * @{
+ */
+#define LUA_JITOFF          0    /**< 停止编译，已编译的函数也回到解释执行 */
+#define LUA_JITON           1    /**< 恢复编译与机器码执行 */
+#define LUA_JITHOT          2    /**< 设置热度阈值（data > 0），返回旧值 */
+#define LUA_JITCOUNT        3    /**< 返回当前已编译的函数原型数量 */
+/** @} */
+
+/**
+ * @brief JIT控制函数
+ *
+ * 详细说明：
+ * 控制基线模板JIT（见luaconf.h中的LUA_USE_JIT）。JIT对整个状态机
+ * （包括所有协程）生效；设置了行钩子或计数钩子时机器码自动让位给
+ * 解释器，无需关闭JIT。
+ *
+ * @param L Lua状态机指针
+ * @param what 操作类型（LUA_JITOFF等）
+ * @param data 操作参数，仅LUA_JITHOT使用
+ * @return LUA_JITOFF/LUA_JITON返回之前的开关状态，LUA_JITHOT返回旧阈值，
+ *         LUA_JITCOUNT返回数量；未编译JIT或what无效时返回-1
+ *
+ * @see LUA_JITOFF, LUA_JITON, LUA_JITHOT, LUA_JITCOUNT
+ */
+LUA_API int (lua_jit) (lua_State *L, int what, int data);
+
 /**
  * @brief 抛出错误
  *
@@ -130,11 +130,12 @@ static int dumping=1;			/* 转储字节码？ */
 /**
  * @brief 调试信息剥离标志
  *
- * 控制是否在输出的字节码中保留调试信息。
- * - 0：保留调试信息（默认）
- * - 1：剥离调试信息，减小文件大小
+ * 控制输出字节码的内容，作为选项位传给luaU_dump。
+ * - 0：保留调试信息，超级指令还原为原始操作码（默认）
+ * - LUAU_DUMPSTRIP（-s）：剥离调试信息，减小文件大小
+ * - LUAU_DUMPFUSED（-F）：保留超级指令，标准Lua 5.1无法加载
  */
-static int stripping=0;			/* 剥离调试信息？ */
+static int stripping=0;			/* 输出选项 */
 
 /**
  * @brief 默认输出文件名缓冲区
@@ -253,6 +254,7 @@ static void cannot(const char* what)
  *
  * 显示的选项说明：
  * - "-"：处理标准输入
+ * - "-F"：保留超级指令
  * - "-l"：列出字节码
  * - "-o name"：指定输出文件
  * - "-p"：仅解析，不输出
@@ -281,6 +283,7 @@ static void usage(const char* message)
     "usage: %s [options] [filenames].\n"
     "Available options are:\n"
     "  -        process stdin\n"
+    "  -F       keep superinstructions (not loadable by stock Lua 5.1)\n"
     "  -l       list\n"
     "  -o name  output to file " LUA_QL("name") " (default is \"%s\")\n"
     "  -p       parse only\n"
@@ -398,6 +401,8 @@ static int doargs(int argc, char* argv[])
         }
         else if (IS("-"))			/* 选项结束；使用标准输入 */
             break;
+        else if (IS("-F"))			/* 保留超级指令 */
+            stripping|=LUAU_DUMPFUSED;
         else if (IS("-l"))			/* 列出 */
             ++listing;
         else if (IS("-o"))			/* 输出文件 */
@@ -409,7 +414,7 @@ static int doargs(int argc, char* argv[])
         else if (IS("-p"))			/* 仅解析 */
             dumping=0;
         else if (IS("-s"))			/* 剥离调试信息 */
-            stripping=1;
+            stripping|=LUAU_DUMPSTRIP;
         else if (IS("-v"))			/* 显示版本 */
             ++version;
         else					/* 未知选项 */
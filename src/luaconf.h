@@ -234,6 +234,30 @@
 #define LUA_USE_ULONGJMP
 #endif
 
+/**
+ * @brief 虚拟机跳转表分发（computed goto）
+ *
+ * 详细说明：
+ * 当定义LUA_USE_JUMPTABLE时，luaV_execute使用GCC/Clang的"标签取址"
+ * 扩展（&&label / goto *ptr）实现线索化分发：每个操作码对应跳转表中
+ * 的一个标签地址，并在每个指令处理器末尾复制一份取指与分发代码。
+ *
+ * 性能影响：
+ * - switch分发所有指令共享同一条间接跳转，分支预测器只能记住一个目标
+ * - 复制分发后每个处理器拥有独立的间接跳转，可按"前一条指令"预测
+ * - 省去switch的边界检查
+ *
+ * 启用条件：
+ * - GCC或Clang编译器（__GNUC__）
+ * - 非LUA_ANSI模式
+ * - 未定义LUA_NOJUMPTABLE（用于强制回退到可移植的switch实现）
+ *
+ * @see luaV_execute, vmdispatch, vmcase, vmbreak
+ */
+#if defined(__GNUC__) && !defined(LUA_ANSI) && !defined(LUA_NOJUMPTABLE)
+#define LUA_USE_JUMPTABLE
+#endif
+
 /** @} */
 
 /**
@@ -952,6 +976,212 @@
  */
 #define LUAI_GCMUL              200
 
+/**
+ * @brief 垃圾回收计时使用的时钟（微秒）
+ *
+ * 详细说明：
+ * 设置了时间预算（collectgarbage("setbudget", us)）时，luaC_step用它
+ * 决定何时停止步进；每次步进的耗时也用它统计。只用于计算差值，可以
+ * 从任意时刻开始，也可以回绕。POSIX系统使用单调时钟，其他平台退回到
+ * clock()（进程CPU时间，精度较低）。
+ *
+ * @see LUA_GCSETBUDGET, LUA_GCMAXSTEP
+ */
+#if defined(LUA_CORE)
+#include <time.h>
+#if defined(LUA_USE_POSIX) && defined(CLOCK_MONOTONIC)
+#define luai_gcclock(t) { struct timespec ts_; \
+        clock_gettime(CLOCK_MONOTONIC, &ts_); \
+        (t) = (lu_mem)ts_.tv_sec * 1000000 + (lu_mem)(ts_.tv_nsec / 1000); }
+#else
+#define luai_gcclock(t) \
+        { (t) = (lu_mem)((double)clock() * 1000000 / CLOCKS_PER_SEC); }
+#endif
+#endif
+
+/**
+ * @brief 分代模式的次要回收间隔
+ *
+ * 详细说明：
+ * 分代模式下，堆比上次回收后增长这个百分比时执行一次次要回收。
+ * 可以通过collectgarbage("generational", value)运行时修改。
+ *
+ * @see lua_gc(), LUA_GCGEN
+ */
+#define LUAI_GENMINORMUL        20
+
+/**
+ * @brief 分代模式的主要回收间隔
+ *
+ * 详细说明：
+ * 分代模式下，估计使用量比上次主要回收后增长这个百分比时，下一次
+ * 回收改为完整回收，释放已经死亡的老对象。
+ *
+ * @see LUAI_GENMINORMUL
+ */
+#define LUAI_GENMAJORMUL        100
+
+/**
+ * @brief 并行标记
+ *
+ * 详细说明：
+ * 定义LUA_USE_PARMARK后，原子阶段和完整回收中的灰色列表传播由主线程
+ * 和若干辅助线程共同完成：标记位用原子操作修改，空闲线程从其他线程
+ * 窃取灰色对象。释放的对象与串行标记完全相同。
+ *
+ * 启用条件：
+ * - 显式定义LUA_USE_PARMARK（默认关闭），链接时需要-pthread
+ * - GCC/Clang（__atomic内建函数）和POSIX线程（LUA_USE_POSIX）
+ *
+ * @see luaC_parmark, LUA_GCPARMARK
+ */
+#if defined(LUA_USE_PARMARK) && !(defined(__GNUC__) && defined(LUA_USE_POSIX))
+#undef LUA_USE_PARMARK
+#endif
+
+/**
+ * @brief 并行标记的辅助线程数
+ *
+ * 详细说明：
+ * 不包括执行回收的线程本身。0表示不使用并行标记。默认值不超过
+ * 其他在线CPU的数目（单CPU机器上为0）；collectgarbage("parmark", n)
+ * 显式设置的线程数不受这个限制。
+ */
+#define LUAI_PARMARKTHREADS     3
+
+/**
+ * @brief 使用并行标记的最小堆大小（字节）
+ *
+ * 详细说明：
+ * 堆较小时唤醒辅助线程的开销超过并行带来的收益，直接串行标记。
+ */
+#define LUAI_PARMARKMIN         (1 << 20)
+
+/**
+ * @brief 后台释放
+ *
+ * 详细说明：
+ * 定义LUA_USE_BGFREE后，可以用collectgarbage("bgfree", 1)让清扫阶段
+ * 释放的内存块成批交给一个后台线程调用分配器释放。死亡对象的判断和
+ * 摘链仍在主线程上进行，只有分配器的free调用离开主线程。
+ *
+ * 启用条件：
+ * - 显式定义LUA_USE_BGFREE（默认关闭），链接时需要-pthread
+ * - GCC/Clang（__atomic内建函数）和POSIX线程（LUA_USE_POSIX）
+ * - 运行时还要求分配器是线程安全的（默认的l_alloc满足）
+ *
+ * @see luaM_bgfree, LUA_GCBGFREE
+ */
+#if defined(LUA_USE_BGFREE) && !(defined(__GNUC__) && defined(LUA_USE_POSIX))
+#undef LUA_USE_BGFREE
+#endif
+
+/**
+ * @brief 后台释放每批的内存块数
+ *
+ * 详细说明：
+ * 主线程每攒满一批才与后台线程同步一次。
+ */
+#define LUAI_BGFREEBATCH        256
+
+/**
+ * @brief 后台释放的批数
+ *
+ * 详细说明：
+ * 所有批都在等待后台线程时，主线程直接释放内存块，不会等待，因此
+ * 尚未归还分配器的内存最多为LUAI_BGFREEBATCHES * LUAI_BGFREEBATCH块。
+ */
+#define LUAI_BGFREEBATCHES      8
+
+/**
+ * @brief 分级内存池
+ *
+ * 详细说明：
+ * 定义LUA_USE_SLAB后，用lua_newslabstate（luaL_newstate默认使用它）
+ * 创建的状态机拥有自己的一组大小类：不超过LUAI_SLABMAX字节的内存块
+ * 按LUAI_SLABSTEP取整后从对应大小类的空闲链表分配，空闲链表为空时从
+ * 向分配器申请的块区中切分。释放的小块回到空闲链表，块区在关闭状态机
+ * 时才归还分配器。表、字符串、闭包和上值等小对象因此不再逐个调用
+ * 分配器。
+ *
+ * 统计：lua_gc的LUA_GCSLABSIZE/LUA_GCSLABUSED/LUA_GCSLABFREE。
+ *
+ * @see lua_newslabstate
+ */
+
+/**
+ * @brief 大小类的粒度（字节），也是小块的对齐
+ */
+#define LUAI_SLABSTEP           16
+
+/**
+ * @brief 由内存池分配的最大块（字节），必须是LUAI_SLABSTEP的倍数
+ */
+#define LUAI_SLABMAX            256
+
+/**
+ * @brief 每次向分配器申请的块区大小（字节）
+ */
+#define LUAI_SLABCHUNK          8192
+
+/**
+ * @brief 堆分析器的默认采样间隔（字节）
+ *
+ * 详细说明：
+ * collectgarbage("heapprof", n)的n为正数时使用n。平均每分配这么多
+ * 字节采样一次，记录当时的调用栈；间隔越小报告越精确，开销越大。
+ *
+ * @see LUA_GCHEAPPROF, lua_heapdump
+ */
+#define LUAI_PROFINTERVAL       (512 * 1024)
+
+/**
+ * @brief 堆分析器记录的最大调用栈深度
+ *
+ * 详细说明：
+ * 更深的调用栈只保留最内层的LUAI_PROFDEPTH层，外层记为"..."。
+ */
+#define LUAI_PROFDEPTH          32
+
+/**
+ * @brief 延迟连接的长度门槛（字节）
+ *
+ * 详细说明：
+ * OP_CONCAT的左操作数至少这么长（或者已经是rope）时，结果是记录
+ * "左边 + 其余部分"的rope，不复制左边；需要字符串内容时才一次性
+ * 压平。循环中的s = s .. piece因此是摊还O(1)而不是O(#s)。门槛以下
+ * 的短字符串照常连接，省去rope节点的开销。设为MAX_SIZET可以关闭。
+ *
+ * @see luaS_newrope, luaS_flatten
+ */
+#define LUAI_ROPEMIN            128
+
+/**
+ * @brief 内部化字符串的最大长度（字节）
+ *
+ * 详细说明：
+ * 不超过这个长度的字符串放进全局字符串表，相同内容只有一个对象，
+ * 比较只需比较指针。更长的字符串（io.read("*a")读入的内容、
+ * luaL_Buffer拼出的结果等）不进字符串表：创建时不计算哈希也不查找
+ * 冲突链，第一次用作表键时才计算哈希，比较时比较长度和内容。
+ * 大量长字符串不再撑大字符串表，也不再引起luaS_resize的重哈希停顿。
+ *
+ * @see luaS_newlstr, luaS_eqstr
+ */
+#define LUAI_MAXSHORTLEN        40
+
+/**
+ * @brief 字符串哈希读取的最大字节数
+ *
+ * 详细说明：
+ * 默认不限制，哈希读取字符串的全部内容，攻击者无法只改动不参与哈希的
+ * 字节来制造冲突。设为较小的正数（例如64）时，更长的字符串只按固定
+ * 间隔读取约这么多字节，哈希代价与长度无关，但重新暴露了这种攻击面。
+ *
+ * @see luaS_hash
+ */
+#define LUAI_HASHLIMIT          (~(size_t)0)
+
 /** @} */
 
 /**
@@ -1427,6 +1657,26 @@
  */
 #define LUAL_BUFFERSIZE         BUFSIZ
 
+/**
+ * @brief 可增长的字符串缓冲区
+ *
+ * 详细说明：
+ * 定义LUA_USE_GROWBUFFER后，luaL_Buffer的内容保存在一块连续的存储区
+ * 中：先用结构体自带的buffer，放不下时换成栈顶的一个用户数据，容量
+ * 按两倍增长，最后只创建一次结果字符串，不再把片段压栈再连接。同时
+ * 提供luaL_prepbuffsize和luaL_buffinitsize预留容量。
+ *
+ * 启用条件：
+ * - 显式定义LUA_USE_GROWBUFFER（默认关闭）
+ *
+ * @warning 这个选项改变luaL_Buffer的布局和luaL_addchar宏，与标准
+ *          Lua 5.1的C模块二进制不兼容。打开后所有C模块都必须用同一个
+ *          luaconf.h重新编译。
+ *
+ * @see luaL_Buffer, luaL_prepbuffsize, luaL_buffinitsize
+ */
+/* #define LUA_USE_GROWBUFFER */
+
 /* }================================================================== */
 
 
@@ -1677,6 +1927,167 @@ union luai_Cast { double l_d; long l_l; };
 
 /** @} */
 
+/**
+ * @name 即时编译配置
+ * @brief 基线模板JIT的启用条件与热度阈值
+ * @{
+ */
+
+/**
+ * @brief 基线模板JIT
+ *
+ * 详细说明：
+ * 定义LUA_USE_JIT（例如-DLUA_USE_JIT）后，热点函数和热点循环会被
+ * ljit.c翻译为x86-64机器码：常见指令直接展开为模板，其余指令调用
+ * 与解释器语义相同的C辅助函数，函数调用和返回退回解释器完成。
+ *
+ * 启用条件：
+ * - 显式定义LUA_USE_JIT（默认关闭）
+ * - x86-64 Linux上的GCC/Clang，以C方式编译
+ * - lua_Number为double（模板直接使用SSE2浮点指令）
+ *
+ * 条件不满足时自动取消定义，解释器行为与未开启时完全相同。
+ *
+ * @see luaJ_compile, lua_jit
+ */
+#if defined(LUA_USE_JIT) && !(defined(__x86_64__) && defined(__linux__) && \
+    defined(__GNUC__) && !defined(__cplusplus) && defined(LUA_NUMBER_DOUBLE))
+#undef LUA_USE_JIT
+#endif
+
+/**
+ * @brief JIT热度阈值
+ *
+ * 详细说明：
+ * 一个函数被调用或其循环回跳累计达到此次数后编译为机器码。
+ * 运行时可通过lua_jit(L, LUA_JITHOT, n)调整。
+ */
+#define LUAI_JITHOT             50
+
+/** @} */
+
+/**
+ * @name 整数子类型配置
+ * @brief 数字的双重表示
+ * @{
+ */
+
+/**
+ * @brief 整数子类型
+ *
+ * 详细说明：
+ * 定义LUA_USE_INTNUM后，能用int精确表示的数字以int存储（内部标签
+ * LUA_TINT），数组下标、数值for循环和整数算术不再经过double与int
+ * 之间的转换。这只是内部表示：结果在任何可观察的方面都与全部使用
+ * double时相同，溢出、除法、-0等情况自动回到浮点表示。
+ *
+ * 启用条件：
+ * - lua_Number为double（int可以被double精确表示）
+ * - 未定义LUA_NOINTNUM（用于强制只使用double表示）
+ * - 未启用LUA_USE_JIT（JIT模板假定数字都是double表示）
+ *
+ * @see LUA_TINT, setnumvalue
+ */
+#if defined(LUA_NUMBER_DOUBLE) && !defined(LUA_NOINTNUM) && \
+    !defined(LUA_USE_JIT)
+#define LUA_USE_INTNUM
+#endif
+
+/**
+ * @brief NaN装箱的紧凑TValue
+ *
+ * 详细说明：
+ * 定义LUA_USE_NANBOX后，TValue从16字节（8字节值+类型标签+填充）
+ * 压缩为一个8字节字：double按原样存储，其他类型编码在负quiet NaN
+ * 的空间里，类型标签放在高17位，指针、布尔值和整数放在低47位。
+ * 栈、表的数组部分和哈希节点随之变小（Node从40字节变为24字节），
+ * 同样大小的缓存能容纳更多的值。
+ *
+ * 启用条件：
+ * - 显式定义LUA_USE_NANBOX（默认关闭）
+ * - x86-64 Linux上的GCC/Clang（用户空间地址不超过47位）
+ * - lua_Number为double
+ * - 未启用LUA_USE_JIT（JIT模板假定16字节的TValue布局）
+ *
+ * 轻量级用户数据也必须是用户空间地址，调试构建下会断言检查。
+ *
+ * @see TValuefields
+ */
+#if defined(LUA_USE_NANBOX) && (!(defined(__x86_64__) && \
+    defined(__linux__) && defined(__GNUC__) && defined(LUA_NUMBER_DOUBLE)) || \
+    defined(LUA_USE_JIT))
+#undef LUA_USE_NANBOX
+#endif
+
+/**
+ * @brief 分组探测的哈希部分
+ *
+ * 详细说明：
+ * 定义LUA_USE_SWISSTABLE后，表的哈希部分改用开放寻址：节点数组之后
+ * 是一个每槽一字节的控制数组，空槽为0x80，占用的槽保存哈希值的低7位。
+ * 查找时按16个槽一组探测（SSE2一次比较整组控制字节，其他平台8个一组
+ * 逐字节比较），只对控制字节相同的槽比较键，遇到含空槽的组即停止。
+ * 节点不再需要冲突链指针（Node从40字节变为32字节，NaN装箱时从24字节
+ * 变为16字节）。负载达到7/8时重哈希。luaH_*接口和next的语义不变，
+ * 垃圾回收器和内联缓存照常按槽位访问节点。
+ *
+ * 启用条件：
+ * - 显式定义LUA_USE_SWISSTABLE（默认关闭）
+ *
+ * @see ltable.c
+ */
+
+/**
+ * @brief 大表的增量重哈希
+ *
+ * 详细说明：
+ * 定义LUA_USE_INCREHASH后，哈希部分不小于2^LUAI_INCREHASHBITS个节点
+ * 的表在空闲节点快用完时（lastfree低于四分之一）开始增量重哈希：统计
+ * 键数并分配新的节点数组，之后每次插入新键时先初始化一段新数组，初始化
+ * 完成后新旧两个节点数组并存，每次插入新键时迁移LUAI_INCREHASHSTEP个
+ * 旧节点。新键总是插入新数组；查找、next和垃圾回收器同时看两个数组。
+ * 原来一次插入中完成的分配、初始化和全部重新插入因此分摊到后续的插入
+ * 中，只剩统计键数的一次顺序扫描。数组部分需要改变大小时仍然一次完成。
+ *
+ * 启用条件：
+ * - 显式定义LUA_USE_INCREHASH（默认关闭）
+ * - 未启用LUA_USE_SWISSTABLE（只支持链式的哈希部分）
+ *
+ * @see ltable.c incrstart, incrstep
+ */
+#if defined(LUA_USE_INCREHASH) && defined(LUA_USE_SWISSTABLE)
+#undef LUA_USE_INCREHASH
+#endif
+
+/**
+ * @brief 使用增量重哈希的最小哈希部分（节点数的对数）
+ */
+#define LUAI_INCREHASHBITS      16
+
+/**
+ * @brief 增量重哈希时每次插入迁移的旧节点数
+ *
+ * 详细说明：
+ * 新节点数组的初始化每次推进它的4倍。
+ */
+#define LUAI_INCREHASHSTEP      16
+
+/**
+ * @brief table.sort（pdqsort）的区间阈值
+ *
+ * 详细说明：
+ * ltable.c中数组部分的快速路径（luaH_sort）和ltablib.c中逐个比较的
+ * 一般路径是同一个算法，共用这些阈值：
+ * - LUAI_SORTINSERTION：短于此长度的区间用插入排序
+ * - LUAI_SORTNINTHER：长于此长度的区间用九数取中选枢轴
+ * - LUAI_SORTPARTIAL：划分没有交换时，试探性插入排序最多移动的元素数
+ */
+#define LUAI_SORTINSERTION      24
+#define LUAI_SORTNINTHER        128
+#define LUAI_SORTPARTIAL        8
+
+/** @} */
+
 /**
  * @name 内存对齐配置
  * @brief 定义最大对齐要求的类型
@@ -1863,6 +2274,40 @@ union luai_Cast { double l_d; long l_l; };
  */
 #define LUA_MAXCAPTURES         32
 
+/**
+ * @brief 每个状态缓存的已编译模式个数
+ *
+ * 详细说明：
+ * string.find、match、gmatch和gsub把模式编译成模式项数组，字符类
+ * （%a、[...]等）预先算成256位的位图，按最近最少使用的顺序缓存这么多个。
+ * 反复使用同一批模式的程序不再每次重新解析模式。
+ *
+ * @see lstrlib.c getprog
+ */
+#define LUA_PATCACHE            32
+
+/**
+ * @brief 向量化的字符串操作
+ *
+ * 详细说明：
+ * 定义LUA_USE_SIMDSTR时，string.find的普通查找以及模式开头的字面
+ * 前缀（find、match、gmatch、gsub）用SSE2一次检查16个起点：同时比较
+ * 子串的首字节和末字节，只对两者都相同的位置调用memcmp。运行时检测到
+ * AVX2时改用32字节的版本。C locale下string.upper和string.lower也用
+ * SSE2一次转换16个字节。
+ *
+ * 启用条件：
+ * - x86-64上的GCC或Clang（__GNUC__，目标属性和__builtin_cpu_supports）
+ * - 非LUA_ANSI模式
+ * - 未定义LUA_NOSIMDSTR（用于强制使用可移植的逐字节实现）
+ *
+ * @see lstrlib.c lmemfind, casemap
+ */
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(LUA_ANSI) && \
+    !defined(LUA_NOSIMDSTR)
+#define LUA_USE_SIMDSTR
+#endif
+
 /** @} */
 
 
@@ -126,6 +126,7 @@
 
 #include "lua.h"
 
+#include "lcode.h"
 #include "ldebug.h"
 #include "ldo.h"
 #include "lfunc.h"
@@ -736,8 +737,8 @@ static void LoadConstants(LoadState *S, Proto *f)
             break;
             
         case LUA_TNUMBER:
-            // 数值：读取lua_Number并设置TValue
-            setnvalue(o, LoadNumber(S));
+            // 数值：读取lua_Number并设置TValue，整数常量使用整数子类型
+            setnumvalue(o, LoadNumber(S));
             break;
             
         case LUA_TSTRING:
@@ -992,6 +993,12 @@ static Proto *LoadFunction(LoadState *S, TString *p)
     
     // 字节码验证：确保生成的字节码在语义上正确
     IF(!luaG_checkcode(f), "bad code");
+
+    // 融合超级指令：验证针对原始操作码进行，已融合的字节码保持不变
+    luaK_fuse(f);
+
+    // 分配内联缓存：缓存不进入字节码文件，加载时重新建立
+    luaF_initcache(S->L, f);
     
     // 清理GC保护：从栈中移除函数，恢复栈状态
     S->L->top--;
@@ -275,7 +275,8 @@ LUAI_FUNC void luaU_header(char* h);
  * @param f 要序列化的函数原型指针
  * @param w 输出函数指针，负责实际的数据写入
  * @param data 传递给输出函数的用户数据
- * @param strip 是否移除调试信息（1=移除，0=保留）
+ * @param strip 选项位：LUAU_DUMPSTRIP移除调试信息，LUAU_DUMPFUSED
+ *              保留超级指令；0表示都不启用，输出标准5.1字节码
  * @return 成功时返回0，失败时返回非零值
  * 
  * @note 这是从ldump.c实现的序列化函数
@@ -284,6 +285,20 @@ LUAI_FUNC void luaU_header(char* h);
  */
 LUAI_FUNC int luaU_dump(lua_State* L, const Proto* f, lua_Writer w, void* data, int strip);
 
+/**
+ * @name luaU_dump选项
+ * @brief 可以按位组合，LUAU_DUMPSTRIP的值与原来的strip参数兼容
+ * @{
+ */
+#define LUAU_DUMPSTRIP  1   /**< 移除调试信息 */
+/**
+ * 保留超级指令。输出的文件头仍是5.1，但标准5.1的加载器会以"bad code"
+ * 拒绝其中的融合操作码，只适合由本实现加载；加载时无论哪种输出都会
+ * 重新融合，因此默认输出原始操作码。
+ */
+#define LUAU_DUMPFUSED  2
+/** @} */
+
 /* 条件编译：仅在luac编译器中包含打印功能 */
 #ifdef luac_c
 
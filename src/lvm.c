@@ -88,6 +88,7 @@
 #include "ldo.h"
 #include "lfunc.h"
 #include "lgc.h"
+#include "ljit.h"
 #include "lobject.h"
 #include "lopcodes.h"
 #include "lstate.h"
@@ -530,6 +531,7 @@ static void callTM(lua_State *L, const TValue *f, const TValue *p1,
 void luaV_gettable(lua_State *L, const TValue *t, TValue *key, StkId val)
 {
     int loop;
+    luaS_flatobj(L, key);
     for (loop = 0; loop < MAXTAGLOOP; loop++) {
         const TValue *tm;
         if (ttistable(t)) {
@@ -553,6 +555,70 @@ void luaV_gettable(lua_State *L, const TValue *t, TValue *key, StkId val)
 }
 
 
+/**
+ * @brief 以字符串常量为键的表访问（带内联缓存）
+ *
+ * 详细说明：
+ * 与luaV_gettable语义完全相同，但在__index链上的每一层表都使用
+ * 当前指令的内联缓存项做槽位提示。对于obj:method()这样的调用，
+ * 键通常不在对象自身而在其类表中，提示最终会记住类表中的槽位。
+ *
+ * @param L Lua状态机指针
+ * @param t 被索引的值
+ * @param key 字符串常量键
+ * @param val 存储结果的栈位置
+ * @param hint 当前指令的内联缓存项
+ *
+ * @see luaV_gettable, luaH_getstrhint
+ */
+void luaV_gettablestr(lua_State *L, const TValue *t, TValue *key, StkId val,
+                      int *hint)
+{
+    int loop;
+    for (loop = 0; loop < MAXTAGLOOP; loop++) {
+        const TValue *tm;
+        if (ttistable(t)) {
+            Table *h = hvalue(t);
+            const TValue *res = luaH_getstrhint(h, rawtsvalue(key), hint);
+            if (!ttisnil(res) ||
+                (tm = fasttm(L, h->metatable, TM_INDEX)) == NULL) {
+                setobj2s(L, val, res);
+                return;
+            }
+        }
+        else if (ttisnil(tm = luaT_gettmbyobj(L, t, TM_INDEX)))
+            luaG_typeerror(L, t, "index");
+        if (ttisfunction(tm)) {
+            callTMres(L, val, tm, t, key);
+            return;
+        }
+        t = tm;
+    }
+    luaG_runerror(L, "loop in gettable");
+}
+
+
+/**
+ * @brief 内联缓存探测
+ *
+ * 详细说明：
+ * 只检查缓存项所指的那一个节点：键相同且值非nil时返回值指针，
+ * 否则返回NULL，由调用者走完整的查找路径。
+ *
+ * @param h 目标表
+ * @param key 字符串键
+ * @param ic 内联缓存项
+ * @return 命中时返回值指针，未命中返回NULL
+ */
+static const TValue *icprobe(Table *h, TString *key, const int *ic)
+{
+    Node *n = gnode(h, lmod(*ic, sizenode(h)));
+    if (ttisstring(gkey(n)) && rawtsvalue(gkey(n)) == key && !ttisnil(gval(n)))
+        return gval(n);
+    return NULL;
+}
+
+
 /**
  * @brief 向表中设置值（支持元方法）
  *
@@ -619,6 +685,8 @@ void luaV_settable(lua_State *L, const TValue *t, TValue *key, StkId val)
 {
     int loop;
     TValue temp;
+    luaS_flatobj(L, key);
+    luaS_flatobj(L, val);    // 表中不保存rope
     for (loop = 0; loop < MAXTAGLOOP; loop++) {
         const TValue *tm;
         if (ttistable(t)) {
@@ -808,6 +876,20 @@ static int call_orderTM(lua_State *L, const TValue *p1, const TValue *p2,
  * @{
  */
 
+/**
+ * @brief 字符串值的内容：rope先压平
+ *
+ * @param L Lua状态机指针
+ * @param o 字符串或rope
+ * @return 内容相同的内部化字符串
+ *
+ * @see luaS_flatten
+ */
+static TString *flatstr(lua_State *L, const TValue *o)
+{
+    return ttisrope(o) ? luaS_flatten(L, ropevalue(o)) : rawtsvalue(o);
+}
+
 /**
  * @brief 字符串比较函数
  *
@@ -869,7 +951,7 @@ static int call_orderTM(lua_State *L, const TValue *p1, const TValue *p2,
  * @since Lua 5.1
  * @see strcoll, luaV_lessthan, 字符串比较
  */
-static int l_strcmp(const TString *ls, const TString *rs)
+int luaV_strcmp(const TString *ls, const TString *rs)
 {
     const char *l = getstr(ls);
     size_t ll = ls->tsv.len;
@@ -918,7 +1000,7 @@ static int l_strcmp(const TString *ls, const TString *rs)
  * - 高效的数值比较算法
  *
  * 字符串比较：
- * - 使用l_strcmp进行字典序比较
+ * - 使用luaV_strcmp进行字典序比较
  * - 支持locale感知的排序
  * - 处理包含null字符的字符串
  * - 国际化字符串比较
@@ -956,12 +1038,14 @@ static int l_strcmp(const TString *ls, const TString *rs)
 int luaV_lessthan(lua_State *L, const TValue *l, const TValue *r)
 {
     int res;
-    if (ttype(l) != ttype(r))
+    if (ttisint(l) && ttisint(r))
+        return ivalue(l) < ivalue(r);
+    else if (basetype(l) != basetype(r))
         return luaG_ordererror(L, l, r);
     else if (ttisnumber(l))
         return luai_numlt(nvalue(l), nvalue(r));
-    else if (ttisstring(l))
-        return l_strcmp(rawtsvalue(l), rawtsvalue(r)) < 0;
+    else if (basetype(l) == LUA_TSTRING)
+        return luaV_strcmp(flatstr(L, l), flatstr(L, r)) < 0;
     else if ((res = call_orderTM(L, l, r, TM_LT)) != -1)
         return res;
     return luaG_ordererror(L, l, r);
@@ -1018,15 +1102,17 @@ int luaV_lessthan(lua_State *L, const TValue *l, const TValue *r)
  * @since Lua 5.1
  * @see luaV_lessthan, __le元方法, __lt元方法
  */
-static int lessequal(lua_State *L, const TValue *l, const TValue *r)
+int luaV_lessequal(lua_State *L, const TValue *l, const TValue *r)
 {
     int res;
-    if (ttype(l) != ttype(r))
+    if (ttisint(l) && ttisint(r))
+        return ivalue(l) <= ivalue(r);
+    else if (basetype(l) != basetype(r))
         return luaG_ordererror(L, l, r);
     else if (ttisnumber(l))
         return luai_numle(nvalue(l), nvalue(r));
-    else if (ttisstring(l))
-        return l_strcmp(rawtsvalue(l), rawtsvalue(r)) <= 0;
+    else if (basetype(l) == LUA_TSTRING)
+        return luaV_strcmp(flatstr(L, l), flatstr(L, r)) <= 0;
     else if ((res = call_orderTM(L, l, r, TM_LE)) != -1)
         return res;
     else if ((res = call_orderTM(L, r, l, TM_LT)) != -1)
@@ -1114,12 +1200,26 @@ static int lessequal(lua_State *L, const TValue *l, const TValue *r)
 int luaV_equalval(lua_State *L, const TValue *t1, const TValue *t2)
 {
     const TValue *tm;
-    lua_assert(ttype(t1) == ttype(t2));
-    switch (ttype(t1)) {
+    lua_assert(basetype(t1) == basetype(t2));
+    switch (basetype(t1)) {
         case LUA_TNIL: return 1;
-        case LUA_TNUMBER: return luai_numeq(nvalue(t1), nvalue(t2));
+        case LUA_TNUMBER:
+            if (ttisint(t1) && ttisint(t2)) return ivalue(t1) == ivalue(t2);
+            return luai_numeq(nvalue(t1), nvalue(t2));
         case LUA_TBOOLEAN: return bvalue(t1) == bvalue(t2);
         case LUA_TLIGHTUSERDATA: return pvalue(t1) == pvalue(t2);
+        case LUA_TSTRING: {
+            TString *s1, *s2;
+            if (ttisstring(t1) && ttisstring(t2))
+                return luaS_eqstr(rawtsvalue(t1), rawtsvalue(t2));
+            // 有一边是rope：长度不同时不必压平
+            if ((ttisrope(t1) ? ropevalue(t1)->len : tsvalue(t1)->len) !=
+                (ttisrope(t2) ? ropevalue(t2)->len : tsvalue(t2)->len))
+                return 0;
+            s1 = flatstr(L, t1);
+            s2 = flatstr(L, t2);
+            return luaS_eqstr(s1, s2);
+        }
         case LUA_TUSERDATA: {
             if (uvalue(t1) == uvalue(t2)) return 1;
             tm = get_compTM(L, uvalue(t1)->metatable, uvalue(t2)->metatable,
@@ -1245,6 +1345,136 @@ void luaV_concat(lua_State *L, int total, int last)
 }
 
 
+/**
+ * @brief OP_CONCAT的字符串连接：不复制长的左操作数
+ *
+ * 详细说明：
+ * 左操作数是rope或者不短于LUAI_ROPEMIN的字符串、其余操作数都是
+ * 字符串或数字时，其余操作数连接后成为新rope的右半部分，左操作数
+ * 只被引用，所以循环中的s = s .. piece每次只复制piece。否则先压平
+ * 操作数中的rope，再交给luaV_concat（包括__concat元方法）。
+ *
+ * 结果留在Lua寄存器中。lua_concat和luaO_pushfstring的结果要交给C，
+ * 它们使用luaV_concat。
+ *
+ * @param L Lua状态机指针
+ * @param total 要连接的值的总数
+ * @param last 最后一个值在栈中的索引
+ *
+ * @see luaV_concat, luaS_newrope, LUAI_ROPEMIN
+ */
+void luaV_lazyconcat(lua_State *L, int total, int last)
+{
+    StkId first = L->base + last - total + 1;
+    StkId top = L->base + last + 1;
+    StkId o;
+    if (ttisrope(first) ||
+        (ttisstring(first) && tsvalue(first)->len >= LUAI_ROPEMIN)) {
+        size_t llen = ttisrope(first) ? ropevalue(first)->len
+                                      : tsvalue(first)->len;
+        size_t rlen = 0;
+        // 先只检查类型：改用__concat时数字操作数必须保持原样
+        for (o = first + 1; o < top; o++) {
+            if (!ttisstring(o) && !ttisnumber(o) && !ttisrope(o))
+                break;
+        }
+        if (o == top) {
+            Rope *r;
+            char *p;
+            for (o = first + 1; o < top; o++) {
+                luaS_flatobj(L, o);
+                (void)tostring(L, o);
+                if (tsvalue(o)->len >= MAX_SIZET - llen - rlen)
+                    luaG_runerror(L, "string length overflow");
+                rlen += tsvalue(o)->len;
+            }
+            if (rlen == 0)
+                return;    // 结果就是左操作数
+            r = luaS_newrope(L, gcvalue(first), llen + rlen, rlen);
+            p = getrope(r);
+            for (o = first + 1; o < top; o++) {
+                memcpy(p, svalue(o), tsvalue(o)->len);
+                p += tsvalue(o)->len;
+            }
+            setropevalue(L, first, r);
+            return;
+        }
+    }
+    for (o = first; o < top; o++)
+        luaS_flatobj(L, o);
+    luaV_concat(L, total, last);
+}
+
+
+/** @} */
+
+/**
+ * @name 整数子类型算术
+ * @brief 两个int操作数的快速运算
+ *
+ * 详细说明：
+ * 每个函数在结果能用int精确表示、并且与double运算的结果完全相同时
+ * 把结果写入*r并返回1；否则返回0，调用者改用浮点运算。返回0的情况：
+ * - 溢出（加、减、乘、取负）
+ * - 结果应为-0（负数乘以0、对0取负）
+ * - 除数为0的取模（结果是NaN）
+ *
+ * 除法和乘方的结果通常不是整数，总是使用浮点运算。
+ * @{
+ */
+
+/** @brief 整数加法 */
+static int intadd (int a, int b, int *r) {
+    int s = cast_int(cast(unsigned int, a) + cast(unsigned int, b));
+    if (((a ^ s) & (b ^ s)) < 0) return 0;  /* 溢出：符号与两个操作数都不同 */
+    *r = s;
+    return 1;
+}
+
+/** @brief 整数减法 */
+static int intsub (int a, int b, int *r) {
+    int s = cast_int(cast(unsigned int, a) - cast(unsigned int, b));
+    if (((a ^ b) & (a ^ s)) < 0) return 0;  /* 溢出 */
+    *r = s;
+    return 1;
+}
+
+/** @brief 整数乘法：两个int的乘积在int范围内时double运算是精确的 */
+static int intmul (int a, int b, int *r) {
+    lua_Number m = luai_nummul(cast_num(a), cast_num(b));
+    if (!(m >= cast_num(INT_MIN) && m <= cast_num(INT_MAX))) return 0;
+    if (m == 0 && (a | b) < 0) return 0;  /* 结果是-0 */
+    *r = cast_int(m);
+    return 1;
+}
+
+/** @brief 整数取模：与luai_nummod相同，结果的符号与除数相同 */
+static int intmod (int a, int b, int *r) {
+    int m;
+    if (b == 0) return 0;  /* NaN */
+    if (b == -1) {  /* 避免INT_MIN % -1溢出 */
+        *r = 0;
+        return 1;
+    }
+    m = a % b;
+    if (m != 0 && (m ^ b) < 0) m += b;
+    *r = m;
+    return 1;
+}
+
+/** @brief 整数取负 */
+static int intunm (int a, int *r) {
+    if (a == 0 || a == INT_MIN) return 0;  /* -0或溢出 */
+    *r = -a;
+    return 1;
+}
+
+/** @brief 没有整数快速路径的运算（除法、乘方） */
+static int intnone (int a, int b, int *r) {
+    UNUSED(a); UNUSED(b); UNUSED(r);
+    return 0;
+}
+
 /** @} */
 
 /**
@@ -1253,6 +1483,21 @@ void luaV_concat(lua_State *L, int total, int last)
  * @{
  */
 
+/**
+ * @brief 算术运算的操作数转换：与luaV_tonumber相同，rope先压平
+ *
+ * 压平的字符串放在n中，原来的操作数保持不变，元方法和错误信息
+ * 仍然使用原来的位置。
+ */
+static const TValue *arithnum(lua_State *L, const TValue *obj, TValue *n)
+{
+    if (ttisrope(obj)) {
+        setsvalue(L, n, luaS_flatten(L, ropevalue(obj)));
+        obj = n;
+    }
+    return luaV_tonumber(obj, n);
+}
+
 /**
  * @brief 算术运算处理函数
  *
@@ -1312,13 +1557,29 @@ void luaV_concat(lua_State *L, int total, int last)
  * @since Lua 5.1
  * @see luaV_tonumber, call_binTM, 算术元方法
  */
-static void Arith(lua_State *L, StkId ra, const TValue *rb,
-                  const TValue *rc, TMS op)
+void luaV_arith(lua_State *L, StkId ra, const TValue *rb,
+                const TValue *rc, TMS op)
 {
     TValue tempb, tempc;
     const TValue *b, *c;
-    if ((b = luaV_tonumber(rb, &tempb)) != NULL &&
-        (c = luaV_tonumber(rc, &tempc)) != NULL) {
+    if (ttisint(rb) && ttisint(rc)) {
+        int a = ivalue(rb), d = ivalue(rc), r;
+        int ok;
+        switch (op) {
+            case TM_ADD: ok = intadd(a, d, &r); break;
+            case TM_SUB: ok = intsub(a, d, &r); break;
+            case TM_MUL: ok = intmul(a, d, &r); break;
+            case TM_MOD: ok = intmod(a, d, &r); break;
+            case TM_UNM: ok = intunm(a, &r); break;
+            default: ok = 0; break;
+        }
+        if (ok) {
+            setivalue(ra, r);
+            return;
+        }
+    }
+    if ((b = arithnum(L, rb, &tempb)) != NULL &&
+        (c = arithnum(L, rc, &tempc)) != NULL) {
         lua_Number nb = nvalue(b), nc = nvalue(c);
         switch (op) {
             case TM_ADD: setnvalue(ra, luai_numadd(nb, nc)); break;
@@ -1353,7 +1614,7 @@ static void Arith(lua_State *L, StkId ra, const TValue *rb,
  * @param L Lua状态机指针
  * @param c 要检查的条件
  */
-#define runtime_check(L, c) { if (!(c)) break; }
+#define runtime_check(L, c) { if (!(c)) vmbreak; }
 
 /**
  * @brief 获取指令的A寄存器地址
@@ -1426,17 +1687,50 @@ static void Arith(lua_State *L, StkId ra, const TValue *rb,
  */
 #define KBx(i) check_exp(getBMode(GET_OPCODE(i)) == OpArgK, k+GETARG_Bx(i))
 
+/**
+ * @brief 当前指令的内联缓存项
+ *
+ * 详细说明：
+ * Proto::icache与code平行，pc已经指向下一条指令，所以减一。
+ *
+ * @see luaF_initcache
+ */
+#define ICACHE() (cl->p->icache + (pc - cl->p->code - 1))
+
+/**
+ * @brief 刷新钩子陷阱
+ *
+ * 详细说明：
+ * 执行循环有两个变体：无钩子的快速路径和带钩子检查的插桩路径。
+ * 当前使用哪个变体由局部状态决定（跳转表模式下是分发表指针disp，
+ * switch模式下是trap标志），只在"安全点"根据L->hookmask重新选择：
+ *
+ * - 进入或返回到一个Lua函数（reentry）
+ * - 任何可能执行任意代码的操作之后（Protect、C函数调用）
+ * - 跳转之后（dojump），保证死循环也能及时响应异步设置的钩子
+ *
+ * 因此lua_sethook无需通知解释器：运行中的状态会在下一个安全点
+ * 切换到对应的变体，钩子关闭时快速路径上没有任何钩子检查开销。
+ */
+#if defined(LUA_USE_JUMPTABLE)
+#define updatetrap() \
+    (disp = (L->hookmask & (LUA_MASKLINE | LUA_MASKCOUNT)) ? hooktab : disptab)
+#else
+#define updatetrap()  (trap = L->hookmask & (LUA_MASKLINE | LUA_MASKCOUNT))
+#endif
+
 /**
  * @brief 执行跳转操作
  *
  * 详细说明：
  * 更新程序计数器并让出线程控制权。用于实现条件跳转和循环。
+ * 跳转是钩子切换的安全点。
  *
  * @param L Lua状态机指针
  * @param pc 程序计数器
  * @param i 跳转偏移量
  */
-#define dojump(L,pc,i) {(pc) += (i); luai_threadyield(L);}
+#define dojump(L,pc,i) {(pc) += (i); luai_threadyield(L); updatetrap();}
 
 /**
  * @brief 保护操作宏
@@ -1444,32 +1738,227 @@ static void Arith(lua_State *L, StkId ra, const TValue *rb,
  * 详细说明：
  * 在执行可能导致栈重分配的操作前保存程序计数器，
  * 操作后恢复base指针。确保虚拟机状态的一致性。
+ * 被保护的操作可能调用debug.sethook，因此之后刷新钩子陷阱。
  *
  * @param x 要保护的操作
  */
-#define Protect(x) { L->savedpc = pc; {x;}; base = L->base; }
+#define Protect(x) { L->savedpc = pc; {x;}; base = L->base; updatetrap(); }
 
 /**
  * @brief 算术运算宏
  *
  * 详细说明：
  * 实现算术运算的通用宏，优化了数字运算的快速路径。
- * 如果操作数都是数字，直接计算；否则调用Arith函数处理元方法。
+ * 如果操作数都是数字，直接计算；否则调用luaV_arith处理元方法。
+ * 两个整数子类型的操作数先尝试整数运算，溢出等情况回到浮点运算；
+ * 未启用整数子类型时这一分支在编译期消失。
  *
  * @param op 数字运算操作
+ * @param iop 对应的整数运算（见intadd等）
  * @param tm 对应的元方法类型
  */
-#define arith_op(op,tm) { \
+#define arith_op(op,iop,tm) { \
         TValue *rb = RKB(i); \
         TValue *rc = RKC(i); \
-        if (ttisnumber(rb) && ttisnumber(rc)) { \
+        int ri; \
+        if (ttisfloat(rb) && ttisfloat(rc)) { \
+          lua_Number nb = fltvalue(rb), nc = fltvalue(rc); \
+          setnvalue(ra, op(nb, nc)); \
+        } \
+        else if (ttisint(rb) && ttisint(rc) && \
+                 iop(ivalue(rb), ivalue(rc), &ri)) { \
+          setivalue(ra, ri); \
+        } \
+        else if (ttisnumber(rb) && ttisnumber(rc)) { \
           lua_Number nb = nvalue(rb), nc = nvalue(rc); \
           setnvalue(ra, op(nb, nc)); \
         } \
         else \
-          Protect(Arith(L, ra, rb, rc, tm)); \
+          Protect(luaV_arith(L, ra, rb, rc, tm)); \
+      }
+
+/**
+ * @brief 读全局变量宏
+ *
+ * 详细说明：
+ * OP_GETGLOBAL的处理器主体，OP_GETGLOBAL_CALL和OP_GETGLOBAL_GETTABLE
+ * 共用。先用内联缓存探测环境表，未命中时走完整的查找流程。
+ */
+#define getglobal_op() { \
+        TValue *rb = KBx(i); \
+        const TValue *res; \
+        lua_assert(ttisstring(rb)); \
+        res = icprobe(cl->env, rawtsvalue(rb), ICACHE()); \
+        if (res != NULL) { \
+          setobj2s(L, ra, res); \
+        } else { \
+          TValue g; \
+          sethvalue(L, &g, cl->env); \
+          Protect(luaV_gettablestr(L, &g, rb, ra, ICACHE())); \
+        } \
+      }
+
+/**
+ * @brief 索引表宏
+ *
+ * 详细说明：
+ * OP_GETTABLE的处理器主体，OP_GETTABLE_GETTABLE共用。常量字符串键
+ * 使用内联缓存；整数子类型的键直接访问数组部分（槽位为nil且表有元表时
+ * 可能需要__index，仍走通用路径）；其他键走通用的luaV_gettable。
+ */
+#define gettable_op() { \
+        TValue *rb = RB(i); \
+        TValue *rc = RKC(i); \
+        if (ISK(GETARG_C(i)) && ttisstring(rc)) { \
+          const TValue *res; \
+          if (ttistable(rb) && \
+              (res = icprobe(hvalue(rb), rawtsvalue(rc), ICACHE())) != NULL) { \
+            setobj2s(L, ra, res); \
+          } else { \
+            Protect(luaV_gettablestr(L, rb, rc, ra, ICACHE())); \
+          } \
+        } else if (ttisint(rc) && ttistable(rb) && \
+                   cast(unsigned int, ivalue(rc)) - 1u < \
+                   cast(unsigned int, hvalue(rb)->sizearray) && \
+                   (!ttisnil(&hvalue(rb)->array[ivalue(rc) - 1]) || \
+                    hvalue(rb)->metatable == NULL)) { \
+          setobj2s(L, ra, &hvalue(rb)->array[ivalue(rc) - 1]); \
+        } else { \
+          Protect(luaV_gettable(L, rb, rc, ra)); \
+        } \
+      }
+
+/**
+ * @brief 钩子检查宏（插桩路径）
+ *
+ * 详细说明：
+ * 处理行钩子和计数钩子。仅在插桩变体中执行；钩子函数可能修改钩子
+ * 设置，所以处理完后刷新钩子陷阱。
+ *
+ * 钩子处理：
+ * - 仅当设置了行钩子或计数钩子时才进入traceexec
+ * - 钩子中协程让出时，回退PC以便恢复后重新执行本条指令
+ */
+#define hookcheck() { \
+        if ((L->hookmask & (LUA_MASKLINE | LUA_MASKCOUNT)) && \
+            (--L->hookcount == 0 || L->hookmask & LUA_MASKLINE)) { \
+          traceexec(L, pc); \
+          if (L->status == LUA_YIELD) { \
+            L->savedpc = pc - 1; \
+            return; \
+          } \
+          base = L->base; \
+        } \
+        updatetrap(); \
       }
 
+/**
+ * @brief 取指宏
+ *
+ * 详细说明：
+ * 读取下一条指令并递增PC，最后解码A操作数。
+ * 在跳转表模式下，这段代码会被复制到每个指令处理器的末尾；钩子检查
+ * 由插桩分发表hooktab统一跳转到L_hook完成，快速路径上不出现。
+ * 在switch模式下，用局部trap标志决定是否进行钩子检查。
+ */
+#if defined(LUA_USE_JUMPTABLE)
+#define vmfetch() { \
+        i = *pc++; \
+        ra = RA(i); \
+        lua_assert(base == L->base && L->base == L->ci->base); \
+        lua_assert(base <= L->top && L->top <= L->stack + L->stacksize); \
+        lua_assert(L->top == L->ci->top || luaG_checkopenop(i)); \
+      }
+#else
+#define vmfetch() { \
+        i = *pc++; \
+        if (trap) hookcheck(); \
+        ra = RA(i); \
+        lua_assert(base == L->base && L->base == L->ci->base); \
+        lua_assert(base <= L->top && L->top <= L->stack + L->stacksize); \
+        lua_assert(L->top == L->ci->top || luaG_checkopenop(i)); \
+      }
+#endif
+
+/**
+ * @brief 指令分发宏
+ *
+ * 详细说明：
+ * vmdispatch/vmcase/vmbreak抽象了两种分发方式：
+ *
+ * - 跳转表模式（LUA_USE_JUMPTABLE）：vmcase展开为标签，vmbreak在处理器
+ *   末尾直接取下一条指令并通过disptab间接跳转，每个处理器各有一条
+ *   独立的间接跳转指令
+ * - switch模式（可移植回退）：vmcase展开为case，vmbreak回到循环顶部，
+ *   所有指令共享switch的同一条间接跳转
+ *
+ * @see LUA_USE_JUMPTABLE
+ */
+#if defined(LUA_USE_JUMPTABLE)
+#define vmdispatch(o)   goto *disp[o];
+#define vmcase(l)       L_##l:
+#define vmbreak         { vmfetch(); vmdispatch(GET_OPCODE(i)); }
+#else
+#define vmdispatch(o)   switch (o)
+#define vmcase(l)       case l:
+#define vmbreak         continue
+#endif
+
+/**
+ * @brief 超级指令的后半部分
+ *
+ * 详细说明：
+ * 融合指令执行完第一条指令后，跳转表模式下直接取出紧随其后的第二条
+ * 指令（luaK_fuse保证它的操作码是l）并跳到l的处理器，省去一次经过
+ * 分发表的间接跳转。第一条指令可能打开了钩子，此时按普通方式取指，
+ * 让第二条指令经过钩子检查。switch模式下退化为普通的vmbreak。
+ *
+ * @param l 第二条指令的操作码
+ *
+ * @see luaK_fuse
+ */
+#if defined(LUA_USE_JUMPTABLE)
+#define vmfuse(l) { \
+        if (disp == disptab) { \
+          vmfetch(); \
+          lua_assert(GET_OPCODE(i) == l); \
+          goto L_##l; \
+        } \
+        vmbreak; \
+      }
+#else
+#define vmfuse(l)       vmbreak
+#endif
+
+/**
+ * @brief 进入JIT机器码
+ *
+ * 详细说明：
+ * 当前函数已编译且没有行/计数钩子时，从pc处转入机器码执行。机器码
+ * 遇到调用、返回或需要钩子的回跳时把退出位置写回L->savedpc并返回，
+ * 解释器从该位置继续。jitloop在循环回跳处额外统计热度，使只被调用
+ * 一次的长循环函数也能被编译（栈上替换）。
+ *
+ * 使用位置：reentry、C函数调用返回后、循环回跳之后（pc已指向目标）。
+ *
+ * @see luaJ_run, luaJ_hot
+ */
+#if defined(LUA_USE_JIT)
+#define jitenter() { \
+        if (cl->p->jitstate == JIT_READY && G(L)->jiton && \
+            !(L->hookmask & (LUA_MASKLINE | LUA_MASKCOUNT))) { \
+          luaJ_run(L, cl, pc); \
+          pc = L->savedpc; \
+          base = L->base; \
+          updatetrap(); \
+        } \
+      }
+#define jitloop()       { luaJ_hot(L, cl->p); jitenter(); }
+#else
+#define jitenter()      ((void)0)
+#define jitloop()       ((void)0)
+#endif
+
 /** @} */
 
 
@@ -1554,6 +2043,31 @@ void luaV_execute(lua_State *L, int nexeccalls) {
     StkId base;                // 栈基址指针
     TValue *k;                 // 常量表指针
     const Instruction *pc;     // 程序计数器
+    Instruction i;             // 当前指令
+    StkId ra;                  // 指令的A操作数
+#if defined(LUA_USE_JUMPTABLE)
+    // 跳转表：顺序必须与lopcodes.h中OpCode枚举完全一致
+    static const void *const disptab[NUM_OPCODES] = {
+        &&L_OP_MOVE, &&L_OP_LOADK, &&L_OP_LOADBOOL, &&L_OP_LOADNIL,
+        &&L_OP_GETUPVAL, &&L_OP_GETGLOBAL, &&L_OP_GETTABLE,
+        &&L_OP_SETGLOBAL, &&L_OP_SETUPVAL, &&L_OP_SETTABLE,
+        &&L_OP_NEWTABLE, &&L_OP_SELF, &&L_OP_ADD, &&L_OP_SUB,
+        &&L_OP_MUL, &&L_OP_DIV, &&L_OP_MOD, &&L_OP_POW, &&L_OP_UNM,
+        &&L_OP_NOT, &&L_OP_LEN, &&L_OP_CONCAT, &&L_OP_JMP, &&L_OP_EQ,
+        &&L_OP_LT, &&L_OP_LE, &&L_OP_TEST, &&L_OP_TESTSET, &&L_OP_CALL,
+        &&L_OP_TAILCALL, &&L_OP_RETURN, &&L_OP_FORLOOP, &&L_OP_FORPREP,
+        &&L_OP_TFORLOOP, &&L_OP_SETLIST, &&L_OP_CLOSE, &&L_OP_CLOSURE,
+        &&L_OP_VARARG, &&L_OP_GETGLOBAL_CALL, &&L_OP_GETGLOBAL_GETTABLE,
+        &&L_OP_GETTABLE_GETTABLE
+    };
+    // 插桩分发表：所有操作码先经过L_hook做钩子检查，再转入disptab
+    static const void *const hooktab[NUM_OPCODES] = {
+        [0 ... NUM_OPCODES - 1] = &&L_hook
+    };
+    const void *const *disp;   // 当前使用的分发表
+#else
+    int trap;                  // 是否需要钩子检查
+#endif
 
 reentry:
     // 虚拟机状态初始化
@@ -1562,163 +2076,206 @@ reentry:
     cl = &clvalue(L->ci->func)->l;
     base = L->base;
     k = cl->p->k;
+    updatetrap();
+    jitenter();
 
     // 主执行循环 - 字节码解释执行
     for (;;) {
-        const Instruction i = *pc++;    // 获取当前指令并递增PC
-        StkId ra;                       // 指令的A操作数
-
-        // 调试钩子检查 - 处理行钩子和计数钩子
-        if ((L->hookmask & (LUA_MASKLINE | LUA_MASKCOUNT)) &&
-            (--L->hookcount == 0 || L->hookmask & LUA_MASKLINE)) {
-
-            traceexec(L, pc);
-            if (L->status == LUA_YIELD) {
-                L->savedpc = pc - 1;
-                return;
-            }
-            base = L->base;
-        }
-
-        // 指令解码和断言检查
-        ra = RA(i);
-        lua_assert(base == L->base && L->base == L->ci->base);
-        lua_assert(base <= L->top && L->top <= L->stack + L->stacksize);
-        lua_assert(L->top == L->ci->top || luaG_checkopenop(i));
+        // 取指
+        vmfetch();
 
         // 字节码指令分发
-        switch (GET_OPCODE(i)) {
-            case OP_MOVE: {
+        vmdispatch(GET_OPCODE(i)) {
+#if defined(LUA_USE_JUMPTABLE)
+            // 插桩变体的入口：检查钩子后分发到真正的指令处理器
+            L_hook: {
+                hookcheck();
+                ra = RA(i);
+                goto *disptab[GET_OPCODE(i)];
+            }
+#endif
+            vmcase(OP_MOVE) {
                 setobjs2s(L, ra, RB(i));
-                continue;
+                vmbreak;
             }
 
-            case OP_LOADK: {
+            vmcase(OP_LOADK) {
                 setobj2s(L, ra, KBx(i));
-                continue;
+                vmbreak;
             }
 
-            case OP_LOADBOOL: {
+            vmcase(OP_LOADBOOL) {
                 setbvalue(ra, GETARG_B(i));
                 if (GETARG_C(i)) {
                     pc++;
                 }
-                continue;
+                vmbreak;
             }
 
-            case OP_LOADNIL: {
+            vmcase(OP_LOADNIL) {
                 TValue *rb = RB(i);
                 do {
                     setnilvalue(rb--);
                 } while (rb >= ra);
-                continue;
+                vmbreak;
             }
-            case OP_GETUPVAL: {
+            vmcase(OP_GETUPVAL) {
                 int b = GETARG_B(i);
                 setobj2s(L, ra, cl->upvals[b]->v);
-                continue;
+                vmbreak;
             }
 
-            case OP_GETGLOBAL: {
-                TValue g;
-                TValue *rb = KBx(i);
-                sethvalue(L, &g, cl->env);
-                lua_assert(ttisstring(rb));
-                Protect(luaV_gettable(L, &g, rb, ra));
-                continue;
+            vmcase(OP_GETGLOBAL) {
+                getglobal_op();
+                vmbreak;
+            }
+
+            vmcase(OP_GETTABLE) {
+                gettable_op();
+                vmbreak;
+            }
+
+            vmcase(OP_GETGLOBAL_CALL) {
+                getglobal_op();
+                vmfuse(OP_CALL);
+            }
+
+            vmcase(OP_GETGLOBAL_GETTABLE) {
+                getglobal_op();
+                vmfuse(OP_GETTABLE);
             }
 
-            case OP_GETTABLE: {
-                Protect(luaV_gettable(L, RB(i), RKC(i), ra));
-                continue;
+            vmcase(OP_GETTABLE_GETTABLE) {
+                gettable_op();
+                vmfuse(OP_GETTABLE);
             }
 
-            case OP_SETGLOBAL: {
+            vmcase(OP_SETGLOBAL) {
                 TValue g;
                 sethvalue(L, &g, cl->env);
                 lua_assert(ttisstring(KBx(i)));
                 Protect(luaV_settable(L, &g, KBx(i), ra));
-                continue;
+                vmbreak;
             }
 
-            case OP_SETUPVAL: {
+            vmcase(OP_SETUPVAL) {
                 UpVal *uv = cl->upvals[GETARG_B(i)];
                 setobj(L, uv->v, ra);
                 luaC_barrier(L, uv, ra);
-                continue;
+                vmbreak;
             }
 
-            case OP_SETTABLE: {
-                Protect(luaV_settable(L, ra, RKB(i), RKC(i)));
-                continue;
+            vmcase(OP_SETTABLE) {
+                TValue *rb = RKB(i);
+                TValue *rc = RKC(i);
+                if (ttisrope(rc)) {
+                    // 表中不保存rope，luaV_settable会压平它
+                } else if (ISK(GETARG_B(i)) && ttisstring(rb) && ttistable(ra)) {
+                    // 已存在的键：与luaV_settable的原始赋值路径相同
+                    Table *h = hvalue(ra);
+                    TValue *oldval = cast(TValue *,
+                        luaH_getstrhint(h, rawtsvalue(rb), ICACHE()));
+                    if (!ttisnil(oldval)) {
+                        setobj2t(L, oldval, rc);
+                        h->flags = 0;
+                        luaC_barriert(L, h, rc);
+                        vmbreak;
+                    }
+                } else if (ttisint(rb) && ttistable(ra)) {
+                    // 整数子类型的键落在数组部分：没有__newindex时原始赋值
+                    Table *h = hvalue(ra);
+                    unsigned int k = cast(unsigned int, ivalue(rb)) - 1u;
+                    if (k < cast(unsigned int, h->sizearray) &&
+                        (!ttisnil(&h->array[k]) || h->metatable == NULL)) {
+                        setobj2t(L, &h->array[k], rc);
+                        luaC_barriert(L, h, rc);
+                        vmbreak;
+                    }
+                }
+                Protect(luaV_settable(L, ra, rb, rc));
+                vmbreak;
             }
 
-            case OP_NEWTABLE: {
+            vmcase(OP_NEWTABLE) {
                 int b = GETARG_B(i);
                 int c = GETARG_C(i);
                 sethvalue(L, ra, luaH_new(L, luaO_fb2int(b), luaO_fb2int(c)));
                 Protect(luaC_checkGC(L));
-                continue;
+                vmbreak;
             }
 
-            case OP_SELF: {
+            vmcase(OP_SELF) {
                 StkId rb = RB(i);
+                TValue *rc = RKC(i);
                 setobjs2s(L, ra + 1, rb);
-                Protect(luaV_gettable(L, rb, RKC(i), ra));
-                continue;
+                if (ISK(GETARG_C(i)) && ttisstring(rc)) {
+                    const TValue *res;
+                    if (ttistable(rb) &&
+                        (res = icprobe(hvalue(rb), rawtsvalue(rc), ICACHE())) != NULL) {
+                        setobj2s(L, ra, res);
+                    } else {
+                        Protect(luaV_gettablestr(L, rb, rc, ra, ICACHE()));
+                    }
+                } else {
+                    Protect(luaV_gettable(L, rb, rc, ra));
+                }
+                vmbreak;
             }
             // 算术运算指令组
-            case OP_ADD: {
-                arith_op(luai_numadd, TM_ADD);
-                continue;
+            vmcase(OP_ADD) {
+                arith_op(luai_numadd, intadd, TM_ADD);
+                vmbreak;
             }
 
-            case OP_SUB: {
-                arith_op(luai_numsub, TM_SUB);
-                continue;
+            vmcase(OP_SUB) {
+                arith_op(luai_numsub, intsub, TM_SUB);
+                vmbreak;
             }
 
-            case OP_MUL: {
-                arith_op(luai_nummul, TM_MUL);
-                continue;
+            vmcase(OP_MUL) {
+                arith_op(luai_nummul, intmul, TM_MUL);
+                vmbreak;
             }
 
-            case OP_DIV: {
-                arith_op(luai_numdiv, TM_DIV);
-                continue;
+            vmcase(OP_DIV) {
+                arith_op(luai_numdiv, intnone, TM_DIV);
+                vmbreak;
             }
 
-            case OP_MOD: {
-                arith_op(luai_nummod, TM_MOD);
-                continue;
+            vmcase(OP_MOD) {
+                arith_op(luai_nummod, intmod, TM_MOD);
+                vmbreak;
             }
 
-            case OP_POW: {
-                arith_op(luai_numpow, TM_POW);
-                continue;
+            vmcase(OP_POW) {
+                arith_op(luai_numpow, intnone, TM_POW);
+                vmbreak;
             }
 
-            case OP_UNM: {
+            vmcase(OP_UNM) {
                 TValue *rb = RB(i);
-                if (ttisnumber(rb)) {
+                int ri;
+                if (ttisint(rb) && intunm(ivalue(rb), &ri)) {
+                    setivalue(ra, ri);
+                } else if (ttisnumber(rb)) {
                     lua_Number nb = nvalue(rb);
                     setnvalue(ra, luai_numunm(nb));
                 } else {
-                    Protect(Arith(L, ra, rb, rb, TM_UNM));
+                    Protect(luaV_arith(L, ra, rb, rb, TM_UNM));
                 }
-                continue;
+                vmbreak;
             }
 
-            case OP_NOT: {
+            vmcase(OP_NOT) {
                 int res = l_isfalse(RB(i));
                 setbvalue(ra, res);
-                continue;
+                vmbreak;
             }
-            case OP_LEN: {
+            vmcase(OP_LEN) {
                 const TValue *rb = RB(i);
                 switch (ttype(rb)) {
                     case LUA_TTABLE: {
-                        setnvalue(ra, cast_num(luaH_getn(hvalue(rb))));
+                        setivalue(ra, luaH_getn(hvalue(rb)));
                         break;
                     }
 
@@ -1727,6 +2284,11 @@ reentry:
                         break;
                     }
 
+                    case LUA_TROPE: {
+                        setnvalue(ra, cast_num(ropevalue(rb)->len));
+                        break;
+                    }
+
                     default: {
                         Protect(
                             if (!call_binTM(L, rb, luaO_nilobject, ra, TM_LEN))
@@ -1734,23 +2296,26 @@ reentry:
                         )
                     }
                 }
-                continue;
+                vmbreak;
             }
 
-            case OP_CONCAT: {
+            vmcase(OP_CONCAT) {
                 int b = GETARG_B(i);
                 int c = GETARG_C(i);
-                Protect(luaV_concat(L, c - b + 1, c); luaC_checkGC(L));
+                Protect(luaV_lazyconcat(L, c - b + 1, c); luaC_checkGC(L));
                 setobjs2s(L, RA(i), base + b);
-                continue;
+                vmbreak;
             }
 
             // 跳转和比较指令组
-            case OP_JMP: {
+            vmcase(OP_JMP) {
                 dojump(L, pc, GETARG_sBx(i));
-                continue;
+                if (GETARG_sBx(i) < 0) {
+                    jitloop();
+                }
+                vmbreak;
             }
-            case OP_EQ: {
+            vmcase(OP_EQ) {
                 TValue *rb = RKB(i);
                 TValue *rc = RKC(i);
                 Protect(
@@ -1758,46 +2323,60 @@ reentry:
                         dojump(L, pc, GETARG_sBx(*pc));
                 )
                 pc++;
-                continue;
+                vmbreak;
             }
 
-            case OP_LT: {
-                Protect(
-                    if (luaV_lessthan(L, RKB(i), RKC(i)) == GETARG_A(i))
+            vmcase(OP_LT) {
+                TValue *rb = RKB(i);
+                TValue *rc = RKC(i);
+                if (ttisint(rb) && ttisint(rc)) {
+                    if ((ivalue(rb) < ivalue(rc)) == GETARG_A(i))
                         dojump(L, pc, GETARG_sBx(*pc));
-                )
+                } else {
+                    Protect(
+                        if (luaV_lessthan(L, rb, rc) == GETARG_A(i))
+                            dojump(L, pc, GETARG_sBx(*pc));
+                    )
+                }
                 pc++;
-                continue;
+                vmbreak;
             }
 
-            case OP_LE: {
-                Protect(
-                    if (lessequal(L, RKB(i), RKC(i)) == GETARG_A(i))
+            vmcase(OP_LE) {
+                TValue *rb = RKB(i);
+                TValue *rc = RKC(i);
+                if (ttisint(rb) && ttisint(rc)) {
+                    if ((ivalue(rb) <= ivalue(rc)) == GETARG_A(i))
                         dojump(L, pc, GETARG_sBx(*pc));
-                )
+                } else {
+                    Protect(
+                        if (luaV_lessequal(L, rb, rc) == GETARG_A(i))
+                            dojump(L, pc, GETARG_sBx(*pc));
+                    )
+                }
                 pc++;
-                continue;
+                vmbreak;
             }
 
-            case OP_TEST: {
+            vmcase(OP_TEST) {
                 if (l_isfalse(ra) != GETARG_C(i)) {
                     dojump(L, pc, GETARG_sBx(*pc));
                 }
                 pc++;
-                continue;
+                vmbreak;
             }
 
-            case OP_TESTSET: {
+            vmcase(OP_TESTSET) {
                 TValue *rb = RB(i);
                 if (l_isfalse(rb) != GETARG_C(i)) {
                     setobjs2s(L, ra, rb);
                     dojump(L, pc, GETARG_sBx(*pc));
                 }
                 pc++;
-                continue;
+                vmbreak;
             }
             // 函数调用指令组
-            case OP_CALL: {
+            vmcase(OP_CALL) {
                 int b = GETARG_B(i);
                 int nresults = GETARG_C(i) - 1;
 
@@ -1817,7 +2396,9 @@ reentry:
                             L->top = L->ci->top;
                         }
                         base = L->base;
-                        continue;
+                        updatetrap();
+                        jitenter();
+                        vmbreak;
                     }
 
                     default: {
@@ -1825,7 +2406,7 @@ reentry:
                     }
                 }
             }
-            case OP_TAILCALL: {
+            vmcase(OP_TAILCALL) {
                 int b = GETARG_B(i);
 
                 if (b != 0) {
@@ -1862,7 +2443,8 @@ reentry:
 
                     case PCRC: {
                         base = L->base;
-                        continue;
+                        updatetrap();
+                        vmbreak;
                     }
 
                     default: {
@@ -1870,7 +2452,7 @@ reentry:
                     }
                 }
             }
-            case OP_RETURN: {
+            vmcase(OP_RETURN) {
                 int b = GETARG_B(i);
 
                 if (b != 0) {
@@ -1882,6 +2464,13 @@ reentry:
                 }
 
                 L->savedpc = pc;
+                if (nexeccalls == 1) {
+                    // 返回到C：返回值中不能有rope
+                    StkId res;
+                    for (res = ra; res < L->top; res++) {
+                        luaS_flatobj(L, res);
+                    }
+                }
                 b = luaD_poscall(L, ra);
 
                 if (--nexeccalls == 0) {
@@ -1896,26 +2485,44 @@ reentry:
                 }
             }
             // 循环控制指令组
-            case OP_FORLOOP: {
-                lua_Number step = nvalue(ra + 2);
-                lua_Number idx = luai_numadd(nvalue(ra), step);
-                lua_Number limit = nvalue(ra + 1);
-
-                if (luai_numlt(0, step) ? luai_numle(idx, limit)
-                                        : luai_numle(limit, idx)) {
-                    dojump(L, pc, GETARG_sBx(i));
-                    setnvalue(ra, idx);
-                    setnvalue(ra + 3, idx);
+            vmcase(OP_FORLOOP) {
+                if (ttisint(ra) && ttisint(ra + 1) && ttisint(ra + 2)) {
+                    /* 整数循环：步进溢出说明已经越过int范围内的上限 */
+                    int step = ivalue(ra + 2);
+                    int idx;
+                    if (intadd(ivalue(ra), step, &idx) &&
+                        (0 < step ? idx <= ivalue(ra + 1)
+                                  : ivalue(ra + 1) <= idx)) {
+                        dojump(L, pc, GETARG_sBx(i));
+                        setivalue(ra, idx);
+                        setivalue(ra + 3, idx);
+                        jitloop();
+                    }
+                } else {
+                    lua_Number step = nvalue(ra + 2);
+                    lua_Number idx = luai_numadd(nvalue(ra), step);
+                    lua_Number limit = nvalue(ra + 1);
+
+                    if (luai_numlt(0, step) ? luai_numle(idx, limit)
+                                            : luai_numle(limit, idx)) {
+                        dojump(L, pc, GETARG_sBx(i));
+                        setnvalue(ra, idx);
+                        setnvalue(ra + 3, idx);
+                        jitloop();
+                    }
                 }
-                continue;
+                vmbreak;
             }
 
-            case OP_FORPREP: {
+            vmcase(OP_FORPREP) {
                 const TValue *init = ra;
                 const TValue *plimit = ra + 1;
                 const TValue *pstep = ra + 2;
 
                 L->savedpc = pc;
+                luaS_flatobj(L, ra);
+                luaS_flatobj(L, ra + 1);
+                luaS_flatobj(L, ra + 2);
 
                 if (!tonumber(init, ra)) {
                     luaG_runerror(L, LUA_QL("for")
@@ -1928,11 +2535,23 @@ reentry:
                                   " step must be a number");
                 }
 
-                setnvalue(ra, luai_numsub(nvalue(ra), nvalue(pstep)));
+                {
+                    int ri;
+                    if (ttisint(ra) && ttisint(ra + 1) && ttisint(ra + 2) &&
+                        intsub(ivalue(ra), ivalue(ra + 2), &ri)) {
+                        setivalue(ra, ri);  /* 三个值都是整数：整数循环 */
+                    } else {
+                        /* 浮点循环：统一为浮点表示，FORLOOP据此选择路径 */
+                        lua_Number init0 = nvalue(ra);
+                        setnvalue(ra + 1, nvalue(ra + 1));
+                        setnvalue(ra + 2, nvalue(ra + 2));
+                        setnvalue(ra, luai_numsub(init0, nvalue(ra + 2)));
+                    }
+                }
                 dojump(L, pc, GETARG_sBx(i));
-                continue;
+                vmbreak;
             }
-            case OP_TFORLOOP: {
+            vmcase(OP_TFORLOOP) {
                 StkId cb = ra + 3;
                 setobjs2s(L, cb + 2, ra + 2);
                 setobjs2s(L, cb + 1, ra + 1);
@@ -1946,12 +2565,15 @@ reentry:
                 if (!ttisnil(cb)) {
                     setobjs2s(L, cb - 1, cb);
                     dojump(L, pc, GETARG_sBx(*pc));
+                    pc++;
+                    jitloop();
+                    vmbreak;
                 }
                 pc++;
-                continue;
+                vmbreak;
             }
 
-            case OP_SETLIST: {
+            vmcase(OP_SETLIST) {
                 int n = GETARG_B(i);
                 int c = GETARG_C(i);
                 int last;
@@ -1976,17 +2598,18 @@ reentry:
 
                 for (; n > 0; n--) {
                     TValue *val = ra + n;
+                    luaS_flatobj(L, val);
                     setobj2t(L, luaH_setnum(L, h, last--), val);
                     luaC_barriert(L, h, val);
                 }
-                continue;
+                vmbreak;
             }
-            case OP_CLOSE: {
+            vmcase(OP_CLOSE) {
                 luaF_close(L, ra);
-                continue;
+                vmbreak;
             }
 
-            case OP_CLOSURE: {
+            vmcase(OP_CLOSURE) {
                 Proto *p;
                 Closure *ncl;
                 int nup, j;
@@ -2007,10 +2630,10 @@ reentry:
 
                 setclvalue(L, ra, ncl);
                 Protect(luaC_checkGC(L));
-                continue;
+                vmbreak;
             }
 
-            case OP_VARARG: {
+            vmcase(OP_VARARG) {
                 int b = GETARG_B(i) - 1;
                 int j;
                 CallInfo *ci = L->ci;
@@ -2030,7 +2653,7 @@ reentry:
                         setnilvalue(ra + j);
                     }
                 }
-                continue;
+                vmbreak;
             }
         }
     }
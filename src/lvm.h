@@ -138,14 +138,14 @@
  * @note 转换后o指向n，调用者需要确保n的生命周期
  * @warning 此宏修改o的值，具有副作用
  */
-#define tonumber(o, n) (ttype(o) == LUA_TNUMBER || \
+#define tonumber(o, n) (ttisnumber(o) || \
                         (((o) = luaV_tonumber(o, n)) != NULL))
 
 /**
  * @brief 对象相等性比较：深度比较两个Lua对象的值
  * 
  * 实现原理：
- * 1. 首先比较对象类型，类型不同则必不相等
+ * 1. 首先比较对象类型（两种数字表示视为同一类型），类型不同则必不相等
  * 2. 类型相同时调用luaV_equalval进行值比较
  * 3. 可能触发__eq元方法进行自定义比较
  * 
@@ -170,7 +170,7 @@
  * @warning 元方法调用可能产生错误，需要适当的错误处理
  */
 #define equalobj(L, o1, o2) \
-    (ttype(o1) == ttype(o2) && luaV_equalval(L, o1, o2))
+    (basetype(o1) == basetype(o2) && luaV_equalval(L, o1, o2))
 
 /**
  * @brief 虚拟机核心函数声明：Lua虚拟机的主要操作接口
@@ -222,6 +222,16 @@
  */
 LUAI_FUNC int luaV_lessthan(lua_State *L, const TValue *l, const TValue *r);
 
+/**
+ * @brief 按当前locale比较两个字符串（支持内嵌的'\0'）
+ *
+ * 字符串<和<=运算使用的比较，table.sort的整块排序也用它。
+ *
+ * @return 负数、零或正数，含义与strcmp相同
+ * @see luaV_lessthan()
+ */
+LUAI_FUNC int luaV_strcmp(const TString *ls, const TString *rs);
+
 /**
  * @brief 相等性比较：实现Lua的"=="操作符深度语义
  * 
@@ -588,4 +598,54 @@ LUAI_FUNC void luaV_execute(lua_State *L, int nexeccalls);
  */
 LUAI_FUNC void luaV_concat(lua_State *L, int total, int last);
 
+/**
+ * @brief OP_CONCAT的字符串连接：长的左操作数只被引用
+ *
+ * 详细说明：
+ * 与luaV_concat相同，但左操作数是rope或不短于LUAI_ROPEMIN的字符串时
+ * 结果是rope（LUA_TROPE），不复制左操作数。只用于结果写回Lua寄存器
+ * 的场合。
+ *
+ * @param L Lua状态机
+ * @param total 要连接的值的总数
+ * @param last 最后一个值在栈中的索引
+ *
+ * @see luaV_concat, luaS_newrope
+ */
+LUAI_FUNC void luaV_lazyconcat(lua_State *L, int total, int last);
+
+/**
+ * @brief 小于等于比较（支持__le/__lt元方法）
+ *
+ * 与luaV_lessthan对应，实现OP_LE的完整语义：优先使用__le，
+ * 没有时回退为not (r < l)。
+ *
+ * @return 如果l <= r返回非零值，否则返回0
+ * @see luaV_lessthan
+ */
+LUAI_FUNC int luaV_lessequal(lua_State *L, const TValue *l, const TValue *r);
+
+/**
+ * @brief 算术运算的通用路径
+ *
+ * 先尝试把操作数转换为数字（包括数字字符串），失败时调用对应的
+ * 算术元方法，没有元方法则抛出算术错误。结果写入ra。
+ *
+ * @param op 运算类型（TM_ADD至TM_UNM）
+ * @see luaV_tonumber
+ */
+LUAI_FUNC void luaV_arith(lua_State *L, StkId ra, const TValue *rb,
+                          const TValue *rc, TMS op);
+
+/**
+ * @brief 以字符串常量为键的表读取（带内联缓存）
+ *
+ * 语义与luaV_gettable相同，hint是当前指令的内联缓存项，
+ * 在__index链的每一层表上用作槽位提示。
+ *
+ * @see luaV_gettable, luaH_getstrhint
+ */
+LUAI_FUNC void luaV_gettablestr(lua_State *L, const TValue *t, TValue *key,
+                                StkId val, int *hint);
+
 #endif
@@ -235,7 +235,7 @@ static void PrintString(const TString* ts)
 static void PrintConstant(const Proto* f, int i)
 {
     const TValue* o=&f->k[i];
-    switch (ttype(o))
+    switch (basetype(o))
     {
     case LUA_TNIL:
         printf("nil");
@@ -344,7 +344,7 @@ static void PrintCode(const Proto* f)
         int line=getline(f,pc);
         printf("\t%d\t",pc+1);
         if (line>0) printf("[%d]\t",line); else printf("[-]\t");
-        printf("%-9s\t",luaP_opnames[o]);
+        printf("%-9s\t",luaP_opnames[stockop(o)]);
         switch (getOpMode(o))
         {
         case iABC:
@@ -359,7 +359,7 @@ static void PrintCode(const Proto* f)
             if (o==OP_JMP) printf("%d",sbx); else printf("%d %d",a,sbx);
             break;
         }
-        switch (o)
+        switch (stockop(o))
         {
         case OP_LOADK:
             printf("\t; "); PrintConstant(f,bx);
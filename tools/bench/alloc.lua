@@ -0,0 +1,36 @@
+-- 小对象分配基准测试
+-- 用法: lua tools/bench/alloc.lua [倍数]
+-- 大量创建和丢弃小表、闭包（带上值）和短字符串，时间主要花在分配和
+-- 释放上。用于比较默认构建与分级内存池（-DLUA_USE_SLAB）的构建。
+-- 最后打印内存池各大小类的统计（不使用内存池时为空）。
+
+local scale = tonumber(arg and arg[1]) or 1
+local bench = dofile((arg[0]:gsub("[^/\\]*$", "")) .. "common.lua").bench(scale)
+
+bench("tables", function(n)
+  local keep = {}
+  for i = 1, n do
+    keep[i % 1000 + 1] = {i, i + 1, x = i}
+  end
+end, 3000000)
+
+bench("closures", function(n)
+  local keep = {}
+  for i = 1, n do
+    local a = i
+    keep[i % 1000 + 1] = function() return a end
+  end
+end, 3000000)
+
+bench("strings", function(n)
+  local keep = {}
+  for i = 1, n do
+    keep[i % 1000 + 1] = "s" .. i
+  end
+end, 3000000)
+
+for _, c in ipairs(collectgarbage("slab")) do
+  if c.used + c.free > 0 then
+    print(string.format("slab %3d     %8d used %8d free", c.size, c.used, c.free))
+  end
+end
@@ -0,0 +1,43 @@
+-- luaL_Buffer基准测试
+-- 用法: lua tools/bench/buffer.lua [倍数]
+-- 生成几MB的结果：table.concat、gsub（替换函数）、string.format的长
+-- %s参数和io.read("*a")。逐片压栈再连接的实现会产生大量中间字符串，
+-- 单一可增长存储区（LUA_USE_GROWBUFFER）只在最后创建一次结果。
+
+local scale = tonumber(arg and arg[1]) or 1
+local bench = dofile((arg[0]:gsub("[^/\\]*$", "")) .. "common.lua").bench(scale)
+
+local t = {}
+for i = 1, 200000 do t[i] = "item" .. i end
+local text = table.concat(t, " ")
+
+bench("concat", function(n)
+  for _ = 1, n do table.concat(t, ",") end
+end, 20)
+
+bench("gsub-func", function(n)
+  for _ = 1, n do
+    string.gsub(text, "%d+", function(d) return "<" .. d .. ">" end)
+  end
+end, 5)
+
+bench("gsub-str", function(n)
+  for _ = 1, n do string.gsub(text, "item", "entry") end
+end, 10)
+
+bench("format", function(n)
+  for _ = 1, n do string.format("[%s] (%s)", text, text) end
+end, 50)
+
+local name = os.tmpname()
+local f = assert(io.open(name, "wb"))
+for _ = 1, 4 do f:write(text, "\n") end
+f:close()
+bench("read-all", function(n)
+  for _ = 1, n do
+    local h = assert(io.open(name, "rb"))
+    h:read("*a")
+    h:close()
+  end
+end, 50)
+os.remove(name)
@@ -0,0 +1,21 @@
+-- 基准测试脚本共用的计时函数
+-- 用法: local bench = dofile((arg[0]:gsub("[^/\\]*$", "")) .. "common.lua").bench(scale)
+-- bench(name, f, n)运行f(n * scale)，按"名称 耗时"打印一行。showresult
+-- 为真时在行尾附上f返回的整数（例如匹配次数），用来确认各构建的结果一致。
+
+local M = {}
+
+function M.bench(scale, showresult)
+  return function(name, f, n)
+    local t0 = os.clock()
+    local r = f(n * scale)
+    local t = os.clock() - t0
+    if showresult then
+      print(string.format("%-12s %8.3f s  (%d)", name, t, r))
+    else
+      print(string.format("%-12s %8.3f s", name, t))
+    end
+  end
+end
+
+return M
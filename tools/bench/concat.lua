@@ -0,0 +1,46 @@
+-- 字符串连接基准测试
+-- 用法: lua tools/bench/concat.lua [倍数]
+-- append: 循环中s = s .. piece，逐步增长一个长字符串；
+-- upvalue: 同样的累加经过上值；
+-- short: 大量短字符串连接（低于rope门槛，衡量普通路径的开销）；
+-- buffer: 用表收集再table.concat，作为参照。
+-- 用于比较延迟连接（rope）前后的构建。
+
+local scale = tonumber(arg and arg[1]) or 1
+local bench = dofile((arg[0]:gsub("[^/\\]*$", "")) .. "common.lua").bench(scale)
+
+local piece = "0123456789abcdef"
+
+bench("append", function(n)
+  for _ = 1, 10 do
+    local s = ""
+    for i = 1, n do s = s .. piece end
+    assert(#s == n * #piece)
+  end
+end, 20000)
+
+bench("upvalue", function(n)
+  for _ = 1, 10 do
+    local s = ""
+    local function add(x) s = s .. x end
+    for i = 1, n do add(piece) end
+    assert(#s == n * #piece)
+  end
+end, 20000)
+
+bench("short", function(n)
+  local k = 0
+  for i = 1, n do
+    local s = "k" .. (i % 100) .. "_" .. piece
+    k = k + #s
+  end
+  return k
+end, 2000000)
+
+bench("buffer", function(n)
+  for _ = 1, 10 do
+    local t = {}
+    for i = 1, n do t[i] = piece end
+    assert(#table.concat(t) == n * #piece)
+  end
+end, 20000)
@@ -0,0 +1,48 @@
+-- 时间预算步进基准测试
+-- 用法: lua tools/bench/gc_budget.lua [预算微秒] [倍数] [大表元素数]
+-- 模拟按帧运行的宿主：一个长期存活的大堆加上每帧产生的临时对象，
+-- 其中夹杂一些很大的表（大表元素数为0时没有）。每帧记录这一帧中最长
+-- 的一次回收步进，报告它的p50、p99和最大值、超出预算的帧数、总时间和
+-- 结束时的内存。预算为0时按gcstepmul计算的工作量步进。
+
+local budget = tonumber(arg and arg[1]) or 0
+local scale = tonumber(arg and arg[2]) or 1
+local bigsize = tonumber(arg and arg[3]) or 20000
+collectgarbage("setbudget", budget)
+
+local world = {}
+for i = 1, 100000 do
+  world[i] = {id = i, pos = {i, i}, name = "e" .. i}
+end
+
+local steps = {}
+local keep = {}
+collectgarbage("maxstep", 1)    -- 清零并开始统计
+local t0 = os.clock()
+for f = 1, 2000 * scale do
+  for i = 1, 500 do
+    local e = world[(f * 500 + i) % #world + 1]
+    e.pos = {e.pos[1] + 1, e.pos[2]}
+  end
+  if f % 50 == 0 and bigsize > 0 then
+    local big = {}
+    for i = 1, bigsize do big[i] = {i} end
+    keep[f % 5 + 1] = big
+  end
+  steps[#steps + 1] = collectgarbage("maxstep")
+end
+local total = os.clock() - t0
+local over = 0
+for i = 1, #steps do
+  if budget > 0 and steps[i] > budget then over = over + 1 end
+end
+
+table.sort(steps)
+print(string.format("%-12s %8.3f s", "total", total))
+print(string.format("%-12s %8.3f ms", "step p50",
+                    steps[math.ceil(#steps * 0.5)] / 1000))
+print(string.format("%-12s %8.3f ms", "step p99",
+                    steps[math.ceil(#steps * 0.99)] / 1000))
+print(string.format("%-12s %8.3f ms", "step max", steps[#steps] / 1000))
+print(string.format("%-12s %8d", "over budget", over))
+print(string.format("%-12s %8.1f KB", "memory", collectgarbage("count")))
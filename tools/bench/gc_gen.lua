@@ -0,0 +1,38 @@
+-- 分代回收基准测试
+-- 用法: lua tools/bench/gc_gen.lua [incremental|generational] [倍数]
+-- 模拟服务器负载：先建立一个长期存活的大堆（配置表和会话表），
+-- 然后产生大量短命的临时对象，偶尔修改老表。分别报告建堆时间、
+-- 临时对象阶段的时间和结束时的内存占用。
+
+local mode = arg and arg[1] or "incremental"
+local scale = tonumber(arg and arg[2]) or 1
+collectgarbage(mode)
+
+local function bench(name, f)
+  local t0 = os.clock()
+  f()
+  print(string.format("%-12s %8.3f s", name, os.clock() - t0))
+end
+
+local sessions = {}
+bench("build-old", function()
+  for i = 1, 200000 do
+    sessions[i] = {id = i, name = "user" .. i, tags = {"a", "b", i % 7},
+                   cfg = {limit = i % 100, ratio = i / 3}}
+  end
+end)
+
+bench("temporaries", function()
+  local sum = 0
+  for r = 1, 3000000 * scale do
+    local req = {r, tostring(r % 1000), {x = r}}
+    sum = sum + #req[2] + req[3].x % 3
+    if r % 1000 == 0 then
+      local s = sessions[r % #sessions + 1]
+      s.last = {r}
+    end
+  end
+  return sum
+end)
+
+print(string.format("%-12s %8.1f KB", "memory", collectgarbage("count")))
@@ -0,0 +1,22 @@
+-- 标记阶段基准测试
+-- 用法: lua tools/bench/gc_mark.lua [辅助线程数] [倍数]
+-- 建立一个大而宽的对象图（一个大数组，每个元素是带子表的小表），然后
+-- 计时若干次完整回收。完整回收的时间几乎都花在标记上，用于比较串行
+-- 标记（0）和并行标记（-DLUA_USE_PARMARK构建，线程数大于0）。
+-- os.clock是所有线程的CPU时间之和，并行标记的收益要用墙钟时间衡量，
+-- 例如 time lua tools/bench/gc_mark.lua 3。
+
+local helpers = tonumber(arg and arg[1]) or 3
+local scale = tonumber(arg and arg[2]) or 1
+
+local t = {}
+for i = 1, 300000 * scale do
+  t[i] = {i, {i}, "x", f = function() return i end}
+end
+collectgarbage("parmark", helpers)
+collectgarbage()
+
+local t0 = os.clock()
+for _ = 1, 10 do collectgarbage() end
+print(string.format("%-12s %8.3f s", "full-gc cpu", os.clock() - t0))
+print(string.format("%-12s %8.1f KB", "memory", collectgarbage("count")))
@@ -0,0 +1,32 @@
+-- 清扫阶段基准测试
+-- 用法: lua tools/bench/gc_sweep.lua [0|1] [倍数]
+-- 反复建立大量小表后丢弃，再用单步回收完成一个周期，记录每一步的耗时。
+-- 清扫阶段的步骤主要花在释放死亡对象上，用于比较主线程直接释放（0）
+-- 和后台释放（-DLUA_USE_BGFREE构建，参数为1）。os.clock包含后台线程
+-- 的CPU时间，多核机器上应同时用time观察墙钟时间。
+
+local bgfree = tonumber(arg and arg[1]) or 1
+local scale = tonumber(arg and arg[2]) or 1
+collectgarbage("bgfree", bgfree)
+collectgarbage("stop")
+collectgarbage()                    -- 从暂停状态开始
+
+local steps = {}
+local t0 = os.clock()
+for _ = 1, 10 do
+  local t = {}
+  for i = 1, 200000 * scale do t[i] = {i, "x"} end
+  t = nil
+  repeat
+    local s = os.clock()
+    local done = collectgarbage("step", 64)
+    steps[#steps + 1] = os.clock() - s
+  until done
+end
+local total = os.clock() - t0
+
+table.sort(steps)
+print(string.format("%-12s %8.3f s", "total cpu", total))
+print(string.format("%-12s %8.3f ms", "step p99",
+                    steps[math.ceil(#steps * 0.99)] * 1000))
+print(string.format("%-12s %8.3f ms", "step max", steps[#steps] * 1000))
@@ -0,0 +1,66 @@
+-- 整数键表访问基准测试
+-- 用法: lua tools/bench/int_keys.lua [倍数]
+-- 覆盖以整数为下标的常见负载：数组填充与求和、筛法、矩阵乘法、
+-- ipairs遍历、整数运算的下标计算。用于比较启用与关闭整数子类型
+-- （-DLUA_NOINTNUM）的构建。
+
+local scale = tonumber(arg and arg[1]) or 1
+local bench = dofile((arg[0]:gsub("[^/\\]*$", "")) .. "common.lua").bench(scale)
+
+bench("fill/sum", function(n)
+  local t = {}
+  for i = 1, n do t[i] = i end
+  local s = 0
+  for i = 1, #t do s = s + t[i] end
+  return s
+end, 5000000)
+
+bench("sieve", function(n)
+  local count = 0
+  for _ = 1, n do
+    local flags = {}
+    for i = 2, 8192 do flags[i] = true end
+    for i = 2, 8192 do
+      if flags[i] then
+        for k = i + i, 8192, i do flags[k] = false end
+        count = count + 1
+      end
+    end
+  end
+  return count
+end, 400)
+
+bench("matmul", function(n)
+  local a, b, c = {}, {}, {}
+  for i = 1, n do
+    a[i], b[i], c[i] = {}, {}, {}
+    for j = 1, n do a[i][j] = i + j; b[i][j] = i - j; c[i][j] = 0 end
+  end
+  for i = 1, n do
+    local ai, ci = a[i], c[i]
+    for j = 1, n do
+      local s = 0
+      for k = 1, n do s = s + ai[k] * b[k][j] end
+      ci[j] = s
+    end
+  end
+  return c
+end, 160)
+
+bench("ipairs", function(n)
+  local t = {}
+  for i = 1, 1000 do t[i] = i end
+  local s = 0
+  for _ = 1, n do
+    for i, v in ipairs(t) do s = s + v end
+  end
+  return s
+end, 3000)
+
+bench("indexmath", function(n)
+  local t = {}
+  for i = 1, 1024 do t[i] = i end
+  local s = 0
+  for i = 1, n do s = s + t[i % 1024 + 1] + t[(i * 7) % 1024 + 1] end
+  return s
+end, 5000000)
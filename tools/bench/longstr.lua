@@ -0,0 +1,64 @@
+-- 长字符串基准测试
+-- 用法: lua tools/bench/longstr.lua [倍数]
+-- payload: 反复生成大块内容（模拟io.read("*a")和luaL_Buffer的结果）；
+-- create: 大量互不相同的中等长度字符串（大块内容的切片），创建后立即丢弃；
+-- live: 保留大量互不相同的长字符串（内部化时字符串表随之增长并多次
+--   重哈希）；
+-- lngkeys: 长字符串作表键的查找（长字符串要额外比较内容）；
+-- shortkeys: 短字符串键的字段访问，检查短字符串路径没有变慢。
+-- 用于比较长字符串不内部化前后的构建。
+
+local scale = tonumber(arg and arg[1]) or 1
+local bench = dofile((arg[0]:gsub("[^/\\]*$", "")) .. "common.lua").bench(scale)
+
+local big, seed = {}, 1
+for i = 1, 1048576 do
+  seed = seed * 16807 % 2147483647
+  big[i] = string.char(32 + seed % 95)
+end
+big = table.concat(big)    -- 1MB伪随机内容，不同位置的切片互不相同
+local chunk = string.sub(big, 1, 4096)
+
+bench("payload", function(n)
+  local len = 0
+  for i = 1, n do
+    len = len + #string.rep(chunk, 16, tostring(i))
+  end
+  return len
+end, 2000)
+
+bench("create", function(n)
+  local len = 0
+  for i = 1, n do
+    local p = (i * 4099) % (#big - 200) + 1
+    len = len + #string.sub(big, p, p + 99)
+  end
+  return len
+end, 3000000)
+
+bench("live", function(n)
+  local keep = {}
+  for i = 1, n do
+    local p = (i * 4099) % (#big - 200) + 1
+    keep[i] = string.sub(big, p, p + 99)
+  end
+  return keep
+end, 1000000)
+
+bench("lngkeys", function(n)
+  local t, keys = {}, {}
+  for i = 1, 1000 do
+    keys[i] = string.sub(chunk, i, i + 63)
+    t[keys[i]] = i
+  end
+  local s = 0
+  for i = 1, n do s = s + t[keys[i % 1000 + 1]] end
+  return s
+end, 5000000)
+
+bench("shortkeys", function(n)
+  local o = {alpha = 1, beta = 2, gamma = 3}
+  local s = 0
+  for i = 1, n do s = s + o.alpha + o.beta + o.gamma end
+  return s
+end, 10000000)
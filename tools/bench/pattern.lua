@@ -0,0 +1,54 @@
+-- 模式匹配基准测试
+-- 用法: lua tools/bench/pattern.lua [倍数]
+-- 模拟解析器：对短行反复使用同一批模式（带捕获的match、find、用gmatch
+-- 切分单词、gsub转义），以及在长文本中查找很少出现的字符类。
+-- 用于比较每次解析模式与使用编译缓存的版本。
+
+local scale = tonumber(arg and arg[1]) or 1
+local bench = dofile((arg[0]:gsub("[^/\\]*$", "")) .. "common.lua").bench(scale)
+
+local lines = {}
+for i = 1, 1000 do
+  lines[i] = string.format("  key_%d = %d, name=\"item %d\" -- [%s]", i, i * 37,
+                           i, string.rep("ab", i % 5))
+end
+
+bench("match-kv", function(n)
+  local c = 0
+  for r = 1, n do
+    local k, v = string.match(lines[r % 1000 + 1], "^%s*([%a_][%w_]*)%s*=%s*(%d+)")
+    if k then c = c + #k + v end
+  end
+  return c
+end, 1000000)
+
+bench("find-class", function(n)
+  local c = 0
+  for r = 1, n do
+    c = c + (string.find(lines[r % 1000 + 1], "%-%-%s*%[[ab]*%]") or 0)
+  end
+  return c
+end, 1000000)
+
+bench("gmatch-word", function(n)
+  local c = 0
+  for r = 1, n do
+    for w in string.gmatch(lines[r % 1000 + 1], "[%a_][%w_]*") do c = c + #w end
+  end
+  return c
+end, 200000)
+
+bench("gsub-escape", function(n)
+  local c = 0
+  for r = 1, n do
+    c = c + #string.gsub(lines[r % 1000 + 1], "[\"%[%]]", "\\%0")
+  end
+  return c
+end, 300000)
+
+local text = string.rep("lorem ipsum dolor sit amet ", 4000) .. "#42"
+bench("find-rare", function(n)
+  local c = 0
+  for _ = 1, n do c = c + string.find(text, "#(%d+)") end
+  return c
+end, 2000)
@@ -0,0 +1,48 @@
+-- 长文本中的字面查找基准测试
+-- 用法: lua tools/bench/strfind.lua [倍数]
+-- 模拟日志扫描：在约8MB的日志文本中用普通查找数出某个关键字的出现
+-- 次数、查找以字面前缀开头的模式，以及用gsub替换字面串。关键字的首
+-- 字节在文本中很常见，逐字节memchr加memcmp的查找在这里最慢。
+
+local scale = tonumber(arg and arg[1]) or 1
+local bench = dofile((arg[0]:gsub("[^/\\]*$", "")) .. "common.lua").bench(scale, true)
+
+local t = {}
+for i = 1, 100000 do
+  local level = (i % 997 == 0) and "ERROR" or (i % 3 == 0 and "WARN" or "INFO")
+  t[i] = string.format("2024-01-01 12:%02d:%02d [%s] request %d took %d ms",
+                       i % 60, i % 60, level, i, i % 500)
+end
+local log = table.concat(t, "\n")
+
+bench("find-plain", function(n)
+  local c = 0
+  for _ = 1, n do
+    local i = 1
+    while true do
+      local s, e = string.find(log, " [ERROR]", i, true)
+      if not s then break end
+      c, i = c + 1, e + 1
+    end
+  end
+  return c
+end, 20)
+
+bench("find-prefix", function(n)
+  local c = 0
+  for _ = 1, n do
+    local i = 1
+    while true do
+      local s, e = string.find(log, "ERROR%] request (%d+)", i)
+      if not s then break end
+      c, i = c + 1, e + 1
+    end
+  end
+  return c
+end, 20)
+
+bench("gsub-literal", function(n)
+  local c = 0
+  for _ = 1, n do c = c + select(2, string.gsub(log, " took 499 ms", " slow")) end
+  return c
+end, 20)
@@ -0,0 +1,50 @@
+-- 字符串哈希基准测试
+-- 用法: lua tools/bench/strhash.lua [倍数]
+-- intern: 创建大量不同的短字符串（哈希 + 字符串表查找）；
+-- key100/key1k/key10k: 新创建的长字符串第一次用作表键（长字符串在这时
+--   计算哈希），分别为100、1000和10000字节；
+-- flood: 只在旧的采样哈希不读取的位置上不同的键：40字节的短字符串
+--   （字符串表）和100字节的长字符串（表键）各2万个，旧哈希下全部冲突。
+-- 用于比较带种子的全长哈希与旧的采样哈希。
+
+local scale = tonumber(arg and arg[1]) or 1
+local bench = dofile((arg[0]:gsub("[^/\\]*$", "")) .. "common.lua").bench(scale)
+
+bench("intern", function(n)
+  local k = 0
+  for i = 1, n do
+    local s = "field_" .. i .. "_" .. (i % 977)
+    k = k + #s
+  end
+  return k
+end, 2000000)
+
+local function lngkeys(len)
+  return function(n)
+    local base = string.rep("a", len - 8)
+    local t = {}
+    for i = 1, n do
+      t[base .. string.format("%08d", i % 1000)] = i    -- 每次都是新对象
+    end
+    return t
+  end
+end
+bench("key100", lngkeys(100), 1000000)
+bench("key1k", lngkeys(1000), 200000)
+bench("key10k", lngkeys(10000), 20000)
+
+-- 旧哈希对n字节的字符串从末尾开始每隔(n >> 5) + 1个字节取一个，
+-- 40字节取奇数位置，100字节取3、7、11...，位置0和2都不参与
+local function collide(len, i)
+  local a = string.char(65 + i % 26, 65 + math.floor(i / 26) % 26,
+                        65 + math.floor(i / 676) % 26)
+  local s = a:sub(1, 1) .. "x" .. a:sub(2, 2) .. "x" .. a:sub(3, 3)
+  return s .. string.rep("y", len - #s)
+end
+
+bench("flood", function(n)
+  local t = {}
+  for i = 1, n do t[collide(40, i)] = i end
+  for i = 1, n do t[collide(100, i)] = i end
+  for i = 1, n do assert(t[collide(40, i)] == i and t[collide(100, i)] == i) end
+end, 17000)
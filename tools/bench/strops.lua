@@ -0,0 +1,38 @@
+-- 字符串批量操作基准测试
+-- 用法: lua tools/bench/strops.lua [倍数]
+-- string.upper、lower、reverse、rep和char，分别在短字符串（几十字节，
+-- 调用开销为主）和长字符串（约1MB，逐字节处理的开销为主）上计时。
+
+local scale = tonumber(arg and arg[1]) or 1
+local bench = dofile((arg[0]:gsub("[^/\\]*$", "")) .. "common.lua").bench(scale)
+
+local short = "Content-Type: text/html; charset=UTF-8"
+local long = string.rep("The Quick Brown Fox Jumps Over The Lazy Dog. ", 23000)
+
+bench("upper-short", function(n)
+  for _ = 1, n do string.upper(short) end
+end, 1000000)
+
+bench("lower-long", function(n)
+  for _ = 1, n do string.lower(long) end
+end, 200)
+
+bench("upper-long", function(n)
+  for _ = 1, n do string.upper(long) end
+end, 200)
+
+bench("reverse-long", function(n)
+  for _ = 1, n do string.reverse(long) end
+end, 200)
+
+bench("rep-short", function(n)
+  for _ = 1, n do string.rep("ab", 20) end
+end, 1000000)
+
+bench("rep-long", function(n)
+  for _ = 1, n do string.rep("0123456789", 100000) end
+end, 200)
+
+bench("char", function(n)
+  for i = 1, n do string.char(72, 101, 108, 108, 111, i % 256) end
+end, 1000000)
@@ -0,0 +1,76 @@
+-- 表哈希部分的基准测试
+-- 用法: lua tools/bench/table_hash.lua [倍数]
+-- 对不同大小的表分别计时插入（set）、命中和未命中的查找（get、miss）
+-- 以及pairs遍历（next）。键分为字符串、不连续的整数和表三类，都落在
+-- 哈希部分。每一项的总操作数大致相同，小表重复更多轮。用于比较默认的
+-- 链式哈希部分与分组探测的构建（-DLUA_USE_SWISSTABLE）。每项开始前
+-- 先完整回收一次，插入阶段的计时包含它产生的垃圾的回收。
+
+local scale = tonumber(arg and arg[1]) or 1
+local TOTAL = 2000000 * scale
+
+local function keyset(kind, n)
+  local keys = {}
+  for i = 1, n do
+    if kind == "string" then
+      keys[i] = "key" .. i
+    elseif kind == "int" then
+      keys[i] = i * 7919 + 1000003        -- 不连续，不会进入数组部分
+    else
+      keys[i] = {}
+    end
+  end
+  return keys
+end
+
+local function bench(kind, n)
+  local keys, others = keyset(kind, n), keyset(kind, n)
+  if kind == "string" then
+    for i = 1, n do others[i] = "other" .. i end
+  elseif kind == "int" then
+    for i = 1, n do others[i] = -i * 7919 end
+  end
+  local rounds = math.max(1, math.floor(TOTAL / n))
+  local t
+
+  collectgarbage()
+  local t0 = os.clock()
+  for _ = 1, rounds do
+    t = {}
+    for i = 1, n do t[keys[i]] = i end
+  end
+  local tset = os.clock() - t0
+
+  local s = 0
+  collectgarbage()    -- 上一阶段的垃圾不计入后面的查找和遍历
+  t0 = os.clock()
+  for _ = 1, rounds do
+    for i = 1, n do s = s + t[keys[i]] end
+  end
+  local tget = os.clock() - t0
+
+  t0 = os.clock()
+  for _ = 1, rounds do
+    for i = 1, n do if t[others[i]] then s = s + 1 end end
+  end
+  local tmiss = os.clock() - t0
+
+  t0 = os.clock()
+  for _ = 1, rounds do
+    for _, v in pairs(t) do s = s + v end
+  end
+  local tnext = os.clock() - t0
+
+  print(string.format("%-7s %8d %8.3f %8.3f %8.3f %8.3f", kind, n,
+                      tset, tget, tmiss, tnext))
+  return s
+end
+
+print(string.format("%-7s %8s %8s %8s %8s %8s", "keys", "size",
+                    "set", "get", "miss", "next"))
+for _, kind in ipairs({"string", "int", "table"}) do
+  for _, n in ipairs({4, 16, 100, 1000, 10000, 100000, 1000000}) do
+    bench(kind, n)
+  end
+end
+print(string.format("%-7s %8.1f KB", "memory", collectgarbage("count")))
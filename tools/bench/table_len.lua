@@ -0,0 +1,43 @@
+-- 长度运算符的基准测试
+-- 用法: lua tools/bench/table_len.lua [倍数]
+-- 对不同大小的表计时t[#t+1] = v追加（append）、t[#t] = nil弹出（pop）
+-- 以及不变的表上反复求#t（len）。追加时末尾的元素有一部分在哈希部分，
+-- 弹出时数组部分不满，原来每次#t都要二分搜索。
+
+local scale = tonumber(arg and arg[1]) or 1
+local TOTAL = 4000000 * scale
+
+local function bench(n)
+  local rounds = math.max(1, math.floor(TOTAL / n))
+  local t
+
+  collectgarbage()
+  local t0 = os.clock()
+  for _ = 1, rounds do
+    t = {}
+    for i = 1, n do t[#t + 1] = i end
+  end
+  local tappend = os.clock() - t0
+
+  t0 = os.clock()
+  local s = 0
+  for _ = 1, rounds do
+    for i = 1, n do s = s + #t end
+  end
+  local tlen = os.clock() - t0
+
+  t0 = os.clock()
+  for _ = 1, rounds do
+    for _ = 1, n do t[#t] = nil end
+    for i = 1, n do t[i] = i end
+  end
+  local tpop = os.clock() - t0
+  assert(#t == n and s == n * n * rounds)
+
+  print(string.format("%8d %8.3f %8.3f %8.3f", n, tappend, tpop, tlen))
+end
+
+print(string.format("%8s %8s %8s %8s", "size", "append", "pop", "len"))
+for _, n in ipairs({10, 100, 1000, 10000, 100000, 1000000}) do
+  bench(n)
+end
@@ -0,0 +1,41 @@
+-- 大表重哈希停顿的基准测试
+-- 用法: lua tools/bench/table_rehash.lua [键数]
+-- 向一个表逐个插入字符串键，记录单次插入的最长耗时（max）和超过1ms
+-- 的插入次数（>1ms），以及插入和随后一遍查找的总时间。单次插入的最长
+-- 耗时就是重哈希的停顿。用于比较一次完成的重哈希与增量重哈希的构建
+-- （-DLUA_USE_INCREHASH）。计时期间停止垃圾回收，避免回收步骤混入。
+
+local N = tonumber(arg and arg[1]) or 2000000
+local clock = os.clock
+
+local keys = {}
+for i = 1, N do keys[i] = "session" .. i end
+collectgarbage()
+collectgarbage("stop")
+
+print(string.format("%10s %10s %8s %8s %8s", "keys", "max(ms)", ">1ms",
+                    "set(s)", "get(s)"))
+local t = {}
+local worst, slow = 0, 0
+local report = 1024
+local tstart = clock()
+for i = 1, N do
+  local t0 = clock()
+  t[keys[i]] = i
+  local d = clock() - t0
+  if d > worst then worst = d end
+  if d > 0.001 then slow = slow + 1 end
+  if i == report or i == N then
+    local tset = clock() - tstart
+    local s = 0
+    local t1 = clock()
+    for j = 1, i do s = s + t[keys[j]] end
+    local tget = clock() - t1
+    assert(s == i * (i + 1) / 2)
+    print(string.format("%10d %10.2f %8d %8.3f %8.3f", i, worst * 1000,
+                        slow, tset, tget))
+    report = report * 4
+    tstart = tstart + (clock() - t1)    -- 查找的时间不计入插入
+  end
+end
+collectgarbage("restart")
@@ -0,0 +1,58 @@
+-- 表的预分配与复用的基准测试
+-- 用法: lua tools/bench/table_reuse.lua [倍数]
+-- 模拟每个请求填一个临时表：每次新建表（fresh）、table.new预先分配
+-- （presized）、同一个表用table.clear清空后复用（clear）。另外比较逐个
+-- 元素复制一段数组（loop）与table.move（move）。计时包含垃圾回收。
+
+local scale = tonumber(arg and arg[1]) or 1
+local TOTAL = 4000000 * scale
+
+local function fill(t, n)
+  for i = 1, n do t[i] = i end
+  t.id, t.method, t.path = n, "GET", "/"
+end
+
+local function bench(n)
+  local rounds = math.max(1, math.floor(TOTAL / n))
+
+  collectgarbage()
+  local t0 = os.clock()
+  for _ = 1, rounds do fill({}, n) end
+  local tfresh = os.clock() - t0
+
+  collectgarbage()
+  t0 = os.clock()
+  for _ = 1, rounds do fill(table.new(n, 3), n) end
+  local tnew = os.clock() - t0
+
+  collectgarbage()
+  t0 = os.clock()
+  local t = {}
+  for _ = 1, rounds do
+    table.clear(t)
+    fill(t, n)
+  end
+  local tclear = os.clock() - t0
+
+  local src, dst = {}, {}
+  fill(src, n)
+  fill(dst, n)
+  t0 = os.clock()
+  for _ = 1, rounds do
+    for i = 1, n do dst[i] = src[i] end
+  end
+  local tloop = os.clock() - t0
+
+  t0 = os.clock()
+  for _ = 1, rounds do table.move(src, 1, n, 1, dst) end
+  local tmove = os.clock() - t0
+
+  print(string.format("%8d %8.3f %8.3f %8.3f %8.3f %8.3f", n, tfresh, tnew,
+                      tclear, tloop, tmove))
+end
+
+print(string.format("%8s %8s %8s %8s %8s %8s", "size", "fresh", "presized",
+                    "clear", "loop", "move"))
+for _, n in ipairs({4, 16, 100, 1000, 10000}) do
+  bench(n)
+end
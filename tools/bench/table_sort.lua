@@ -0,0 +1,72 @@
+-- table.sort的基准测试
+-- 用法: lua tools/bench/table_sort.lua [倍数]
+-- 对不同大小的数组计时：随机整数（int）、随机浮点数（float）、随机字符串
+-- （string）用默认比较，随机整数用比较函数（cmp），以及已经有序
+-- （sorted）和针对三数取中的对抗输入（killer）。前三列走数组部分的快速
+-- 路径，后面几列逐个元素比较。每种情况都重复排序新复制的数组。
+
+local scale = tonumber(arg and arg[1]) or 1
+local TOTAL = 2000000 * scale
+
+local seed = 4711
+local function rand(n)
+  seed = (seed * 1103515245 + 12345) % 2147483648
+  return seed % n + 1
+end
+
+local gens = {
+  int = function(n) local a = {} for i = 1, n do a[i] = rand(n) end return a end,
+  float = function(n)
+    local a = {}
+    for i = 1, n do a[i] = rand(n) / 7 end
+    return a
+  end,
+  string = function(n)
+    local a = {}
+    for i = 1, n do a[i] = "key" .. rand(n) end
+    return a
+  end,
+  sorted = function(n) local a = {} for i = 1, n do a[i] = i end return a end,
+  killer = function(n)
+    local a, k = {}, math.floor(n / 2)
+    for i = 1, k do
+      if i % 2 == 1 then a[i] = i else a[i] = k + i - 1 end
+      a[k + i] = 2 * i
+    end
+    if n % 2 == 1 then a[n] = n end
+    return a
+  end,
+}
+
+local function cmp(x, y) return x < y end
+
+local function run(orig, n, rounds, f)
+  local a = {}
+  local t = 0
+  for _ = 1, rounds do
+    for i = 1, n do a[i] = orig[i] end
+    local t0 = os.clock()
+    table.sort(a, f)
+    t = t + os.clock() - t0
+  end
+  return t
+end
+
+local function bench(n)
+  local rounds = math.max(1, math.floor(TOTAL / n))
+  local cols = {}
+  cols[1] = run(gens.int(n), n, rounds)
+  cols[2] = run(gens.float(n), n, rounds)
+  cols[3] = run(gens.string(n), n, rounds)
+  cols[4] = run(gens.int(n), n, rounds, cmp)
+  cols[5] = run(gens.sorted(n), n, rounds)
+  cols[6] = run(gens.killer(n), n, rounds)
+  print(string.format("%8d %8.3f %8.3f %8.3f %8.3f %8.3f %8.3f", n,
+                      cols[1], cols[2], cols[3], cols[4], cols[5], cols[6]))
+end
+
+print(string.format("%8s %8s %8s %8s %8s %8s %8s", "size", "int", "float",
+                    "string", "cmp", "sorted", "killer"))
+for _, n in ipairs({10, 100, 1000, 10000, 100000}) do
+  bench(n)
+end
@@ -0,0 +1,44 @@
+-- TValue大小相关的基准测试
+-- 用法: lua tools/bench/tvalue_mem.lua [倍数]
+-- 负载以内存带宽和GC遍历为主：大数组和大哈希表的顺序/随机访问、
+-- 字符串键表遍历、完整垃圾回收。最后一行打印建表后的内存占用。
+-- 用于比较默认布局与NaN装箱（-DLUA_USE_NANBOX）的构建。
+
+local scale = tonumber(arg and arg[1]) or 1
+local bench = dofile((arg[0]:gsub("[^/\\]*$", "")) .. "common.lua").bench(scale)
+
+local N = 2000000 * scale
+local arr, hash = {}, {}
+for i = 1, N do arr[i] = i * 0.5 end
+for i = 1, N do hash["k" .. i % 200000 .. "_" .. i] = i end
+
+bench("array-seq", function(n)
+  local s = 0
+  for _ = 1, n do
+    for i = 1, N do s = s + arr[i] end
+  end
+  return s
+end, 10)
+
+bench("array-rand", function(n)
+  local s, j = 0, 1
+  for _ = 1, n do
+    j = (j * 1103515245 + 12345) % 2147483648
+    s = s + arr[j % N + 1]
+  end
+  return s
+end, 10000000)
+
+bench("hash-next", function(n)
+  local s = 0
+  for _ = 1, n do
+    for _, v in pairs(hash) do s = s + v end
+  end
+  return s
+end, 5)
+
+bench("full-gc", function(n)
+  for _ = 1, n do collectgarbage() end
+end, 10)
+
+print(string.format("%-12s %8.1f KB", "memory", collectgarbage("count")))
@@ -0,0 +1,63 @@
+-- 虚拟机指令分发基准测试
+-- 用法: lua tools/bench/vm_dispatch.lua [倍数]
+-- 覆盖常见脚本的指令组合：数值循环、表字段读写、方法调用、闭包与上值、
+-- 字符串拼接、条件分支。分别比较switch分发与跳转表分发构建的耗时。
+
+local scale = tonumber(arg and arg[1]) or 1
+local bench = dofile((arg[0]:gsub("[^/\\]*$", "")) .. "common.lua").bench(scale)
+
+bench("arith", function(n)
+  local x, y = 0, 1.5
+  for i = 1, n do x = x + i * y - (i % 7) / 3 end
+  return x
+end, 20000000)
+
+bench("fields", function(n)
+  local p = {x = 1, y = 2, z = 3}
+  for i = 1, n do p.x = p.y + p.z; p.y = p.x - i; p.z = p.x end
+  return p
+end, 10000000)
+
+bench("methods", function(n)
+  local Point = {}
+  Point.__index = Point
+  function Point:move(dx) self.x = self.x + dx return self end
+  function Point:get() return self.x end
+  local p = setmetatable({x = 0}, Point)
+  for i = 1, n do p:move(1); if p:get() < 0 then break end end
+  return p
+end, 5000000)
+
+bench("closures", function(n)
+  local function counter()
+    local c = 0
+    return function() c = c + 1 return c end
+  end
+  local f = counter()
+  for i = 1, n do f() end
+  return f()
+end, 10000000)
+
+bench("branches", function(n)
+  local a, b, c = 0, 0, 0
+  for i = 1, n do
+    if i % 3 == 0 then a = a + 1 elseif i % 3 == 1 then b = b + 1 else c = c + 1 end
+  end
+  return a + b + c
+end, 10000000)
+
+bench("arrays", function(n)
+  local t = {}
+  for i = 1, 1000 do t[i] = i end
+  local s = 0
+  for j = 1, n / 1000 do
+    for i = 1, #t do s = s + t[i] end
+  end
+  return s
+end, 20000000)
+
+bench("strings", function(n)
+  local s
+  for i = 1, n do s = "k" .. (i % 100) end
+  return s
+end, 2000000)
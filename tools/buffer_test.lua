@@ -0,0 +1,91 @@
+-- luaL_Buffer（可增长的存储区）的测试
+-- 用法: lua tools/buffer_test.lua
+-- 通过使用luaL_Buffer的库函数检查：结果跨过LUAL_BUFFERSIZE和多次扩容、
+-- luaL_addvalue在存储区已在栈上时加入长短不同的值、替换函数和__index
+-- 在构建过程中使用栈和触发回收、构建中途出错，以及io.read读入大文件。
+-- 默认构建和定义了LUA_USE_GROWBUFFER的构建都应通过。
+
+local seed = 5
+local function rnd(n)
+  seed = seed * 16807 % 2147483647
+  return seed % n + 1
+end
+
+-- table.concat：各种长度的片段，含很长的片段
+for _, n in ipairs({0, 1, 10, 1000, 100000}) do
+  local t, len = {}, 0
+  for i = 1, n do
+    local k = rnd(10) == 1 and rnd(20000) or rnd(20)
+    t[i] = string.rep(string.char(97 + i % 26), k)
+    len = len + k
+  end
+  local s = table.concat(t, ",")
+  assert(#s == len + math.max(n - 1, 0))
+  local j = 1
+  for i = 1, n do
+    assert(s:sub(j, j + #t[i] - 1) == t[i])
+    j = j + #t[i] + 1
+  end
+end
+
+-- gsub：替换函数的结果长短不一，期间进行完整回收
+do
+  local src = string.rep("abc", 50000)
+  local calls = 0
+  local r = string.gsub(src, "b", function()
+    calls = calls + 1
+    if calls % 5000 == 0 then collectgarbage() end
+    return calls % 100 == 0 and string.rep("X", 9000) or "B"
+  end)
+  assert(calls == 50000)
+  assert(#r == 50000 * 3 + 500 * 8999)
+  assert(r:sub(1, 6) == "aBcaBc")
+  local t = setmetatable({}, {__index = function(_, k) return k:upper() end})
+  assert(string.gsub(string.rep("xy ", 10000), "%w+", t) == string.rep("XY ", 10000))
+end
+
+-- string.format：超过LUAL_BUFFERSIZE的%s和大量小片段
+do
+  local big = string.rep("z", 100000)
+  local s = string.format("<%s|%d|%s>", big, 42, big)
+  assert(#s == 200000 + 6 and s:find("|42|", 1, true) == 100002)
+  local parts = {}
+  for i = 1, 3000 do parts[i] = "%d" end
+  local args = {}
+  for i = 1, 3000 do args[i] = i end
+  local f = string.format(table.concat(parts, " "), unpack(args))
+  assert(f == table.concat(args, " "))
+end
+
+-- 构建中途出错：存储区随栈回收，之后的调用不受影响
+for _ = 1, 10 do
+  local ok = pcall(string.gsub, string.rep("a", 100000), "a", function(c)
+    if rnd(50000) == 1 then error("stop") end
+    return c .. c
+  end)
+  local _ = ok
+  assert(pcall(table.concat, {1, 2, {}}) == false)
+  assert(#table.concat({string.rep("q", 20000), "w"}) == 20001)
+end
+
+-- io.read
+do
+  local name = os.tmpname()
+  local f = assert(io.open(name, "wb"))
+  local line = string.rep("0123456789", 2000)
+  for i = 1, 50 do f:write(line, i, "\n") end
+  f:close()
+  f = assert(io.open(name, "rb"))
+  local all = f:read("*a")
+  f:close()
+  assert(#all == 50 * (20000 + 1) + 9 + 41 * 2)
+  f = assert(io.open(name, "rb"))
+  for i = 1, 50 do assert(f:read("*l") == line .. i) end
+  f:close()
+  f = assert(io.open(name, "rb"))
+  assert(f:read(30000) == all:sub(1, 30000))
+  f:close()
+  os.remove(name)
+end
+
+print("ok")
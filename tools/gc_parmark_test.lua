@@ -0,0 +1,195 @@
+-- 并行标记的差分压力测试
+-- 用法: lua tools/gc_parmark_test.lua [轮数] [辅助线程数]
+-- 需要以-DLUA_USE_PARMARK构建。同一个确定性的随机对象图分别在三个
+-- 新的进程里运行：串行标记（collectgarbage("parmark", 0)）、换一种回收
+-- 节奏的串行标记（对照），以及并行标记。每轮丢掉根之后反复完整回收，
+-- 直到存活对象、弱表条目和已执行的终结器都不再变化，再记录这些集合
+-- （排序后）。三遍的记录必须完全相同。增量模式和分代模式各比较一次。
+-- 对象图包含表、闭包（开放和关闭的上值）、挂起的协程、带终结器的用户
+-- 数据（部分会复活）以及弱键/弱值表。
+-- 只回收一次是不够的：弱键表的值是强引用，键已经死亡的条目组成的链
+-- 每次完整回收只断开一环，剩下多少取决于之前增量周期的时机和堆布局。
+-- 对照遍检查记录确实与回收时机无关。
+
+local rounds = tonumber(arg and arg[1]) or 20
+local helpers = tonumber(arg and arg[2]) or 4
+
+local function run(mode, nhelpers, stepmul)
+  collectgarbage("setstepmul", stepmul)
+  collectgarbage(mode)
+  collectgarbage("parmark", nhelpers)
+
+  local seed = 42
+  local function rand(n)
+    seed = (seed * 1103515245 + 12345) % 2147483648
+    return seed % n + 1
+  end
+
+  local track = setmetatable({}, {__mode = "v"})   -- 编号 -> 对象
+  local idof = setmetatable({}, {__mode = "k"})    -- 对象 -> 编号
+  local nextid = 0
+  local roots, weaks, finalized, revived, log = {}, {}, {}, {}, {}
+  local pool, npool
+
+  local function reg(o)
+    nextid = nextid + 1
+    track[nextid] = o
+    idof[o] = nextid
+    npool = npool + 1
+    pool[npool] = o
+    return o
+  end
+
+  local function any()
+    if npool == 0 then return nil end
+    return pool[rand(npool)]
+  end
+
+  local function gc(u)
+    local id = getmetatable(u).id
+    finalized[#finalized + 1] = id
+    if id % 7 == 0 then revived[id] = u end    -- 复活
+  end
+
+  local makers = {
+    function()    -- 表：数组部分、字符串键和对象键
+      local t = reg({})
+      for i = 1, rand(8) do t[i] = any() end
+      t["k" .. rand(50)] = any()
+      local k = any()
+      if k then t[k] = rand(100) end
+    end,
+    function()    -- 关闭的上值
+      local a, b = any(), any()
+      reg(function() return a, b end)
+    end,
+    function()    -- 挂起的协程：栈上的局部变量和开放的上值
+      local co = coroutine.create(function(x, y)
+        local keep = {x}
+        local f = function() return y, keep end
+        coroutine.yield(f)
+        return x, f
+      end)
+      reg(co)
+      local ok, f = coroutine.resume(co, any(), any())
+      assert(ok)
+      if rand(2) == 1 then reg(f) end
+    end,
+    function()    -- 带终结器的用户数据
+      local u = newproxy(true)
+      local mt = getmetatable(u)
+      mt.__gc = gc
+      mt.ref = any()
+      reg(u)
+      mt.id = idof[u]
+    end,
+    function()    -- 弱表
+      local mode = rand(3) == 1 and "k" or (rand(2) == 1 and "v" or "kv")
+      local w = reg(setmetatable({}, {__mode = mode}))
+      for _ = 1, rand(6) do
+        local k, v = any(), any()
+        if k then w[k] = v or true end
+      end
+      weaks[#weaks + 1] = w
+    end,
+  }
+
+  for r = 1, rounds do
+    pool, npool = {}, 0
+    for _ = 1, 20000 do
+      makers[rand(#makers)]()
+    end
+    -- 先结束进行中的周期，让下面的对象在两次回收之间一起变为不可达，
+    -- 这样终结器复活的对象与回收时机无关
+    collectgarbage()
+    for i = 1, 64 do roots[i] = any() end
+    for i = 1, 16 do
+      local w = weaks[rand(#weaks)]
+      if w then roots[64 + i] = w end
+    end
+    pool = nil
+    weaks = {}
+    if r % 4 == 0 then revived = {} end
+    local last, same = nil, 0
+    repeat
+      collectgarbage()
+      local n, nweak = 0, 0
+      for _ in pairs(track) do n = n + 1 end
+      for i = 65, 80 do
+        if roots[i] then
+          for _ in pairs(roots[i]) do nweak = nweak + 1 end
+        end
+      end
+      local sig = n .. " " .. nweak .. " " .. #finalized
+      same = (sig == last) and same + 1 or 0
+      last = sig
+    until same == 2    -- 连续两次完整回收没有变化
+
+    local alive = {}
+    for id = 1, nextid do
+      if track[id] ~= nil then alive[#alive + 1] = id end
+    end
+    log[#log + 1] = "round " .. r .. " alive " .. table.concat(alive, ",")
+    for i = 65, 80 do
+      local w = roots[i]
+      if w then
+        local ids = {}
+        for k, v in pairs(w) do
+          ids[#ids + 1] = (idof[k] or 0) .. ":" .. (idof[v] or 0)
+        end
+        table.sort(ids)
+        log[#log + 1] = "weak " .. i .. " " .. table.concat(ids, ",")
+      end
+    end
+    table.sort(finalized)
+    log[#log + 1] = "finalized " .. table.concat(finalized, ",")
+  end
+  return log
+end
+
+-- 子进程：lua gc_parmark_test.lua 轮数 辅助线程数 模式 步进倍数
+if arg[3] then
+  io.write(table.concat(run(arg[3], helpers, tonumber(arg[4])), "\n"), "\n")
+  return
+end
+
+collectgarbage("parmark", 1)
+if collectgarbage("parmark", -1) ~= 1 then
+  print("parallel marking not enabled (build with -DLUA_USE_PARMARK)")
+  return
+end
+
+-- 给shell的单引号引用：内部的'写成'\''
+local function shquote(s)
+  return "'" .. s:gsub("'", "'\\''") .. "'"
+end
+
+local lua = arg[-1] or "lua"
+local function pass(mode, nhelpers, stepmul)
+  local f = assert(io.popen(string.format("%s %s %d %d %s %d", shquote(lua),
+                                          shquote(arg[0]), rounds, nhelpers,
+                                          mode, stepmul)))
+  local log = {}
+  for line in f:lines() do log[#log + 1] = line end
+  f:close()
+  return log
+end
+
+local function compare(mode, what, a, b)
+  for i = 1, math.max(#a, #b) do
+    if a[i] ~= b[i] then
+      print(mode .. ": " .. what .. " MISMATCH at record " .. i)
+      print("serial: " .. string.sub(a[i] or "(none)", 1, 200))
+      print(what .. ": " .. string.sub(b[i] or "(none)", 1, 200))
+      os.exit(1)
+    end
+  end
+end
+
+for _, mode in ipairs({"incremental", "generational"}) do
+  local serial = pass(mode, 0, 200)
+  assert(#serial >= rounds * 2, mode .. ": child failed")
+  compare(mode, "control", serial, pass(mode, 0, 1000))
+  compare(mode, "parallel", serial, pass(mode, helpers, 200))
+  print(mode .. ": ok " .. #serial .. " records")
+end
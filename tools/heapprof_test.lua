@@ -0,0 +1,56 @@
+-- 堆分析器测试
+-- 用法: lua tools/heapprof_test.lua [采样间隔]
+-- 一个函数不断往全局表里塞对象（模拟泄漏），另一个函数只产生临时
+-- 对象。检查存活报告中泄漏函数占绝大部分，临时对象的调用点几乎不
+-- 出现；释放泄漏的对象并完整回收后，存活报告随之下降。最后检查累计
+-- 分配报告同时包含两个调用点，以及关闭分析器后报告为空。
+
+local interval = tonumber(arg and arg[1]) or 4096
+
+local function total(report, pat)
+  local sum = 0
+  for stack, bytes in string.gmatch(report, "([^\n]*) (%d+)\n") do
+    if not pat or string.find(stack, pat, 1, true) then
+      sum = sum + tonumber(bytes)
+    end
+  end
+  return sum
+end
+
+local leaked = {}
+local function leaky(n)
+  for i = 1, n do leaked[#leaked + 1] = {i, "leak" .. i, {}} end
+end
+local function churn(n)
+  local s = 0
+  for i = 1, n do local t = {i, "tmp" .. i}; s = s + #t end
+  return s
+end
+
+collectgarbage()
+assert(collectgarbage("heapprof", interval) == 0)
+assert(collectgarbage("heapprof", -1) == interval)
+leaky(50000)
+churn(200000)
+collectgarbage()
+
+local live = debug.heapdump()
+local all, leak, tmp = total(live), total(live, "leaky@"), total(live, "churn@")
+print(string.format("live %d KB, leaky %d KB, churn %d KB",
+                    all / 1024, leak / 1024, tmp / 1024))
+assert(leak > all / 2, "leaking call site does not dominate")
+assert(tmp < leak / 20, "temporaries reported as live")
+
+local alloc = debug.heapdump("alloc")
+assert(total(alloc, "leaky@") > 0 and total(alloc, "churn@") > 0)
+assert(total(alloc) >= all)
+
+leaked = {}
+collectgarbage()
+local after = total(debug.heapdump(), "leaky@")
+print(string.format("after free: leaky %d KB", after / 1024))
+assert(after < leak / 20, "freed objects still reported as live")
+
+assert(collectgarbage("heapprof", 0) == interval)
+assert(debug.heapdump() == "")
+print("ok")
@@ -0,0 +1,253 @@
+-- JIT差分测试脚本
+-- 用法: tools/jit_difftest.sh lua可执行文件（分别以-joff和-jhot=1运行本脚本并比较输出）
+-- 输出必须是确定性的：不打印地址、时间和表遍历顺序。每个用例覆盖一组
+-- 指令模板的快速路径和回退路径（元方法、类型错误、NaN、钩子）。
+
+local out = {}
+local function emit(...)
+  local t = {...}
+  for i = 1, select("#", ...) do t[i] = tostring(t[i]) end
+  out[#out + 1] = table.concat(t, " ")
+end
+
+-- 数字算术快速路径与字符串/元方法回退
+local function arith(a, b)
+  return a + b, a - b, a * b, a / b, a % b, a ^ b, -a
+end
+emit(arith(7, 2))
+emit(arith(-7.5, 0.5))
+emit(arith("10", 4))
+emit(1 / 0, -1 / 0, 0 / 0 ~= 0 / 0)
+local V = {}
+V.__index = V
+V.__add = function(x, y) return setmetatable({v = x.v + y.v}, V) end
+V.__sub = function(x, y) return setmetatable({v = x.v - y.v}, V) end
+V.__unm = function(x) return setmetatable({v = -x.v}, V) end
+V.__eq = function(x, y) return x.v == y.v end
+V.__lt = function(x, y) return x.v < y.v end
+V.__le = function(x, y) return x.v <= y.v end
+V.__concat = function(x, y) return "V" .. (type(x) == "table" and x.v or x) end
+local function vec(v) return setmetatable({v = v}, V) end
+local p, q = vec(3), vec(5)
+emit((p + q).v, (p - q).v, (-p).v, p == vec(3), p ~= q, p < q, q <= p, p .. "x")
+
+-- 比较与条件跳转（包括NaN）
+local nan = 0 / 0
+local function cmp(a, b)
+  local r = {}
+  if a < b then r[#r + 1] = "lt" end
+  if a <= b then r[#r + 1] = "le" end
+  if a == b then r[#r + 1] = "eq" end
+  if not (a < b) then r[#r + 1] = "nlt" end
+  if not (a <= b) then r[#r + 1] = "nle" end
+  if a ~= b then r[#r + 1] = "ne" end
+  return table.concat(r, ",")
+end
+local function cmpk(a)
+  return a < 2, a <= 2, a == 2, 2 < a, a ~= "2"
+end
+emit(cmp(1, 2), cmp(2, 1), cmp(2, 2), cmp(nan, 1), cmp(1, nan), cmp(nan, nan))
+emit(cmpk(1), cmpk(2), cmpk(nan))
+emit(cmp("a", "b"), cmp("b", "a"), pcall(cmp, 1, "x"))
+
+-- TEST/TESTSET
+local function logic(a, b)
+  local x = a and b
+  local y = a or b
+  local z = not a
+  if a then z = 1 elseif b then z = 2 end
+  return x, y, z
+end
+emit(logic(nil, 1))
+emit(logic(false, nil))
+emit(logic(0, false))
+emit(logic(true, "s"))
+
+-- 数值for：正负步长、浮点步长、NaN边界、零次迭代
+local function loops()
+  local r = {}
+  for i = 1, 5 do r[#r + 1] = i end
+  for i = 5, 1, -2 do r[#r + 1] = i end
+  for i = 0, 1, 0.25 do r[#r + 1] = i end
+  for i = 1, 0 do r[#r + 1] = "never" end
+  for i = 1, nan do r[#r + 1] = "nan" end
+  for i = nan, 1 do r[#r + 1] = "nan2" end
+  local s = 0
+  for i = 1, 100000 do s = s + i % 3 end
+  r[#r + 1] = s
+  return table.concat(r, " ")
+end
+emit(loops())
+emit(pcall(function() for i = 1, "x" do end end))
+emit(pcall(function() for i = {}, 1 do end end))
+
+-- while/repeat与break
+local function wr(n)
+  local a, b = 0, 0
+  while a < n do a = a + 1; if a == 7 then break end end
+  repeat b = b + 2 until b >= n
+  return a, b
+end
+emit(wr(5), wr(20))
+
+-- 泛型for
+local function gen()
+  local t = {10, 20, 30, nil, 50}
+  local s = 0
+  for i, v in ipairs(t) do s = s + i * v end
+  local keys = {}
+  for k in pairs({a = 1, b = 2, c = 3}) do keys[#keys + 1] = k end
+  table.sort(keys)
+  local function range(n)
+    return function(_, i) if i < n then return i + 1 end end, nil, 0
+  end
+  local c = 0
+  for i in range(10) do c = c + i end
+  return s, table.concat(keys), c
+end
+emit(gen())
+
+-- 表：构造、SETLIST（含多返回值）、字段、数组、__index/__newindex、长度
+local function three() return 1, 2, 3 end
+local function tables()
+  local t = {1, 2, 3, three()}
+  local u = {three(), three()}
+  local big = {}
+  for i = 1, 60 do big[i] = i end
+  local c = {unpack(big)}
+  local o = {x = 1, y = {z = 2}}
+  o.x = o.x + o.y.z
+  o.w = 5
+  local log = {}
+  local prox = setmetatable({}, {
+    __index = function(_, k) return k .. "!" end,
+    __newindex = function(_, k, v) log[#log + 1] = k .. "=" .. v end})
+  prox.a = 1
+  prox[1] = 2
+  return #t, #u, #c, c[60], o.x, o.w, prox.foo, prox[3], table.concat(log, ";"),
+         #"hello", #{n = 1}
+end
+emit(tables())
+emit(pcall(function() local x; return x.y end))
+emit(pcall(function() return #nil end))
+emit(pcall(function() return {} .. "" end))
+
+-- 上值、闭包、CLOSE
+local function closures()
+  local fs = {}
+  for i = 1, 3 do
+    local j = i * 10
+    fs[i] = function(d) j = j + d; return i, j end
+  end
+  local acc = 0
+  local function add(n) acc = acc + n return acc end
+  add(1); add(2)
+  return fs[1](1), fs[2](2), fs[3](3), fs[1](1), acc
+end
+emit(closures())
+
+-- 可变参数
+local function va(...)
+  local a, b = ...
+  local t = {...}
+  local n = select("#", ...)
+  return n, a, b, #t, ...
+end
+emit(va())
+emit(va(1))
+emit(va(1, nil, 3))
+
+-- 全局变量
+gx = 1
+local function globals()
+  for i = 1, 10 do gx = gx + i end
+  return gx, type(gy)
+end
+emit(globals())
+
+-- 连接
+local function cat(n)
+  local s = ""
+  for i = 1, n do s = s .. i .. "," end
+  return s .. 1.5 .. "|" .. n
+end
+emit(cat(12))
+
+-- 调用、尾调用、递归、方法
+local function fib(n) if n < 2 then return n end return fib(n - 1) + fib(n - 2) end
+local function tail(n, a) if n == 0 then return a end return tail(n - 1, a + n) end
+local Obj = {}
+Obj.__index = Obj
+function Obj:inc(d) self.n = self.n + (d or 1) return self end
+local o = setmetatable({n = 0}, Obj)
+for i = 1, 100 do o:inc(i % 3) end
+emit(fib(20), tail(10000, 0), o:inc():inc(5).n)
+
+-- 错误信息中的行号
+local function where()
+  local ok, msg = pcall(function()
+    local t = nil
+    local x = 1
+    return t.field + x
+  end)
+  return msg
+end
+emit(where())
+
+-- 协程
+local co = coroutine.wrap(function(a)
+  local s = a
+  for i = 1, 5 do s = s + coroutine.yield(s) end
+  return "done" .. s
+end)
+local r = {}
+r[#r + 1] = co(1)
+for i = 1, 5 do r[#r + 1] = co(i) end
+emit(table.concat(r, " "))
+
+-- 循环中打开行钩子和计数钩子
+local function hooked()
+  local lines, counts = 0, 0
+  local s = 0
+  for i = 1, 2000 do
+    s = s + i
+    if i == 1000 then debug.sethook(function() lines = lines + 1 end, "l") end
+  end
+  debug.sethook()
+  for i = 1, 1000 do
+    s = s - 1
+    if i == 500 then debug.sethook(function() counts = counts + 1 end, "", 100) end
+  end
+  debug.sethook()
+  return s, lines, counts
+end
+emit(hooked())
+
+-- 元方法中打开钩子
+local function hookinmeta()
+  local n = 0
+  local m = setmetatable({}, {__index = function()
+    debug.sethook(function() n = n + 1 end, "l")
+    return 1
+  end})
+  local v = m.a
+  v = v + 1
+  v = v + 1
+  debug.sethook()
+  return v, n
+end
+emit(hookinmeta())
+
+-- 垃圾回收与终结器期间的执行
+local function churn()
+  local keep = {}
+  for i = 1, 20000 do
+    local t = {i, tostring(i)}
+    if i % 1000 == 0 then keep[#keep + 1] = t end
+  end
+  collectgarbage()
+  return #keep, keep[20][2]
+end
+emit(churn())
+
+for i = 1, #out do print(out[i]) end
@@ -0,0 +1,37 @@
+#!/bin/sh
+# JIT差分测试：每个脚本分别在解释器（-joff）和"首次调用即编译"（-jhot=1）
+# 两种模式下运行，比较标准输出、标准错误和退出码。
+#
+# 用法: tools/jit_difftest.sh lua可执行文件 [脚本...]
+# 默认脚本为tools/jit_difftest.lua。仓库里没有构建这个可执行文件的
+# Makefile（lua.vcxproj只用于Windows），需要自己把src/下除luac.c以外的
+# 文件以-DLUA_USE_JIT编译链接，否则两种模式都是解释执行，例如：
+#   cc -O2 -DLUA_USE_JIT -DLUA_USE_POSIX -DLUA_USE_DLOPEN -o /tmp/lua \
+#      $(ls src/*.c | grep -v luac.c) -lm -ldl -lpthread
+#   tools/jit_difftest.sh /tmp/lua
+
+if [ $# -eq 0 ]; then
+    echo "usage: $0 lua-executable [script...]" >&2
+    exit 2
+fi
+dir=$(dirname "$0")
+LUA=$1
+shift
+[ $# -eq 0 ] && set -- "$dir/jit_difftest.lua"
+
+tmp=${TMPDIR:-/tmp}/jit_difftest.$$
+trap 'rm -f "$tmp".*' EXIT
+fail=0
+for script in "$@"; do
+    "$LUA" -joff "$script" > "$tmp.ref" 2>&1
+    echo "exit $?" >> "$tmp.ref"
+    "$LUA" -jhot=1 "$script" > "$tmp.jit" 2>&1
+    echo "exit $?" >> "$tmp.jit"
+    if diff -u "$tmp.ref" "$tmp.jit"; then
+        echo "ok    $script"
+    else
+        echo "FAIL  $script"
+        fail=1
+    fi
+done
+exit $fail
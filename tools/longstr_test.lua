@@ -0,0 +1,106 @@
+-- 长字符串（不内部化）的正确性测试
+-- 用法: lua tools/longstr_test.lua
+-- 超过LUAI_MAXSHORTLEN（40）字节的字符串不进字符串表，内容相同的
+-- 长字符串可能是不同的对象。这里检查它们在相等比较、表键、next、
+-- 长标识符、常量、string.dump和各种回收模式下的行为与短字符串一致。
+
+local function long(tag, n)    -- 每次调用都拼出一个新对象
+  return tag .. string.rep("x", n or 60)
+end
+
+-- 相等比较
+do
+  local a, b = long("a"), long("a")
+  assert(a == b and rawequal(a, b) and not (a ~= b))
+  assert(a ~= long("b") and a ~= long("a", 61))
+  assert(a <= b and not (a < b))
+  local s, t = string.rep("y", 40), string.rep("y", 40)
+  assert(s == t and rawequal(s, t))
+end
+
+-- 表键：内容相同的不同对象命中同一个键
+do
+  local t = {}
+  t[long("k")] = 1
+  assert(t[long("k")] == 1 and rawget(t, long("k")) == 1)
+  t[long("k")] = 2
+  local n = 0
+  for k, v in pairs(t) do n = n + 1; assert(k == long("k") and v == 2) end
+  assert(n == 1)
+  t[long("k")] = nil
+  assert(next(t) == nil)
+  -- 大量长字符串键，触发rehash
+  for i = 1, 5000 do t[long("k" .. i)] = i end
+  for i = 1, 5000 do assert(t[long("k" .. i)] == i) end
+  -- next用内容相同的另一个对象继续遍历
+  local k = next(t)
+  local copy = string.sub(k .. "", 1)
+  assert(next(t, copy) == next(t, k))
+  -- 字段访问和方法调用
+  local o = {}
+  o[long("m")] = function() return 7 end
+  assert(o[long("m")]() == 7)
+end
+
+-- 长标识符：局部变量、上值和全局变量
+do
+  local src = [[
+    local a_very_long_local_variable_name_that_exceeds_forty_bytes = 1
+    local function f()
+      a_very_long_local_variable_name_that_exceeds_forty_bytes =
+        a_very_long_local_variable_name_that_exceeds_forty_bytes + 1
+      return a_very_long_local_variable_name_that_exceeds_forty_bytes
+    end
+    f()
+    a_very_long_global_variable_name_that_exceeds_forty_bytes = f()
+    return a_very_long_local_variable_name_that_exceeds_forty_bytes
+  ]]
+  assert(loadstring(src)() == 3)
+  assert(a_very_long_global_variable_name_that_exceeds_forty_bytes == 3)
+  assert(_G[long("a_very_long_global_variable_name_", 0) ..
+            "that_exceeds_forty_bytes"] == 3)
+end
+
+-- 代码中的长常量，以及string.dump后重新加载
+do
+  local f = function(t)
+    t["a long constant key used as a field name in this function"] = 1
+    return t["a long constant key used as a field name in this function"],
+           "a long constant key used as a field name in this function"
+  end
+  local t = {}
+  local v, k = f(t)
+  assert(v == 1 and t[k] == 1)
+  local g = loadstring(string.dump(f))
+  local t2 = {}
+  assert(g(t2) == 1 and t2[k] == 1)
+end
+
+-- 长字符串只被表键引用时不会被回收，无引用时被回收
+for _, mode in ipairs({"incremental", "generational"}) do
+  collectgarbage(mode)
+  local t = {}
+  for i = 1, 2000 do t[long("g" .. i, 200)] = i end
+  collectgarbage()
+  for i = 1, 2000 do assert(t[long("g" .. i, 200)] == i) end
+  local w = setmetatable({}, {__mode = "k"})
+  w[long("w")] = 1    -- 字符串不是弱引用
+  collectgarbage()
+  assert(w[long("w")] == 1)
+  local before = collectgarbage("count")
+  t = nil
+  collectgarbage()
+  collectgarbage()
+  assert(collectgarbage("count") < before - 200)
+end
+collectgarbage("incremental")
+
+-- 与rope的交互：压平的结果是长字符串
+do
+  local s = string.rep("r", 200)
+  for i = 1, 10 do s = s .. i end
+  local t = {[s] = true}
+  assert(t[string.rep("r", 200) .. "12345678910"])
+end
+
+print("longstr ok")
@@ -0,0 +1,202 @@
+-- 模式匹配（编译的模式和模式缓存）的测试
+-- 用法: lua tools/pattern_test.lua [轮数] > 输出
+-- 先检查若干已知结果，包括缓存淘汰、gsub的替换函数里使用大量其他模式、
+-- gmatch迭代期间的淘汰和locale切换；然后对随机生成的模式和字符串执行
+-- find、match、gmatch和gsub，每个用例打印一行结果（包括错误信息）。
+-- 随机部分用于差分：同一脚本在未使用编译模式的版本上的输出应完全相同，
+-- 例如 diff <(lua-old tools/pattern_test.lua) <(lua tools/pattern_test.lua)
+
+local rounds = tonumber(arg and arg[1]) or 3000
+
+-- 已知结果
+assert(string.find("hello world", "o w") == 5)
+assert(string.find("hello", "^h") == 1 and string.find("hello", "^e") == nil)
+assert(select(3, string.find("key = value", "(%w+)%s*=%s*(%w+)")) == "key")
+assert(string.match("  x", "^%s*()") == 3)
+assert(string.match("f(a(b)c)d", "%b()") == "(a(b)c)")
+assert(string.match("THE (quick) fox", "%f[%a]%a+", 5) == "quick")
+assert(string.match("abcabc", "(abc)%1") == "abc")
+assert(string.match("a]b", "[]]") == "]" and string.match("]]x", "[^]]") == "x")
+assert(string.match("a$b", "a$b") == "a$b" and string.match("ab", "b$") == "b")
+assert(string.gsub("abc", "", "-") == "-a-b-c-")
+assert(string.gsub("hello world", "o", "0", 1) == "hell0 world")
+assert(string.gsub("abc", "^a", "x") == "xbc")
+local words = {}
+for w in string.gmatch("one two  three", "%a+") do words[#words + 1] = w end
+assert(table.concat(words, ",") == "one,two,three")
+-- gmatch中'^'不是锚点
+local n = 0
+for _ in string.gmatch("^a^a", "^a") do n = n + 1 end
+assert(n == 2)
+assert(string.find("x^a", "^a") == nil and string.find("x^a", "%^a") == 2)
+
+-- 错误在执行到时才报告，与解释执行相同
+assert(string.find("abc", "x%") == nil)    -- 'x'处就失败了，不会读到'%'
+assert(not pcall(string.find, "xbc", "x%"))
+assert(not pcall(string.find, "abc", "[a"))
+assert(string.find("", "a[") == nil)
+assert(select(2, pcall(string.find, "a", "%b")):find("unbalanced"))
+assert(select(2, pcall(string.find, "a", "%fx")):find("missing"))
+assert(select(2, pcall(string.match, "a", "(a")):find("unfinished"))
+assert(select(2, pcall(string.match, "a", "a)")):find("invalid pattern capture"))
+assert(select(2, pcall(string.match, "a", "%1")):find("invalid capture index"))
+assert(select(2, pcall(string.match, "aa", string.rep("(a)", 40))) == nil)
+assert(select(2, pcall(string.match, string.rep("a", 40), string.rep("(a)", 33)))
+       :find("too many captures"))
+
+-- 超过缓存容量的模式，以及替换函数里使用其他模式时淘汰gsub正在用的模式
+do
+  local pats = {}
+  for i = 1, 100 do pats[i] = "k" .. i .. "=(%d+)" end
+  local s = {}
+  for i = 1, 100 do s[i] = "k" .. i .. "=" .. i * 7 end
+  s = table.concat(s, ";")
+  for r = 1, 3 do
+    for i = 1, 100 do
+      assert(tonumber(string.match(s, pats[i])) == i * 7)
+    end
+  end
+  local out, cnt = string.gsub(s, "k(%d+)=(%d+)", function(k, v)
+    for i = 1, 100 do assert(string.find(s, pats[i])) end
+    collectgarbage()
+    return v / 7 == tonumber(k) and "ok" or "bad"
+  end)
+  assert(cnt == 100 and not out:find("bad") and out:find("^ok;ok"))
+  local it, m = string.gmatch(s, "=(%d+)"), 0
+  for v in it do
+    m = m + 1
+    for i = 1, 100 do string.match(s, pats[i] .. "x?") end
+    collectgarbage()
+    assert(tonumber(v) == m * 7)
+  end
+  assert(m == 100)
+end
+
+-- 字符类与locale有关，切换locale后不能沿用旧的位图：缓存中的"%a"与
+-- 每次都是新模式的"%a()..."结果必须相同
+do
+  local old = os.setlocale(nil, "ctype")
+  local s = "x" .. string.char(170, 181, 192, 223, 233, 255)
+  local function all(p)
+    local t = {}
+    for i in string.gmatch(s, p) do t[#t + 1] = i end
+    return table.concat(t, ",")
+  end
+  local k = 0
+  for _, loc in ipairs({"C", "", "C.UTF-8", "en_US.ISO-8859-1",
+                        "de_DE.ISO-8859-1", "C"}) do
+    if os.setlocale(loc, "ctype") then
+      k = k + 1
+      local fresh = "()%a" .. string.rep("()", k)
+      assert(all("()%a") == all(fresh))
+      assert(all("()[%l%u]") == all("()[%u%l]" .. string.rep("()", k)))
+      assert(string.find(s, "%a+$") == string.find(s, fresh .. "%a*$"))
+    end
+  end
+  os.setlocale(old, "ctype")
+end
+
+-- 字面查找（普通查找和模式的字面前缀）与逐个位置比较的结果相同；
+-- 字母表很小，首末字节相同的候选位置很多
+do
+  local seed = 777
+  local function rnd(n)
+    seed = seed * 16807 % 2147483647
+    return seed % n + 1
+  end
+  local function naive(s, t, init)
+    for i = init, #s - #t + 1 do
+      if s:sub(i, i + #t - 1) == t then return i end
+    end
+    return nil
+  end
+  local function count(s, t)
+    local c, i = 0, 1
+    while true do
+      local j = naive(s, t, i)
+      if not j then return c end
+      c, i = c + 1, j + #t
+    end
+  end
+  for _ = 1, 2000 do
+    local a = {}
+    for i = 1, rnd(300) do a[i] = rnd(3) == 1 and "b" or "a" end
+    local s = table.concat(a)
+    local b = {}
+    for i = 1, rnd(40) do b[i] = rnd(3) == 1 and "b" or "a" end
+    local t = table.concat(b)
+    local init = rnd(#s + 1)
+    local e = naive(s, t, init)
+    assert(string.find(s, t, init, true) == e)
+    assert(string.find(s, t, init) == e)
+    assert(string.find(s, t .. "()", init) == e)
+    assert(select(2, string.gsub(s, t, "")) == count(s, t))
+  end
+end
+
+print("known answers ok")
+
+-- 随机差分用例
+local seed = 12345
+local function rand(n)
+  seed = seed * 16807 % 2147483647
+  return seed % n + 1
+end
+
+local atoms = {
+  "a", "b", "c", "x", ".", "%a", "%d", "%s", "%w", "%p", "%u", "%l", "%x",
+  "%c", "%z", "%%", "%.", "[abc]", "[^a-c]", "[%d_]", "[]]", "[^]]", "[a-]",
+  "[%a-z]", "%b()", "%bab", "%f[%w]", "%f[%W]", "(", ")", "()", "%1", "%2",
+  "%0", "^", "$", "%", "[", "[^", "%b", "%f", "%fa", "-", " ", "\0",
+}
+local quants = {"", "", "", "*", "+", "-", "?"}
+local chars = {"a", "b", "c", "x", "1", "2", " ", "(", ")", "_", "-", "]",
+               "^", "$", "%", "A", "\0", "\233", "\n"}
+
+local function genpat()
+  local t = {}
+  if rand(4) == 1 then t[1] = "^" end
+  for _ = 1, rand(6) do
+    t[#t + 1] = atoms[rand(#atoms)] .. quants[rand(#quants)]
+  end
+  return table.concat(t)
+end
+
+local function gensubj()
+  local t = {}
+  for i = 1, rand(12) - 1 do t[i] = chars[rand(#chars)] end
+  return table.concat(t)
+end
+
+local function show(ok, ...)
+  local t = {ok and "ok" or "err"}
+  for i = 1, select("#", ...) do
+    t[#t + 1] = string.format("%q", tostring((select(i, ...))))
+  end
+  return table.concat(t, " ")
+end
+
+local function gm(s, p)
+  local t = {}
+  for a, b in string.gmatch(s, p) do
+    t[#t + 1] = tostring(a) .. "|" .. tostring(b)
+    if #t > 20 then break end
+  end
+  return table.concat(t, ",")
+end
+
+local repl = {x = "X", ["1"] = false, ab = 7}
+local function frepl(a, b) return b and a .. b or a:upper() end
+
+for i = 1, rounds do
+  local p, s = genpat(), gensubj()
+  local init = rand(5) - 2
+  print(string.format("%d %q %q", i, p, s))
+  print("", show(pcall(string.find, s, p, init)))
+  print("", show(pcall(string.match, s, p)))
+  print("", show(pcall(gm, s, p)))
+  print("", show(pcall(string.gsub, s, p, "<%0>")))
+  print("", show(pcall(string.gsub, s, p, "%1", 2)))
+  print("", show(pcall(string.gsub, s, p, frepl)))
+  print("", show(pcall(string.gsub, s, p, repl)))
+end
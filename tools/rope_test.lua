@@ -0,0 +1,170 @@
+-- 延迟连接（rope）的正确性测试
+-- 用法: lua tools/rope_test.lua
+-- 长字符串的连接结果是rope，只活在寄存器和上值里。这里覆盖rope流出到
+-- 其他地方的各条路径：长度、比较、表键和表值、C函数参数、返回给C、
+-- 协程、调试接口、算术转换以及各种回收模式，结果与逐字拼出的参照
+-- 字符串比较。
+
+local piece = string.rep("ab", 40)
+
+local function ref(n)    -- 参照：用table.concat拼，不经过OP_CONCAT
+  local t = {}
+  for i = 1, n do t[i] = piece .. i end
+  return table.concat(t)
+end
+
+local function build(n)
+  local s = ""
+  for i = 1, n do s = s .. piece .. i end
+  return s
+end
+
+-- 基本连接、长度、比较
+for _, n in ipairs({1, 2, 3, 10, 200}) do
+  local s, r = build(n), ref(n)
+  assert(#s == #r and s == r and not (s < r) and s <= r)
+  assert(s .. "z" > r and r < s .. "z")
+  assert(string.sub(s, -3) == string.sub(r, -3))
+end
+
+-- 局部变量上的比较不经过压平的寄存器
+do
+  local s = string.rep("x", 200)
+  local a, b = s .. "1", s .. "2"
+  assert(a ~= b and a < b and #a == 201)
+  local c = s .. "1"
+  assert(a == c and rawequal(a, c))
+end
+
+-- 表键和表值
+do
+  local s = build(5)
+  local t = {}
+  t[s] = 1
+  assert(t[ref(5)] == 1)
+  t.v = s .. "!"
+  assert(t.v == ref(5) .. "!")
+  local arr = {s, s .. "1"}
+  assert(arr[2] == ref(5) .. "1")
+  rawset(t, s .. "k", 2)
+  assert(rawget(t, ref(5) .. "k") == 2)
+  for k in pairs(t) do assert(type(k) == "string") end
+end
+
+-- 上值上的累加
+do
+  local acc = ""
+  local function add(x) acc = acc .. x end
+  for i = 1, 300 do add(piece .. i) end
+  assert(acc == ref(300))
+  assert(select(2, debug.getupvalue(add, 1)) == ref(300))
+end
+
+-- C函数参数、返回给C、pcall和协程
+do
+  local s = build(20)
+  assert(type(s) == "string" and string.len(s) == #ref(20))
+  assert(select(2, pcall(function() return s .. "x" end)) == ref(20) .. "x")
+  local co = coroutine.wrap(function(a)
+    local b = a .. "y"
+    local c = coroutine.yield(b)
+    return c .. b
+  end)
+  assert(co(s) == ref(20) .. "y")
+  assert(co(s) == ref(20) .. ref(20) .. "y")
+  assert(tostring(s .. "") == ref(20))
+  assert(string.format("%s", s .. "q") == ref(20) .. "q")
+  local t = setmetatable({}, {__index = function(_, k) return k end})
+  assert(t[s .. "m"] == ref(20) .. "m")
+end
+
+-- 可变参数函数
+do
+  local function va(...) return select("#", ...), ... end
+  local s = build(4)
+  local n, a, b = va(s .. "1", s .. "2")
+  assert(n == 2 and a == ref(4) .. "1" and b == ref(4) .. "2")
+  local function va2(...) local t = {...}; return t[1] end
+  assert(va2(s .. "3") == ref(4) .. "3")
+  local function va3(...) local x = arg; return x and x[1] end
+  va3(s .. "4")
+end
+
+-- debug.getlocal
+(function()
+  local s = build(3) .. "L"
+  local name, v = debug.getlocal(1, 1)
+  assert(name == "s" and v == ref(3) .. "L")
+end)()
+
+-- 字符串方法（元表经过basetype映射到string）
+do
+  local s = build(2)
+  assert(s:sub(1, 2) == "ab" and s:len() == #ref(2))
+end
+
+-- 算术转换和数值for
+do
+  local n = string.rep("0", 200)
+  local a = n .. "7"
+  assert(a + 1 == 8 and a * 2 == 14 and -a == -7)
+  for i = a, a .. "" do assert(i == 7) end
+end
+
+-- 元方法__concat和__eq
+do
+  local mt = {__concat = function(a, b)
+    return (type(a) == "table" and "T" or a) .. (type(b) == "table" and "T" or b)
+  end}
+  local o = setmetatable({}, mt)
+  local s = string.rep("c", 150)
+  assert(s .. o == s .. "T")
+  assert(o .. s == "T" .. s)
+  local r = s .. s
+  assert(r .. o == s .. s .. "T")
+end
+
+-- 改用__concat时前面的数字操作数不能已经被转换成字符串
+do
+  local seen
+  local t = setmetatable({}, {__concat = function(a, b)
+    seen = type(a)
+    return "T"
+  end})
+  local s = string.rep("x", 200)
+  assert(s .. 1 .. t == s .. "T" and seen == "number")
+  seen = nil
+  assert("x" .. 1 .. t == "xT" and seen == "number")
+  seen = nil
+  local r = s .. s
+  assert(r .. 2.5 .. t == s .. s .. "T" and seen == "number")
+end
+
+-- 数字操作数
+do
+  local s = string.rep("d", 150)
+  local r = s .. 1 .. 2.5
+  assert(r == s .. "12.5")
+end
+
+-- 各种回收模式下的压力：大量rope作为唯一引用
+for _, mode in ipairs({"incremental", "generational"}) do
+  collectgarbage(mode)
+  local keep = {}
+  for j = 1, 50 do
+    local s = string.rep("e", 130)
+    for i = 1, 200 do
+      s = s .. i
+      if i % 50 == 0 then collectgarbage("step", 1) end
+    end
+    keep[j % 5 + 1] = s
+    collectgarbage("step", 10)
+  end
+  collectgarbage()
+  local s = string.rep("e", 130)
+  for i = 1, 200 do s = s .. i end
+  for j = 1, 5 do assert(keep[j] == s) end
+end
+collectgarbage("incremental")
+
+print("rope ok")
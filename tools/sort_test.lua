@@ -0,0 +1,199 @@
+-- table.sort的测试
+-- 用法: lua tools/sort_test.lua [轮数]
+-- 对各种输入模式（随机、有序、逆序、锯齿、全部相等、少量不同值、管风琴
+-- 形、针对三数取中的对抗输入）和大小分别用默认比较（数组部分的快速
+-- 路径）、比较函数和__lt元方法（逐个比较的路径）排序，检查结果有序并且
+-- 是原来元素的排列，同时检查比较次数不超过n log n的常数倍。另外检查
+-- 混合类型、空洞和NaN时的错误、不一致的比较函数不会越界，以及比较函数
+-- 中的错误能正常传出。
+
+local rounds = tonumber(arg and arg[1]) or 3
+
+local seed = 4711
+local function rand(n)
+  seed = (seed * 1103515245 + 12345) % 2147483648
+  return seed % n + 1
+end
+
+local patterns = {
+  random = function(n) local a = {} for i = 1, n do a[i] = rand(n) end return a end,
+  sorted = function(n) local a = {} for i = 1, n do a[i] = i end return a end,
+  reversed = function(n) local a = {} for i = 1, n do a[i] = n - i end return a end,
+  sawtooth = function(n) local a = {} for i = 1, n do a[i] = i % 37 end return a end,
+  equal = function(n) local a = {} for i = 1, n do a[i] = 7 end return a end,
+  few = function(n) local a = {} for i = 1, n do a[i] = rand(4) end return a end,
+  organ = function(n)
+    local a = {}
+    for i = 1, n do a[i] = i <= n / 2 and i or n - i end
+    return a
+  end,
+  nearly = function(n)
+    local a = {}
+    for i = 1, n do a[i] = i end
+    for _ = 1, n > 0 and 5 or 0 do
+      local i, j = rand(n), rand(n)
+      a[i], a[j] = a[j], a[i]
+    end
+    return a
+  end,
+  -- 让“中间、首、尾三数取中”每次都选到很小的枢轴
+  killer = function(n)
+    local a, k = {}, math.floor(n / 2)
+    for i = 1, k do
+      if i % 2 == 1 then a[i] = i else a[i] = k + i - 1 end
+      a[k + i] = 2 * i
+    end
+    if n % 2 == 1 then a[n] = n end
+    return a
+  end,
+}
+
+local function check(a, orig, lt, what)
+  local n = #orig
+  assert(#a == n, what .. ": length changed")
+  for i = 2, n do
+    assert(not lt(a[i], a[i - 1]), what .. ": not sorted at " .. i)
+  end
+  local count = {}
+  for i = 1, n do count[orig[i]] = (count[orig[i]] or 0) + 1 end
+  for i = 1, n do
+    local c = count[a[i]]
+    assert(c and c > 0, what .. ": not a permutation")
+    count[a[i]] = c - 1
+  end
+end
+
+local function copy(a)
+  local b = {}
+  for i = 1, #a do b[i] = a[i] end
+  return b
+end
+
+local function lt(x, y) return x < y end
+local function log2(x) return math.log(x) / math.log(2) end
+
+local boxmt = {__lt = function(x, y) return x.v < y.v end}
+local function box(a)
+  local b = {}
+  for i = 1, #a do b[i] = setmetatable({v = a[i]}, boxmt) end
+  return b
+end
+
+for _ = 1, rounds do
+  for name, gen in pairs(patterns) do
+    for _, n in ipairs({0, 1, 2, 3, 10, 23, 24, 25, 100, 129, 1000, 5000}) do
+      local orig = gen(n)
+      local what = name .. " " .. n
+
+      local a = copy(orig)
+      table.sort(a)
+      check(a, orig, lt, what .. " default")
+
+      -- 浮点数与整数混合
+      a = {}
+      for i = 1, n do a[i] = orig[i] + (i % 2) * 0.5 end
+      local o2 = copy(a)
+      table.sort(a)
+      check(a, o2, lt, what .. " float")
+
+      -- 字符串
+      a = {}
+      for i = 1, n do a[i] = string.format("%06d", orig[i]) end
+      o2 = copy(a)
+      table.sort(a)
+      check(a, o2, lt, what .. " string")
+
+      -- 比较函数（降序），统计比较次数
+      a = copy(orig)
+      local ncmp = 0
+      table.sort(a, function(x, y) ncmp = ncmp + 1; return x > y end)
+      check(a, orig, function(x, y) return x > y end, what .. " comparator")
+      local bound = 4 * (n + 1) * log2(n + 2) + 64
+      assert(ncmp <= bound, what .. ": " .. ncmp .. " comparisons")
+
+      -- __lt元方法
+      a = box(orig)
+      local b = copy(a)
+      table.sort(a)
+      check(a, b, lt, what .. " __lt")
+    end
+  end
+end
+print("patterns: ok")
+
+-- 大的对抗输入仍然是n log n
+do
+  local n = 200000
+  local a = patterns.killer(n)
+  local ncmp = 0
+  table.sort(a, function(x, y) ncmp = ncmp + 1; return x < y end)
+  for i = 2, n do assert(a[i - 1] <= a[i]) end
+  assert(ncmp < 3 * n * log2(n), "killer: " .. ncmp .. " comparisons")
+  local t0 = os.clock()
+  a = patterns.killer(n)
+  table.sort(a)
+  for i = 2, n do assert(a[i - 1] <= a[i]) end
+  assert(os.clock() - t0 < 5)
+end
+print("adversarial: ok")
+
+-- 字符串：内嵌的'\0'、前缀和不同对象的相同内容
+do
+  local a = {"b", "a\0b", "a", "a\0a", "", "\0", string.rep("x", 60),
+             string.rep("x", 59) .. "y", string.rep("x", 60)}
+  local o = copy(a)
+  table.sort(a)
+  check(a, o, lt, "embedded zeros")
+  assert(a[1] == "" and a[2] == "\0")
+end
+print("strings: ok")
+
+-- 错误：混合类型、空洞、NaN都走逐个比较的路径
+do
+  local ok, err = pcall(table.sort, {3, "a", 1})
+  assert(not ok and err:find("compare"), err)
+  ok, err = pcall(table.sort, {3, 2, {}, 1})
+  assert(not ok and err:find("compare"), err)
+  local h = {5, 4, 3, 2, 1}
+  h[3] = nil
+  ok = pcall(table.sort, h)    -- 可能报比较错误，但不能崩溃
+  local nan = {3, 0/0, 1, 2}
+  pcall(table.sort, nan)
+  ok, err = pcall(table.sort, {3, 2, 1}, function() error("boom") end)
+  assert(not ok and err:find("boom"))
+end
+print("errors: ok")
+
+-- 不一致的比较函数：报错或者返回，但不越界、不丢元素
+do
+  local cmps = {
+    function() return true end,
+    function() return false end,
+    function(x, y) return x <= y end,
+    function() return rand(2) == 1 end,
+  }
+  for _, cmp in ipairs(cmps) do
+    for _, n in ipairs({5, 50, 500, 5000}) do
+      local a = patterns.random(n)
+      local o = copy(a)
+      local ok, err = pcall(table.sort, a, cmp)
+      assert(ok or err:find("invalid order function"), err)
+      check(a, o, function() return false end, "inconsistent")
+    end
+  end
+end
+print("inconsistent comparators: ok")
+
+-- 数组部分和哈希部分混合存放的元素
+do
+  local a = {}
+  for i = 1000, 1, -1 do a[i] = i end    -- 倒序插入，大部分在哈希部分
+  table.sort(a)
+  for i = 1, 1000 do assert(a[i] == i) end
+  local b = {}
+  for i = 1, 100 do b[i] = 101 - i end
+  b[101] = 0    -- 可能在哈希部分
+  table.sort(b)
+  for i = 1, 101 do assert(b[i] == i - 1) end
+end
+print("hash part: ok")
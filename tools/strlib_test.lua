@@ -0,0 +1,122 @@
+-- string.upper、lower、reverse、rep和char的测试
+-- 用法: lua tools/strlib_test.lua
+-- 这些函数把结果直接写入luaL_buffinitsize预留的空间（不超过
+-- LUAL_BUFFERSIZE时在luaL_Buffer自带的数组中，更长时在栈上的用户数据中；
+-- 未定义LUA_USE_GROWBUFFER时由lstrlib.c的resbuffinit按同样的界限选择），
+-- C locale下的大小写转换按16字节一组处理。这里用逐字节的Lua实现作为
+-- 参照，覆盖全部256个字节值、各种长度（跨过16字节分组和LUAL_BUFFERSIZE）
+-- 和各种起始偏移。
+
+local byte, char = string.byte, string.char
+
+local function ref_map(s, f)
+  local t = {}
+  for i = 1, #s do t[i] = char(f(byte(s, i))) end
+  return table.concat(t)
+end
+
+local function lower_c(c)
+  return (c >= 65 and c <= 90) and c + 32 or c
+end
+
+local function upper_c(c)
+  return (c >= 97 and c <= 122) and c - 32 or c
+end
+
+local all = {}
+for c = 0, 255 do all[#all + 1] = char(c) end
+all = table.concat(all)
+
+local seed = 99
+local function rnd(n)
+  seed = seed * 16807 % 2147483647
+  return seed % n + 1
+end
+
+local function randstr(n)
+  local t = {}
+  for i = 1, n do t[i] = char(rnd(256) - 1) end
+  return table.concat(t)
+end
+
+local old = os.setlocale(nil, "ctype")
+assert(os.setlocale("C", "ctype"))
+
+-- 大小写
+assert(string.lower(all) == ref_map(all, lower_c))
+assert(string.upper(all) == ref_map(all, upper_c))
+for _, n in ipairs({0, 1, 15, 16, 17, 31, 32, 33, 100, 8191, 8192, 8193, 20000}) do
+  for off = 0, 3 do
+    local s = randstr(n + off):sub(off + 1)
+    assert(string.lower(s) == ref_map(s, lower_c))
+    assert(string.upper(s) == ref_map(s, upper_c))
+  end
+end
+assert(("Hello, World! 123"):upper() == "HELLO, WORLD! 123")
+assert(("Hello, World! 123"):lower() == "hello, world! 123")
+
+-- 非C locale逐字节调用C库（可用的locale因系统而异，只检查与ASCII一致）
+if os.setlocale("", "ctype") then
+  local s = "AbC xYz @[`{"
+  assert(s:lower() == "abc xyz @[`{" and s:upper() == "ABC XYZ @[`{")
+end
+assert(os.setlocale("C", "ctype"))
+
+-- 反转
+local function ref_reverse(s)
+  local t = {}
+  for i = #s, 1, -1 do t[#t + 1] = s:sub(i, i) end
+  return table.concat(t)
+end
+for _, n in ipairs({0, 1, 2, 17, 8192, 8193, 30000}) do
+  local s = randstr(n)
+  assert(string.reverse(s) == ref_reverse(s))
+  assert(string.reverse(string.reverse(s)) == s)
+end
+
+-- 重复
+local function ref_rep(s, n)
+  local r = ""
+  for _ = 1, n do r = r .. s end
+  return r
+end
+for _, s in ipairs({"", "a", "ab", "xyz\0", randstr(100), randstr(5000)}) do
+  for _, n in ipairs({-1, 0, 1, 2, 3, 7, 8, 9, 100}) do
+    local r = string.rep(s, n)
+    assert(#r == #s * math.max(n, 0) and r == ref_rep(s, n))
+  end
+end
+assert(#string.rep("abc", 1000000) == 3000000)
+assert(string.rep("abc", 1000000):sub(-4) == "cabc")
+
+-- 字节
+assert(string.char() == "")
+assert(string.char(72, 105, 0, 255) == "Hi\0\255")
+local codes = {}
+for i = 1, 7000 do codes[i] = (i * 37) % 256 end
+local s = string.char(unpack(codes))
+assert(#s == 7000)
+for i = 1, 7000 do assert(byte(s, i) == codes[i]) end
+assert(not pcall(string.char, 65, 256))
+assert(select(2, pcall(string.char, 65, -1)):find("invalid value"))
+codes[5000] = 300
+assert(not pcall(string.char, unpack(codes)))
+
+-- 从自带数组换到用户数据的界限：LUAL_BUFFERSIZE默认为BUFSIZ，
+-- 从Lua里看不到，检查常见取值两侧的长度
+for _, size in ipairs({256, 512, 1024, 4096, 8192, 16384}) do
+  for n = size - 1, size + 1 do
+    local s = randstr(n)
+    assert(string.lower(s) == ref_map(s, lower_c))
+    assert(string.upper(s) == ref_map(s, upper_c))
+    assert(string.reverse(s) == ref_reverse(s))
+    assert(string.rep(s, 2) == s .. s)
+    if n < 7000 then  -- 参数个数受LUAI_MAXCSTACK限制
+      local t = {byte(s, 1, n)}
+      assert(string.char(unpack(t)) == s)
+    end
+  end
+end
+
+os.setlocale(old, "ctype")
+print("ok")
@@ -0,0 +1,279 @@
+-- 表哈希部分的测试
+-- 用法: lua tools/table_test.lua [轮数]
+-- 用线性查找的键值数组作为参照，随机地插入、修改、删除和重新插入各种
+-- 类型的键，每批操作后比较查找结果和pairs遍历。另外检查遍历中删除
+-- 当前键、弱键表在对象地址被复用时的遍历（同一个键不能出现两次），
+-- 反复增长和清空、长度运算符的结果，以及table.new/clear/move。默认
+-- 构建和-DLUA_USE_SWISSTABLE构建都应通过。
+-- 最后的大表部分在-DLUA_USE_INCREHASH构建中会经过增量重哈希的各个
+-- 阶段：一边插入一边删除、修改、查找、遍历和回收。
+
+local rounds = tonumber(arg and arg[1]) or 20
+
+local seed = 12345
+local function rand(n)
+  seed = (seed * 1103515245 + 12345) % 2147483648
+  return seed % n + 1
+end
+
+-- 键池：各种类型，包括整数与等值的浮点数、-0和大整数
+local pool = {}
+for i = 1, 40 do pool[#pool + 1] = "s" .. i end
+for i = -5, 40 do pool[#pool + 1] = i * 3 end
+for i = 1, 10 do pool[#pool + 1] = i + 0.5 end
+pool[#pool + 1] = 2^53
+pool[#pool + 1] = -2^31
+pool[#pool + 1] = 1e300
+pool[#pool + 1] = true
+pool[#pool + 1] = false
+for _ = 1, 20 do pool[#pool + 1] = {} end
+for _ = 1, 5 do pool[#pool + 1] = function() end end
+pool[#pool + 1] = coroutine.create(function() end)
+pool[#pool + 1] = string.rep("long", 20)
+
+local function check(t, mk, mv)
+  local n = 0
+  for i = 1, #mk do
+    assert(t[mk[i]] == mv[i], "lookup mismatch")
+    if mv[i] ~= nil then n = n + 1 end
+  end
+  local seen, cnt = {}, 0
+  for k, v in pairs(t) do
+    assert(not seen[k], "key returned twice by next")
+    seen[k] = true
+    cnt = cnt + 1
+    local found = false
+    for i = 1, #mk do
+      if mk[i] == k then
+        assert(mv[i] == v, "pairs value mismatch")
+        found = true
+        break
+      end
+    end
+    assert(found, "pairs returned an unknown key")
+  end
+  assert(cnt == n, "pairs count " .. cnt .. " expected " .. n)
+end
+
+-- 随机操作与参照比较
+for r = 1, rounds do
+  local t, mk, mv = {}, {}, {}
+  for i = 1, #pool do mk[i] = pool[i] end
+  for _ = 1, 20 do
+    for _ = 1, rand(200) do
+      local i = rand(#pool)
+      local v = rand(4) ~= 1 and rand(1000) or nil
+      t[pool[i]] = v
+      mv[i] = v
+    end
+    if rand(5) == 1 then collectgarbage() end
+    check(t, mk, mv)
+  end
+  -- 清空后重新插入
+  for i = 1, #pool do t[pool[i]] = nil; mv[i] = nil end
+  check(t, mk, mv)
+  for i = 1, #pool, 2 do t[pool[i]] = i; mv[i] = i end
+  check(t, mk, mv)
+end
+print("random: ok")
+
+-- 遍历时删除当前键，每个键恰好访问一次
+for n = 1, 300, 37 do
+  local t = {}
+  for i = 1, n do t["k" .. i] = i; t[{}] = -i end
+  collectgarbage()
+  local visited = 0
+  for k, v in pairs(t) do
+    t[k] = nil
+    visited = visited + 1
+    if visited % 10 == 0 then collectgarbage() end
+  end
+  assert(visited == 2 * n, "visited " .. visited)
+  assert(next(t) == nil)
+end
+print("delete during traversal: ok")
+
+-- 弱键表：回收的键的地址会被新对象复用
+for r = 1, rounds do
+  local wk = setmetatable({}, {__mode = "k"})
+  local keep = {}
+  for i = 1, 2000 do
+    local k = {}
+    wk[k] = i
+    if i % 10 == 0 then keep[#keep + 1] = k end
+    if i % 300 == 0 then collectgarbage() end
+  end
+  collectgarbage()
+  local seen, cnt = {}, 0
+  for k in pairs(wk) do
+    assert(not seen[k], "weak key returned twice by next")
+    seen[k] = true
+    cnt = cnt + 1
+  end
+  assert(cnt == #keep, "weak table has " .. cnt .. " keys")
+end
+print("weak keys: ok")
+
+-- 反复增长和清空，穿过各个大小
+do
+  local t = {}
+  for r = 1, 6 do
+    local n = 4 ^ r
+    for i = 1, n do t[i * 1000003] = i; t["x" .. i] = i end
+    for i = 1, n do assert(t[i * 1000003] == i and t["x" .. i] == i) end
+    for i = 1, n do t[i * 1000003] = nil; t["x" .. i] = nil end
+    assert(next(t) == nil)
+  end
+  -- 长度运算符与哈希部分的边界
+  local a = {}
+  for i = 1, 100 do a[i] = i end
+  for i = 100, 1, -1 do a[i] = nil; assert(#a == i - 1 or a[#a + 1] == nil) end
+end
+print("grow and clear: ok")
+
+-- 长度：追加、弹出和随机写入之后#t都必须是边界
+do
+  local function isborder(t, n)
+    return (n == 0 or t[n] ~= nil) and t[n + 1] == nil
+  end
+  local t = {}
+  for i = 1, 1000 do
+    t[#t + 1] = i
+    assert(#t == i)
+  end
+  for i = 999, 500, -1 do
+    t[#t] = nil
+    assert(#t == i)
+  end
+  for _ = 1, 20000 do
+    local k = rand(1200)
+    if rand(3) == 1 then t[k] = nil else t[k] = k end
+    if rand(50) == 1 then collectgarbage() end
+    assert(isborder(t, #t), "#t is not a border")
+  end
+  for k = 1, 1200 do t[k] = nil end
+  assert(#t == 0)
+end
+print("length: ok")
+
+-- table.new、table.clear和table.move
+do
+  local t = table.new(100, 20)
+  assert(next(t) == nil and #t == 0)
+  for i = 1, 100 do t[i] = i end
+  for i = 1, 20 do t["k" .. i] = i end
+  setmetatable(t, {__index = function() return "mt" end})
+  table.clear(t)
+  assert(rawequal(next(t), nil) and #t == 0 and t.x == "mt")
+  for i = 1, 100 do t[i] = -i end
+  for i = 1, 20 do t["k" .. i] = -i end
+  for i = 1, 100 do assert(t[i] == -i) end
+  for i = 1, 20 do assert(t["k" .. i] == -i) end
+  assert(not pcall(table.new, -1))
+
+  -- 与逐个复制的参照比较：数组部分、哈希部分、重叠和nil
+  local function ref(a1, f, e, t, a2)
+    if t > e or t <= f or a1 ~= a2 then
+      for i = 0, e - f do a2[t + i] = a1[f + i] end
+    else
+      for i = e - f, 0, -1 do a2[t + i] = a1[f + i] end
+    end
+  end
+  local function make(n, hole)
+    local a = {}
+    for i = 1, n do a[i] = i end
+    for i = n + 1, n + 10 do a[i * 2] = {} end    -- 哈希部分的整数键
+    if hole then a[hole] = nil end
+    return a
+  end
+  for _ = 1, 300 do
+    local n = rand(40)
+    local f, e, t = rand(n + 25) - 3, rand(n + 25) - 3, rand(n + 25) - 3
+    local same = rand(2) == 1
+    local a1 = make(n, rand(n + 1))
+    local a2 = same and a1 or make(rand(40))
+    local r1 = {}
+    for k, v in pairs(a1) do r1[k] = v end
+    local r2 = r1
+    if not same then
+      r2 = {}
+      for k, v in pairs(a2) do r2[k] = v end
+    end
+    assert(table.move(a1, f, e, t, not same and a2 or nil) == a2)
+    if e >= f then ref(r1, f, e, t, r2) end
+    for k, v in pairs(r2) do assert(a2[k] == v, "move mismatch") end
+    for k, v in pairs(a2) do assert(r2[k] == v, "move extra key") end
+  end
+  assert(not pcall(table.move, {}, -2^31 + 1, 2^31 - 1, 1))
+
+  -- 整块复制新对象到已标记的表：写屏障。只用步进，完整回收会重新标记
+  for _, mode in ipairs({"incremental", "generational"}) do
+    collectgarbage(mode)
+    local dst = table.new(100, 0)
+    for i = 1, 100 do dst[i] = false end
+    for r = 1, 2000 do
+      local src = {}
+      for i = 1, 100 do src[i] = {r, i} end
+      collectgarbage("step", rand(4) - 1)
+      table.move(src, 1, 100, 1, dst)
+      src = nil
+      for _ = 1, rand(3) do collectgarbage("step", rand(8)) end
+      for i = 1, 100 do assert(dst[i][1] == r and dst[i][2] == i) end
+    end
+    table.clear(dst)
+  end
+  collectgarbage("incremental")
+end
+print("table library: ok")
+
+-- 大表：插入的同时删除、修改、查找、遍历和回收
+do
+  local N = 200000
+  local t, wk = {}, setmetatable({}, {__mode = "k"})
+  local objs = {}
+  for i = 1, N do
+    t["k" .. i] = i
+    if i % 3 == 0 then t[i * 7919 + 0.5] = -i end
+    if i % 5 == 0 then t["k" .. (i - 2)] = nil end
+    if i % 7 == 0 then t["k" .. (i - 3)] = -(i - 3) end
+    if i % 50 == 0 then
+      local o = {}
+      wk[o] = i
+      if i % 100 == 0 then objs[#objs + 1] = o end
+    end
+    if i % 4999 == 0 then
+      collectgarbage()
+      for j = i - 20, i do
+        local v = t["k" .. j]
+        assert(v == nil or v == j or v == -j, "lookup during growth")
+      end
+      local cnt = 0
+      for k, v in pairs(t) do
+        t[k] = v    -- 遍历中修改已有的键
+        cnt = cnt + 1
+      end
+      assert(cnt > 0)
+    end
+  end
+  local cnt = 0
+  for i = 1, N do
+    local v = t["k" .. i]
+    if i % 7 == 4 and i + 3 <= N then    -- 删除后又赋值的键也在这里
+      assert(v == -i, "updated key k" .. i)
+    elseif i % 5 == 3 and i + 2 <= N then
+      assert(v == nil, "deleted key k" .. i)
+    else
+      assert(v == i, "key k" .. i)
+    end
+    if v ~= nil then cnt = cnt + 1 end
+    if i % 3 == 0 then assert(t[i * 7919 + 0.5] == -i) end
+  end
+  local total = 0
+  for _ in pairs(t) do total = total + 1 end
+  assert(total == cnt + math.floor(N / 3), "pairs count " .. total)
+  collectgarbage()
+  local wcnt = 0
+  for _ in pairs(wk) do wcnt = wcnt + 1 end
+  assert(wcnt == #objs, "weak table has " .. wcnt .. " keys")
+end
+print("large tables: ok")